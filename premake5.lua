@@ -134,4 +134,110 @@ project "hexray-gpu"
 			"XCOPY %{wks.location}\\extern\\assimp\\lib\\assimp-vc143-mt.dll \"%{cfg.targetdir}\"  /S /Y",
 			"XCOPY %{wks.location}\\extern\\openexr\\lib\\*-2_5.dll \"%{cfg.targetdir}\"  /S /Y",
 			"XCOPY %{wks.location}\\extern\\zlib\\lib\\zlib1.dll \"%{cfg.targetdir}\"  /S /Y",
-		}
\ No newline at end of file
+		}
+
+project "hexray-benchmarks"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	systemversion "latest"
+	staticruntime "on"
+	characterset("ASCII")
+
+	targetdir("%{wks.location}/bin/" .. outputdir)
+	objdir("%{wks.location}/tmp/" .. outputdir .. "/%{prj.name}")
+
+	-- Benchmarks only build the platform independent sources they measure, so they run without a GPU
+	files
+	{
+		"%{wks.location}/tests/testframework.h",
+		"%{wks.location}/tests/testmain.cpp",
+		"%{wks.location}/tests/benchmarks/**.cpp",
+		"%{wks.location}/src/core/logger.cpp",
+		"%{wks.location}/src/core/timer.cpp",
+		"%{wks.location}/src/rendering/descriptorallocator.cpp",
+		"%{wks.location}/src/rendering/heightfield.cpp",
+		"%{wks.location}/src/serialization/scenetokenizer.cpp",
+	}
+
+	includedirs
+	{
+		"%{wks.location}/src",
+		"%{wks.location}/tests",
+		"%{wks.location}/extern/spdlog/include",
+		"%{wks.location}/extern/glm/glm",
+	}
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+
+		defines
+		{
+			"HEXRAY_DEBUG",
+			"_DEBUG"
+		}
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+		defines
+		{
+			"HEXRAY_RELEASE",
+			"NDEBUG"
+		}
+
+project "hexray-tests"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	systemversion "latest"
+	staticruntime "on"
+	characterset("ASCII")
+
+	targetdir("%{wks.location}/bin/" .. outputdir)
+	objdir("%{wks.location}/tmp/" .. outputdir .. "/%{prj.name}")
+
+	-- Unit tests only build the platform independent sources they cover, so they run without a GPU
+	files
+	{
+		"%{wks.location}/tests/testframework.h",
+		"%{wks.location}/tests/testmain.cpp",
+		"%{wks.location}/tests/unit/**.cpp",
+		"%{wks.location}/src/core/logger.cpp",
+		"%{wks.location}/src/core/timer.cpp",
+		"%{wks.location}/src/rendering/emissivetriangles.cpp",
+		"%{wks.location}/src/rendering/lightaliastable.cpp",
+		"%{wks.location}/src/rendering/lightbvh.cpp",
+		"%{wks.location}/src/rendering/rendergraphcompiler.cpp",
+		"%{wks.location}/src/rendering/ringallocator.cpp",
+	}
+
+	includedirs
+	{
+		"%{wks.location}/src",
+		"%{wks.location}/tests",
+		"%{wks.location}/extern/spdlog/include",
+		"%{wks.location}/extern/glm/glm",
+	}
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+
+		defines
+		{
+			"HEXRAY_DEBUG",
+			"_DEBUG"
+		}
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+		defines
+		{
+			"HEXRAY_RELEASE",
+			"NDEBUG"
+		}
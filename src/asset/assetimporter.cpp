@@ -11,7 +11,58 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <ImfRgbaFile.h>
+#include <ImfHeader.h>
 #include <fstream>
+#include <execution>
+
+struct MeshSourceData
+{
+    std::unique_ptr<Assimp::Importer> Importer;
+    const aiScene* Scene = nullptr;
+    MeshDescription Description;
+    std::vector<Vertex> Vertices;
+    std::vector<uint32_t> Indices;
+};
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Block compressed legacy FourCCs map to a DXGI format without any conversion of the payload
+static bool IsBlockCompressedFourCC(uint32_t fourCC)
+{
+    switch (fourCC)
+    {
+    case 0x31545844: // 'DXT1'
+    case 0x32545844: // 'DXT2'
+    case 0x33545844: // 'DXT3'
+    case 0x34545844: // 'DXT4'
+    case 0x35545844: // 'DXT5'
+    case 0x31495441: // 'ATI1'
+    case 0x32495441: // 'ATI2'
+    case 0x55344342: // 'BC4U'
+    case 0x53344342: // 'BC4S'
+    case 0x55354342: // 'BC5U'
+    case 0x53354342: // 'BC5S'
+        return true;
+    default:
+        return false;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static bool HasUndefinedAlpha(DXGI_FORMAT format)
+{
+    return format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// X8 formats are stored with an opaque alpha channel, so shaders sampling alpha don't read whatever the file left in it
+static DXGI_FORMAT FillUndefinedAlpha(DXGI_FORMAT format, std::vector<uint8_t>& pixels)
+{
+    for (size_t i = 3; i < pixels.size(); i += 4)
+        pixels[i] = 255;
+
+    return format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB ? DXGI_FORMAT_B8G8R8A8_UNORM_SRGB : DXGI_FORMAT_B8G8R8A8_UNORM;
+}
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 Uuid AssetImporter::ImportTextureAsset(const std::filesystem::path& sourceFilepath, TextureImportOptions options)
@@ -25,29 +76,81 @@ Uuid AssetImporter::ImportTextureAsset(const std::filesystem::path& sourceFilepa
     TextureDescription textureDesc;
     std::vector<uint8_t> pixels;
 
-    if (sourceFilepath.extension() == ".dds")
+    if (!DecodeTextureFile(sourceFilepath, textureDesc, pixels, options))
     {
-        if (!ImportDDS(sourceFilepath, textureDesc, pixels))
-        {
-            return Uuid::Invalid;
-        }
+        return Uuid::Invalid;
     }
-    else if (sourceFilepath.extension() == ".exr")
+
+    return FinalizeTextureImport(textureDesc, pixels, metaData, options);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+std::vector<Uuid> AssetImporter::ImportTextureAssets(const std::vector<TextureImportRequest>& requests)
+{
+    struct PendingTexture
     {
-        if (!ImportEXR(sourceFilepath, textureDesc, pixels))
+        uint32_t RequestIndex;
+        AssetMetaData MetaData;
+        TextureDescription Description;
+        std::vector<uint8_t> Pixels;
+        bool Decoded = false;
+    };
+
+    std::vector<Uuid> results(requests.size(), Uuid::Invalid);
+
+    // The asset registry is not thread safe, so existing assets are resolved serially and only the missing ones are decoded
+    std::vector<PendingTexture> pendingTextures;
+    std::unordered_map<std::filesystem::path, uint32_t> pendingTextureIndices;
+    std::vector<std::pair<uint32_t, uint32_t>> duplicateRequests;
+
+    for (uint32_t i = 0; i < requests.size(); i++)
+    {
+        const std::filesystem::path& sourceFilepath = requests[i].SourceFilepath;
+
+        AssetMetaData metaData;
+        if (GetExistingOrSetupImport(AssetType::Texture, sourceFilepath.stem().string(), sourceFilepath, metaData))
+        {
+            results[i] = metaData.ID;
+            continue;
+        }
+
+        auto found = pendingTextureIndices.find(metaData.AssetFilepath);
+        if (found != pendingTextureIndices.end())
         {
-            return Uuid::Invalid;
+            duplicateRequests.emplace_back(i, found->second);
+            continue;
         }
+
+        pendingTextureIndices[metaData.AssetFilepath] = pendingTextures.size();
+
+        PendingTexture& pendingTexture = pendingTextures.emplace_back();
+        pendingTexture.RequestIndex = i;
+        pendingTexture.MetaData = metaData;
     }
-    else
+
+    // Decoding, mip generation and compression only touch the CPU data of each texture
+    std::for_each(std::execution::par, pendingTextures.begin(), pendingTextures.end(), [&requests](PendingTexture& texture)
     {
-        if (!ImportSTB(sourceFilepath, textureDesc, pixels))
+        const TextureImportRequest& request = requests[texture.RequestIndex];
+        texture.Decoded = DecodeTextureFile(request.SourceFilepath, texture.Description, texture.Pixels, request.Options) &&
+            ProcessTextureData(texture.Description, texture.Pixels, texture.MetaData, request.Options);
+    });
+
+    // GPU uploads, serialization and registration are serial
+    for (PendingTexture& texture : pendingTextures)
+    {
+        if (texture.Decoded)
         {
-            return Uuid::Invalid;
+            results[texture.RequestIndex] = CreateTextureAsset(texture.Description, texture.Pixels, texture.MetaData);
         }
     }
 
-    return FinalizeTextureImport(textureDesc, pixels, metaData, options);
+    for (const auto& [requestIndex, pendingIndex] : duplicateRequests)
+    {
+        results[requestIndex] = results[pendingTextures[pendingIndex].RequestIndex];
+    }
+
+    return results;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -62,7 +165,7 @@ Uuid AssetImporter::ImportTextureAsset(const byte* compressedData, uint32_t data
     TextureDescription textureDesc;
     std::vector<uint8_t> pixels;
 
-    if (!ImportSTB(compressedData, dataSize, textureDesc, pixels))
+    if (!ImportSTB(compressedData, dataSize, textureDesc, pixels, options))
     {
         return Uuid::Invalid;
     }
@@ -79,6 +182,85 @@ Uuid AssetImporter::ImportMeshAsset(const std::filesystem::path& sourceFilepath,
         return metaData.ID;
     }
 
+    MeshSourceData meshData;
+    if (!ReadMeshSource(sourceFilepath, options, meshData))
+    {
+        return Uuid::Invalid;
+    }
+
+    return FinalizeMeshImport(sourceFilepath, meshData, metaData);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+std::vector<Uuid> AssetImporter::ImportMeshAssets(const std::vector<MeshImportRequest>& requests)
+{
+    struct PendingMesh
+    {
+        uint32_t RequestIndex;
+        AssetMetaData MetaData;
+        MeshSourceData Data;
+        bool Decoded = false;
+    };
+
+    std::vector<Uuid> results(requests.size(), Uuid::Invalid);
+
+    // The asset registry is not thread safe, so existing assets are resolved serially and only the missing ones are read
+    std::vector<PendingMesh> pendingMeshes;
+    std::unordered_map<std::filesystem::path, uint32_t> pendingMeshIndices;
+    std::vector<std::pair<uint32_t, uint32_t>> duplicateRequests;
+
+    for (uint32_t i = 0; i < requests.size(); i++)
+    {
+        const std::filesystem::path& sourceFilepath = requests[i].SourceFilepath;
+
+        AssetMetaData metaData;
+        if (GetExistingOrSetupImport(AssetType::Mesh, sourceFilepath.stem().string(), sourceFilepath, metaData))
+        {
+            results[i] = metaData.ID;
+            continue;
+        }
+
+        auto found = pendingMeshIndices.find(metaData.AssetFilepath);
+        if (found != pendingMeshIndices.end())
+        {
+            duplicateRequests.emplace_back(i, found->second);
+            continue;
+        }
+
+        pendingMeshIndices[metaData.AssetFilepath] = pendingMeshes.size();
+
+        PendingMesh& pendingMesh = pendingMeshes.emplace_back();
+        pendingMesh.RequestIndex = i;
+        pendingMesh.MetaData = metaData;
+    }
+
+    // Each mesh gets its own Assimp importer, so the source files are read and post-processed concurrently
+    std::for_each(std::execution::par, pendingMeshes.begin(), pendingMeshes.end(), [&requests](PendingMesh& mesh)
+    {
+        const MeshImportRequest& request = requests[mesh.RequestIndex];
+        mesh.Decoded = ReadMeshSource(request.SourceFilepath, request.Options, mesh.Data);
+    });
+
+    // Material imports, GPU uploads, serialization and registration are serial
+    for (PendingMesh& mesh : pendingMeshes)
+    {
+        if (mesh.Decoded)
+        {
+            results[mesh.RequestIndex] = FinalizeMeshImport(requests[mesh.RequestIndex].SourceFilepath, mesh.Data, mesh.MetaData);
+        }
+    }
+
+    for (const auto& [requestIndex, pendingIndex] : duplicateRequests)
+    {
+        results[requestIndex] = results[pendingMeshes[pendingIndex].RequestIndex];
+    }
+
+    return results;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool AssetImporter::ReadMeshSource(const std::filesystem::path& sourceFilepath, const MeshImportOptions& options, MeshSourceData& outData)
+{
     // Import asset data
     uint64_t processingFlags = aiProcess_ImproveCacheLocality |
         aiProcess_RemoveRedundantMaterials |
@@ -100,23 +282,25 @@ Uuid AssetImporter::ImportMeshAsset(const std::filesystem::path& sourceFilepath,
         processingFlags |= aiProcess_ConvertToLeftHanded;
     }
 
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(sourceFilepath.string(), processingFlags);
+    outData.Importer = std::make_unique<Assimp::Importer>();
+    const aiScene* scene = outData.Importer->ReadFile(sourceFilepath.string(), processingFlags);
 
     if (!scene)
     {
-        HEXRAY_ERROR("Asset Importer: Failed decoding mesh file. Reason: {}", importer.GetErrorString());
-        return Uuid::Invalid;
+        HEXRAY_ERROR("Asset Importer: Failed decoding mesh file. Reason: {}", outData.Importer->GetErrorString());
+        return false;
     }
 
-    MeshDescription meshDesc;
+    outData.Scene = scene;
+
+    MeshDescription& meshDesc = outData.Description;
     meshDesc.Submeshes.resize(scene->mNumMeshes);
     meshDesc.MaterialTable = std::make_shared<MaterialTable>(scene->mNumMeshes);
 
-    std::vector<Vertex> vertices;
+    std::vector<Vertex>& vertices = outData.Vertices;
     vertices.reserve(5000);
 
-    std::vector<uint32_t> indices;
+    std::vector<uint32_t>& indices = outData.Indices;
     indices.reserve(10000);
 
     // Parse all submeshes
@@ -198,6 +382,15 @@ Uuid AssetImporter::ImportMeshAsset(const std::filesystem::path& sourceFilepath,
         meshDesc.Submeshes[submeshIdx].MaterialIndex = submesh->mMaterialIndex;
     }
 
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+Uuid AssetImporter::FinalizeMeshImport(const std::filesystem::path& sourceFilepath, MeshSourceData& data, const AssetMetaData& metaData)
+{
+    const aiScene* scene = data.Scene;
+    MeshDescription& meshDesc = data.Description;
+
     // Parse all materials
     for (uint32_t materialIdx = 0; materialIdx < scene->mNumMaterials; materialIdx++)
     {
@@ -215,7 +408,7 @@ Uuid AssetImporter::ImportMeshAsset(const std::filesystem::path& sourceFilepath,
 
     // Create and serialize asset
     MeshPtr mesh = std::make_shared<Mesh>(meshDesc, sourceFilepath.stem().wstring().c_str());
-    mesh->UploadGPUData(vertices.data(), indices.data(), true);
+    mesh->UploadGPUData(data.Vertices.data(), data.Indices.data(), true);
 
     mesh->m_MetaData = metaData;
 
@@ -417,16 +610,92 @@ bool AssetImporter::GetExistingOrSetupImport(AssetType type, const std::string&
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-bool AssetImporter::ImportDDS(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels)
+bool AssetImporter::ImportDDS(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options)
 {
-    std::vector<uint8_t> fileContents;
-    if (!ReadFile(filepath, fileContents))
+    std::ifstream ifs(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if (!ifs)
     {
         HEXRAY_ERROR("Asset Importer: Could not open texture asset file: {}", filepath.string());
         return false;
     }
 
-    if (!ImportDDS(fileContents.data(), fileContents.size(), outTextureDesc, outPixels))
+    size_t fileSize = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+
+    // Magic number + DDS_HEADER + optional DDS_HEADER_DXT10
+    constexpr size_t ddsHeaderSize = 128;
+    constexpr size_t ddsHeaderDX10Size = 148;
+    constexpr size_t ddsPixelFormatFlagsOffset = 80;
+    constexpr size_t ddsFourCCOffset = 84;
+    constexpr uint32_t ddsPixelFormatFourCC = 0x4;
+    constexpr uint32_t ddsFourCCDX10 = 0x30315844; // 'DX10'
+
+    uint8_t header[ddsHeaderDX10Size] = {};
+    size_t headerReadSize = std::min(fileSize, ddsHeaderDX10Size);
+    if (!ifs.read((char*)header, headerReadSize))
+    {
+        HEXRAY_ERROR("Asset Importer: Failed reading texture asset file: {}", filepath.string());
+        return false;
+    }
+
+    // Only DX10 headers and block compressed FourCCs describe the payload exactly. Legacy uncompressed pixel formats can need
+    // swizzles, expansions or an alpha fill from DirectXTex even when their size matches, so they take the slow path
+    uint32_t pixelFormatFlags = *(uint32_t*)(header + ddsPixelFormatFlagsOffset);
+    uint32_t fourCC = *(uint32_t*)(header + ddsFourCCOffset);
+    bool isDX10 = fourCC == ddsFourCCDX10;
+    bool isBlockCompressed = !isDX10 && (pixelFormatFlags & ddsPixelFormatFourCC) && IsBlockCompressedFourCC(fourCC);
+
+    DirectX::TexMetadata textureMetaData;
+    if ((isDX10 || isBlockCompressed) && SUCCEEDED(DirectX::GetMetadataFromDDSMemory(header, headerReadSize, DirectX::DDS_FLAGS_NO_LEGACY_EXPANSION, textureMetaData)))
+    {
+        if (textureMetaData.dimension == DirectX::TEX_DIMENSION_TEXTURE1D || textureMetaData.dimension == DirectX::TEX_DIMENSION_TEXTURE3D)
+        {
+            HEXRAY_ERROR("Asset Importer: TEX_DIMENSION_TEXTURE1D and TEX_DIMENSION_TEXTURE3D are not currently supported");
+            return false;
+        }
+
+        TextureDescription textureDesc;
+        textureDesc.Format = textureMetaData.format;
+        textureDesc.ArrayLevels = textureMetaData.arraySize;
+        textureDesc.Width = textureMetaData.width;
+        textureDesc.Height = textureMetaData.height;
+        textureDesc.MipLevels = textureMetaData.mipLevels;
+        textureDesc.IsCubeMap = textureMetaData.IsCubemap();
+
+        size_t headerSize = isDX10 ? ddsHeaderDX10Size : ddsHeaderSize;
+        size_t pixelsSize = GetTextureDataSize(textureDesc, textureDesc.MipLevels);
+
+        // The payload of DDS files that need no conversion has the same layout as our pixel data, so read it straight into the output.
+        // X8 formats leave their alpha undefined in the file, they take the slow path which makes it opaque
+        if (fileSize >= headerSize && fileSize - headerSize == pixelsSize && !HasUndefinedAlpha(textureDesc.Format))
+        {
+            outTextureDesc = textureDesc;
+            ReserveTextureData(outTextureDesc, options, outPixels);
+            outPixels.resize(pixelsSize);
+
+            ifs.seekg(headerSize, std::ios::beg);
+            if (!ifs.read((char*)outPixels.data(), pixelsSize))
+            {
+                HEXRAY_ERROR("Asset Importer: Failed reading texture asset file: {}", filepath.string());
+                outPixels.clear();
+                return false;
+            }
+
+            return true;
+        }
+    }
+
+    // Legacy formats have to be converted by DirectXTex
+    std::vector<uint8_t> fileContents(fileSize);
+    ifs.seekg(0, std::ios::beg);
+    if (!ifs.read((char*)fileContents.data(), fileSize))
+    {
+        HEXRAY_ERROR("Asset Importer: Failed reading texture asset file: {}", filepath.string());
+        return false;
+    }
+
+    if (!ImportDDS(fileContents.data(), fileContents.size(), outTextureDesc, outPixels, options))
     {
         HEXRAY_ERROR("Asset Importer: Failed decoding file: {}", filepath.string());
         return false;
@@ -436,7 +705,7 @@ bool AssetImporter::ImportDDS(const std::filesystem::path& filepath, TextureDesc
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-bool AssetImporter::ImportDDS(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels)
+bool AssetImporter::ImportDDS(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options)
 {
     DirectX::ScratchImage imageData;
     HRESULT loadResult = DirectX::LoadFromDDSMemory(data, size, DirectX::DDS_FLAGS_NONE, nullptr, imageData);
@@ -462,14 +731,18 @@ bool AssetImporter::ImportDDS(const uint8_t* data, uint32_t size, TextureDescrip
     outTextureDesc.MipLevels = textureMetaData.mipLevels;
     outTextureDesc.IsCubeMap = textureMetaData.IsCubemap();
 
+    ReserveTextureData(outTextureDesc, options, outPixels);
     outPixels.resize(imageData.GetPixelsSize());
     memcpy(outPixels.data(), imageData.GetPixels(), imageData.GetPixelsSize());
 
+    if (HasUndefinedAlpha(outTextureDesc.Format))
+        outTextureDesc.Format = FillUndefinedAlpha(outTextureDesc.Format, outPixels);
+
     return true;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-bool AssetImporter::ImportSTB(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels)
+bool AssetImporter::ImportSTB(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options)
 {
     std::vector<uint8_t> fileContents;
     if (!ReadFile(filepath, fileContents))
@@ -478,7 +751,7 @@ bool AssetImporter::ImportSTB(const std::filesystem::path& filepath, TextureDesc
         return false;
     }
 
-    if (!ImportSTB(fileContents.data(), fileContents.size(), outTextureDesc, outPixels))
+    if (!ImportSTB(fileContents.data(), fileContents.size(), outTextureDesc, outPixels, options))
     {
         HEXRAY_ERROR("Asset Importer: Failed decoding file: {}", filepath.string());
         return false;
@@ -488,44 +761,90 @@ bool AssetImporter::ImportSTB(const std::filesystem::path& filepath, TextureDesc
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-bool AssetImporter::ImportEXR(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels)
+bool AssetImporter::ImportHeightfield(const std::filesystem::path& sourceFilepath, HeightfieldDescription& outHeightfield)
 {
-    DirectX::ScratchImage imageData;
-    HRESULT loadResult = DirectX::LoadFromEXRFile(filepath.wstring().c_str(), nullptr, imageData);
-
-    if (FAILED(loadResult))
+    std::vector<uint8_t> fileContents;
+    if (!ReadFile(sourceFilepath, fileContents))
     {
-        HEXRAY_ERROR("Asset Importer: Failed loading EXR file");
+        HEXRAY_ERROR("Asset Importer: Could not open heightfield file: {}", sourceFilepath.string());
         return false;
     }
 
-    const DirectX::TexMetadata& textureMetaData = imageData.GetMetadata();
+    // Color images are converted to luminance, 8 bit ones are expanded to the full 16 bit range
+    int32_t width, height, channels;
+    uint16_t* samples = stbi_load_16_from_memory(fileContents.data(), int32_t(fileContents.size()), &width, &height, &channels, 1);
+    if (!samples)
+    {
+        HEXRAY_ERROR("Asset Importer: Failed decoding heightfield file: {}", sourceFilepath.string());
+        return false;
+    }
 
-    if (textureMetaData.dimension == DirectX::TEX_DIMENSION_TEXTURE1D || textureMetaData.dimension == DirectX::TEX_DIMENSION_TEXTURE3D)
+    uint32_t maxCellCount = c_HeightfieldTileSize << (c_HeightfieldMaxMipCount - 1);
+    if (width < 2 || height < 2 || uint32_t(width - 1) > maxCellCount || uint32_t(height - 1) > maxCellCount || uint64_t(width) * height * sizeof(uint16_t) > UINT32_MAX / 2)
     {
-        HEXRAY_ERROR("Asset Importer: TEX_DIMENSION_TEXTURE1D and TEX_DIMENSION_TEXTURE3D are not currently supported");
+        HEXRAY_ERROR("Asset Importer: Unsupported heightfield size {}x{}: {}", width, height, sourceFilepath.string());
+        stbi_image_free(samples);
         return false;
     }
 
-    outTextureDesc.Format = textureMetaData.format;
-    outTextureDesc.ArrayLevels = textureMetaData.arraySize;
-    outTextureDesc.Width = textureMetaData.width;
-    outTextureDesc.Height = textureMetaData.height;
-    outTextureDesc.MipLevels = textureMetaData.mipLevels;
-    outTextureDesc.IsCubeMap = textureMetaData.IsCubemap();
+    outHeightfield.Width = width;
+    outHeightfield.Depth = height;
+    outHeightfield.Heights.assign(samples, samples + size_t(width) * height);
+    stbi_image_free(samples);
 
-    outPixels.resize(imageData.GetPixelsSize());
-    memcpy(outPixels.data(), imageData.GetPixels(), imageData.GetPixelsSize());
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool AssetImporter::ImportEXR(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options)
+{
+    // Decode with OpenEXR directly into the output instead of going through a DirectXTex scratch image
+    try
+    {
+        Imf::RgbaInputFile file(filepath.string().c_str());
+
+        const Imath::Box2i& dataWindow = file.dataWindow();
+        int32_t width = dataWindow.max.x - dataWindow.min.x + 1;
+        int32_t height = dataWindow.max.y - dataWindow.min.y + 1;
+
+        if (width < 1 || height < 1)
+        {
+            HEXRAY_ERROR("Asset Importer: Failed loading EXR file");
+            return false;
+        }
+
+        // Environment maps store the 6 cube faces stacked vertically
+        bool isEnvironmentMap = file.header().find("envmap") != file.header().end() && width == height / 6;
+
+        outTextureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        outTextureDesc.ArrayLevels = isEnvironmentMap ? 6 : 1;
+        outTextureDesc.Width = width;
+        outTextureDesc.Height = isEnvironmentMap ? width : height;
+        outTextureDesc.MipLevels = 1;
+        outTextureDesc.IsCubeMap = isEnvironmentMap;
+
+        ReserveTextureData(outTextureDesc, options, outPixels);
+        outPixels.resize(size_t(width) * height * sizeof(Imf::Rgba));
+
+        file.setFrameBuffer((Imf::Rgba*)outPixels.data() - dataWindow.min.x - dataWindow.min.y * width, 1, width);
+        file.readPixels(dataWindow.min.y, dataWindow.max.y);
+    }
+    catch (const std::exception& e)
+    {
+        HEXRAY_ERROR("Asset Importer: Failed loading EXR file. Reason: {}", e.what());
+        return false;
+    }
 
     return true;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-bool AssetImporter::ImportSTB(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels)
+bool AssetImporter::ImportSTB(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options)
 {
     int32_t channels;
     int32_t width, height;
     uint8_t* pixels = nullptr;
+    bool expandToRGBA = false;
     if (stbi_info_from_memory(data, int32_t(size), &width, &height, &channels))
     {
         if (stbi_is_hdr_from_memory(data, int32_t(size)))
@@ -546,19 +865,16 @@ bool AssetImporter::ImportSTB(const uint8_t* data, uint32_t size, TextureDescrip
             // 1. Save that this is 3 channel image.
             // 2. Generate mips using stb_resize for 3 channels (DirectXTex relies on DXGI formats)
             // 3. use BC1 for compression (3 channels)
-            if (channels == 3)
-            {
-                // Converts RGB to RGBA, since there are no RGB8 formats.
-                channels = 4;
-            }
-
             switch (channels)
             {
                 case 1: outTextureDesc.Format = DXGI_FORMAT_R8_UNORM; break;
                 case 2: outTextureDesc.Format = DXGI_FORMAT_R8G8_UNORM; break;
+                case 3:
                 case 4: outTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; break;
             }
 
+            // RGB is decoded as is and converted to RGBA while copying to the output, since there are no RGB8 formats
+            expandToRGBA = channels == 3;
             pixels = stbi_load_from_memory(data, int32_t(size), &width, &height, &channels, channels);
         }
     }
@@ -573,23 +889,82 @@ bool AssetImporter::ImportSTB(const uint8_t* data, uint32_t size, TextureDescrip
     outTextureDesc.Height = height;
 
     uint32_t textureSize = outTextureDesc.Width * outTextureDesc.Height * DirectX::BitsPerPixel(outTextureDesc.Format) / 8;
+    ReserveTextureData(outTextureDesc, options, outPixels);
     outPixels.resize(textureSize);
-    memcpy(outPixels.data(), pixels, textureSize);
+
+    if (expandToRGBA)
+        ExpandRGBToRGBA(pixels, outPixels.data(), outTextureDesc.Width * outTextureDesc.Height);
+    else
+        memcpy(outPixels.data(), pixels, textureSize);
 
     stbi_image_free(pixels);
 
     return true;
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+size_t AssetImporter::GetTextureDataSize(const TextureDescription& desc, uint32_t mipLevels)
+{
+    size_t sliceSize = 0;
+    for (uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        size_t rowPitch, slicePitch;
+        DirectX::ComputePitch(desc.Format, std::max(desc.Width >> mip, 1u), std::max(desc.Height >> mip, 1u), rowPitch, slicePitch);
+        sliceSize += slicePitch;
+    }
+
+    return sliceSize * desc.ArrayLevels;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void AssetImporter::ReserveTextureData(const TextureDescription& desc, const TextureImportOptions& options, std::vector<uint8_t>& pixels)
+{
+    // Reserve the whole mip chain up front so that mip generation appends to the decoded image without reallocating it
+    uint32_t mipLevels = options.GenerateMips ? GetMipChainLength(desc.Width, desc.Height) : desc.MipLevels;
+    pixels.reserve(GetTextureDataSize(desc, std::max(mipLevels, desc.MipLevels)));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t AssetImporter::GetMipChainLength(uint32_t width, uint32_t height)
+{
+    return (uint32_t)log2(std::max(width, height)) + 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool AssetImporter::DecodeTextureFile(const std::filesystem::path& sourceFilepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options)
+{
+    if (sourceFilepath.extension() == ".dds")
+    {
+        return ImportDDS(sourceFilepath, outTextureDesc, outPixels, options);
+    }
+    else if (sourceFilepath.extension() == ".exr")
+    {
+        return ImportEXR(sourceFilepath, outTextureDesc, outPixels, options);
+    }
+
+    return ImportSTB(sourceFilepath, outTextureDesc, outPixels, options);
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 Uuid AssetImporter::FinalizeTextureImport(TextureDescription& desc, std::vector<uint8_t>& pixels, const AssetMetaData& metaData, TextureImportOptions options)
+{
+    if (!ProcessTextureData(desc, pixels, metaData, options))
+    {
+        return Uuid::Invalid;
+    }
+
+    return CreateTextureAsset(desc, pixels, metaData);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool AssetImporter::ProcessTextureData(TextureDescription& desc, std::vector<uint8_t>& pixels, const AssetMetaData& metaData, const TextureImportOptions& options)
 {
     if (options.GenerateMips)
     {
         if (!GenerateMipmaps(desc, pixels))
         {
             HEXRAY_ERROR("Asset Importer: Couldn't generate mips for texture asset {}", metaData.AssetFilepath.string());
-            return Uuid::Invalid;
+            return false;
         }
     }
 
@@ -598,10 +973,16 @@ Uuid AssetImporter::FinalizeTextureImport(TextureDescription& desc, std::vector<
         if (!CompressDXT(desc, pixels))
         {
             HEXRAY_ERROR("Asset Importer: Couldn't compress texture asset {}", metaData.AssetFilepath.string());
-            return Uuid::Invalid;
+            return false;
         }
     }
 
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+Uuid AssetImporter::CreateTextureAsset(const TextureDescription& desc, std::vector<uint8_t>& pixels, const AssetMetaData& metaData)
+{
     TexturePtr texture = std::make_shared<Texture>(desc, metaData.AssetFilepath.stem().wstring().c_str());
     texture->UploadGPUData(pixels.data(), true);
 
@@ -620,7 +1001,7 @@ Uuid AssetImporter::FinalizeTextureImport(TextureDescription& desc, std::vector<
 // ------------------------------------------------------------------------------------------------------------------------------------
 bool AssetImporter::GenerateMipmaps(TextureDescription& desc, std::vector<uint8_t>& pixels)
 {
-    uint32_t totalMips = (uint32_t)log2(std::max(desc.Width, desc.Height)) + 1;
+    uint32_t totalMips = GetMipChainLength(desc.Width, desc.Height);
     if (desc.MipLevels == totalMips)
     {
     	return true;
@@ -683,14 +1064,16 @@ bool AssetImporter::GenerateMipmaps(TextureDescription& desc, std::vector<uint8_
     dxImage.pixels = pixels.data();
 
     DirectX::ScratchImage dxScratchImage;
-    HRESULT hr = DirectX::GenerateMipMaps(dxImage, DirectX::TEX_FILTER_BOX, totalMips, dxScratchImage);
+    // WIC needs COM on the calling thread, batched imports generate mips on worker threads
+    HRESULT hr = DirectX::GenerateMipMaps(dxImage, DirectX::TEX_FILTER_BOX | DirectX::TEX_FILTER_FORCE_NON_WIC, totalMips, dxScratchImage);
     if (FAILED(hr))
     {
         return false;
     }
 
+    // The top mip is a copy of the source image, so only the generated mips are appended after it
     pixels.resize(dxScratchImage.GetPixelsSize());
-    memcpy(pixels.data(), dxScratchImage.GetPixels(), dxScratchImage.GetPixelsSize());
+    memcpy(pixels.data() + slicePitch, dxScratchImage.GetPixels() + slicePitch, dxScratchImage.GetPixelsSize() - slicePitch);
 #endif
     desc.MipLevels = totalMips;
     return true;
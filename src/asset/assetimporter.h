@@ -8,6 +8,7 @@
 
 struct aiMaterial;
 struct aiScene;
+struct MeshSourceData;
 
 struct TextureImportOptions
 {
@@ -20,22 +21,49 @@ struct MeshImportOptions
     bool ConvertToLeftHanded = true;
 };
 
+struct TextureImportRequest
+{
+    std::filesystem::path SourceFilepath;
+    TextureImportOptions Options;
+};
+
+struct MeshImportRequest
+{
+    std::filesystem::path SourceFilepath;
+    MeshImportOptions Options;
+};
+
 class AssetImporter
 {
 public:
     static Uuid ImportTextureAsset(const std::filesystem::path& sourceFilepath, TextureImportOptions options = TextureImportOptions());
     static Uuid ImportTextureAsset(const byte* compressedData, uint32_t dataSize, const std::string& assetName, TextureImportOptions options = TextureImportOptions());
     static Uuid ImportMeshAsset(const std::filesystem::path& sourceFilepath, MeshImportOptions options = MeshImportOptions());
+
+    // Batch imports decode the source files concurrently. The result at each index is the asset ID for the request at that index
+    static std::vector<Uuid> ImportTextureAssets(const std::vector<TextureImportRequest>& requests);
+    static std::vector<Uuid> ImportMeshAssets(const std::vector<MeshImportRequest>& requests);
     static Uuid ImportMaterialAsset(const aiMaterial* assimpMaterial, const aiScene* assimpScene, const std::filesystem::path& meshSourcePath);
     static Uuid CreateMeshAsset(const std::filesystem::path& filepath, const MeshDescription& meshDesc, const Vertex* vertexData, const uint32_t* indexData);
     static Uuid CreateMaterialAsset(const std::filesystem::path& filepath, MaterialType materialType, MaterialFlags materialFlags = MaterialFlags::None);
+
+    // Heightfields are not assets, the samples are decoded straight from the source image
+    static bool ImportHeightfield(const std::filesystem::path& sourceFilepath, HeightfieldDescription& outHeightfield);
 private:
     static bool GetExistingOrSetupImport(AssetType type, const std::string& assetName, const std::filesystem::path& sourcePath, AssetMetaData& outMetaData);
-    static bool ImportDDS(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels);
-    static bool ImportDDS(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels);
-    static bool ImportSTB(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels);
-    static bool ImportEXR(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels);
-    static bool ImportSTB(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels);
+    static bool ImportDDS(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options);
+    static bool ImportDDS(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options);
+    static bool ImportSTB(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options);
+    static bool ImportEXR(const std::filesystem::path& filepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options);
+    static bool ImportSTB(const uint8_t* data, uint32_t size, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options);
+    static size_t GetTextureDataSize(const TextureDescription& desc, uint32_t mipLevels);
+    static void ReserveTextureData(const TextureDescription& desc, const TextureImportOptions& options, std::vector<uint8_t>& pixels);
+    static uint32_t GetMipChainLength(uint32_t width, uint32_t height);
+    static bool DecodeTextureFile(const std::filesystem::path& sourceFilepath, TextureDescription& outTextureDesc, std::vector<uint8_t>& outPixels, const TextureImportOptions& options);
+    static bool ProcessTextureData(TextureDescription& desc, std::vector<uint8_t>& pixels, const AssetMetaData& metaData, const TextureImportOptions& options);
+    static Uuid CreateTextureAsset(const TextureDescription& desc, std::vector<uint8_t>& pixels, const AssetMetaData& metaData);
+    static bool ReadMeshSource(const std::filesystem::path& sourceFilepath, const MeshImportOptions& options, MeshSourceData& outData);
+    static Uuid FinalizeMeshImport(const std::filesystem::path& sourceFilepath, MeshSourceData& data, const AssetMetaData& metaData);
     static Uuid FinalizeTextureImport(TextureDescription& desc, std::vector<uint8_t>& pixels, const AssetMetaData& metaData, TextureImportOptions options);
     static bool GenerateMipmaps(TextureDescription& desc, std::vector<uint8_t>& pixels);
     static bool CompressDXT(TextureDescription& desc, std::vector<uint8_t>& pixels);
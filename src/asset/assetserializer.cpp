@@ -1,6 +1,7 @@
 #include "assetserializer.h"
 
 #include "asset/assetmanager.h"
+#include "rendering/virtualtexture.h"
 #include <fstream>
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -206,6 +207,18 @@ bool AssetSerializer::Deserialize(const std::filesystem::path& filepath, std::sh
     uint32_t pixelsSize;
     ifs.read((char*)&pixelsSize, sizeof(pixelsSize));
 
+    if (VirtualTextureSystem::ShouldVirtualize(textureDesc))
+    {
+        // Leave the pixels on disk, pages are streamed in on demand by the virtual texture system
+        textureDesc.IsVirtual = true;
+
+        outAsset = std::make_shared<Texture>(textureDesc, filepath.stem().wstring().c_str());
+        outAsset->m_PixelDataOffset = ifs.tellg();
+        outAsset->m_MetaData = metaData;
+
+        return true;
+    }
+
     std::vector<uint8_t> pixels(pixelsSize);
     ifs.read((char*)pixels.data(), pixelsSize);
 
@@ -6,7 +6,9 @@
 #include "core/utils.h"
 #include "scene/component.h"
 #include "scene/sceneserializer.h"
+#include "scene/scenecache.h"
 #include "rendering/defaultresources.h"
+#include "rendering/virtualtexture.h"
 #include "asset/assetimporter.h"
 #include "asset/assetmanager.h"
 #include "asset/assetserializer.h"
@@ -277,6 +279,7 @@ Application::Application(const ApplicationDescription& description)
     m_GraphicsContext = std::make_unique<GraphicsContext>(gfxContextDesc);
 
     DefaultResources::Initialize();
+    VirtualTextureSystem::Initialize(VirtualTextureSystemDescription());
 
     //CreateBloomTestScene();
     ParseCommandlineArgs();
@@ -291,12 +294,16 @@ Application::Application(const ApplicationDescription& description)
 
     SetMaxFPS(120);
     SetMaxDeltaTime(2.0);
+
+    if (!m_BenchmarkDescription.CameraPathFilepath.empty())
+        StartBenchmark();
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 Application::~Application()
 {
     AssetManager::Shutdown();
+    VirtualTextureSystem::Shutdown();
     DefaultResources::Shutdown();
 }
 
@@ -398,12 +405,27 @@ void Application::BeginFrame()
     m_Window->ProcessEvents();
 
     m_GraphicsContext->BeginFrame();
+
+    // Only the CPU work of the frame is timed, waiting for a frame in flight to finish is excluded
+    m_CPUFrameTimer.Reset();
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 void Application::Update()
 {
-    m_Scene->OnUpdate(m_DeltaTime);
+    if (m_Benchmark)
+    {
+        // The camera follows the recorded path and ignores input, scene edits are not picked up while measuring
+        m_Benchmark->BeginFrame(m_Scene->GetCamera());
+    }
+    else
+    {
+        if (m_SceneWatcher.CheckForChanges())
+            ReloadScene();
+
+        m_Scene->OnUpdate(m_DeltaTime);
+    }
+
     m_Scene->OnRender(m_SceneRenderer);
 }
 
@@ -413,6 +435,8 @@ void Application::EndFrame()
     m_GraphicsContext->CopyTextureToSwapChain(m_SceneRenderer->GetFinalImage().get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     m_GraphicsContext->EndFrame();
 
+    if (m_Benchmark)
+        EndBenchmarkFrame();
 
     double frameEnd = m_Timer.GetTimeNow();
     double frameDuration = (frameEnd - m_LastTime);
@@ -443,6 +467,15 @@ void Application::EndFrame()
     newTitle << "FPS (";
     newTitle << std::fixed << std::setprecision(1) << m_AvgDeltaTimeMS;
     newTitle << " ms)";
+
+    if (VirtualTextureSystem::HasVirtualTextures())
+    {
+        const VirtualTextureStats& vtStats = VirtualTextureSystem::GetStats();
+        newTitle << " | VT pages: " << vtStats.ResidentPages;
+        newTitle << ", faults: " << vtStats.PageFaults;
+        newTitle << ", cache: " << vtStats.CacheMemoryUsage / (1024 * 1024) << " MB";
+    }
+
     m_Window->SetTitle(newTitle.str());
 }
 
@@ -509,9 +542,34 @@ void Application::ParseCommandlineArgs()
         {
             std::filesystem::path filepath = args[++i];
             AssetManager::Initialize(filepath.parent_path() / "assets");
-            m_Scene = std::make_shared<Scene>(filepath.string());
-            DefaultSceneParser parser;
-            parser.Parse(filepath.string().c_str(), m_Scene.get(), &m_RendererDescription);
+
+            // Parsing is skipped when the compiled scene next to the source was built from the same file contents
+            std::filesystem::path cachePath = std::filesystem::path(filepath).replace_extension(".hexscene");
+            uint64_t sourceHash = 0;
+            bool hasSourceHash = SceneCache::HashSourceFile(filepath, sourceHash);
+
+            // The parser is kept alive so edits to the source file can be applied incrementally
+            m_SceneParser = std::make_unique<DefaultSceneParser>();
+            if (!hasSourceHash || !SceneCache::Deserialize(cachePath, sourceHash, m_Scene, m_RendererDescription))
+            {
+                m_Scene = std::make_shared<Scene>(filepath.string());
+                if (m_SceneParser->Parse(filepath.string().c_str(), m_Scene.get(), &m_RendererDescription) && hasSourceHash)
+                    SceneCache::Serialize(cachePath, sourceHash, m_Scene, m_RendererDescription);
+            }
+
+            m_SceneWatcher = FileWatcher(filepath);
+        }
+        else if (strcmp(args[i], "-benchmark") == 0)
+        {
+            m_BenchmarkDescription.CameraPathFilepath = args[++i];
+        }
+        else if (strcmp(args[i], "-benchmark-frames") == 0)
+        {
+            m_BenchmarkDescription.FrameCount = uint32_t(std::max(std::atoi(args[++i]), 0));
+        }
+        else if (strcmp(args[i], "-benchmark-output") == 0)
+        {
+            m_BenchmarkDescription.OutputFilepath = args[++i];
         }
     }
 }
@@ -534,6 +592,59 @@ void Application::OpenScene(const std::filesystem::path& filepath)
         return;
     }
 
+    m_SceneParser.reset();
+    m_SceneWatcher = FileWatcher(filepath);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Application::ReloadScene()
+{
+    Timer reloadTimer;
+    reloadTimer.Reset();
+
+    const std::filesystem::path& filepath = m_SceneWatcher.GetFilepath();
+    bool rendererDescriptionChanged = true;
+
+    if (m_SceneParser && m_SceneParser->HasParsed())
+    {
+        // Only the blocks that changed are applied to the live scene
+        if (!m_SceneParser->Reload(filepath.string().c_str(), rendererDescriptionChanged))
+        {
+            HEXRAY_ERROR("Failed reloading scene {}, keeping the current scene", filepath.string());
+            return;
+        }
+    }
+    else
+    {
+        // Everything else is rebuilt as a whole. Assets stay registered in the asset manager, so only the entities are recreated
+        std::shared_ptr<Scene> scene;
+        bool loaded = false;
+
+        if (m_SceneParser)
+        {
+            scene = std::make_shared<Scene>(filepath.string());
+            loaded = m_SceneParser->Parse(filepath.string().c_str(), scene.get(), &m_RendererDescription);
+        }
+        else
+        {
+            loaded = SceneSerializer::Deserialize(filepath, scene, m_RendererDescription);
+        }
+
+        if (!loaded)
+        {
+            HEXRAY_ERROR("Failed reloading scene {}, keeping the current scene", filepath.string());
+            return;
+        }
+
+        m_Scene = scene;
+        m_Scene->OnViewportResize(m_Window->GetWidth(), m_Window->GetHeight());
+    }
+
+    if (rendererDescriptionChanged)
+        InitSceneRenderer();
+
+    reloadTimer.Stop();
+    HEXRAY_INFO("Scene reload took {:.2f} ms", reloadTimer.GetElapsedTimeMS());
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -544,6 +655,55 @@ void Application::InitSceneRenderer()
     m_SceneRenderer = std::make_shared<Renderer>(m_RendererDescription);
     m_SceneRenderer->SetViewportSize(m_Window->GetWidth(), m_Window->GetHeight());
 
+    if (m_Benchmark)
+        m_SceneRenderer->SetFixedFrameIndex(1);
+
     double endTime = m_Timer.GetTimeNow();
     HEXRAY_INFO("Scene load took {}ms", endTime - startTime);
 }
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Application::StartBenchmark()
+{
+    m_Benchmark = std::make_unique<Benchmark>(m_BenchmarkDescription);
+    if (!m_Benchmark->LoadCameraPath())
+    {
+        HEXRAY_ERROR("Benchmark: Failed loading camera path, running without benchmark");
+        m_Benchmark.reset();
+        return;
+    }
+
+    // Frames are rendered as fast as possible with a fixed time step and a single sample of the same seed each frame, so the
+    // rendered images and the work per frame are identical between runs
+    SetMaxFPS(0);
+    SetFixedDeltaTime(m_BenchmarkDescription.FrameDeltaTime);
+    m_SceneRenderer->SetFixedFrameIndex(1);
+
+    if (m_Window->IsVSyncOn())
+        m_Window->ToggleVSync();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Application::EndBenchmarkFrame()
+{
+    m_CPUFrameTimer.Stop();
+    m_Benchmark->EndFrame(m_CPUFrameTimer.GetElapsedTimeMS(), m_GraphicsContext->GetFrameNumber());
+
+    m_GPUFrameTimings.clear();
+    m_GraphicsContext->GetCompletedGPUFrameTimings(m_GPUFrameTimings);
+    m_Benchmark->AddGPUFrameTimings(m_GPUFrameTimings);
+
+    if (!m_Benchmark->IsFinished())
+        return;
+
+    // Collect the timings of the frames still in flight before writing the report
+    m_GraphicsContext->WaitForGPU();
+
+    m_GPUFrameTimings.clear();
+    m_GraphicsContext->GetCompletedGPUFrameTimings(m_GPUFrameTimings);
+    m_Benchmark->AddGPUFrameTimings(m_GPUFrameTimings);
+
+    m_Benchmark->WriteReport(m_Scene->GetName());
+    m_IsRunning = false;
+}
\ No newline at end of file
@@ -4,10 +4,14 @@
 #include "core/event.h"
 #include "core/window.h"
 #include "core/timer.h"
+#include "core/filewatcher.h"
+#include "core/benchmark.h"
 #include "rendering/graphicscontext.h"
 #include "rendering/renderer.h"
 #include "scene/scene.h"
 
+class DefaultSceneParser;
+
 struct CommandLineArgs
 {
     int Count = 0;
@@ -102,13 +106,22 @@ private:
     void CompileShaders();
     void ParseCommandlineArgs();
     void OpenScene(const std::filesystem::path& filepath);
+    void ReloadScene();
     void InitSceneRenderer();
+    void StartBenchmark();
+    void EndBenchmarkFrame();
 private:
     ApplicationDescription m_Description;
     std::unique_ptr<Window> m_Window;
     std::unique_ptr<GraphicsContext> m_GraphicsContext;
     std::shared_ptr<Scene> m_Scene;
     std::shared_ptr<Renderer> m_SceneRenderer;
+    std::unique_ptr<DefaultSceneParser> m_SceneParser;
+    FileWatcher m_SceneWatcher;
+    BenchmarkDescription m_BenchmarkDescription;
+    std::unique_ptr<Benchmark> m_Benchmark;
+    std::vector<GPUFrameTiming> m_GPUFrameTimings;
+    Timer m_CPUFrameTimer;
 
     Timer m_Timer;
     double m_DeltaTime;
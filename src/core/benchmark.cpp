@@ -0,0 +1,234 @@
+#include "benchmark.h"
+
+#include "core/logger.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static double GetPercentile(const std::vector<double>& sortedValues, double percentile)
+{
+    if (sortedValues.empty())
+        return 0.0;
+
+    // Nearest-rank percentile, so the result is always one of the recorded frame times
+    size_t rank = size_t(std::ceil(percentile / 100.0 * sortedValues.size()));
+    return sortedValues[std::clamp<size_t>(rank, 1, sortedValues.size()) - 1];
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static void WriteFrameTimeStatistics(std::ostream& stream, const char* name, const std::vector<double>& frameTimesMS, const std::vector<bool>& hasFrameTime, bool isLast)
+{
+    std::vector<double> sortedFrameTimes;
+    for (size_t i = 0; i < frameTimesMS.size(); i++)
+    {
+        if (hasFrameTime[i])
+            sortedFrameTimes.push_back(frameTimesMS[i]);
+    }
+
+    std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+
+    double mean = 0.0;
+    for (double frameTime : sortedFrameTimes)
+        mean += frameTime;
+
+    mean = sortedFrameTimes.empty() ? 0.0 : mean / sortedFrameTimes.size();
+
+    stream << "    \"" << name << "\": {\n";
+    stream << "        \"mean\": " << mean << ",\n";
+    stream << "        \"p50\": " << GetPercentile(sortedFrameTimes, 50.0) << ",\n";
+    stream << "        \"p95\": " << GetPercentile(sortedFrameTimes, 95.0) << ",\n";
+    stream << "        \"p99\": " << GetPercentile(sortedFrameTimes, 99.0) << ",\n";
+    stream << "        \"min\": " << (sortedFrameTimes.empty() ? 0.0 : sortedFrameTimes.front()) << ",\n";
+    stream << "        \"max\": " << (sortedFrameTimes.empty() ? 0.0 : sortedFrameTimes.back()) << ",\n";
+    stream << "        \"recordedFrameCount\": " << sortedFrameTimes.size() << ",\n";
+    stream << "        \"frames\": [";
+
+    // Frames without a timing are written as null so the array still lines up with the frame index
+    for (size_t i = 0; i < frameTimesMS.size(); i++)
+    {
+        stream << (i == 0 ? "" : ", ");
+        if (hasFrameTime[i])
+            stream << frameTimesMS[i];
+        else
+            stream << "null";
+    }
+
+    stream << "]\n";
+    stream << "    }" << (isLast ? "\n" : ",\n");
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static std::string EscapeJSONString(const std::string& string)
+{
+    std::string result;
+    result.reserve(string.size());
+
+    for (char c : string)
+    {
+        if (c == '"' || c == '\\')
+            result += '\\';
+
+        result += c;
+    }
+
+    return result;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+Benchmark::Benchmark(const BenchmarkDescription& description)
+    : m_Description(description)
+{
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool Benchmark::LoadCameraPath()
+{
+    std::ifstream stream(m_Description.CameraPathFilepath);
+    if (!stream)
+    {
+        HEXRAY_ERROR("Benchmark: Failed opening camera path {}", m_Description.CameraPathFilepath.string());
+        return false;
+    }
+
+    m_Keyframes.clear();
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+
+        size_t firstCharacter = line.find_first_not_of(" \t\r");
+        if (firstCharacter == std::string::npos || line[firstCharacter] == '#')
+            continue;
+
+        CameraKeyframe keyframe;
+        std::istringstream lineStream(line);
+        if (!(lineStream >> keyframe.Time >> keyframe.Position.x >> keyframe.Position.y >> keyframe.Position.z >> keyframe.Yaw >> keyframe.Pitch))
+        {
+            HEXRAY_ERROR("Benchmark: Invalid keyframe at {}:{}", m_Description.CameraPathFilepath.string(), lineNumber);
+            return false;
+        }
+
+        if (!m_Keyframes.empty() && keyframe.Time < m_Keyframes.back().Time)
+        {
+            HEXRAY_ERROR("Benchmark: Keyframe times have to be ascending at {}:{}", m_Description.CameraPathFilepath.string(), lineNumber);
+            return false;
+        }
+
+        m_Keyframes.push_back(keyframe);
+    }
+
+    if (m_Keyframes.empty())
+    {
+        HEXRAY_ERROR("Benchmark: Camera path {} has no keyframes", m_Description.CameraPathFilepath.string());
+        return false;
+    }
+
+    if (m_Description.FrameCount == 0)
+        m_Description.FrameCount = uint32_t(std::floor(m_Keyframes.back().Time / m_Description.FrameDeltaTime)) + 1;
+
+    m_CPUFrameTimesMS.assign(m_Description.FrameCount, 0.0);
+    m_GPUFrameTimesMS.assign(m_Description.FrameCount, 0.0);
+    m_HasGPUFrameTime.assign(m_Description.FrameCount, false);
+    m_CurrentFrame = 0;
+
+    HEXRAY_INFO("Benchmark: Loaded {} camera keyframes, rendering {} frames", m_Keyframes.size(), m_Description.FrameCount);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Benchmark::BeginFrame(Camera& camera)
+{
+    // Time is derived from the frame number instead of accumulated, so every run sees the exact same camera positions
+    uint32_t recordedFrame = m_CurrentFrame < m_Description.WarmupFrameCount ? 0 : m_CurrentFrame - m_Description.WarmupFrameCount;
+    CameraKeyframe keyframe = EvaluateCameraPath(float(recordedFrame * m_Description.FrameDeltaTime));
+
+    camera.SetView(keyframe.Position, keyframe.Yaw, keyframe.Pitch);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Benchmark::EndFrame(double cpuFrameTimeMS, uint64_t gpuFrameNumber)
+{
+    if (m_CurrentFrame >= m_Description.WarmupFrameCount)
+    {
+        uint32_t recordedFrame = m_CurrentFrame - m_Description.WarmupFrameCount;
+        if (recordedFrame == 0)
+            m_FirstGPUFrameNumber = gpuFrameNumber;
+
+        m_CPUFrameTimesMS[recordedFrame] = cpuFrameTimeMS;
+    }
+
+    m_CurrentFrame++;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Benchmark::AddGPUFrameTimings(const std::vector<GPUFrameTiming>& timings)
+{
+    if (m_CurrentFrame <= m_Description.WarmupFrameCount)
+        return;
+
+    for (const GPUFrameTiming& timing : timings)
+    {
+        if (timing.FrameNumber < m_FirstGPUFrameNumber || timing.FrameNumber - m_FirstGPUFrameNumber >= m_GPUFrameTimesMS.size())
+            continue;
+
+        m_GPUFrameTimesMS[timing.FrameNumber - m_FirstGPUFrameNumber] = timing.TimeMS;
+        m_HasGPUFrameTime[timing.FrameNumber - m_FirstGPUFrameNumber] = true;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool Benchmark::WriteReport(const std::string& sceneName) const
+{
+    std::ofstream stream(m_Description.OutputFilepath);
+    if (!stream)
+    {
+        HEXRAY_ERROR("Benchmark: Failed writing report {}", m_Description.OutputFilepath.string());
+        return false;
+    }
+
+    stream << std::fixed << std::setprecision(4);
+    stream << "{\n";
+    stream << "    \"scene\": \"" << EscapeJSONString(sceneName) << "\",\n";
+    stream << "    \"cameraPath\": \"" << EscapeJSONString(m_Description.CameraPathFilepath.generic_string()) << "\",\n";
+    stream << "    \"frameCount\": " << m_Description.FrameCount << ",\n";
+    stream << "    \"warmupFrameCount\": " << m_Description.WarmupFrameCount << ",\n";
+    stream << "    \"frameDeltaTime\": " << m_Description.FrameDeltaTime << ",\n";
+    WriteFrameTimeStatistics(stream, "cpu", m_CPUFrameTimesMS, std::vector<bool>(m_CPUFrameTimesMS.size(), true), false);
+    WriteFrameTimeStatistics(stream, "gpu", m_GPUFrameTimesMS, m_HasGPUFrameTime, true);
+    stream << "}\n";
+
+    size_t gpuFrameCount = std::count(m_HasGPUFrameTime.begin(), m_HasGPUFrameTime.end(), true);
+    if (gpuFrameCount < m_Description.FrameCount)
+        HEXRAY_WARNING("Benchmark: Only {} of {} frames have a GPU timing", gpuFrameCount, m_Description.FrameCount);
+
+    HEXRAY_INFO("Benchmark: Wrote report for {} frames to {}", m_Description.FrameCount, m_Description.OutputFilepath.string());
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+CameraKeyframe Benchmark::EvaluateCameraPath(float time) const
+{
+    if (time <= m_Keyframes.front().Time)
+        return m_Keyframes.front();
+
+    if (time >= m_Keyframes.back().Time)
+        return m_Keyframes.back();
+
+    auto next = std::upper_bound(m_Keyframes.begin(), m_Keyframes.end(), time, [](float t, const CameraKeyframe& keyframe) { return t < keyframe.Time; });
+    const CameraKeyframe& k1 = *next;
+    const CameraKeyframe& k0 = *(next - 1);
+
+    float duration = k1.Time - k0.Time;
+    float t = duration > 0.0f ? (time - k0.Time) / duration : 1.0f;
+
+    CameraKeyframe result;
+    result.Time = time;
+    result.Position = glm::mix(k0.Position, k1.Position, t);
+    result.Yaw = glm::mix(k0.Yaw, k1.Yaw, t);
+    result.Pitch = glm::mix(k0.Pitch, k1.Pitch, t);
+    return result;
+}
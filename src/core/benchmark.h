@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/core.h"
+#include "rendering/camera.h"
+#include "rendering/graphicscontext.h"
+
+struct CameraKeyframe
+{
+    float Time = 0.0f;
+    glm::vec3 Position = glm::vec3(0.0f);
+    float Yaw = 0.0f;
+    float Pitch = 0.0f;
+};
+
+struct BenchmarkDescription
+{
+    std::filesystem::path CameraPathFilepath;
+    std::filesystem::path OutputFilepath = "benchmark.json";
+    uint32_t FrameCount = 0;
+    uint32_t WarmupFrameCount = 16;
+    double FrameDeltaTime = 1.0 / 60.0;
+};
+
+// Plays back a camera path with a fixed time step and records the CPU and GPU time of every frame. The path is a text file
+// with one "time x y z yaw pitch" keyframe per line, lines starting with '#' are ignored. Without an explicit frame count the
+// path is played once. Warmup frames render the first keyframe and are not recorded. Frames without a GPU timing are left out
+// of the GPU statistics instead of counting as zero
+class Benchmark
+{
+public:
+    Benchmark(const BenchmarkDescription& description);
+
+    bool LoadCameraPath();
+
+    void BeginFrame(Camera& camera);
+    void EndFrame(double cpuFrameTimeMS, uint64_t gpuFrameNumber);
+    void AddGPUFrameTimings(const std::vector<GPUFrameTiming>& timings);
+    bool WriteReport(const std::string& sceneName) const;
+
+    inline bool IsFinished() const { return m_CurrentFrame >= m_Description.WarmupFrameCount + m_Description.FrameCount; }
+    inline const BenchmarkDescription& GetDescription() const { return m_Description; }
+private:
+    CameraKeyframe EvaluateCameraPath(float time) const;
+private:
+    BenchmarkDescription m_Description;
+    std::vector<CameraKeyframe> m_Keyframes;
+    std::vector<double> m_CPUFrameTimesMS;
+    std::vector<double> m_GPUFrameTimesMS;
+    std::vector<bool> m_HasGPUFrameTime;
+    uint64_t m_FirstGPUFrameNumber = 0;
+    uint32_t m_CurrentFrame = 0;
+};
@@ -0,0 +1,30 @@
+#include "filewatcher.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+FileWatcher::FileWatcher(const std::filesystem::path& filepath, double pollIntervalMS)
+    : m_Filepath(filepath), m_LastPollTime(std::chrono::steady_clock::now()), m_PollIntervalMS(pollIntervalMS)
+{
+    std::error_code error;
+    m_LastWriteTime = std::filesystem::last_write_time(m_Filepath, error);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool FileWatcher::CheckForChanges()
+{
+    if (!IsWatching())
+        return false;
+
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double, std::milli>(now - m_LastPollTime).count() < m_PollIntervalMS)
+        return false;
+
+    m_LastPollTime = now;
+
+    std::error_code error;
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(m_Filepath, error);
+    if (error || writeTime == m_LastWriteTime)
+        return false;
+
+    m_LastWriteTime = writeTime;
+    return true;
+}
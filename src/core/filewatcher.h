@@ -0,0 +1,24 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <chrono>
+
+// Polls the last write time of a single file. Editors often save by replacing the file, so a missing file is not reported
+// as a change and the new time stamp is picked up once the file exists again
+class FileWatcher
+{
+public:
+    FileWatcher() = default;
+    FileWatcher(const std::filesystem::path& filepath, double pollIntervalMS = 250.0);
+
+    bool CheckForChanges();
+
+    inline bool IsWatching() const { return !m_Filepath.empty(); }
+    inline const std::filesystem::path& GetFilepath() const { return m_Filepath; }
+private:
+    std::filesystem::path m_Filepath;
+    std::filesystem::file_time_type m_LastWriteTime;
+    std::chrono::steady_clock::time_point m_LastPollTime;
+    double m_PollIntervalMS = 250.0;
+};
@@ -10,7 +10,7 @@ void Timer::Reset()
 void Timer::Stop()
 {
     auto endPoint = std::chrono::steady_clock::now();
-    m_ElapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(endPoint - m_StartPoint).count();
+    m_ElapsedTime = std::chrono::duration<double, std::milli>(endPoint - m_StartPoint).count();
 }
 
 double Timer::GetTimeNow() const
@@ -3,6 +3,8 @@
 
 #include <cstdarg>
 #include <fstream>
+#include <tmmintrin.h>
+#include <Windows.h>
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& outData)
@@ -17,9 +19,9 @@ bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& outData)
 	uint32_t fileSize = ifs.tellg();
 	outData.resize(fileSize);
 	ifs.seekg(0, std::ios::beg);
-	ifs.read((char*)outData.data(), fileSize);
-	ifs.close();
-	return true;
+
+	// A short read leaves the tail of the buffer unfilled, so it fails like a missing file
+	return (bool)ifs.read((char*)outData.data(), fileSize);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -35,9 +37,7 @@ bool ReadFile(const std::filesystem::path& path, std::string& outData)
 	uint32_t fileSize = ifs.tellg();
 	outData.resize(fileSize);
 	ifs.seekg(0, std::ios::beg);
-	ifs.read(outData.data(), fileSize);
-	ifs.close();
-	return true;
+	return (bool)ifs.read(outData.data(), fileSize);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -102,6 +102,55 @@ std::vector<std::string> Tokenize(const std::string& s)
 	return result;
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+MappedFile::MappedFile(const std::filesystem::path& path, bool copyOnWrite)
+{
+	HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	m_FileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		return;
+	}
+
+	m_Size = (size_t)fileSize.QuadPart;
+
+	// Empty files can't be mapped
+	if (m_Size == 0)
+	{
+		m_IsValid = true;
+		return;
+	}
+
+	m_MappingHandle = CreateFileMappingW(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+	if (!m_MappingHandle)
+	{
+		return;
+	}
+
+	m_Data = (char*)MapViewOfFile(m_MappingHandle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	m_IsValid = m_Data != nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+
+	if (m_FileHandle)
+		CloseHandle(m_FileHandle);
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 bool AreAllBytesZero(void* data, size_t size)
 {
@@ -109,3 +158,41 @@ bool AreAllBytesZero(void* data, size_t size)
 	HEXRAY_ASSERT(size < 128);
 	return memcmp(data, zeros, size) == 0;
 }
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void ExpandRGBToRGBA(const uint8_t* src, uint8_t* dest, size_t pixelCount, uint8_t alpha)
+{
+	size_t pixel = 0;
+
+	// 16 pixels per iteration: 3 loads of 48 RGB bytes are split into 4 groups of 4 pixels and shuffled into 64 RGBA bytes
+	const __m128i shuffleMask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alphaMask = _mm_set1_epi32(int32_t(uint32_t(alpha) << 24));
+	for (; pixel + 16 <= pixelCount; pixel += 16)
+	{
+		const uint8_t* s = src + pixel * 3;
+		uint8_t* d = dest + pixel * 4;
+
+		__m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+
+		__m128i p0 = a;
+		__m128i p1 = _mm_alignr_epi8(b, a, 12);
+		__m128i p2 = _mm_alignr_epi8(c, b, 8);
+		__m128i p3 = _mm_srli_si128(c, 4);
+
+		_mm_storeu_si128((__m128i*)(d + 0), _mm_or_si128(_mm_shuffle_epi8(p0, shuffleMask), alphaMask));
+		_mm_storeu_si128((__m128i*)(d + 16), _mm_or_si128(_mm_shuffle_epi8(p1, shuffleMask), alphaMask));
+		_mm_storeu_si128((__m128i*)(d + 32), _mm_or_si128(_mm_shuffle_epi8(p2, shuffleMask), alphaMask));
+		_mm_storeu_si128((__m128i*)(d + 48), _mm_or_si128(_mm_shuffle_epi8(p3, shuffleMask), alphaMask));
+	}
+
+	for (; pixel < pixelCount; pixel++)
+	{
+		dest[pixel * 4 + 0] = src[pixel * 3 + 0];
+		dest[pixel * 4 + 1] = src[pixel * 3 + 1];
+		dest[pixel * 4 + 2] = src[pixel * 3 + 2];
+		dest[pixel * 4 + 3] = alpha;
+	}
+}
\ No newline at end of file
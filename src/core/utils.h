@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <execution>
+#include <numeric>
 
 bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& outData);
 bool ReadFile(const std::filesystem::path& path, std::string& outData);
@@ -13,6 +15,9 @@ std::vector<std::string> Tokenize(const std::string& str);
 
 bool AreAllBytesZero(void* data, size_t size);
 
+// Expands tightly packed 8-bit RGB pixels to RGBA with a constant alpha. The source and destination must not overlap
+void ExpandRGBToRGBA(const uint8_t* src, uint8_t* dest, size_t pixelCount, uint8_t alpha = 255);
+
 /// a simple RAII class for FILE* pointers.
 class FileRAII
 {
@@ -24,6 +29,26 @@ public:
 	FileRAII& operator = (const FileRAII&) = delete;
 };
 
+/// a read-only or copy-on-write view of a whole file. Copy-on-write views can be modified in place without touching the file
+class MappedFile
+{
+public:
+	MappedFile(const std::filesystem::path& path, bool copyOnWrite = false);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator = (const MappedFile&) = delete;
+
+	inline bool IsValid() const { return m_IsValid; }
+	inline char* GetData() const { return m_Data; }
+	inline size_t GetSize() const { return m_Size; }
+private:
+	void* m_FileHandle = nullptr;
+	void* m_MappingHandle = nullptr;
+	char* m_Data = nullptr;
+	size_t m_Size = 0;
+	bool m_IsValid = false;
+};
+
 // Based on boost::hash_combine
 template <typename T>
 void HashCombine(size_t& accumulatedHash, const T& value)
@@ -41,4 +66,23 @@ struct std::hash<std::pair<T, U>>
 		HashCombine(hash, p.second);
 		return hash;
 	}
-};
\ No newline at end of file
+};
+
+inline size_t GetChunkCount(size_t count, size_t chunkSize)
+{
+	return (count + chunkSize - 1) / chunkSize;
+}
+
+// Splits [0, count) into contiguous chunks of chunkSize elements and calls func(chunkIndex, begin, end) for all chunks in
+// parallel. Chunk indices are stable, so every chunk can write to its own output slot and the results merged without locks
+template <typename Func>
+void ParallelForChunks(size_t count, size_t chunkSize, Func&& func)
+{
+	std::vector<size_t> chunks(GetChunkCount(count, chunkSize));
+	std::iota(chunks.begin(), chunks.end(), size_t(0));
+
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t chunk)
+	{
+		func(chunk, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+	});
+}
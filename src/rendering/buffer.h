@@ -20,8 +20,8 @@ public:
     Buffer(const BufferDescription& description, const wchar_t* debugName = L"Unnamed Buffer");
     ~Buffer();
 
-    inline DescriptorIndex GetSRV() const { return m_SRVDescriptor; }
-    inline DescriptorIndex GetUAV() const { return m_UAVDescriptor; }
+    inline DescriptorIndex GetSRV() const { return GetDescriptorSlot(m_SRVDescriptor); }
+    inline DescriptorIndex GetUAV() const { return GetDescriptorSlot(m_UAVDescriptor); }
 
     inline uint32_t GetSize() const { return m_Description.ElementCount * m_Description.ElementSize; }
     inline uint32_t GetElementSize() const { return m_Description.ElementSize; }
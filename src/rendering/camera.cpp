@@ -109,6 +109,17 @@ void Camera::SetViewportSize(uint32_t width, uint32_t height)
     RecalculateProjection();
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Camera::SetView(const glm::vec3& position, float yaw, float pitch)
+{
+    m_Position = position;
+    m_YawAngle = yaw;
+    m_PitchAngle = std::clamp(pitch, -89.0f, 89.0f);
+    m_HasMoved = true;
+
+    RecalculateView();
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 void Camera::RecalculateProjection()
 {
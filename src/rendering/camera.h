@@ -8,6 +8,7 @@ class Camera
 {
 public:
 	friend class DefaultSceneParser;
+	friend class SceneCache;
 public:
 	Camera() = default;
 	Camera(float fov, float aspectRatio, const glm::vec3& position, float yaw, float pitch, float exposure);
@@ -20,6 +21,7 @@ public:
 	glm::vec3 GetCameraFront() const;
 
 	void SetViewportSize(uint32_t width, uint32_t height);
+	void SetView(const glm::vec3& position, float yaw, float pitch);
 
 	inline void SetPerspectiveFOV(float fov) { m_PerspectiveFOV = fov; RecalculateProjection(); }
 
@@ -31,8 +31,4 @@ public:
 
     static void Initialize();
     static void Shutdown();
-
-private:
-    static std::unordered_map<glm::vec4, TexturePtr> m_RuntimeColorTextures;
-    static std::unordered_map<std::pair<glm::vec4, glm::vec4>, TexturePtr> m_RuntimeCheckerTextures;
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "descriptorallocator.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static uint64_t MakeFreeListHead(uint32_t slot, uint32_t tag)
+{
+    return (uint64_t(tag) << 32) | slot;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+DescriptorAllocator::DescriptorAllocator(uint32_t capacity)
+    : m_Capacity(capacity), m_NextSlots(new std::atomic<uint32_t>[capacity]), m_Generations(new std::atomic<uint32_t>[capacity]), m_AllocatedCount(0)
+{
+    HEXRAY_ASSERT_MSG(capacity > 0 && capacity <= DescriptorSlotMask, "Descriptor allocator capacity has to fit into {} bits", DescriptorSlotBits);
+
+    // Slots are handed out in ascending order initially
+    for (uint32_t slot = 0; slot < capacity; slot++)
+    {
+        m_NextSlots[slot].store(slot + 1 < capacity ? slot + 1 : EndOfList, std::memory_order_relaxed);
+        m_Generations[slot].store(0, std::memory_order_relaxed);
+    }
+
+    for (uint32_t frameIndex = 0; frameIndex < FRAMES_IN_FLIGHT; frameIndex++)
+        m_DeferredReleaseHeads[frameIndex].store(EndOfList, std::memory_order_relaxed);
+
+    m_FreeListHead.store(MakeFreeListHead(0, 0), std::memory_order_release);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+DescriptorIndex DescriptorAllocator::Allocate()
+{
+    uint64_t head = m_FreeListHead.load(std::memory_order_acquire);
+    uint32_t slot = EndOfList;
+
+    while (true)
+    {
+        slot = uint32_t(head);
+        if (slot == EndOfList)
+            return InvalidDescriptorIndex;
+
+        // The next slot may be stale if another thread took this slot in the meantime, the tag makes the exchange fail then
+        uint32_t nextSlot = m_NextSlots[slot].load(std::memory_order_relaxed);
+        if (m_FreeListHead.compare_exchange_weak(head, MakeFreeListHead(nextSlot, uint32_t(head >> 32) + 1), std::memory_order_acq_rel, std::memory_order_acquire))
+            break;
+    }
+
+    m_AllocatedCount.fetch_add(1, std::memory_order_relaxed);
+    return MakeDescriptorIndex(slot, m_Generations[slot].load(std::memory_order_relaxed));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void DescriptorAllocator::Release(DescriptorIndex index)
+{
+    if (!InvalidateSlot(index))
+        return;
+
+    uint32_t slot = GetDescriptorSlot(index);
+    PushFreeSlots(slot, slot);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void DescriptorAllocator::ReleaseDeferred(DescriptorIndex index, uint32_t frameIndex)
+{
+    HEXRAY_ASSERT(frameIndex < FRAMES_IN_FLIGHT);
+
+    // The index becomes stale right away, only the slot is kept from reuse until the frame finished on the GPU
+    if (!InvalidateSlot(index))
+        return;
+
+    uint32_t slot = GetDescriptorSlot(index);
+    uint32_t head = m_DeferredReleaseHeads[frameIndex].load(std::memory_order_relaxed);
+
+    do
+    {
+        m_NextSlots[slot].store(head, std::memory_order_relaxed);
+    } while (!m_DeferredReleaseHeads[frameIndex].compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void DescriptorAllocator::ProcessDeferredReleases(uint32_t frameIndex)
+{
+    HEXRAY_ASSERT(frameIndex < FRAMES_IN_FLIGHT);
+
+    uint32_t firstSlot = m_DeferredReleaseHeads[frameIndex].exchange(EndOfList, std::memory_order_acquire);
+    if (firstSlot == EndOfList)
+        return;
+
+    // The detached list is only owned by this thread, so it is returned to the free slots with a single exchange
+    uint32_t lastSlot = firstSlot;
+    while (m_NextSlots[lastSlot].load(std::memory_order_relaxed) != EndOfList)
+        lastSlot = m_NextSlots[lastSlot].load(std::memory_order_relaxed);
+
+    PushFreeSlots(firstSlot, lastSlot);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool DescriptorAllocator::IsValid(DescriptorIndex index) const
+{
+    uint32_t slot = GetDescriptorSlot(index);
+    return slot < m_Capacity && m_Generations[slot].load(std::memory_order_relaxed) == GetDescriptorGeneration(index);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool DescriptorAllocator::InvalidateSlot(DescriptorIndex index)
+{
+    uint32_t slot = GetDescriptorSlot(index);
+    HEXRAY_ASSERT_MSG(slot < m_Capacity, "Descriptor index {} is out of range", index);
+
+    if (slot >= m_Capacity)
+        return false;
+
+    // Only one release of the same index can win, releasing a stale index again is caught here
+    uint32_t generation = GetDescriptorGeneration(index);
+    bool isReleased = m_Generations[slot].compare_exchange_strong(generation, (generation + 1) & DescriptorGenerationMask, std::memory_order_relaxed);
+    HEXRAY_ASSERT_MSG(isReleased, "Descriptor index {} is stale, slot {} is at generation {}", index, slot, generation);
+
+    if (!isReleased)
+        return false;
+
+    m_AllocatedCount.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void DescriptorAllocator::PushFreeSlots(uint32_t firstSlot, uint32_t lastSlot)
+{
+    uint64_t head = m_FreeListHead.load(std::memory_order_relaxed);
+
+    do
+    {
+        m_NextSlots[lastSlot].store(uint32_t(head), std::memory_order_relaxed);
+    } while (!m_FreeListHead.compare_exchange_weak(head, MakeFreeListHead(firstSlot, uint32_t(head >> 32) + 1), std::memory_order_release, std::memory_order_relaxed));
+}
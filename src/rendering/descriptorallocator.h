@@ -0,0 +1,62 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <atomic>
+
+// Descriptor indices hold the slot of the descriptor in their low bits and the generation of the slot in their high bits.
+// The generation changes every time the slot is released, so indices that outlived their descriptor are detected. Shaders
+// only ever see the slot
+using DescriptorIndex = uint32_t;
+static constexpr DescriptorIndex InvalidDescriptorIndex = UINT32_MAX;
+static constexpr uint32_t DescriptorSlotBits = 20;
+static constexpr uint32_t DescriptorSlotMask = (1u << DescriptorSlotBits) - 1;
+static constexpr uint32_t DescriptorGenerationMask = (1u << (32 - DescriptorSlotBits)) - 1;
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+inline DescriptorIndex MakeDescriptorIndex(uint32_t slot, uint32_t generation)
+{
+    return ((generation & DescriptorGenerationMask) << DescriptorSlotBits) | (slot & DescriptorSlotMask);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+inline uint32_t GetDescriptorSlot(DescriptorIndex index)
+{
+    return index == InvalidDescriptorIndex ? InvalidDescriptorIndex : index & DescriptorSlotMask;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+inline uint32_t GetDescriptorGeneration(DescriptorIndex index)
+{
+    return index >> DescriptorSlotBits;
+}
+
+// Platform independent allocator for the slots of one descriptor table. Free slots form a lock free stack linked through the
+// slots themselves, the head is tagged with a counter so a slot that was popped and pushed again in between is not mistaken
+// for the old head. Deferred releases are pushed onto one lock free list per frame in flight, linked the same way
+class DescriptorAllocator
+{
+public:
+    DescriptorAllocator(uint32_t capacity);
+
+    DescriptorIndex Allocate();
+    void Release(DescriptorIndex index);
+    void ReleaseDeferred(DescriptorIndex index, uint32_t frameIndex);
+    void ProcessDeferredReleases(uint32_t frameIndex);
+
+    bool IsValid(DescriptorIndex index) const;
+    inline uint32_t GetCapacity() const { return m_Capacity; }
+    inline uint32_t GetAllocatedCount() const { return m_AllocatedCount.load(std::memory_order_relaxed); }
+private:
+    bool InvalidateSlot(DescriptorIndex index);
+    void PushFreeSlots(uint32_t firstSlot, uint32_t lastSlot);
+private:
+    static constexpr uint32_t EndOfList = UINT32_MAX;
+
+    uint32_t m_Capacity;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_NextSlots;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_Generations;
+    std::atomic<uint64_t> m_FreeListHead;
+    std::atomic<uint32_t> m_DeferredReleaseHeads[FRAMES_IN_FLIGHT];
+    std::atomic<uint32_t> m_AllocatedCount;
+};
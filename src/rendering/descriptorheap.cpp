@@ -3,7 +3,7 @@
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 DescriptorHeapBase::DescriptorHeapBase(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t capacity, const wchar_t* debugName)
-    : m_Type(type), m_Capacity(capacity), m_Size(0)
+    : m_Type(type), m_Capacity(capacity)
 {
 
     HEXRAY_ASSERT(capacity);
@@ -30,22 +30,15 @@ DescriptorHeapBase::DescriptorHeapBase(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 StandardDescriptorHeap::StandardDescriptorHeap(const StandardDescriptorHeapDescription& description, const wchar_t* debugName)
-    : DescriptorHeapBase(description.Type, description.Capacity, debugName)
+    : DescriptorHeapBase(description.Type, description.Capacity, debugName), m_Allocator(description.Capacity)
 {
-    for (uint32_t i = 0; i < description.Capacity; i++)
-        m_FreeSlots.push(i);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 DescriptorIndex StandardDescriptorHeap::Allocate()
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-
-    HEXRAY_ASSERT_MSG(!m_FreeSlots.empty(), "Heap is full");
-
-    uint32_t descriptorIndex = m_FreeSlots.front();
-    m_FreeSlots.pop();
-    m_Size++;
+    DescriptorIndex descriptorIndex = m_Allocator.Allocate();
+    HEXRAY_ASSERT_MSG(descriptorIndex != InvalidDescriptorIndex, "Heap is full");
 
     return descriptorIndex;
 }
@@ -53,32 +46,35 @@ DescriptorIndex StandardDescriptorHeap::Allocate()
 // ------------------------------------------------------------------------------------------------------------------------------------
 void StandardDescriptorHeap::ReleaseDescriptor(DescriptorIndex descriptorIndex, bool deferredRelease)
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-
-    uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
     if (deferredRelease)
     {
-        m_DeferredReleaseDescriptors[currentFrameIndex].push_back(descriptorIndex);
+        uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
+        m_Allocator.ReleaseDeferred(descriptorIndex, currentFrameIndex);
     }
     else
     {
-        m_Size--;
-        m_FreeSlots.push(descriptorIndex);
+        m_Allocator.Release(descriptorIndex);
     }
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 void StandardDescriptorHeap::ProcessDeferredReleases(uint32_t frameIndex)
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Allocator.ProcessDeferredReleases(frameIndex);
+}
 
-    for (DescriptorIndex index : m_DeferredReleaseDescriptors[frameIndex])
-    {
-        m_Size--;
-        m_FreeSlots.push(index);
-    }
+// ------------------------------------------------------------------------------------------------------------------------------------
+D3D12_CPU_DESCRIPTOR_HANDLE StandardDescriptorHeap::GetCPUHandle(DescriptorIndex index) const
+{
+    HEXRAY_ASSERT_MSG(m_Allocator.IsValid(index), "Descriptor index {} is stale", index);
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_CPUStartHandle, GetDescriptorSlot(index), m_DescriptorSize);
+}
 
-    m_DeferredReleaseDescriptors[frameIndex].clear();
+// ------------------------------------------------------------------------------------------------------------------------------------
+D3D12_GPU_DESCRIPTOR_HANDLE StandardDescriptorHeap::GetGPUHandle(DescriptorIndex index) const
+{
+    HEXRAY_ASSERT_MSG(m_Allocator.IsValid(index), "Descriptor index {} is stale", index);
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_GPUStartHandle, GetDescriptorSlot(index), m_DescriptorSize);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -98,11 +94,7 @@ SegregatedDescriptorHeap::SegregatedDescriptorHeap(const SegregatedDescriptorHea
     for (uint32_t type = 0; type < NumDescriptorTypes; type++)
     {
         m_DescriptorTableOffsets[type] = currentOffset;
-
-        for (uint32_t j = 0; j < description.DescriptorTableSizes[type]; j++)
-        {
-            m_FreeSlots[type].push(j);
-        }
+        m_Allocators[type] = std::make_unique<DescriptorAllocator>(description.DescriptorTableSizes[type]);
 
         currentOffset += description.DescriptorTableSizes[type];
     }
@@ -111,13 +103,8 @@ SegregatedDescriptorHeap::SegregatedDescriptorHeap(const SegregatedDescriptorHea
 // ------------------------------------------------------------------------------------------------------------------------------------
 DescriptorIndex SegregatedDescriptorHeap::Allocate(DescriptorType descriptorType)
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-
-    HEXRAY_ASSERT_MSG(!m_FreeSlots[descriptorType].empty(), "Descriptor table for type {} is full", descriptorType);
-
-    uint32_t descriptorIndex = m_FreeSlots[descriptorType].front();
-    m_FreeSlots[descriptorType].pop();
-    m_Size++;
+    DescriptorIndex descriptorIndex = m_Allocators[descriptorType]->Allocate();
+    HEXRAY_ASSERT_MSG(descriptorIndex != InvalidDescriptorIndex, "Descriptor table for type {} is full", descriptorType);
 
     return descriptorIndex;
 }
@@ -125,32 +112,36 @@ DescriptorIndex SegregatedDescriptorHeap::Allocate(DescriptorType descriptorType
 // ------------------------------------------------------------------------------------------------------------------------------------
 void SegregatedDescriptorHeap::ReleaseDescriptor(DescriptorIndex descriptorIndex, DescriptorType descriptorType, bool deferredRelease)
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
-
-    uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
     if (deferredRelease)
     {
-        m_DeferredReleaseDescriptors[currentFrameIndex].push_back({ descriptorIndex, descriptorType });
+        uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
+        m_Allocators[descriptorType]->ReleaseDeferred(descriptorIndex, currentFrameIndex);
     }
     else
     {
-        m_Size--;
-        m_FreeSlots[descriptorType].push(descriptorIndex);
+        m_Allocators[descriptorType]->Release(descriptorIndex);
     }
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 void SegregatedDescriptorHeap::ProcessDeferredReleases(uint32_t frameIndex)
 {
-    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (uint32_t type = 0; type < NumDescriptorTypes; type++)
+        m_Allocators[type]->ProcessDeferredReleases(frameIndex);
+}
 
-    for (auto& [descriptorIndex, descriptorType] : m_DeferredReleaseDescriptors[frameIndex])
-    {
-        m_Size--;
-        m_FreeSlots[descriptorType].push(descriptorIndex);
-    }
+// ------------------------------------------------------------------------------------------------------------------------------------
+D3D12_CPU_DESCRIPTOR_HANDLE SegregatedDescriptorHeap::GetCPUHandle(DescriptorIndex index, DescriptorType type) const
+{
+    HEXRAY_ASSERT_MSG(m_Allocators[type]->IsValid(index), "Descriptor index {} is stale", index);
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_CPUStartHandle, GetDescriptorSlot(index) + m_DescriptorTableOffsets[type], m_DescriptorSize);
+}
 
-    m_DeferredReleaseDescriptors[frameIndex].clear();
+// ------------------------------------------------------------------------------------------------------------------------------------
+D3D12_GPU_DESCRIPTOR_HANDLE SegregatedDescriptorHeap::GetGPUHandle(DescriptorIndex index, DescriptorType type) const
+{
+    HEXRAY_ASSERT_MSG(m_Allocators[type]->IsValid(index), "Descriptor index {} is stale", index);
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_GPUStartHandle, GetDescriptorSlot(index) + m_DescriptorTableOffsets[type], m_DescriptorSize);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -2,11 +2,7 @@
 
 #include "core/core.h"
 #include "rendering/directx12.h"
-
-#include <queue>
-
-using DescriptorIndex = uint32_t;
-static constexpr DescriptorIndex InvalidDescriptorIndex = UINT32_MAX;
+#include "rendering/descriptorallocator.h"
 
 class DescriptorHeapBase
 {
@@ -26,7 +22,6 @@ protected:
     D3D12_CPU_DESCRIPTOR_HANDLE m_CPUStartHandle{ 0 };
     D3D12_GPU_DESCRIPTOR_HANDLE m_GPUStartHandle{ 0 };
     uint32_t m_Capacity;
-    uint32_t m_Size;
     uint32_t m_DescriptorSize;
     ComPtr<ID3D12DescriptorHeap> m_Heap;
 };
@@ -47,12 +42,11 @@ public:
     void ReleaseDescriptor(DescriptorIndex descriptorIndex, bool deferredRelease);
     void ProcessDeferredReleases(uint32_t frameIndex);
 
-    inline D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(DescriptorIndex index) const { return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_CPUStartHandle, index, m_DescriptorSize); }
-    inline D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(DescriptorIndex index) const { return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_GPUStartHandle, index, m_DescriptorSize); }
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(DescriptorIndex index) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(DescriptorIndex index) const;
+    inline uint32_t GetAllocatedCount() const { return m_Allocator.GetAllocatedCount(); }
 private:
-    std::queue<DescriptorIndex> m_FreeSlots;
-    std::vector<DescriptorIndex> m_DeferredReleaseDescriptors[FRAMES_IN_FLIGHT];
-    std::mutex m_Mutex;
+    DescriptorAllocator m_Allocator;
 };
 
 enum DescriptorType
@@ -84,15 +78,13 @@ public:
     void ProcessDeferredReleases(uint32_t frameIndex);
 
     inline const SegregatedDescriptorHeapDescription& GetDescription() const { return m_Description; }
-    inline D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(DescriptorIndex index, DescriptorType type) const { return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_CPUStartHandle, index + m_DescriptorTableOffsets[type], m_DescriptorSize); }
-    inline D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(DescriptorIndex index, DescriptorType type) const { return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_GPUStartHandle, index + m_DescriptorTableOffsets[type], m_DescriptorSize); }
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(DescriptorIndex index, DescriptorType type) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(DescriptorIndex index, DescriptorType type) const;
 public:
     static uint32_t GetShaderSpaceForDescriptorType(DescriptorType type);
     static bool IsDescriptorTypeReadOnly(DescriptorType type);
 private:
     SegregatedDescriptorHeapDescription m_Description;
     uint32_t m_DescriptorTableOffsets[NumDescriptorTypes];
-    std::queue<DescriptorIndex> m_FreeSlots[NumDescriptorTypes];
-    std::vector<std::pair<DescriptorIndex, DescriptorType>> m_DeferredReleaseDescriptors[FRAMES_IN_FLIGHT];
-    std::mutex m_Mutex;
+    std::unique_ptr<DescriptorAllocator> m_Allocators[NumDescriptorTypes];
 };
\ No newline at end of file
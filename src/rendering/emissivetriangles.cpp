@@ -0,0 +1,105 @@
+#include "emissivetriangles.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void EmissiveTriangles::Clear()
+{
+    m_Instances.clear();
+    m_InstanceWeights.clear();
+    m_Cdf.clear();
+    m_TriangleCdfs.clear();
+    m_TriangleCdfOffsets.clear();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void EmissiveTriangles::AddInstance(const glm::mat4& transform, uint32_t geometryIndex, const float* triangleAreas, uint32_t triangleCount, float surfaceArea, const glm::vec3& emission, bool isTwoSided)
+{
+    // Scaling by s changes areas by s^2, the cube root of the determinant is the average scale along the three axes
+    float areaScale = glm::pow(glm::abs(glm::determinant(glm::mat3(transform))), 2.0f / 3.0f);
+    float weight = GetEmissionLuminance(emission) * surfaceArea * areaScale;
+    if (!(weight > 0.0f) || triangleCount == 0)
+        return;
+
+    auto found = m_TriangleCdfOffsets.find(geometryIndex);
+    if (found == m_TriangleCdfOffsets.end())
+    {
+        // The surface area weights the instance, the triangle CDF is normalized by the areas it is built from
+        double triangleAreaSum = 0.0;
+        for (uint32_t i = 0; i < triangleCount; i++)
+            triangleAreaSum += glm::max(triangleAreas[i], 0.0f);
+
+        if (!(triangleAreaSum > 0.0))
+            return;
+
+        found = m_TriangleCdfOffsets.emplace(geometryIndex, uint32_t(m_TriangleCdfs.size())).first;
+
+        double areaSum = 0.0;
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            areaSum += glm::max(triangleAreas[i], 0.0f);
+            m_TriangleCdfs.push_back(float(areaSum / triangleAreaSum));
+        }
+
+        m_TriangleCdfs.back() = 1.0f;
+    }
+
+    EmissiveInstance& instance = m_Instances.emplace_back();
+    for (uint32_t row = 0; row < 3; row++)
+        instance.ObjectToWorld[row] = glm::vec4(transform[0][row], transform[1][row], transform[2][row], transform[3][row]);
+
+    instance.GeometryIndex = geometryIndex;
+    instance.TriangleCdfOffset = found->second;
+    instance.TriangleCount = triangleCount;
+    instance.IsTwoSided = isTwoSided;
+
+    m_InstanceWeights.push_back(weight);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void EmissiveTriangles::Build()
+{
+    uint32_t instanceCount = m_Instances.size();
+
+    m_Cdf.clear();
+    if (instanceCount == 0)
+        return;
+
+    double weightSum = 0.0;
+    for (float weight : m_InstanceWeights)
+        weightSum += weight;
+
+    // The emitter CDF goes first, so the triangle CDFs move behind it
+    double cumulativeWeight = 0.0;
+    for (float weight : m_InstanceWeights)
+    {
+        cumulativeWeight += weight;
+        m_Cdf.push_back(float(cumulativeWeight / weightSum));
+    }
+
+    m_Cdf.back() = 1.0f;
+    m_Cdf.insert(m_Cdf.end(), m_TriangleCdfs.begin(), m_TriangleCdfs.end());
+
+    for (EmissiveInstance& instance : m_Instances)
+        instance.TriangleCdfOffset += instanceCount;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t EmissiveTriangles::SampleInstance(float u, float& outPdf) const
+{
+    HEXRAY_ASSERT(!m_Instances.empty());
+    return SampleEmissiveCdf(m_Cdf.data(), 0, m_Instances.size(), u, outPdf);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t EmissiveTriangles::SampleTriangle(uint32_t instanceIndex, float u, float& outPdf) const
+{
+    HEXRAY_ASSERT(instanceIndex < m_Instances.size());
+
+    const EmissiveInstance& instance = m_Instances[instanceIndex];
+    return SampleEmissiveCdf(m_Cdf.data(), instance.TriangleCdfOffset, instance.TriangleCount, u, outPdf);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+float EmissiveTriangles::GetEmissionLuminance(const glm::vec3& emission)
+{
+    return glm::max(glm::dot(emission, glm::vec3(0.2126f, 0.7152f, 0.0722f)), 0.0f);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/core.h"
+#include "rendering/shaders/resources.h"
+
+// Collects the mesh instances whose materials emit light and builds the CDFs the shaders sample them with, so emissive
+// triangles are found by next event estimation instead of only by bounce rays that hit them by chance. Emitters are weighted
+// by their power, the luminance of their emission times their approximate world space area, and triangles by their area
+class EmissiveTriangles
+{
+public:
+    void Clear();
+    void AddInstance(const glm::mat4& transform, uint32_t geometryIndex, const float* triangleAreas, uint32_t triangleCount, float surfaceArea, const glm::vec3& emission, bool isTwoSided);
+    void Build();
+
+    uint32_t SampleInstance(float u, float& outPdf) const;
+    uint32_t SampleTriangle(uint32_t instanceIndex, float u, float& outPdf) const;
+
+    static float GetEmissionLuminance(const glm::vec3& emission);
+
+    inline const std::vector<EmissiveInstance>& GetInstances() const { return m_Instances; }
+    inline const std::vector<float>& GetCdf() const { return m_Cdf; }
+private:
+    std::vector<EmissiveInstance> m_Instances;
+    std::vector<float> m_InstanceWeights;
+    std::vector<float> m_Cdf;
+
+    // Instances of the same submesh share one triangle CDF, offsets are relative to the first triangle CDF until the build
+    std::vector<float> m_TriangleCdfs;
+    std::unordered_map<uint32_t, uint32_t> m_TriangleCdfOffsets;
+};
@@ -1,4 +1,5 @@
 #include "graphicscontext.h"
+#include "core/utils.h"
 
 #include <DirectXTex.h>
 #include <pix3.h>
@@ -17,6 +18,8 @@ GraphicsContext::GraphicsContext(const GraphicsContextDescription& description)
     CreateDescriptorHeaps();
     CreateSwapChainAndSyncPrimitives();
     CreateRootSignatures();
+    CreateTimestampQueries();
+    CreateUploadResources();
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -24,6 +27,18 @@ GraphicsContext::~GraphicsContext()
 {
     WaitForGPU();
 
+    m_TimestampReadbackBuffer.reset();
+    m_TimestampQueryHeap.Reset();
+
+    m_UploadBuffer.reset();
+    m_UploadAllocator.reset();
+    m_UploadCommandList.Reset();
+    for (uint32_t i = 0; i < UPLOAD_SUBMISSION_COUNT; i++)
+        m_UploadCommandAllocators[i].Reset();
+
+    CloseHandle(m_UploadFenceEvent);
+    m_UploadFence.Reset();
+
     for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
     {
         m_CommandAllocators[i].Reset();
@@ -72,11 +87,16 @@ void GraphicsContext::BeginFrame()
         WaitForSingleObjectEx(m_FrameFenceEvent, INFINITE, FALSE);
     }
 
+    // The timestamps of the frame that last used this back buffer are overwritten by this frame, read them before they are lost
+    CollectGPUFrameTimings();
+
     ProcessDeferredReleases(m_BackBufferIndex);
 
     DXCall(m_CommandAllocators[m_BackBufferIndex]->Reset());
     DXCall(m_CommandList->Reset(m_CommandAllocators[m_BackBufferIndex].Get(), nullptr));
 
+    m_CommandList->EndQuery(m_TimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, uint32_t(m_BackBufferIndex * 2));
+
     PIXBeginEvent(m_CommandList.Get(), 0, "BeginFrame");
 
     D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_BackBuffers[m_BackBufferIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);;
@@ -94,8 +114,15 @@ void GraphicsContext::EndFrame()
 
     PIXEndEvent(m_CommandList.Get());
 
+    uint32_t timestampIndex = uint32_t(m_BackBufferIndex * 2);
+    m_CommandList->EndQuery(m_TimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timestampIndex + 1);
+    m_CommandList->ResolveQueryData(m_TimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timestampIndex, 2,
+        m_TimestampReadbackBuffer->GetResource().Get(), timestampIndex * sizeof(uint64_t));
+
     DXCall(m_CommandList->Close());
 
+    WaitForUploadsOnGraphicsQueue();
+
     ID3D12CommandList* commandLists[] = { m_CommandList.Get() };
     m_GraphicsQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
 
@@ -104,6 +131,46 @@ void GraphicsContext::EndFrame()
 
     m_FrameFenceValues[m_BackBufferIndex] = ++m_FenceValue;
     DXCall(m_GraphicsQueue->Signal(m_FrameFence.Get(), m_FrameFenceValues[m_BackBufferIndex]));
+
+    m_TimestampFrameNumbers[m_BackBufferIndex] = ++m_FrameNumber;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::GetCompletedGPUFrameTimings(std::vector<GPUFrameTiming>& outTimings)
+{
+    CollectGPUFrameTimings();
+
+    std::sort(m_CollectedGPUFrameTimings.begin(), m_CollectedGPUFrameTimings.end(), [](const GPUFrameTiming& a, const GPUFrameTiming& b) { return a.FrameNumber < b.FrameNumber; });
+    outTimings.insert(outTimings.end(), m_CollectedGPUFrameTimings.begin(), m_CollectedGPUFrameTimings.end());
+    m_CollectedGPUFrameTimings.clear();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::CollectGPUFrameTimings()
+{
+    uint64_t completedFenceValue = m_FrameFence->GetCompletedValue();
+    const uint64_t* timestamps = reinterpret_cast<const uint64_t*>(m_TimestampReadbackBuffer->GetMappedData());
+
+    // A slot is tagged with its frame number when the frame is submitted and untagged once its timestamps are read. Slots are
+    // read here before BeginFrame reuses them, so no frame is lost when the CPU waits for the GPU to catch up
+    for (uint32_t slot = 0; slot < FRAMES_IN_FLIGHT; slot++)
+    {
+        if (m_TimestampFrameNumbers[slot] == 0 || completedFenceValue < m_FrameFenceValues[slot])
+            continue;
+
+        uint64_t beginTimestamp = timestamps[slot * 2];
+        uint64_t endTimestamp = timestamps[slot * 2 + 1];
+
+        // Timestamps that went backwards, e.g. after the GPU clock was reset, don't measure the frame
+        if (endTimestamp > beginTimestamp)
+        {
+            GPUFrameTiming& timing = m_CollectedGPUFrameTimings.emplace_back();
+            timing.FrameNumber = m_TimestampFrameNumbers[slot];
+            timing.TimeMS = double(endTimestamp - beginTimestamp) * 1000.0 / double(m_TimestampFrequency);
+        }
+
+        m_TimestampFrameNumbers[slot] = 0;
+    }
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -129,6 +196,11 @@ void GraphicsContext::ResizeSwapChain(uint32_t width, uint32_t height)
 // ------------------------------------------------------------------------------------------------------------------------------------
 void GraphicsContext::WaitForGPU()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_UploadMutex);
+        FlushUploads();
+    }
+
     HANDLE waitFenceEvent = CreateEvent(0, false, false, 0);
     ComPtr<ID3D12Fence1> waitFence;
     DXCall(m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&waitFence)));
@@ -154,14 +226,14 @@ void GraphicsContext::ProcessDeferredReleases(uint64_t frameIndex)
 
     std::lock_guard<std::mutex> lock(m_DeferredReleaseMutex);
 
-    for (ID3D12Resource2* resource : m_DeferredReleaseResources[frameIndex])
+    for (ID3D12Pageable* resource : m_DeferredReleaseResources[frameIndex])
         resource->Release();
 
     m_DeferredReleaseResources[frameIndex].clear();
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void GraphicsContext::ReleaseResource(ID3D12Resource2* resource, bool deferredRelease)
+void GraphicsContext::ReleaseResource(ID3D12Pageable* resource, bool deferredRelease)
 {
     if (!resource)
         return;
@@ -181,49 +253,20 @@ void GraphicsContext::UploadBufferData(Buffer* destBuffer, const void* data)
 {
     if (data)
     {
-        // Create an upload buffer that is large enough to contain the source data
-        BufferDescription uploadBufferDesc;
-        uploadBufferDesc.ElementCount = GetRequiredIntermediateSize(destBuffer->GetResource().Get(), 0, 1);
-        uploadBufferDesc.ElementSize = sizeof(uint8_t);
-        uploadBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
-        uploadBufferDesc.InitialState = D3D12_RESOURCE_STATE_GENERIC_READ;
-
-        std::unique_ptr<Buffer> uploadBuffer = std::make_unique<Buffer>(uploadBufferDesc, L"Upload Buffer");
-
-        // Create a new copy command list and execute the upload operation
-        HANDLE waitFenceEvent = CreateEvent(0, false, false, 0);
-        ComPtr<ID3D12Fence1> waitFence;
-        DXCall(m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&waitFence)));
-        DXCall(waitFence->SetName(L"Upload Wait Fence"));
-
-        ComPtr<ID3D12CommandAllocator> allocator;
-        DXCall(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator)));
-        DXCall(allocator->SetName(L"Upload Command Allocator"));
-
-        ComPtr<ID3D12GraphicsCommandList6> copyCmdList;
-        DXCall(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator.Get(), nullptr, IID_PPV_ARGS(&copyCmdList)));
-        DXCall(copyCmdList->SetName(L"Upload Command List"));
-        DXCall(copyCmdList->Close());
-        DXCall(copyCmdList->Reset(allocator.Get(), nullptr));
+        std::lock_guard<std::mutex> lock(m_UploadMutex);
 
-        D3D12_SUBRESOURCE_DATA subresourceData = {};
-        subresourceData.pData = data;
-        subresourceData.RowPitch = destBuffer->GetSize();
-        subresourceData.SlicePitch = subresourceData.RowPitch;
+        // Buffers larger than the upload buffer are copied in chunks
+        const uint8_t* srcData = reinterpret_cast<const uint8_t*>(data);
+        uint64_t size = destBuffer->GetSize();
 
-        UpdateSubresources<1>(copyCmdList.Get(), destBuffer->GetResource().Get(), uploadBuffer->GetResource().Get(), 0, 0, 1, &subresourceData);
-
-        DXCall(copyCmdList->Close());
-
-        ID3D12CommandList* copyCommandLists[] = { copyCmdList.Get() };
-        m_CopyQueue->ExecuteCommandLists(1, copyCommandLists);
-
-        // Wait for the upload to finish on the GPU before we continue
-        DXCall(m_CopyQueue->Signal(waitFence.Get(), 1));
-        DXCall(waitFence->SetEventOnCompletion(1, waitFenceEvent));
-        WaitForSingleObjectEx(waitFenceEvent, INFINITE, FALSE);
+        for (uint64_t chunkOffset = 0; chunkOffset < size; chunkOffset += UPLOAD_BUFFER_SIZE)
+        {
+            uint64_t chunkSize = std::min(size - chunkOffset, UPLOAD_BUFFER_SIZE);
+            uint64_t uploadOffset = AllocateUploadMemory(chunkSize, 16);
 
-        CloseHandle(waitFenceEvent);
+            memcpy(reinterpret_cast<uint8_t*>(m_UploadBuffer->GetMappedData()) + uploadOffset, srcData + chunkOffset, chunkSize);
+            m_UploadCommandList->CopyBufferRegion(destBuffer->GetResource().Get(), chunkOffset, m_UploadBuffer->GetResource().Get(), uploadOffset, chunkSize);
+        }
     }
 }
 
@@ -232,15 +275,15 @@ void GraphicsContext::UploadTextureData(Texture* destTexture, const void* data,
 {
     if (data)
     {
-        uint32_t subresourceIdx = D3D12CalcSubresource(mip, face, 0, destTexture->GetMipLevels(), destTexture->IsCubeMap() ? 6 : 1);
+        std::lock_guard<std::mutex> lock(m_UploadMutex);
 
-        BufferDescription uploadBufferDesc;
-        uploadBufferDesc.ElementCount = GetRequiredIntermediateSize(destTexture->GetResource().Get(), subresourceIdx, 1);
-        uploadBufferDesc.ElementSize = sizeof(uint8_t);
-        uploadBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
-        uploadBufferDesc.InitialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+        uint32_t subresourceIdx = D3D12CalcSubresource(mip, face, 0, destTexture->GetMipLevels(), destTexture->IsCubeMap() ? 6 : 1);
 
-        std::unique_ptr<Buffer> uploadBuffer = std::make_unique<Buffer>(uploadBufferDesc, L"Upload Buffer");
+        D3D12_RESOURCE_DESC resourceDesc = destTexture->GetResource()->GetDesc();
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+        uint32_t numRows;
+        uint64_t rowSize, uploadSize;
+        m_Device->GetCopyableFootprints(&resourceDesc, subresourceIdx, 1, 0, &layout, &numRows, &rowSize, &uploadSize);
 
         uint32_t width = std::max(destTexture->GetWidth() >> mip, 1u);
         uint32_t height = std::max(destTexture->GetHeight() >> mip, 1u);
@@ -253,35 +296,45 @@ void GraphicsContext::UploadTextureData(Texture* destTexture, const void* data,
         subresourceData.RowPitch = rowPitch;
         subresourceData.SlicePitch = slicePitch;
 
-        // Create a new copy command list and execute the upload operation
-        HANDLE waitFenceEvent = CreateEvent(0, false, false, 0);
-        ComPtr<ID3D12Fence1> waitFence;
-        DXCall(m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&waitFence)));
-        DXCall(waitFence->SetName(L"Upload Wait Fence"));
+        // Subresources that don't fit into the upload buffer get their own, which is released once the upload finished
+        Buffer* uploadBuffer = m_UploadBuffer.get();
+        std::unique_ptr<Buffer> dedicatedUploadBuffer;
 
-        ComPtr<ID3D12CommandAllocator> allocator;
-        DXCall(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator)));
-        DXCall(allocator->SetName(L"Upload Command Allocator"));
+        if (uploadSize > UPLOAD_BUFFER_SIZE)
+        {
+            BufferDescription uploadBufferDesc;
+            uploadBufferDesc.ElementCount = uint32_t(uploadSize);
+            uploadBufferDesc.ElementSize = sizeof(uint8_t);
+            uploadBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+            uploadBufferDesc.InitialState = D3D12_RESOURCE_STATE_GENERIC_READ;
 
-        ComPtr<ID3D12GraphicsCommandList6> copyCmdList;
-        DXCall(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator.Get(), nullptr, IID_PPV_ARGS(&copyCmdList)));
-        DXCall(copyCmdList->SetName(L"Upload Command List"));
-        DXCall(copyCmdList->Close());
-        DXCall(copyCmdList->Reset(allocator.Get(), nullptr));
+            dedicatedUploadBuffer = std::make_unique<Buffer>(uploadBufferDesc, L"Upload Buffer");
+            uploadBuffer = dedicatedUploadBuffer.get();
+            layout.Offset = 0;
 
-        UpdateSubresources<1>(copyCmdList.Get(), destTexture->GetResource().Get(), uploadBuffer->GetResource().Get(), 0, subresourceIdx, 1, &subresourceData);
+            BeginUploadCommandList();
+        }
+        else
+        {
+            layout.Offset = AllocateUploadMemory(uploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        }
 
-        DXCall(copyCmdList->Close());
+        D3D12_MEMCPY_DEST destData = {};
+        destData.pData = reinterpret_cast<uint8_t*>(uploadBuffer->GetMappedData()) + layout.Offset;
+        destData.RowPitch = layout.Footprint.RowPitch;
+        destData.SlicePitch = SIZE_T(layout.Footprint.RowPitch) * numRows;
 
-        ID3D12CommandList* copyCommandLists[] = { copyCmdList.Get() };
-        m_CopyQueue->ExecuteCommandLists(1, copyCommandLists);
+        MemcpySubresource(&destData, &subresourceData, rowSize, numRows, layout.Footprint.Depth);
 
-        // Wait for the upload to finish on the GPU before we continue
-        DXCall(m_CopyQueue->Signal(waitFence.Get(), 1));
-        DXCall(waitFence->SetEventOnCompletion(1, waitFenceEvent));
-        WaitForSingleObjectEx(waitFenceEvent, INFINITE, FALSE);
+        CD3DX12_TEXTURE_COPY_LOCATION destLocation(destTexture->GetResource().Get(), subresourceIdx);
+        CD3DX12_TEXTURE_COPY_LOCATION srcLocation(uploadBuffer->GetResource().Get(), layout);
+        m_UploadCommandList->CopyTextureRegion(&destLocation, 0, 0, 0, &srcLocation, nullptr);
 
-        CloseHandle(waitFenceEvent);
+        if (dedicatedUploadBuffer)
+        {
+            FlushUploads();
+            WaitForUploadFence(m_UploadFenceValue);
+        }
     }
 }
 
@@ -341,10 +394,63 @@ void GraphicsContext::CopyTextureToSwapChain(Texture* texture, D3D12_RESOURCE_ST
     };
 
     m_CommandList->ResourceBarrier(2, preCopyBarriers);
-    m_CommandList->CopyResource(m_BackBuffers[m_BackBufferIndex].Get(), texture->GetResource().Get());
+    // Pooled textures can be larger than the swap chain, only the top left region is copied
+    D3D12_BOX sourceBox = {};
+    sourceBox.right = std::min(m_SwapChainWidth, texture->GetWidth());
+    sourceBox.bottom = std::min(m_SwapChainHeight, texture->GetHeight());
+    sourceBox.back = 1;
+
+    CD3DX12_TEXTURE_COPY_LOCATION destLocation(m_BackBuffers[m_BackBufferIndex].Get(), 0);
+    CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(texture->GetResource().Get(), 0);
+
+    m_CommandList->CopyTextureRegion(&destLocation, 0, 0, 0, &sourceLocation, &sourceBox);
     m_CommandList->ResourceBarrier(2, postCopyBarriers);
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::CopyBufferToTexture(Texture* destTexture, const Buffer* srcBuffer, const std::vector<TextureRegionCopy>& regions, D3D12_RESOURCE_STATES textureCurrentState)
+{
+    if (!destTexture || !srcBuffer || regions.empty())
+        return;
+
+    D3D12_RESOURCE_BARRIER preCopyBarrier = CD3DX12_RESOURCE_BARRIER::Transition(destTexture->GetResource().Get(), textureCurrentState, D3D12_RESOURCE_STATE_COPY_DEST);
+    D3D12_RESOURCE_BARRIER postCopyBarrier = CD3DX12_RESOURCE_BARRIER::Transition(destTexture->GetResource().Get(), D3D12_RESOURCE_STATE_COPY_DEST, textureCurrentState);
+
+    m_CommandList->ResourceBarrier(1, &preCopyBarrier);
+
+    for (const TextureRegionCopy& region : regions)
+    {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+        footprint.Offset = region.BufferOffset;
+        footprint.Footprint.Format = destTexture->GetFormat();
+        footprint.Footprint.Width = region.Width;
+        footprint.Footprint.Height = region.Height;
+        footprint.Footprint.Depth = 1;
+        footprint.Footprint.RowPitch = region.RowPitch;
+
+        CD3DX12_TEXTURE_COPY_LOCATION srcLocation(srcBuffer->GetResource().Get(), footprint);
+        CD3DX12_TEXTURE_COPY_LOCATION destLocation(destTexture->GetResource().Get(), 0);
+
+        m_CommandList->CopyTextureRegion(&destLocation, region.DestX, region.DestY, 0, &srcLocation, nullptr);
+    }
+
+    m_CommandList->ResourceBarrier(1, &postCopyBarrier);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::CopyBuffer(Buffer* destBuffer, const Buffer* srcBuffer, D3D12_RESOURCE_STATES srcBufferCurrentState)
+{
+    if (!destBuffer || !srcBuffer)
+        return;
+
+    D3D12_RESOURCE_BARRIER preCopyBarrier = CD3DX12_RESOURCE_BARRIER::Transition(srcBuffer->GetResource().Get(), srcBufferCurrentState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    D3D12_RESOURCE_BARRIER postCopyBarrier = CD3DX12_RESOURCE_BARRIER::Transition(srcBuffer->GetResource().Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, srcBufferCurrentState);
+
+    m_CommandList->ResourceBarrier(1, &preCopyBarrier);
+    m_CommandList->CopyBufferRegion(destBuffer->GetResource().Get(), 0, srcBuffer->GetResource().Get(), 0, std::min(destBuffer->GetSize(), srcBuffer->GetSize()));
+    m_CommandList->ResourceBarrier(1, &postCopyBarrier);
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 void GraphicsContext::AddUAVBarrier(Texture* texture)
 {
@@ -358,18 +464,40 @@ void GraphicsContext::AddUAVBarrier(Texture* texture)
     m_CommandList->ResourceBarrier(1, barriers);
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::AddResourceBarriers(const std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+{
+    if (barriers.empty())
+        return;
+
+    m_CommandList->ResourceBarrier(barriers.size(), barriers.data());
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 std::shared_ptr<Buffer> GraphicsContext::BuildBottomLevelAccelerationStructure(Mesh* mesh, uint32_t submeshIndex)
 {
     D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
-    geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-    geometryDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-    geometryDesc.Triangles.IndexBuffer = mesh->GetIndexBuffer(submeshIndex)->GetResource()->GetGPUVirtualAddress();
-    geometryDesc.Triangles.IndexCount = mesh->GetIndexBuffer(submeshIndex)->GetElementCount();
-    geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-    geometryDesc.Triangles.VertexBuffer.StartAddress = mesh->GetVertexBuffer(submeshIndex)->GetResource()->GetGPUVirtualAddress();
-    geometryDesc.Triangles.VertexCount = mesh->GetVertexBuffer(submeshIndex)->GetElementCount();
-    geometryDesc.Triangles.VertexBuffer.StrideInBytes = mesh->GetVertexBuffer(submeshIndex)->GetElementSize();
+
+    if (mesh->IsPrimitive())
+    {
+        // Analytic primitives only provide their bounding box, the actual surface is found by the intersection shader
+        geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_PROCEDURAL_PRIMITIVE_AABBS;
+        geometryDesc.AABBs.AABBCount = mesh->GetAABBBuffer()->GetElementCount();
+        geometryDesc.AABBs.AABBs.StartAddress = mesh->GetAABBBuffer()->GetResource()->GetGPUVirtualAddress();
+        geometryDesc.AABBs.AABBs.StrideInBytes = mesh->GetAABBBuffer()->GetElementSize();
+    }
+    else
+    {
+        geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+        geometryDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
+        geometryDesc.Triangles.IndexBuffer = mesh->GetIndexBuffer(submeshIndex)->GetResource()->GetGPUVirtualAddress();
+        geometryDesc.Triangles.IndexCount = mesh->GetIndexBuffer(submeshIndex)->GetElementCount();
+        geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+        geometryDesc.Triangles.VertexBuffer.StartAddress = mesh->GetVertexBuffer(submeshIndex)->GetResource()->GetGPUVirtualAddress();
+        geometryDesc.Triangles.VertexCount = mesh->GetVertexBuffer(submeshIndex)->GetElementCount();
+        geometryDesc.Triangles.VertexBuffer.StrideInBytes = mesh->GetVertexBuffer(submeshIndex)->GetElementSize();
+    }
+
     geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
 
     if (!mesh->GetMaterial(submeshIndex)->GetFlag(MaterialFlags::Transparent))
@@ -436,6 +564,8 @@ std::shared_ptr<Buffer> GraphicsContext::BuildBottomLevelAccelerationStructure(M
 
     DXCall(cmdList->Close());
 
+    WaitForUploadsOnGraphicsQueue();
+
     ID3D12CommandList* cmdLists[] = { cmdList.Get() };
     m_GraphicsQueue->ExecuteCommandLists(1, cmdLists);
 
@@ -452,44 +582,74 @@ std::shared_ptr<Buffer> GraphicsContext::BuildBottomLevelAccelerationStructure(M
 // ------------------------------------------------------------------------------------------------------------------------------------
 std::shared_ptr<Buffer> GraphicsContext::BuildTopLevelAccelerationStructure(const std::vector<MeshInstance>& meshInstances)
 {
-    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs;
-    instanceDescs.reserve(meshInstances.size());
+    // Every mesh instance writes its descriptors at an offset known up front, so they are filled in parallel
+    std::vector<uint32_t> descOffsets(meshInstances.size());
+    uint32_t instanceCount = 0;
+    for (size_t i = 0; i < meshInstances.size(); i++)
+    {
+        descOffsets[i] = instanceCount;
+        if (meshInstances[i].Mesh)
+            instanceCount += meshInstances[i].Mesh->GetSubmeshes().size() * meshInstances[i].InstanceCount;
+    }
+
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs(instanceCount);
 
-    for (const MeshInstance& instance : meshInstances)
+    // Instance IDs index the geometry buffer, whose entries point into the material buffer.
+    // Instances without a mesh are free slots of the renderer and are skipped
+    ParallelForChunks(meshInstances.size(), 64, [&](size_t chunk, size_t begin, size_t end)
     {
-        for (uint32_t i = 0; i < instance.Mesh->GetSubmeshes().size(); i++)
+        for (size_t instanceIndex = begin; instanceIndex < end; instanceIndex++)
         {
-            D3D12_RAYTRACING_INSTANCE_DESC& instanceDesc = instanceDescs.emplace_back();
+            const MeshInstance& instance = meshInstances[instanceIndex];
+            if (!instance.Mesh)
+                continue;
+
+            D3D12_RAYTRACING_INSTANCE_DESC* instanceDesc = instanceDescs.data() + descOffsets[instanceIndex];
 
-            for (uint32_t i = 0; i < 3; i++)
+            for (uint32_t i = 0; i < instance.Mesh->GetSubmeshes().size(); i++)
             {
-                for (uint32_t j = 0; j < 4; j++)
+                uint32_t geometryIndex = instance.GeometryIDs[i];
+
+                D3D12_RAYTRACING_INSTANCE_FLAGS flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+
+                if (instance.Mesh->GetMaterial(i)->GetFlag(MaterialFlags::Transparent))
                 {
-                    instanceDesc.Transform[i][j] = instance.Transform[j][i];
+                    flags |= D3D12_RAYTRACING_INSTANCE_FLAG_FORCE_NON_OPAQUE;
+                }
+                else
+                {
+                    flags |= D3D12_RAYTRACING_INSTANCE_FLAG_FORCE_OPAQUE;
                 }
-            }
 
-            instanceDesc.InstanceID = instanceDescs.size() - 1;
-            instanceDesc.InstanceMask = 1;
-            instanceDesc.InstanceContributionToHitGroupIndex = 0;
-            instanceDesc.AccelerationStructure = instance.Mesh->GetAccelerationStructure(i)->GetResource()->GetGPUVirtualAddress();
-            instanceDesc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+                if (instance.Mesh->GetMaterial(i)->GetFlag(MaterialFlags::TwoSided))
+                {
+                    flags |= D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE;
+                }
 
-            if (instance.Mesh->GetMaterial(i)->GetFlag(MaterialFlags::Transparent))
-            {
-                instanceDesc.Flags |= D3D12_RAYTRACING_INSTANCE_FLAG_FORCE_NON_OPAQUE;
-            }
-            else
-            {
-                instanceDesc.Flags |= D3D12_RAYTRACING_INSTANCE_FLAG_FORCE_OPAQUE;
-            }
+                D3D12_GPU_VIRTUAL_ADDRESS accelerationStructure = instance.Mesh->GetAccelerationStructure(i)->GetResource()->GetGPUVirtualAddress();
+                uint32_t hitGroupIndex = instance.Mesh->IsPrimitive() ? c_PrimitiveHitGroupIndex : c_TriangleHitGroupIndex;
 
-            if (instance.Mesh->GetMaterial(i)->GetFlag(MaterialFlags::TwoSided))
-            {
-                instanceDesc.Flags |= D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_CULL_DISABLE;
+                for (uint32_t j = 0; j < instance.InstanceCount; j++, instanceDesc++)
+                {
+                    glm::mat4 transform = instance.InstanceTransforms ? instance.Transform * (*instance.InstanceTransforms)[j] : instance.Transform;
+
+                    for (uint32_t row = 0; row < 3; row++)
+                    {
+                        for (uint32_t column = 0; column < 4; column++)
+                        {
+                            instanceDesc->Transform[row][column] = transform[column][row];
+                        }
+                    }
+
+                    instanceDesc->InstanceID = geometryIndex;
+                    instanceDesc->InstanceMask = 1;
+                    instanceDesc->InstanceContributionToHitGroupIndex = hitGroupIndex;
+                    instanceDesc->AccelerationStructure = accelerationStructure;
+                    instanceDesc->Flags = flags;
+                }
             }
         }
-    }
+    });
 
     BufferDescription instanceBufferDesc;
     instanceBufferDesc.ElementCount = instanceDescs.size();
@@ -552,6 +712,8 @@ std::shared_ptr<Buffer> GraphicsContext::BuildTopLevelAccelerationStructure(cons
 
     DXCall(cmdList->Close());
 
+    WaitForUploadsOnGraphicsQueue();
+
     ID3D12CommandList* cmdLists[] = { cmdList.Get() };
     m_GraphicsQueue->ExecuteCommandLists(1, cmdLists);
 
@@ -565,6 +727,83 @@ std::shared_ptr<Buffer> GraphicsContext::BuildTopLevelAccelerationStructure(cons
     return accelerationStructure;
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint64_t GraphicsContext::AllocateUploadMemory(uint64_t size, uint64_t alignment)
+{
+    m_UploadAllocator->Release(m_UploadFence->GetCompletedValue());
+
+    uint64_t offset = 0;
+    while (!m_UploadAllocator->Allocate(size, alignment, offset))
+    {
+        // The upload buffer is full. Submit the copies recorded so far and wait until the oldest ones finished
+        FlushUploads();
+        WaitForUploadFence(m_UploadAllocator->GetOldestSubmissionFenceValue());
+        m_UploadAllocator->Release(m_UploadFence->GetCompletedValue());
+    }
+
+    BeginUploadCommandList();
+    return offset;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::BeginUploadCommandList()
+{
+    if (m_HasPendingUploads)
+        return;
+
+    // Command allocators are reused in submission order, the oldest one may still be executing
+    WaitForUploadFence(m_UploadCommandAllocatorFenceValues[m_UploadSubmissionIndex]);
+
+    const ComPtr<ID3D12CommandAllocator>& allocator = m_UploadCommandAllocators[m_UploadSubmissionIndex];
+    DXCall(allocator->Reset());
+    DXCall(m_UploadCommandList->Reset(allocator.Get(), nullptr));
+
+    m_HasPendingUploads = true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::FlushUploads()
+{
+    if (!m_HasPendingUploads)
+        return;
+
+    DXCall(m_UploadCommandList->Close());
+
+    ID3D12CommandList* commandLists[] = { m_UploadCommandList.Get() };
+    m_CopyQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+    DXCall(m_CopyQueue->Signal(m_UploadFence.Get(), ++m_UploadFenceValue));
+
+    m_UploadCommandAllocatorFenceValues[m_UploadSubmissionIndex] = m_UploadFenceValue;
+    m_UploadSubmissionIndex = (m_UploadSubmissionIndex + 1) % UPLOAD_SUBMISSION_COUNT;
+
+    // The allocator of this submission was waited for, so there is always room for it in the ring allocator
+    m_UploadAllocator->Release(m_UploadFence->GetCompletedValue());
+    m_UploadAllocator->Submit(m_UploadFenceValue);
+
+    m_HasPendingUploads = false;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::WaitForUploadFence(uint64_t fenceValue)
+{
+    if (m_UploadFence->GetCompletedValue() < fenceValue)
+    {
+        DXCall(m_UploadFence->SetEventOnCompletion(fenceValue, m_UploadFenceEvent));
+        WaitForSingleObjectEx(m_UploadFenceEvent, INFINITE, FALSE);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::WaitForUploadsOnGraphicsQueue()
+{
+    // Uploads are not waited for on the CPU, work on the graphics queue waits for them on the GPU instead
+    std::lock_guard<std::mutex> lock(m_UploadMutex);
+
+    FlushUploads();
+    DXCall(m_GraphicsQueue->Wait(m_UploadFence.Get(), m_UploadFenceValue));
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 void GraphicsContext::RecreateRenderTargetViews(uint32_t width, uint32_t height)
 {
@@ -731,6 +970,62 @@ void GraphicsContext::CreateDescriptorHeaps()
     m_ResourceDescriptorHeap = std::make_unique<SegregatedDescriptorHeap>(resourceHeapDesc, L"Resource Descriptor Heap");
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::CreateTimestampQueries()
+{
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+    queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryHeapDesc.Count = FRAMES_IN_FLIGHT * 2;
+    queryHeapDesc.NodeMask = 0;
+
+    DXCall(m_Device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_TimestampQueryHeap)));
+    DXCall(m_TimestampQueryHeap->SetName(L"Timestamp Query Heap"));
+
+    BufferDescription readbackBufferDesc;
+    readbackBufferDesc.ElementCount = FRAMES_IN_FLIGHT * 2;
+    readbackBufferDesc.ElementSize = sizeof(uint64_t);
+    readbackBufferDesc.HeapType = D3D12_HEAP_TYPE_READBACK;
+
+    m_TimestampReadbackBuffer = std::make_shared<Buffer>(readbackBufferDesc, L"Timestamp Readback Buffer");
+
+    DXCall(m_GraphicsQueue->GetTimestampFrequency(&m_TimestampFrequency));
+    m_FrameNumber = 0;
+    memset(m_TimestampFrameNumbers, 0, sizeof(m_TimestampFrameNumbers));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void GraphicsContext::CreateUploadResources()
+{
+    BufferDescription uploadBufferDesc;
+    uploadBufferDesc.ElementCount = UPLOAD_BUFFER_SIZE;
+    uploadBufferDesc.ElementSize = sizeof(uint8_t);
+    uploadBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    uploadBufferDesc.InitialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+
+    m_UploadBuffer = std::make_shared<Buffer>(uploadBufferDesc, L"Upload Ring Buffer");
+    m_UploadAllocator = std::make_unique<RingAllocator>(UPLOAD_BUFFER_SIZE, UPLOAD_SUBMISSION_COUNT);
+
+    for (uint32_t i = 0; i < UPLOAD_SUBMISSION_COUNT; i++)
+    {
+        DXCall(m_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_UploadCommandAllocators[i])));
+        DXCall(m_UploadCommandAllocators[i]->SetName(fmt::format(L"Upload Command Allocator {}", i).c_str()));
+    }
+
+    memset(m_UploadCommandAllocatorFenceValues, 0, sizeof(m_UploadCommandAllocatorFenceValues));
+    m_UploadSubmissionIndex = 0;
+
+    DXCall(m_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_UploadCommandAllocators[0].Get(), nullptr, IID_PPV_ARGS(&m_UploadCommandList)));
+    DXCall(m_UploadCommandList->SetName(L"Upload Command List"));
+    DXCall(m_UploadCommandList->Close());
+    m_HasPendingUploads = false;
+
+    m_UploadFenceValue = 0;
+    DXCall(m_Device->CreateFence(m_UploadFenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_UploadFence)));
+    DXCall(m_UploadFence->SetName(L"Upload Fence"));
+
+    m_UploadFenceEvent = CreateEvent(0, false, false, 0);
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 void GraphicsContext::CreateSwapChainAndSyncPrimitives()
 {
@@ -7,6 +7,23 @@
 #include "rendering/buffer.h"
 #include "rendering/mesh.h"
 #include "rendering/renderer.h"
+#include "rendering/ringallocator.h"
+
+struct TextureRegionCopy
+{
+    uint64_t BufferOffset = 0;
+    uint32_t RowPitch = 0;
+    uint32_t DestX = 0;
+    uint32_t DestY = 0;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+};
+
+struct GPUFrameTiming
+{
+    uint64_t FrameNumber = 0;
+    double TimeMS = 0.0;
+};
 
 struct GraphicsContextDescription
 {
@@ -25,16 +42,24 @@ public:
     void ResizeSwapChain(uint32_t width, uint32_t height);
     void WaitForGPU();
     void ProcessDeferredReleases(uint64_t frameIndex);
-    void ReleaseResource(ID3D12Resource2* resource, bool deferredRelease = true);
+    void ReleaseResource(ID3D12Pageable* resource, bool deferredRelease = true);
     void UploadBufferData(Buffer* destBuffer, const void* data);
     void UploadTextureData(Texture* destTexture, const void* data, uint32_t mip = 0, uint32_t face = 0);
     void DispatchRays(uint32_t width, uint32_t height, const ResourceBindTable& resourceBindings, const RaytracingPipeline* pipeline);
     void DispatchComputeShader(uint32_t threadCountX, uint32_t threadCountY, uint32_t threadCountZ, const ResourceBindTable& resourceBindings, const ComputePipeline* pipeline);
     void CopyTextureToSwapChain(Texture* texture, D3D12_RESOURCE_STATES textureCurrentState);
+    void CopyBufferToTexture(Texture* destTexture, const Buffer* srcBuffer, const std::vector<TextureRegionCopy>& regions, D3D12_RESOURCE_STATES textureCurrentState);
+    void CopyBuffer(Buffer* destBuffer, const Buffer* srcBuffer, D3D12_RESOURCE_STATES srcBufferCurrentState);
     void AddUAVBarrier(Texture* texture);
+    void AddResourceBarriers(const std::vector<D3D12_RESOURCE_BARRIER>& barriers);
     std::shared_ptr<Buffer> BuildBottomLevelAccelerationStructure(Mesh* mesh, uint32_t submeshIndex);
     std::shared_ptr<Buffer> BuildTopLevelAccelerationStructure(const std::vector<MeshInstance>& meshInstances);
 
+    // Appends the GPU time of every frame that finished executing since the last call. Timestamps are taken at the start and
+    // end of the frame command list, so work submitted on other queues is not included. Frames whose timestamps could not be
+    // read are left out, so callers have to expect gaps in the frame numbers
+    void GetCompletedGPUFrameTimings(std::vector<GPUFrameTiming>& outTimings);
+
     inline bool IsDebugLayerEnabled() const { return m_Description.EnableDebugLayer; }
     inline bool IsHardwareRayTracingSupported() const { return m_HardwareRayTracingSupported; }
     inline bool IsTearingSupported() const { return m_TearingSupported; }
@@ -53,6 +78,7 @@ public:
 
     inline const ComPtr<IDXGISwapChain4>& GetSwapChain() const { return m_SwapChain; }
     inline uint64_t GetBackBufferIndex() const { return m_BackBufferIndex; }
+    inline uint64_t GetFrameNumber() const { return m_FrameNumber; }
 
     inline const ComPtr<ID3D12RootSignature>& GetBindlessRootSignature() const { return m_BindlessRootSignature; }
 public:
@@ -65,7 +91,19 @@ private:
     void CreateDescriptorHeaps();
     void CreateSwapChainAndSyncPrimitives();
     void CreateRootSignatures();
+    void CreateTimestampQueries();
+    void CreateUploadResources();
+    void CollectGPUFrameTimings();
+
+    uint64_t AllocateUploadMemory(uint64_t size, uint64_t alignment);
+    void BeginUploadCommandList();
+    void FlushUploads();
+    void WaitForUploadFence(uint64_t fenceValue);
+    void WaitForUploadsOnGraphicsQueue();
 private:
+    static constexpr uint64_t UPLOAD_BUFFER_SIZE = 64 * 1024 * 1024;
+    static constexpr uint32_t UPLOAD_SUBMISSION_COUNT = 8;
+
     GraphicsContextDescription m_Description;
     bool m_HardwareRayTracingSupported;
     bool m_TearingSupported;
@@ -88,6 +126,28 @@ private:
     uint64_t m_FrameFenceValues[FRAMES_IN_FLIGHT];
     HANDLE m_FrameFenceEvent;
 
+    // Timestamp query objects. Every frame in flight owns a begin and end timestamp
+    ComPtr<ID3D12QueryHeap> m_TimestampQueryHeap;
+    std::shared_ptr<Buffer> m_TimestampReadbackBuffer;
+    uint64_t m_TimestampFrequency;
+    uint64_t m_FrameNumber;
+    uint64_t m_TimestampFrameNumbers[FRAMES_IN_FLIGHT];
+    std::vector<GPUFrameTiming> m_CollectedGPUFrameTimings;
+
+    // Upload objects. Upload data is copied into one persistent upload buffer and the copies are recorded on the copy queue.
+    // They are submitted in batches, at the latest before the graphics queue executes, which waits for them on the GPU
+    std::unique_ptr<RingAllocator> m_UploadAllocator;
+    std::shared_ptr<Buffer> m_UploadBuffer;
+    ComPtr<ID3D12CommandAllocator> m_UploadCommandAllocators[UPLOAD_SUBMISSION_COUNT];
+    uint64_t m_UploadCommandAllocatorFenceValues[UPLOAD_SUBMISSION_COUNT];
+    uint32_t m_UploadSubmissionIndex;
+    ComPtr<ID3D12GraphicsCommandList6> m_UploadCommandList;
+    bool m_HasPendingUploads;
+    ComPtr<ID3D12Fence1> m_UploadFence;
+    uint64_t m_UploadFenceValue;
+    HANDLE m_UploadFenceEvent;
+    std::mutex m_UploadMutex;
+
     // Descriptor heap objects
     std::unique_ptr<StandardDescriptorHeap> m_RTVDescriptorHeap;
     std::unique_ptr<StandardDescriptorHeap> m_DSVDescriptorHeap;
@@ -109,7 +169,7 @@ private:
     ComPtr<ID3D12InfoQueue> m_InfoQueue;
 
     // Deferred release resources
-    std::vector<ID3D12Resource2*> m_DeferredReleaseResources[FRAMES_IN_FLIGHT];
+    std::vector<ID3D12Pageable*> m_DeferredReleaseResources[FRAMES_IN_FLIGHT];
     std::mutex m_DeferredReleaseMutex;
 
     // Root signatures:
@@ -0,0 +1,98 @@
+#include "heightfield.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+HeightfieldInfo HeightfieldBuilder::Build(const HeightfieldDescription& heightfield, float cellSize, std::vector<uint32_t>& outData)
+{
+    HEXRAY_ASSERT(heightfield.Width >= 2 && heightfield.Depth >= 2 && heightfield.Heights.size() == heightfield.Width * heightfield.Depth);
+
+    uint32_t cellCountX = heightfield.Width - 1;
+    uint32_t cellCountZ = heightfield.Depth - 1;
+
+    // The finest pyramid level bounds the samples of every tile, including the ones shared with the neighbouring tiles
+    std::vector<std::vector<uint32_t>> mips;
+    std::vector<uint32_t>& tiles = mips.emplace_back(GetHeightfieldNodeCount(cellCountX, 0) * GetHeightfieldNodeCount(cellCountZ, 0));
+    uint32_t tileCountX = GetHeightfieldNodeCount(cellCountX, 0);
+
+    for (uint32_t i = 0; i < tiles.size(); i++)
+    {
+        uint32_t tileX = i % tileCountX;
+        uint32_t tileZ = i / tileCountX;
+        uint16_t minHeight = UINT16_MAX;
+        uint16_t maxHeight = 0;
+
+        for (uint32_t z = tileZ * c_HeightfieldTileSize; z <= std::min((tileZ + 1) * c_HeightfieldTileSize, cellCountZ); z++)
+        {
+            for (uint32_t x = tileX * c_HeightfieldTileSize; x <= std::min((tileX + 1) * c_HeightfieldTileSize, cellCountX); x++)
+            {
+                minHeight = std::min(minHeight, heightfield.Heights[z * heightfield.Width + x]);
+                maxHeight = std::max(maxHeight, heightfield.Heights[z * heightfield.Width + x]);
+            }
+        }
+
+        tiles[i] = minHeight | (uint32_t(maxHeight) << 16);
+    }
+
+    // Every next level merges 2x2 nodes until a single node covers the whole grid
+    while (mips.size() < c_HeightfieldMaxMipCount && mips.back().size() > 1)
+    {
+        uint32_t mip = mips.size();
+        uint32_t childCountX = GetHeightfieldNodeCount(cellCountX, mip - 1);
+        uint32_t childCountZ = GetHeightfieldNodeCount(cellCountZ, mip - 1);
+        uint32_t nodeCountX = GetHeightfieldNodeCount(cellCountX, mip);
+        uint32_t nodeCountZ = GetHeightfieldNodeCount(cellCountZ, mip);
+
+        std::vector<uint32_t> nodes(nodeCountX * nodeCountZ);
+        const std::vector<uint32_t>& children = mips.back();
+
+        for (uint32_t i = 0; i < nodes.size(); i++)
+        {
+            uint32_t nodeX = i % nodeCountX;
+            uint32_t nodeZ = i / nodeCountX;
+            uint32_t minHeight = UINT16_MAX;
+            uint32_t maxHeight = 0;
+
+            for (uint32_t z = nodeZ * 2; z < std::min(nodeZ * 2 + 2, childCountZ); z++)
+            {
+                for (uint32_t x = nodeX * 2; x < std::min(nodeX * 2 + 2, childCountX); x++)
+                {
+                    minHeight = std::min(minHeight, children[z * childCountX + x] & 0xffff);
+                    maxHeight = std::max(maxHeight, children[z * childCountX + x] >> 16);
+                }
+            }
+
+            nodes[i] = minHeight | (maxHeight << 16);
+        }
+
+        mips.push_back(std::move(nodes));
+    }
+
+    HEXRAY_ASSERT(mips.back().size() == 1);
+
+    HeightfieldInfo info;
+    info.Width = heightfield.Width;
+    info.Depth = heightfield.Depth;
+    info.CellSize = cellSize;
+    info.HeightScale = heightfield.HeightScale;
+    info.MipCount = mips.size();
+
+    // Header, samples packed in pairs and then the pyramid from the finest to the coarsest level
+    outData.assign(c_HeightfieldInfoStructSize / sizeof(uint32_t) + (heightfield.Heights.size() + 1) / 2, 0);
+    memcpy(outData.data(), &info, c_HeightfieldInfoStructSize);
+    memcpy(outData.data() + c_HeightfieldInfoStructSize / sizeof(uint32_t), heightfield.Heights.data(), heightfield.Heights.size() * sizeof(uint16_t));
+
+    for (const std::vector<uint32_t>& nodes : mips)
+    {
+        outData.insert(outData.end(), nodes.begin(), nodes.end());
+    }
+
+    return info;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void HeightfieldBuilder::GetHeightRange(const HeightfieldInfo& info, const std::vector<uint32_t>& data, float& outMinHeight, float& outMaxHeight)
+{
+    // The root node is the last one of the coarsest level
+    uint32_t rootNode = data.back();
+    outMinHeight = (rootNode & 0xffff) / 65535.0f * info.HeightScale;
+    outMaxHeight = (rootNode >> 16) / 65535.0f * info.HeightScale;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core/core.h"
+#include "rendering/shaders/resources.h"
+
+struct HeightfieldDescription
+{
+    uint32_t Width = 0;            // Samples along x
+    uint32_t Depth = 0;            // Samples along z
+    float HeightScale = 1.0f;      // Height of a sample at full intensity
+    std::vector<uint16_t> Heights; // Normalized samples, row by row along z
+};
+
+// Builds the buffer the shaders trace heightfields in: the HeightfieldInfo header, the samples and the min/max pyramid over
+// them. Kept apart from the mesh so the traversal can be run and measured on the CPU against the same data
+class HeightfieldBuilder
+{
+public:
+    static HeightfieldInfo Build(const HeightfieldDescription& heightfield, float cellSize, std::vector<uint32_t>& outData);
+
+    // Height range of the root node, which bounds every sample of the grid
+    static void GetHeightRange(const HeightfieldInfo& info, const std::vector<uint32_t>& data, float& outMinHeight, float& outMaxHeight);
+};
@@ -0,0 +1,110 @@
+#include "lightaliastable.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void LightAliasTable::Build(const float* weights, uint32_t lightCount)
+{
+    m_Entries.resize(lightCount);
+    m_ScaledWeights.resize(lightCount);
+    m_SmallEntries.clear();
+    m_LargeEntries.clear();
+
+    if (lightCount == 0)
+        return;
+
+    double weightSum = 0.0;
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        m_ScaledWeights[i] = glm::max(weights[i], 0.0f);
+        weightSum += m_ScaledWeights[i];
+    }
+
+    // Scale the weights so that their average is 1. Without any light emitting, every light is equally likely
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        float pdf = weightSum > 0.0 ? float(m_ScaledWeights[i] / weightSum) : 1.0f / lightCount;
+
+        m_Entries[i].Pdf = pdf;
+        m_ScaledWeights[i] = pdf * lightCount;
+
+        if (m_ScaledWeights[i] < 1.0f)
+            m_SmallEntries.push_back(i);
+        else
+            m_LargeEntries.push_back(i);
+    }
+
+    // Vose's method: every entry below the average is filled up with probability from an entry above it
+    while (!m_SmallEntries.empty() && !m_LargeEntries.empty())
+    {
+        uint32_t small = m_SmallEntries.back();
+        uint32_t large = m_LargeEntries.back();
+        m_SmallEntries.pop_back();
+
+        m_Entries[small].Threshold = m_ScaledWeights[small];
+        m_Entries[small].Alias = large;
+
+        m_ScaledWeights[large] -= 1.0f - m_ScaledWeights[small];
+        if (m_ScaledWeights[large] < 1.0f)
+        {
+            m_LargeEntries.pop_back();
+            m_SmallEntries.push_back(large);
+        }
+    }
+
+    // Entries left over are at the average up to rounding errors and always keep their own light
+    for (uint32_t i : m_SmallEntries)
+    {
+        m_Entries[i].Threshold = 1.0f;
+        m_Entries[i].Alias = i;
+    }
+
+    for (uint32_t i : m_LargeEntries)
+    {
+        m_Entries[i].Threshold = 1.0f;
+        m_Entries[i].Alias = i;
+    }
+
+    for (LightAliasEntry& entry : m_Entries)
+        entry.AliasPdf = m_Entries[entry.Alias].Pdf;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t LightAliasTable::Sample(float u, float& outPdf) const
+{
+    HEXRAY_ASSERT(!m_Entries.empty());
+
+    uint32_t lightCount = m_Entries.size();
+    uint32_t entryIndex = GetLightAliasEntryIndex(lightCount, u);
+    const LightAliasEntry& entry = m_Entries[entryIndex];
+
+    uint32_t lightIndex = SampleLightAliasEntry(entry, entryIndex, lightCount, u);
+    outPdf = GetLightAliasEntryPdf(entry, entryIndex, lightIndex);
+    return lightIndex;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+float LightAliasTable::GetLightIntensity(const Light& light)
+{
+    float luminance = glm::dot(light.Color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+    float intensity = glm::max(luminance * light.Intensity, 0.0f);
+
+    // Directional lights don't fall off and light the whole scene
+    if (light.LightType == LightType::DirLight)
+        return intensity;
+
+    // Local lights are compared by the light they deliver at a reference distance
+    float d = WeightReferenceDistance;
+    float attenuation = 1.0f / glm::max(light.AttenuationFactors[0] + light.AttenuationFactors[1] * d + light.AttenuationFactors[2] * d * d, 1e-4f);
+    return intensity * attenuation;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+float LightAliasTable::GetLightWeight(const Light& light)
+{
+    float weight = GetLightIntensity(light);
+
+    // Spot lights only emit into their cone, the smooth edge counts half
+    if (light.LightType == LightType::SpotLight)
+        weight *= glm::clamp(1.0f - 0.5f * (light.ConeAngleMin + light.ConeAngleMax), 0.0f, 2.0f) * 0.5f;
+
+    return weight;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "core/core.h"
+#include "rendering/shaders/resources.h"
+
+// Builds the Walker alias table the shaders select lights from, given a weight per light. Lights are usually weighted by their
+// power, estimated from their color, intensity, falloff and the solid angle they emit into. Selection does not depend on
+// the shading point, so the table only has to be rebuilt when lights change
+class LightAliasTable
+{
+public:
+    static constexpr float WeightReferenceDistance = 1.0f;
+
+    void Build(const float* weights, uint32_t lightCount);
+    uint32_t Sample(float u, float& outPdf) const;
+
+    static float GetLightIntensity(const Light& light);
+    static float GetLightWeight(const Light& light);
+
+    inline const std::vector<LightAliasEntry>& GetEntries() const { return m_Entries; }
+private:
+    std::vector<LightAliasEntry> m_Entries;
+
+    // Kept across builds so rebuilding the table does not allocate memory unless the number of lights grew
+    std::vector<float> m_ScaledWeights;
+    std::vector<uint32_t> m_SmallEntries;
+    std::vector<uint32_t> m_LargeEntries;
+};
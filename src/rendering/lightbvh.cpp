@@ -0,0 +1,252 @@
+#include "lightbvh.h"
+#include "rendering/lightaliastable.h"
+
+#include <gtc/constants.hpp>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void LightBVH::Build(const Light* lights, uint32_t lightCount)
+{
+    m_Nodes.clear();
+    m_BuildLights.clear();
+
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        if (lights[i].LightType == LightType::DirLight)
+            continue;
+
+        BuildLight buildLight;
+        buildLight.Bounds = GetLightBounds(lights[i]);
+        buildLight.LightIndex = i;
+
+        if (buildLight.Bounds.Power > 0.0f)
+            m_BuildLights.push_back(buildLight);
+    }
+
+    if (m_BuildLights.empty())
+        return;
+
+    m_Nodes.reserve(m_BuildLights.size() * 2 - 1);
+    BuildRecursive(0, m_BuildLights.size());
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t LightBVH::Sample(const glm::vec3& position, const glm::vec3& normal, float u, float& outPdf) const
+{
+    if (m_Nodes.empty())
+    {
+        outPdf = 0.0f;
+        return c_InvalidLightIndex;
+    }
+
+    return SampleLightBVH(m_Nodes.data(), position, normal, u, outPdf);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t LightBVH::BuildRecursive(uint32_t begin, uint32_t end)
+{
+    uint32_t nodeIndex = m_Nodes.size();
+    m_Nodes.emplace_back();
+
+    LightBounds nodeBounds;
+    glm::vec3 centroidMin = glm::vec3(FLT_MAX);
+    glm::vec3 centroidMax = glm::vec3(-FLT_MAX);
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const LightBounds& bounds = m_BuildLights[i].Bounds;
+        glm::vec3 centroid = (bounds.BoundsMin + bounds.BoundsMax) * 0.5f;
+
+        nodeBounds = Union(nodeBounds, bounds);
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+
+    LightBVHNode& node = m_Nodes[nodeIndex];
+    node.BoundsMin = nodeBounds.BoundsMin;
+    node.BoundsMax = nodeBounds.BoundsMax;
+    node.Power = nodeBounds.Power;
+    node.ConeAxis = nodeBounds.ConeAxis;
+    node.CosThetaO = nodeBounds.CosThetaO;
+    node.CosThetaE = nodeBounds.CosThetaE;
+
+    if (end - begin == 1)
+    {
+        node.ChildOrLightIndex = m_BuildLights[begin].LightIndex;
+        node.IsLeaf = 1;
+        return nodeIndex;
+    }
+
+    node.IsLeaf = 0;
+
+    // Bin the lights by their centroid along every axis and take the cheapest split between two bins
+    glm::vec3 nodeExtent = nodeBounds.BoundsMax - nodeBounds.BoundsMin;
+    float minCost = FLT_MAX;
+    uint32_t minCostAxis = 0;
+    uint32_t minCostBucket = 0;
+
+    auto getBucket = [&](const BuildLight& buildLight, uint32_t axis)
+    {
+        float centroid = (buildLight.Bounds.BoundsMin[axis] + buildLight.Bounds.BoundsMax[axis]) * 0.5f;
+        uint32_t bucket = uint32_t(SplitBucketCount * (centroid - centroidMin[axis]) / (centroidMax[axis] - centroidMin[axis]));
+        return std::min(bucket, SplitBucketCount - 1);
+    };
+
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        if (centroidMax[axis] == centroidMin[axis])
+            continue;
+
+        LightBounds buckets[SplitBucketCount];
+        for (uint32_t i = begin; i < end; i++)
+        {
+            uint32_t bucket = getBucket(m_BuildLights[i], axis);
+            buckets[bucket] = Union(buckets[bucket], m_BuildLights[i].Bounds);
+        }
+
+        for (uint32_t split = 0; split < SplitBucketCount - 1; split++)
+        {
+            LightBounds below, above;
+            for (uint32_t bucket = 0; bucket <= split; bucket++)
+                below = Union(below, buckets[bucket]);
+
+            for (uint32_t bucket = split + 1; bucket < SplitBucketCount; bucket++)
+                above = Union(above, buckets[bucket]);
+
+            float cost = EvaluateSplitCost(below, nodeExtent, axis) + EvaluateSplitCost(above, nodeExtent, axis);
+            if (cost < minCost)
+            {
+                minCost = cost;
+                minCostAxis = axis;
+                minCostBucket = split;
+            }
+        }
+    }
+
+    uint32_t middle = begin + (end - begin) / 2;
+    if (minCost < FLT_MAX)
+    {
+        auto it = std::partition(m_BuildLights.begin() + begin, m_BuildLights.begin() + end, [&](const BuildLight& buildLight)
+        {
+            return getBucket(buildLight, minCostAxis) <= minCostBucket;
+        });
+
+        uint32_t partition = it - m_BuildLights.begin();
+        if (partition != begin && partition != end)
+            middle = partition;
+    }
+
+    // The first child directly follows its parent, only the second one has to be stored
+    BuildRecursive(begin, middle);
+    uint32_t secondChild = BuildRecursive(middle, end);
+    m_Nodes[nodeIndex].ChildOrLightIndex = secondChild;
+
+    return nodeIndex;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+LightBVH::LightBounds LightBVH::GetLightBounds(const Light& light)
+{
+    LightBounds bounds;
+    bounds.BoundsMin = light.Position;
+    bounds.BoundsMax = light.Position;
+
+    // The power is not reduced by the cone of spot lights, the orientation bounds account for it
+    bounds.Power = LightAliasTable::GetLightIntensity(light);
+
+    if (light.LightType == LightType::SpotLight)
+    {
+        // Full intensity within the inner cone, fading out until the outer one
+        float thetaO = glm::acos(glm::clamp(light.ConeAngleMin, -1.0f, 1.0f));
+        float thetaOuter = glm::acos(glm::clamp(light.ConeAngleMax, -1.0f, 1.0f));
+
+        bounds.ConeAxis = glm::normalize(light.Direction);
+        bounds.CosThetaO = glm::cos(thetaO);
+        bounds.CosThetaE = glm::cos(glm::max(thetaOuter - thetaO, 0.0f));
+    }
+    else
+    {
+        // Point lights emit into every direction
+        bounds.CosThetaO = -1.0f;
+        bounds.CosThetaE = 0.0f;
+    }
+
+    return bounds;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+LightBVH::LightBounds LightBVH::Union(const LightBounds& a, const LightBounds& b)
+{
+    if (a.Power == 0.0f)
+        return b;
+
+    if (b.Power == 0.0f)
+        return a;
+
+    LightBounds result;
+    result.BoundsMin = glm::min(a.BoundsMin, b.BoundsMin);
+    result.BoundsMax = glm::max(a.BoundsMax, b.BoundsMax);
+    result.Power = a.Power + b.Power;
+    result.CosThetaE = glm::min(a.CosThetaE, b.CosThetaE);
+
+    // Smallest cone containing both cones
+    float thetaA = glm::acos(glm::clamp(a.CosThetaO, -1.0f, 1.0f));
+    float thetaB = glm::acos(glm::clamp(b.CosThetaO, -1.0f, 1.0f));
+    float thetaD = glm::acos(glm::clamp(glm::dot(a.ConeAxis, b.ConeAxis), -1.0f, 1.0f));
+
+    if (glm::min(thetaD + thetaB, glm::pi<float>()) <= thetaA)
+    {
+        result.ConeAxis = a.ConeAxis;
+        result.CosThetaO = a.CosThetaO;
+        return result;
+    }
+
+    if (glm::min(thetaD + thetaA, glm::pi<float>()) <= thetaB)
+    {
+        result.ConeAxis = b.ConeAxis;
+        result.CosThetaO = b.CosThetaO;
+        return result;
+    }
+
+    float thetaO = (thetaA + thetaD + thetaB) * 0.5f;
+    glm::vec3 rotationAxis = glm::cross(a.ConeAxis, b.ConeAxis);
+
+    if (thetaO >= glm::pi<float>() || glm::dot(rotationAxis, rotationAxis) == 0.0f)
+    {
+        result.ConeAxis = a.ConeAxis;
+        result.CosThetaO = -1.0f;
+        return result;
+    }
+
+    // Rotate the axis of the first cone towards the second one until it is centered between their outer edges
+    float thetaR = thetaO - thetaA;
+    glm::vec3 k = glm::normalize(rotationAxis);
+    glm::vec3 v = a.ConeAxis;
+
+    result.ConeAxis = glm::normalize(v * glm::cos(thetaR) + glm::cross(k, v) * glm::sin(thetaR) + k * glm::dot(k, v) * (1.0f - glm::cos(thetaR)));
+    result.CosThetaO = glm::cos(thetaO);
+    return result;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+float LightBVH::EvaluateSplitCost(const LightBounds& bounds, const glm::vec3& nodeExtent, uint32_t axis)
+{
+    if (bounds.Power == 0.0f)
+        return 0.0f;
+
+    // Solid angle measure of the directions the lights emit into
+    float thetaO = glm::acos(glm::clamp(bounds.CosThetaO, -1.0f, 1.0f));
+    float thetaE = glm::acos(glm::clamp(bounds.CosThetaE, -1.0f, 1.0f));
+    float thetaW = glm::min(thetaO + thetaE, glm::pi<float>());
+    float sinThetaO = glm::sin(thetaO);
+    float orientationMeasure = 2.0f * glm::pi<float>() * (1.0f - bounds.CosThetaO) +
+        glm::pi<float>() * 0.5f * (2.0f * thetaW * sinThetaO - glm::cos(thetaO - 2.0f * thetaW) - 2.0f * thetaO * sinThetaO + bounds.CosThetaO);
+
+    // Splits across thin axes are penalized, so nodes don't become long and narrow
+    float maxExtent = glm::max(nodeExtent.x, glm::max(nodeExtent.y, nodeExtent.z));
+    float axisRatio = nodeExtent[axis] > 0.0f ? maxExtent / nodeExtent[axis] : 0.0f;
+
+    glm::vec3 extent = bounds.BoundsMax - bounds.BoundsMin;
+    float surfaceArea = 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+
+    return bounds.Power * orientationMeasure * axisRatio * surfaceArea;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "core/core.h"
+#include "rendering/shaders/resources.h"
+
+#include <cfloat>
+
+// Builds the light BVH the shaders traverse to pick a local light by its estimated contribution to the shading point, so
+// noise stays nearly flat as the number of lights grows. The hierarchy is split with the surface area orientation heuristic
+// from pbrt-v4, which keeps lights that are close together and emit into similar directions in the same subtree. Directional
+// lights and lights without power are left out
+class LightBVH
+{
+public:
+    static constexpr uint32_t SplitBucketCount = 12;
+
+    void Build(const Light* lights, uint32_t lightCount);
+    uint32_t Sample(const glm::vec3& position, const glm::vec3& normal, float u, float& outPdf) const;
+
+    inline const std::vector<LightBVHNode>& GetNodes() const { return m_Nodes; }
+private:
+    struct LightBounds
+    {
+        glm::vec3 BoundsMin = glm::vec3(FLT_MAX);
+        glm::vec3 BoundsMax = glm::vec3(-FLT_MAX);
+        float Power = 0.0f;
+        glm::vec3 ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        float CosThetaO = 1.0f;
+        float CosThetaE = 1.0f;
+    };
+
+    struct BuildLight
+    {
+        LightBounds Bounds;
+        uint32_t LightIndex = 0;
+    };
+private:
+    uint32_t BuildRecursive(uint32_t begin, uint32_t end);
+
+    static LightBounds GetLightBounds(const Light& light);
+    static LightBounds Union(const LightBounds& a, const LightBounds& b);
+    static float EvaluateSplitCost(const LightBounds& bounds, const glm::vec3& nodeExtent, uint32_t axis);
+private:
+    std::vector<LightBVHNode> m_Nodes;
+    std::vector<BuildLight> m_BuildLights;
+};
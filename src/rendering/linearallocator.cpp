@@ -0,0 +1,28 @@
+#include "linearallocator.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+LinearAllocator::LinearAllocator(uint64_t capacity)
+    : m_Capacity(capacity)
+{
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool LinearAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset)
+{
+    HEXRAY_ASSERT_MSG(alignment > 0 && (alignment & (alignment - 1)) == 0, "Alignment has to be a power of two");
+
+    uint64_t offset = Align(m_Head, alignment);
+    if (offset + size > m_Capacity)
+        return false;
+
+    outOffset = offset;
+    m_Head = offset + size;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void LinearAllocator::Reset(uint64_t capacity)
+{
+    m_Capacity = capacity;
+    m_Head = 0;
+}
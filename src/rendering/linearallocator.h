@@ -0,0 +1,20 @@
+#pragma once
+
+#include "core/core.h"
+
+// Platform independent bump allocator for a fixed size memory range. Allocations are never freed individually, the whole
+// range is reset at once when the memory it describes is no longer in use
+class LinearAllocator
+{
+public:
+    LinearAllocator(uint64_t capacity = 0);
+
+    bool Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset);
+    void Reset(uint64_t capacity);
+
+    inline uint64_t GetCapacity() const { return m_Capacity; }
+    inline uint64_t GetUsedSize() const { return m_Head; }
+private:
+    uint64_t m_Capacity;
+    uint64_t m_Head = 0;
+};
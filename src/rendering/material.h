@@ -70,6 +70,7 @@ class Material : public Asset
 {
     friend class AssetSerializer;
     friend class DefaultSceneParser;
+    friend class SceneCache;
 public:
     Material(MaterialType type, MaterialFlags flags = MaterialFlags::None);
 
@@ -1,6 +1,8 @@
 #include "mesh.h"
 
+#include "core/timer.h"
 #include "rendering/graphicscontext.h"
+#include "rendering/defaultresources.h"
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 Mesh::Mesh(const MeshDescription& description, const wchar_t* debugName)
@@ -9,16 +11,51 @@ Mesh::Mesh(const MeshDescription& description, const wchar_t* debugName)
     CreateGPU(debugName);
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+Mesh::Mesh(const PrimitiveDescription& description, const wchar_t* debugName)
+    : Asset(AssetType::Mesh), m_PrimitiveDescription(description)
+{
+    CreatePrimitiveGPU(debugName);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+Mesh::Mesh(const PrimitiveDescription& description, HeightfieldDescription&& heightfield, const wchar_t* debugName)
+    : Asset(AssetType::Mesh), m_PrimitiveDescription(description), m_HeightfieldDescription(std::move(heightfield))
+{
+    CreatePrimitiveGPU(debugName);
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 void Mesh::UploadGPUData(const Vertex* vertexData, const uint32_t* indexData, bool keepCPUData)
 {
     uint32_t vertexCount = 0;
     uint32_t indexCount = 0;
 
+    for (const Submesh& submesh : m_Description.Submeshes)
+        m_TriangleAreas.resize(std::max<size_t>(m_TriangleAreas.size(), (submesh.StartIndex + submesh.IndexCount) / 3));
+
+    m_SurfaceAreas.resize(m_Description.Submeshes.size());
+
     for (uint32_t i = 0 ; i < m_Description.Submeshes.size(); i++)
     {
         const Submesh& submesh = m_Description.Submeshes[i];
 
+        // Compute triangle areas, indices are relative to the first vertex of the submesh
+        const Vertex* vertices = vertexData + submesh.StartVertex;
+        const uint32_t* indices = indexData + submesh.StartIndex;
+        float* triangleAreas = m_TriangleAreas.data() + submesh.StartIndex / 3;
+
+        m_SurfaceAreas[i] = 0.0f;
+        for (uint32_t t = 0; t < submesh.IndexCount / 3; t++)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].Position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].Position;
+
+            triangleAreas[t] = 0.5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+            m_SurfaceAreas[i] += triangleAreas[t];
+        }
+
         // Upload vertex data
         GraphicsContext::GetInstance()->UploadBufferData(m_VertexBuffers[i].get(), vertexData + submesh.StartVertex);
 
@@ -70,3 +107,88 @@ void Mesh::CreateGPU(const wchar_t* debugName)
         m_IndexBuffers[i] = std::make_shared<Buffer>(ibDesc, fmt::format(L"{} Submesh {} Index Buffer", debugName, m_Description.Submeshes.size() - 1).c_str());
     }
 }
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Mesh::CreatePrimitiveGPU(const wchar_t* debugName)
+{
+    // Analytic primitives are a single submesh without any vertex or index data
+    m_Description.MaterialTable = std::make_shared<MaterialTable>(1);
+    m_Description.MaterialTable->SetMaterial(0, DefaultResources::DefaultMaterial);
+    m_Description.Submeshes.push_back(Submesh{ 0, 0, 0, 0, 0 });
+
+    glm::vec3 minBound;
+    glm::vec3 maxBound;
+
+    if (m_PrimitiveDescription.Type == PrimitiveType::Heightfield)
+    {
+        CreateHeightfieldGPU(minBound, maxBound, debugName);
+    }
+    else
+    {
+        glm::vec3 halfSize = glm::vec3(m_PrimitiveDescription.Extent);
+
+        if (m_PrimitiveDescription.Type == PrimitiveType::Plane)
+        {
+            // Keep some thickness so that the bounding box never collapses
+            halfSize.y = 0.001f;
+        }
+
+        minBound = m_PrimitiveDescription.Center - halfSize;
+        maxBound = m_PrimitiveDescription.Center + halfSize;
+    }
+
+    D3D12_RAYTRACING_AABB aabb = { minBound.x, minBound.y, minBound.z, maxBound.x, maxBound.y, maxBound.z };
+
+    // Create AABB buffer
+    BufferDescription aabbBufferDesc;
+    aabbBufferDesc.ElementCount = 1;
+    aabbBufferDesc.ElementSize = sizeof(D3D12_RAYTRACING_AABB);
+    aabbBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    aabbBufferDesc.InitialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+
+    m_AABBBuffer = std::make_shared<Buffer>(aabbBufferDesc, fmt::format(L"{} AABB Buffer", debugName).c_str());
+    memcpy(m_AABBBuffer->GetMappedData(), &aabb, sizeof(D3D12_RAYTRACING_AABB));
+
+    // Create acceleration structure
+    m_AccelerationStructures.push_back(GraphicsContext::GetInstance()->BuildBottomLevelAccelerationStructure(this, 0));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Mesh::CreateHeightfieldGPU(glm::vec3& outMinBound, glm::vec3& outMaxBound, const wchar_t* debugName)
+{
+    const HeightfieldDescription& heightfield = m_HeightfieldDescription;
+
+    Timer timer;
+    timer.Reset();
+
+    uint32_t cellCountX = heightfield.Width - 1;
+    uint32_t cellCountZ = heightfield.Depth - 1;
+
+    std::vector<uint32_t> data;
+    HeightfieldInfo info = HeightfieldBuilder::Build(heightfield, 2.0f * m_PrimitiveDescription.Extent / std::max(cellCountX, cellCountZ), data);
+
+    BufferDescription heightfieldBufferDesc;
+    heightfieldBufferDesc.ElementCount = data.size();
+    heightfieldBufferDesc.ElementSize = sizeof(uint32_t);
+    heightfieldBufferDesc.InitialState = D3D12_RESOURCE_STATE_COMMON;
+
+    m_HeightfieldBuffer = std::make_shared<Buffer>(heightfieldBufferDesc, fmt::format(L"{} Heightfield Buffer", debugName).c_str());
+    GraphicsContext::GetInstance()->UploadBufferData(m_HeightfieldBuffer.get(), data.data());
+
+    // The bounding box spans the grid footprint and the height range of the root node
+    float minHeight, maxHeight;
+    HeightfieldBuilder::GetHeightRange(info, data, minHeight, maxHeight);
+    maxHeight = std::max(maxHeight, minHeight + 0.001f);
+
+    glm::vec2 halfSize = 0.5f * glm::vec2(cellCountX, cellCountZ) * info.CellSize;
+
+    outMinBound = m_PrimitiveDescription.Center + glm::vec3(-halfSize.x, minHeight, -halfSize.y);
+    outMaxBound = m_PrimitiveDescription.Center + glm::vec3(halfSize.x, maxHeight, halfSize.y);
+
+    timer.Stop();
+
+    // A triangulated grid would need a vertex per sample and two triangles per cell
+    float triangulatedSize = heightfield.Heights.size() * sizeof(Vertex) + cellCountX * cellCountZ * 6 * sizeof(uint32_t);
+    HEXRAY_INFO("Mesh: Built {}x{} heightfield with {} pyramid levels in {:.2f} ms ({:.2f} MB, {:.2f} MB triangulated)",
+        heightfield.Width, heightfield.Depth, info.MipCount, timer.GetElapsedTimeMS(), data.size() * sizeof(uint32_t) / (1024.0f * 1024.0f), triangulatedSize / (1024.0f * 1024.0f));
+}
@@ -3,6 +3,7 @@
 #include "core/core.h"
 #include "rendering/buffer.h"
 #include "rendering/material.h"
+#include "rendering/heightfield.h"
 #include "rendering/resources_fwd.h"
 #include "asset/asset.h"
 #include "rendering/shaders/resources.h"
@@ -24,15 +25,28 @@ struct MeshDescription
     std::vector<Submesh> Submeshes;
 };
 
+struct PrimitiveDescription
+{
+    PrimitiveType Type = PrimitiveType::NotPrimitive;
+    glm::vec3 Center = glm::vec3(0.0f);
+    float Extent = 1.0f; // Radius of a sphere, half the side of a cube, half the size of a plane or half the longer side of a heightfield
+};
+
 class Mesh : public Asset
 {
 public:
     Mesh(const MeshDescription& description, const wchar_t* debugName = L"Unnamed Mesh");
+    Mesh(const PrimitiveDescription& description, const wchar_t* debugName = L"Unnamed Primitive");
+    Mesh(const PrimitiveDescription& description, HeightfieldDescription&& heightfield, const wchar_t* debugName = L"Unnamed Heightfield");
 
     void UploadGPUData(const Vertex* vertexData, const uint32_t* indexData, bool keepCPUData = false);
 
     inline const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
     inline const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+
+    // Object space area of every triangle, kept for all meshes so emissive triangles can be sampled by area
+    inline const float* GetTriangleAreas(uint32_t submeshIndex) const { return m_TriangleAreas.data() + GetSubmesh(submeshIndex).StartIndex / 3; }
+    inline float GetSurfaceArea(uint32_t submeshIndex) const { return m_SurfaceAreas[submeshIndex]; }
     inline const std::shared_ptr<MaterialTable>& GetMaterialTable() const { return m_Description.MaterialTable; }
     inline const std::vector<Submesh>& GetSubmeshes() const { return m_Description.Submeshes; }
 
@@ -41,13 +55,27 @@ public:
     inline const BufferPtr& GetVertexBuffer(uint32_t submeshIndex) const { return m_VertexBuffers[submeshIndex]; }
     inline const BufferPtr& GetIndexBuffer(uint32_t submeshIndex) const { return m_IndexBuffers[submeshIndex]; }
     inline const BufferPtr& GetAccelerationStructure(uint32_t submeshIndex) const { return m_AccelerationStructures[submeshIndex]; }
+
+    inline bool IsPrimitive() const { return m_PrimitiveDescription.Type != PrimitiveType::NotPrimitive; }
+    inline const PrimitiveDescription& GetPrimitiveDescription() const { return m_PrimitiveDescription; }
+    inline const BufferPtr& GetAABBBuffer() const { return m_AABBBuffer; }
+    inline const HeightfieldDescription& GetHeightfieldDescription() const { return m_HeightfieldDescription; }
+    inline const BufferPtr& GetHeightfieldBuffer() const { return m_HeightfieldBuffer; }
 private:
     void CreateGPU(const wchar_t* debugName = L"Unnamed Mesh");
+    void CreatePrimitiveGPU(const wchar_t* debugName = L"Unnamed Primitive");
+    void CreateHeightfieldGPU(glm::vec3& outMinBound, glm::vec3& outMaxBound, const wchar_t* debugName = L"Unnamed Heightfield");
 private:
     MeshDescription m_Description;
+    PrimitiveDescription m_PrimitiveDescription;
+    HeightfieldDescription m_HeightfieldDescription;
+    BufferPtr m_AABBBuffer;
+    BufferPtr m_HeightfieldBuffer;
     std::vector<BufferPtr> m_VertexBuffers;
     std::vector<BufferPtr> m_IndexBuffers;
     std::vector<BufferPtr> m_AccelerationStructures;
     std::vector<Vertex> m_Vertices;
     std::vector<uint32_t> m_Indices;
+    std::vector<float> m_TriangleAreas;
+    std::vector<float> m_SurfaceAreas;
 };
@@ -2,23 +2,33 @@
 #include "core/application.h"
 #include "rendering/graphicscontext.h"
 #include "rendering/defaultresources.h"
+#include "rendering/virtualtexture.h"
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 Renderer::Renderer(const RendererDescription& description)
-    : m_Description(description)
+    : m_Description(description),
+    m_LightsBuffer(sizeof(Light)),
+    m_MaterialBuffer(sizeof(MaterialConstants)),
+    m_GeometryBuffer(sizeof(GeometryConstants)),
+    m_LightAliasBuffer(sizeof(LightAliasEntry)),
+    m_LightBVHBuffer(sizeof(LightBVHNode)),
+    m_EmissiveInstanceBuffer(sizeof(EmissiveInstance)),
+    m_EmissiveCdfBuffer(sizeof(float))
 {
     // Create raytracing pipeline
     RaytracingPipelineDescription pipelineDesc;
     pipelineDesc.ShaderFilePath = Application::GetInstance()->GetExecutablePath().parent_path() / "shaderdata.cso";
     pipelineDesc.MaxRecursionDepth = m_Description.RayRecursionDepth;
     pipelineDesc.MaxPayloadSize = sizeof(ColorRayPayload);
-    pipelineDesc.MaxIntersectAttributesSize = sizeof(glm::vec2);
+    pipelineDesc.MaxIntersectAttributesSize = std::max(sizeof(glm::vec2), sizeof(PrimitiveAttributes));
     pipelineDesc.RayGenShader = L"RayGenShader";
     pipelineDesc.MissShaders = {
         L"MissShader_Color", L"MissShader_Shadow"
     };
+    // Order has to match c_TriangleHitGroupIndex and c_PrimitiveHitGroupIndex
     pipelineDesc.HitGroups = {
         HitGroup { D3D12_HIT_GROUP_TYPE_TRIANGLES, L"ColorHitGroup", L"ClosestHitShader_Color", L"", L"" },
+        HitGroup { D3D12_HIT_GROUP_TYPE_PROCEDURAL_PRIMITIVE, L"PrimitiveHitGroup", L"ClosestHitShader_Primitive", L"", L"IntersectionShader_Primitive" },
     };
 
     m_RTPipeline = std::make_shared<RaytracingPipeline>(pipelineDesc, L"Triangle Raytracing Pipeline");
@@ -42,17 +52,8 @@ Renderer::Renderer(const RendererDescription& description)
 
     // Create per frame resources
     for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
-    {
         RecreateTextures(i);
 
-        BufferDescription sceneBufferDesc;
-        sceneBufferDesc.ElementCount = 1;
-        sceneBufferDesc.ElementSize = sizeof(SceneConstants);
-        sceneBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
-
-        m_SceneBuffers[i] = std::make_shared<Buffer>(sceneBufferDesc, fmt::format(L"Scene Buffer {}", i).c_str());
-    }
-
     m_SceneConstants.FrameIndex = 1;
 }
 
@@ -73,7 +74,6 @@ void Renderer::BeginScene(const Camera& camera, const std::shared_ptr<Texture>&
     m_SceneConstants.InvProjMatrix = glm::inverse(m_SceneConstants.ProjectionMatrix);
     m_SceneConstants.InvViewMatrix = glm::inverse(m_SceneConstants.ViewMatrix);
     m_SceneConstants.CameraPosition = camera.GetPosition();
-    m_SceneConstants.NumLights = 0;
 
     m_CameraExposure = camera.GetExposure();
 
@@ -81,41 +81,293 @@ void Renderer::BeginScene(const Camera& camera, const std::shared_ptr<Texture>&
         m_SceneConstants.FrameIndex = 1;
 
     m_ResourceBindTable.EnvironmentMapIndex = environmentMap ? environmentMap->GetSRV() : DefaultResources::BlackTextureCube->GetSRV();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::SetViewportSize(uint32_t width, uint32_t height)
+{
+    if (m_ViewportWidth == width && m_ViewportHeight == height)
+        return;
+
+    m_ViewportWidth = width;
+    m_ViewportHeight = height;
+    m_SceneConstants.FrameIndex = 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::Render()
+{
+    if (m_MeshCount == 0)
+        return;
+
+    uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
+
+    // Update Render target
+    std::shared_ptr<Texture>& renderTarget = m_RenderTargets[currentFrameIndex];
+
+    // Pooled textures can be larger than the viewport, they are only replaced when they no longer fit or waste too much memory
+    if (!TexturePoolPolicy::CanServe(renderTarget->GetWidth(), renderTarget->GetHeight(), m_ViewportWidth, m_ViewportHeight))
+    {
+        RecreateTextures(currentFrameIndex);
+    }
+
+    m_TexturePool.Update();
+
+    m_ResourceBindTable.RenderTargetIndex = renderTarget->GetUAV(0);
+    m_ResourceBindTable.ViewportWidth = m_ViewportWidth;
+    m_ResourceBindTable.ViewportHeight = m_ViewportHeight;
+
+    std::shared_ptr<Texture>& prevFrameRenderTarget = m_RenderTargets[currentFrameIndex == 0 ? FRAMES_IN_FLIGHT - 1 : currentFrameIndex - 1];
+    m_ResourceBindTable.PrevFrameRenderTargetIndex = prevFrameRenderTarget->GetUAV(0);
+
+    // Update scene, light, material and geometry constants
+    m_SceneConstants.NumLights = m_LightsBuffer.GetElementCount();
+
+    if (m_FixedFrameIndex != 0)
+        m_SceneConstants.FrameIndex = m_FixedFrameIndex;
+
+    UpdateFrameConstants(currentFrameIndex);
+
+    // Update Top-level Acceleration structure. The previous one stays valid for frames still in flight, buffers are released deferred
+    if (m_IsAccelerationStructureDirty)
+    {
+        m_TopLevelAccelerationStructure = GraphicsContext::GetInstance()->BuildTopLevelAccelerationStructure(m_MeshInstances);
+        m_IsAccelerationStructureDirty = false;
+    }
+
+    m_ResourceBindTable.AccelerationStructureIndex = m_TopLevelAccelerationStructure->GetSRV();
+
+    // Stream in the virtual texture pages requested by previous frames
+    VirtualTextureSystem::Update(currentFrameIndex, m_ResourceBindTable.VirtualTextureConstants);
+
+    // Render scene. The frame is recorded as a render graph that places the barriers between the passes and the post FX
+    // textures in transient memory
+    RenderGraphResourceID renderTargetID = m_RenderGraph.ImportTexture(renderTarget, RenderGraphResourceState::UnorderedAccess, RenderGraphResourceState::UnorderedAccess);
+    RenderGraphResourceID prevFrameRenderTargetID = m_RenderGraph.ImportTexture(prevFrameRenderTarget, RenderGraphResourceState::UnorderedAccess, RenderGraphResourceState::UnorderedAccess);
+
+    std::vector<RenderGraphResourceAccess> pathTracingAccesses = {
+        { renderTargetID, RenderGraphResourceState::UnorderedAccess, RenderGraphAccessType::Write },
+        { prevFrameRenderTargetID, RenderGraphResourceState::UnorderedAccess, RenderGraphAccessType::Read },
+    };
+
+    // Resolving the virtual texture feedback has effects outside of the graph, so the pass is never culled
+    m_RenderGraph.AddPass("Path Tracing", pathTracingAccesses, [this, currentFrameIndex]()
+    {
+        GraphicsContext::GetInstance()->DispatchRays(m_ViewportWidth, m_ViewportHeight, m_ResourceBindTable, m_RTPipeline.get());
+        VirtualTextureSystem::ResolveFeedback(currentFrameIndex);
+    }, true);
+
+    // Render PostFX
+    RenderGraphResourceID sceneColorID = ApplyBloom(renderTargetID);
+    ApplyTonemapping(sceneColorID);
+
+    m_RenderGraph.Execute();
+
+    m_SceneConstants.FrameIndex++;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RenderObjectID Renderer::AddMesh(const MeshInstance& instance)
+{
+    if (!instance.Mesh)
+        return InvalidRenderObjectID;
+
+    RenderObjectID id;
+    if (!m_FreeMeshIDs.empty())
+    {
+        id = m_FreeMeshIDs.back();
+        m_FreeMeshIDs.pop_back();
+    }
+    else
+    {
+        id = m_MeshInstances.size();
+        m_MeshInstances.emplace_back();
+    }
+
+    MeshInstance& meshInstance = m_MeshInstances[id];
+    meshInstance = instance;
+    AcquireGeometries(meshInstance, false);
+
+    m_MeshCount++;
+    m_IsAccelerationStructureDirty = true;
+    m_IsEmissiveTrianglesDirty = true;
+    m_SceneConstants.FrameIndex = 1;
+    return id;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::UpdateMesh(RenderObjectID id, const MeshInstance& instance)
+{
+    HEXRAY_ASSERT(id < m_MeshInstances.size() && m_MeshInstances[id].Mesh);
+
+    if (!instance.Mesh)
+    {
+        RemoveMesh(id);
+        return;
+    }
+
+    // The new entries are acquired before the old ones are released, so entries both use are not recreated
+    MeshInstance& meshInstance = m_MeshInstances[id];
+    std::vector<uint32_t> previousGeometryIDs = std::move(meshInstance.GeometryIDs);
 
-    m_Lights.clear();
+    meshInstance = instance;
+    AcquireGeometries(meshInstance, true);
+
+    for (uint32_t geometryID : previousGeometryIDs)
+        ReleaseGeometry(geometryID);
+
+    m_IsAccelerationStructureDirty = true;
+    m_IsEmissiveTrianglesDirty = true;
+    m_SceneConstants.FrameIndex = 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::UpdateMeshTransform(RenderObjectID id, const glm::mat4& transform)
+{
+    HEXRAY_ASSERT(id < m_MeshInstances.size() && m_MeshInstances[id].Mesh);
+
+    m_MeshInstances[id].Transform = transform;
+    m_IsAccelerationStructureDirty = true;
+    m_IsEmissiveTrianglesDirty = true;
+    m_SceneConstants.FrameIndex = 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::RemoveMesh(RenderObjectID id)
+{
+    HEXRAY_ASSERT(id < m_MeshInstances.size() && m_MeshInstances[id].Mesh);
+
+    for (uint32_t geometryID : m_MeshInstances[id].GeometryIDs)
+        ReleaseGeometry(geometryID);
+
+    m_MeshInstances[id] = MeshInstance();
+    m_FreeMeshIDs.push_back(id);
+
+    m_MeshCount--;
+    m_IsAccelerationStructureDirty = true;
+    m_IsEmissiveTrianglesDirty = true;
+    m_SceneConstants.FrameIndex = 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RenderObjectID Renderer::AddLight(const Light& light)
+{
+    RenderObjectID id;
+    if (!m_FreeLightIDs.empty())
+    {
+        id = m_FreeLightIDs.back();
+        m_FreeLightIDs.pop_back();
+    }
+    else
+    {
+        id = m_LightIndices.size();
+        m_LightIndices.emplace_back();
+    }
+
+    uint32_t lightIndex = m_LightIDs.size();
+    m_LightIndices[id] = lightIndex;
+    m_LightIDs.push_back(id);
+
+    m_LightsBuffer.Resize(lightIndex + 1);
+    m_LightsBuffer.Write(lightIndex, &light);
+
+    m_IsLightSamplingDirty = true;
+    m_SceneConstants.FrameIndex = 1;
+    return id;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::UpdateLight(RenderObjectID id, const Light& light)
+{
+    HEXRAY_ASSERT(id < m_LightIndices.size());
+
+    m_LightsBuffer.Write(m_LightIndices[id], &light);
+
+    m_IsLightSamplingDirty = true;
+    m_SceneConstants.FrameIndex = 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::RemoveLight(RenderObjectID id)
+{
+    HEXRAY_ASSERT(id < m_LightIndices.size());
+
+    uint32_t lightIndex = m_LightIndices[id];
+    uint32_t lastLightIndex = m_LightIDs.size() - 1;
+
+    if (lightIndex != lastLightIndex)
+    {
+        m_LightsBuffer.Write(lightIndex, m_LightsBuffer.GetElement(lastLightIndex));
+        m_LightIDs[lightIndex] = m_LightIDs[lastLightIndex];
+        m_LightIndices[m_LightIDs[lightIndex]] = lightIndex;
+    }
+
+    m_LightIDs.pop_back();
+    m_LightsBuffer.Resize(lastLightIndex);
+    m_FreeLightIDs.push_back(id);
+
+    m_IsLightSamplingDirty = true;
+    m_SceneConstants.FrameIndex = 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::ClearRenderObjects()
+{
     m_MeshInstances.clear();
+    m_FreeMeshIDs.clear();
+    m_MeshCount = 0;
+
+    m_MaterialIDs.clear();
+    m_MaterialKeys.clear();
+    m_MaterialRefCounts.clear();
+    m_FreeMaterialIDs.clear();
+    m_MaterialBuffer.Resize(0);
+
+    m_GeometryIDs.clear();
+    m_GeometryKeys.clear();
+    m_GeometryRefCounts.clear();
+    m_FreeGeometryIDs.clear();
+    m_GeometryBuffer.Resize(0);
+
+    m_LightIndices.clear();
+    m_LightIDs.clear();
+    m_FreeLightIDs.clear();
+    m_LightsBuffer.Resize(0);
+    m_IsLightSamplingDirty = true;
+
+    m_IsAccelerationStructureDirty = true;
+    m_IsEmissiveTrianglesDirty = true;
+    m_SceneConstants.FrameIndex = 1;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::SubmitDirectionalLight(const glm::vec3& color, const glm::vec3& direction, float intensity)
+Light Renderer::CreateDirectionalLight(const glm::vec3& color, const glm::vec3& direction, float intensity)
 {
-    Light& light = m_Lights.emplace_back();
+    Light light = {};
     light.LightType = LightType::DirLight;
     light.Color = { color.r, color.g, color.b };
     light.Position = direction * -(MAX_RAY_DEPTH - 0.1f); // somewhere reaaaaally far
     light.Direction = direction;
     light.Intensity = intensity;
-
-    m_SceneConstants.NumLights++;
+    return light;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::SubmitPointLight(const glm::vec3& color, const glm::vec3& position, float intensity, const glm::vec3& attenuationFactors)
+Light Renderer::CreatePointLight(const glm::vec3& color, const glm::vec3& position, float intensity, const glm::vec3& attenuationFactors)
 {
-    Light& light = m_Lights.emplace_back();
+    Light light = {};
     light.LightType = LightType::PointLight;
     light.Color = { color.r, color.g, color.b };
     light.Position = { position.x, position.y, position.z };
     light.Intensity = intensity;
     light.AttenuationFactors = attenuationFactors;
-
-    m_SceneConstants.NumLights++;
+    return light;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::SubmitSpotLight(const glm::vec3& color, const glm::vec3& position, const glm::vec3& direction, float intensity, float coneAngleMin, float coneAngleMax, const glm::vec3& attenuationFactors)
+Light Renderer::CreateSpotLight(const glm::vec3& color, const glm::vec3& position, const glm::vec3& direction, float intensity, float coneAngleMin, float coneAngleMax, const glm::vec3& attenuationFactors)
 {
-    Light& light = m_Lights.emplace_back();
+    Light light = {};
     light.LightType = LightType::SpotLight;
     light.Color = { color.r, color.g, color.b };
     light.Position = { position.x, position.y, position.z };
@@ -124,336 +376,516 @@ void Renderer::SubmitSpotLight(const glm::vec3& color, const glm::vec3& position
     light.ConeAngleMin = cos(coneAngleMin);
     light.ConeAngleMax = cos(coneAngleMax);
     light.AttenuationFactors = attenuationFactors;
-
-    m_SceneConstants.NumLights++;
+    return light;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::SubmitMesh(const std::shared_ptr<Mesh>& mesh, const glm::mat4& transform, const std::shared_ptr<MaterialTable>& overrideMaterialTable)
+const std::shared_ptr<Texture>& Renderer::GetFinalImage() const
 {
-    if (!mesh)
-        return;
-
-    MeshInstance& instance = m_MeshInstances.emplace_back();
-    instance.Transform = transform;
-    instance.Mesh = mesh;
-    instance.OverrideMaterialTable = overrideMaterialTable;
+    uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
+    return m_FinalOutputTexture[currentFrameIndex];
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::SetViewportSize(uint32_t width, uint32_t height)
+void Renderer::UpdateFrameConstants(uint32_t frameIndex)
 {
-    if (m_ViewportWidth == width && m_ViewportHeight == height)
-        return;
+    if (m_IsLightSamplingDirty)
+    {
+        uint32_t lightCount = m_LightsBuffer.GetElementCount();
+        const Light* lights = lightCount > 0 ? (const Light*)m_LightsBuffer.GetElement(0) : nullptr;
+
+        // Local lights get no weight in the alias table, they are only reached through the light BVH. Without a directional
+        // light that emits, the table falls back to picking every light uniformly, so the shaders must not use it at all
+        uint32_t directionalLightCount = 0;
+        m_LightWeights.resize(lightCount);
+        for (uint32_t i = 0; i < lightCount; i++)
+        {
+            m_LightWeights[i] = lights[i].LightType == LightType::DirLight ? LightAliasTable::GetLightWeight(lights[i]) : 0.0f;
+            directionalLightCount += m_LightWeights[i] > 0.0f ? 1 : 0;
+        }
 
-    m_ViewportWidth = width;
-    m_ViewportHeight = height;
-    m_SceneConstants.FrameIndex = 1;
-}
+        m_LightAliasTable.Build(m_LightWeights.data(), lightCount);
+        m_LightBVH.Build(lights, lightCount);
 
-// ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::Render()
-{
-    if (m_MeshInstances.empty())
-        return;
+        m_LightAliasBuffer.Resize(lightCount);
+        if (lightCount > 0)
+            m_LightAliasBuffer.Write(0, m_LightAliasTable.GetEntries().data(), lightCount);
 
-    uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
+        uint32_t nodeCount = m_LightBVH.GetNodes().size();
+        m_LightBVHBuffer.Resize(nodeCount);
+        if (nodeCount > 0)
+            m_LightBVHBuffer.Write(0, m_LightBVH.GetNodes().data(), nodeCount);
 
-    // Update Render target
-    std::shared_ptr<Texture>& renderTarget = m_RenderTargets[currentFrameIndex];
+        m_ResourceBindTable.DirectionalLightCount = directionalLightCount;
+        m_ResourceBindTable.LightBVHNodeCount = nodeCount;
+        m_IsLightSamplingDirty = false;
+    }
 
-    if (renderTarget->GetWidth() != m_ViewportWidth || renderTarget->GetHeight() != m_ViewportHeight)
+    if (m_IsEmissiveTrianglesDirty)
     {
-        RecreateTextures(currentFrameIndex);
+        UpdateEmissiveTriangles();
+        m_IsEmissiveTrianglesDirty = false;
     }
 
-    m_ResourceBindTable.RenderTargetIndex = renderTarget->GetUAV(0);
+    uint64_t requiredSize = Align(sizeof(SceneConstants), FrameConstantAlignment) + Align(m_LightsBuffer.GetSize(), FrameConstantAlignment) +
+        Align(m_LightAliasBuffer.GetSize(), FrameConstantAlignment) + Align(m_LightBVHBuffer.GetSize(), FrameConstantAlignment) +
+        Align(m_EmissiveInstanceBuffer.GetSize(), FrameConstantAlignment) + Align(m_EmissiveCdfBuffer.GetSize(), FrameConstantAlignment) +
+        Align(m_MaterialBuffer.GetSize(), FrameConstantAlignment) + m_GeometryBuffer.GetSize();
 
-    std::shared_ptr<Texture>& prevFrameRenderTarget = m_RenderTargets[currentFrameIndex == 0 ? FRAMES_IN_FLIGHT - 1 : currentFrameIndex - 1];
-    m_ResourceBindTable.PrevFrameRenderTargetIndex = prevFrameRenderTarget->GetUAV(0);
+    // The buffer grows with some headroom, so steady state frames neither create buffers nor allocate memory
+    std::shared_ptr<Buffer>& frameConstantBuffer = m_FrameConstantBuffers[frameIndex];
+    if (!frameConstantBuffer || frameConstantBuffer->GetSize() < requiredSize)
+    {
+        BufferDescription bufferDesc;
+        bufferDesc.ElementCount = uint32_t(Align(requiredSize + requiredSize / 2, 4ull) / 4);
+        bufferDesc.ElementSize = 4;
+        bufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        frameConstantBuffer = std::make_shared<Buffer>(bufferDesc, fmt::format(L"Frame Constants {}", frameIndex).c_str());
+
+        m_LightsBuffer.Invalidate(frameIndex);
+        m_LightAliasBuffer.Invalidate(frameIndex);
+        m_LightBVHBuffer.Invalidate(frameIndex);
+        m_EmissiveInstanceBuffer.Invalidate(frameIndex);
+        m_EmissiveCdfBuffer.Invalidate(frameIndex);
+        m_MaterialBuffer.Invalidate(frameIndex);
+        m_GeometryBuffer.Invalidate(frameIndex);
+    }
 
-    // Update Scene buffer
-    std::shared_ptr<Buffer>& sceneBuffer = m_SceneBuffers[currentFrameIndex];
+    m_FrameConstantAllocator.Reset(frameConstantBuffer->GetSize());
+    uint8_t* frameData = (uint8_t*)frameConstantBuffer->GetMappedData();
 
-    memcpy(sceneBuffer->GetMappedData(), &m_SceneConstants, sizeof(SceneConstants));
-    m_ResourceBindTable.SceneBufferIndex = sceneBuffer->GetSRV();
+    uint64_t sceneConstantsOffset = AllocateFrameConstants(sizeof(SceneConstants));
+    memcpy(frameData + sceneConstantsOffset, &m_SceneConstants, sizeof(SceneConstants));
 
-    // Update Lights buffer
-    if (!m_Lights.empty())
-    {
-        std::shared_ptr<Buffer>& lightsBuffer = m_LightsBuffers[currentFrameIndex];
+    // Retained constants keep their offsets while the element counts don't change, then only the entries that changed
+    // since this frame's memory was last used are copied
+    uint64_t lightsOffset = AllocateFrameConstants(m_LightsBuffer.GetSize());
+    m_LightsBuffer.Upload(frameIndex, frameData, lightsOffset);
 
-        if (!lightsBuffer || lightsBuffer->GetElementCount() != m_Lights.size())
-        {
-            BufferDescription lightsBufferDesc;
-            lightsBufferDesc.ElementCount = m_Lights.size();
-            lightsBufferDesc.ElementSize = sizeof(Light);
-            lightsBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+    uint64_t lightAliasTableOffset = AllocateFrameConstants(m_LightAliasBuffer.GetSize());
+    m_LightAliasBuffer.Upload(frameIndex, frameData, lightAliasTableOffset);
 
-            lightsBuffer = std::make_shared<Buffer>(lightsBufferDesc, fmt::format(L"Lights Buffer {}", currentFrameIndex).c_str());
-        }
+    uint64_t lightBVHOffset = AllocateFrameConstants(m_LightBVHBuffer.GetSize());
+    m_LightBVHBuffer.Upload(frameIndex, frameData, lightBVHOffset);
 
-        memcpy(lightsBuffer->GetMappedData(), m_Lights.data(), m_Lights.size() * sizeof(Light));
+    uint64_t emissiveInstancesOffset = AllocateFrameConstants(m_EmissiveInstanceBuffer.GetSize());
+    m_EmissiveInstanceBuffer.Upload(frameIndex, frameData, emissiveInstancesOffset);
 
-        m_ResourceBindTable.LightsBufferIndex = lightsBuffer->GetSRV();
-    }
-    else
-    {
-        m_ResourceBindTable.LightsBufferIndex = InvalidDescriptorIndex;
-    }
+    uint64_t emissiveCdfOffset = AllocateFrameConstants(m_EmissiveCdfBuffer.GetSize());
+    m_EmissiveCdfBuffer.Upload(frameIndex, frameData, emissiveCdfOffset);
+
+    uint64_t materialsOffset = AllocateFrameConstants(m_MaterialBuffer.GetSize());
+    m_MaterialBuffer.Upload(frameIndex, frameData, materialsOffset);
+
+    uint64_t geometryOffset = AllocateFrameConstants(m_GeometryBuffer.GetSize());
+    m_GeometryBuffer.Upload(frameIndex, frameData, geometryOffset);
+
+    m_ResourceBindTable.FrameConstantsBufferIndex = frameConstantBuffer->GetSRV();
+    m_ResourceBindTable.SceneConstantsOffset = uint32_t(sceneConstantsOffset);
+    m_ResourceBindTable.LightsOffset = uint32_t(lightsOffset);
+    m_ResourceBindTable.LightAliasTableOffset = uint32_t(lightAliasTableOffset);
+    m_ResourceBindTable.LightBVHOffset = uint32_t(lightBVHOffset);
+    m_ResourceBindTable.EmissiveInstancesOffset = uint32_t(emissiveInstancesOffset);
+    m_ResourceBindTable.EmissiveCdfOffset = uint32_t(emissiveCdfOffset);
+    m_ResourceBindTable.MaterialsOffset = uint32_t(materialsOffset);
+    m_ResourceBindTable.GeometryOffset = uint32_t(geometryOffset);
+}
 
-    // Update Material buffer
-    std::shared_ptr<Buffer>& materialBuffer = m_MaterialBuffers[currentFrameIndex];
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint64_t Renderer::AllocateFrameConstants(uint64_t size)
+{
+    uint64_t offset = 0;
+    [[maybe_unused]] bool isAllocated = m_FrameConstantAllocator.Allocate(size, FrameConstantAlignment, offset);
+    HEXRAY_ASSERT_MSG(isAllocated, "Frame constants need {} more bytes than were reserved", size);
+    return offset;
+}
 
-    std::vector<MaterialConstants> materials;
-    materials.reserve(m_MeshInstances.size());
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::UpdateEmissiveTriangles()
+{
+    m_EmissiveTriangles.Clear();
 
+    // Every copy of every submesh with an emissive material becomes an emitter. Primitives have no triangles to sample
     for (const MeshInstance& instance : m_MeshInstances)
     {
+        if (!instance.Mesh || instance.Mesh->IsPrimitive())
+            continue;
+
         for (uint32_t i = 0; i < instance.Mesh->GetSubmeshes().size(); i++)
         {
-            uint32_t materialIndex = instance.Mesh->GetSubmesh(i).MaterialIndex;
-            MaterialPtr overrideMaterial = instance.OverrideMaterialTable ? instance.OverrideMaterialTable->GetMaterial(materialIndex) : nullptr;
-            MaterialPtr meshMaterial = instance.Mesh->GetMaterial(i);
+            uint32_t geometryIndex = instance.GeometryIDs[i];
+            const MaterialConstants* material = (const MaterialConstants*)m_MaterialBuffer.GetElement(m_GeometryKeys[geometryIndex].MaterialID);
+            glm::vec3 emission = glm::vec3(material->EmissiveColor);
 
-            MaterialPtr material = overrideMaterial ? overrideMaterial : meshMaterial;
+            if (EmissiveTriangles::GetEmissionLuminance(emission) <= 0.0f)
+                continue;
 
-            MaterialConstants& materialConstants = materials.emplace_back();
-            materialConstants.MaterialType = material->GetType();
+            // Culling is decided by the mesh material, like in the top level acceleration structure
+            bool isTwoSided = instance.Mesh->GetMaterial(i)->GetFlag(MaterialFlags::TwoSided);
+            const float* triangleAreas = instance.Mesh->GetTriangleAreas(i);
+            uint32_t triangleCount = instance.Mesh->GetSubmesh(i).IndexCount / 3;
+            float surfaceArea = instance.Mesh->GetSurfaceArea(i);
 
-            material->GetProperty(MaterialPropertyType::AlbedoColor, materialConstants.AlbedoColor);
-            material->GetProperty(MaterialPropertyType::EmissiveColor, materialConstants.EmissiveColor);
-            material->GetProperty(MaterialPropertyType::RefractionColor, materialConstants.RefractionColor);
-            material->GetProperty(MaterialPropertyType::IndexOfRefraction, materialConstants.IndexOfRefraction);
-            material->GetProperty(MaterialPropertyType::ReflectionColor, materialConstants.ReflectionColor);
+            for (uint32_t j = 0; j < instance.InstanceCount; j++)
+            {
+                glm::mat4 transform = instance.InstanceTransforms ? instance.Transform * (*instance.InstanceTransforms)[j] : instance.Transform;
+                m_EmissiveTriangles.AddInstance(transform, geometryIndex, triangleAreas, triangleCount, surfaceArea, emission, isTwoSided);
+            }
+        }
+    }
 
-            TexturePtr albedoMap = nullptr;
-            material->GetTexture(MaterialTextureType::Albedo, albedoMap);
+    m_EmissiveTriangles.Build();
 
-            materialConstants.AlbedoMapIndex = albedoMap ? albedoMap->GetSRV() : InvalidDescriptorIndex;
-            materialConstants.AlbedoSamplerType = albedoMap ? albedoMap->GetSamplerType() : SamplerType::LinearClamp;
-            materialConstants.AlbedoMapScaling = albedoMap ? albedoMap->GetScaling() : 1.0f;
-   
+    uint32_t instanceCount = m_EmissiveTriangles.GetInstances().size();
+    m_EmissiveInstanceBuffer.Resize(instanceCount);
+    if (instanceCount > 0)
+        m_EmissiveInstanceBuffer.Write(0, m_EmissiveTriangles.GetInstances().data(), instanceCount);
 
-            TexturePtr normalMap = nullptr;
-            if (material->GetTexture(MaterialTextureType::Normal, normalMap))
-                materialConstants.NormalMapIndex = normalMap ? normalMap->GetSRV() : InvalidDescriptorIndex;
+    uint32_t cdfSize = m_EmissiveTriangles.GetCdf().size();
+    m_EmissiveCdfBuffer.Resize(cdfSize);
+    if (cdfSize > 0)
+        m_EmissiveCdfBuffer.Write(0, m_EmissiveTriangles.GetCdf().data(), cdfSize);
 
-            if (material->GetType() == MaterialType::Phong)
-            {
-                material->GetProperty(MaterialPropertyType::SpecularColor, materialConstants.SpecularColor);
-                material->GetProperty(MaterialPropertyType::Shininess, materialConstants.Shininess);
-            }
-            else if (material->GetType() == MaterialType::PBR)
-            {
-                material->GetProperty(MaterialPropertyType::Roughness, materialConstants.Roughness);
-                material->GetProperty(MaterialPropertyType::Metalness, materialConstants.Metalness);
+    m_ResourceBindTable.EmissiveInstanceCount = instanceCount;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::RecreateTextures(uint32_t frameIndex)
+{
+    TextureDescription rtDesc;
+    rtDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    rtDesc.Width = m_ViewportWidth;
+    rtDesc.Height = m_ViewportHeight;
+    rtDesc.MipLevels = 1;
+    rtDesc.InitialState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    rtDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-                TexturePtr roughnessMap = nullptr;
-                if (material->GetTexture(MaterialTextureType::Roughness, roughnessMap))
-                    materialConstants.RoughnessMapIndex = roughnessMap ? roughnessMap->GetSRV() : InvalidDescriptorIndex;
+    // Old textures go back to the pool, the other frames in flight may pick them up again while the size keeps changing
+    m_TexturePool.Release(m_RenderTargets[frameIndex]);
+    m_RenderTargets[frameIndex] = m_TexturePool.Acquire(rtDesc, fmt::format(L"Render Target {}", frameIndex));
 
-                TexturePtr metalnessMap = nullptr;
-                if (material->GetTexture(MaterialTextureType::Metalness, metalnessMap))
-                    materialConstants.MetalnessMapIndex = metalnessMap ? metalnessMap->GetSRV() : InvalidDescriptorIndex;
-            }
-        }
-    }
+    TextureDescription finalOutputTextureDesc;
+    finalOutputTextureDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    finalOutputTextureDesc.Width = m_ViewportWidth;
+    finalOutputTextureDesc.Height = m_ViewportHeight;
+    finalOutputTextureDesc.MipLevels = 1;
+    finalOutputTextureDesc.InitialState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    finalOutputTextureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+    m_TexturePool.Release(m_FinalOutputTexture[frameIndex]);
+    m_FinalOutputTexture[frameIndex] = m_TexturePool.Acquire(finalOutputTextureDesc, fmt::format(L"Final Output {}", frameIndex));
+}
 
-    if (!materialBuffer || materialBuffer->GetElementCount() != materials.size())
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::AcquireGeometries(MeshInstance& instance, bool refreshMaterials)
+{
+    instance.GeometryIDs.resize(instance.Mesh->GetSubmeshes().size());
+
+    for (uint32_t i = 0; i < instance.Mesh->GetSubmeshes().size(); i++)
     {
-        BufferDescription materialBufferDesc;
-        materialBufferDesc.ElementCount = materials.size();
-        materialBufferDesc.ElementSize = sizeof(MaterialConstants);
-        materialBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+        uint32_t materialIndex = instance.Mesh->GetSubmesh(i).MaterialIndex;
+        MaterialPtr overrideMaterial = instance.OverrideMaterialTable ? instance.OverrideMaterialTable->GetMaterial(materialIndex) : nullptr;
+        MaterialPtr meshMaterial = instance.Mesh->GetMaterial(i);
 
-        materialBuffer = std::make_shared<Buffer>(materialBufferDesc, fmt::format(L"Material Buffer {}", currentFrameIndex).c_str());
-    }
+        MaterialPtr material = overrideMaterial ? overrideMaterial : meshMaterial;
+        uint32_t materialID = AcquireMaterial(material, refreshMaterials);
 
-    memcpy(materialBuffer->GetMappedData(), materials.data(), materials.size() * sizeof(MaterialConstants));
-    m_ResourceBindTable.MaterialBufferIndex = materialBuffer->GetSRV();
+        // Every geometry entry holds one reference to its material, an existing entry already has it
+        GeometryKey key = { instance.Mesh.get(), i, materialID };
+        auto found = m_GeometryIDs.find(key);
+        if (found != m_GeometryIDs.end())
+        {
+            m_GeometryRefCounts[found->second]++;
+            ReleaseMaterial(materialID);
+            instance.GeometryIDs[i] = found->second;
+            continue;
+        }
 
-    // Update Geometry buffer
-    std::shared_ptr<Buffer>& geometryBuffer = m_GeometryBuffers[currentFrameIndex];
+        uint32_t geometryID;
+        if (!m_FreeGeometryIDs.empty())
+        {
+            geometryID = m_FreeGeometryIDs.back();
+            m_FreeGeometryIDs.pop_back();
+        }
+        else
+        {
+            geometryID = m_GeometryKeys.size();
+            m_GeometryKeys.emplace_back();
+            m_GeometryRefCounts.emplace_back();
+            m_GeometryBuffer.Resize(m_GeometryKeys.size());
+        }
 
-    std::vector<GeometryConstants> geometries;
-    geometries.reserve(m_MeshInstances.size());
+        m_GeometryIDs[key] = geometryID;
+        m_GeometryKeys[geometryID] = key;
+        m_GeometryRefCounts[geometryID] = 1;
+        instance.GeometryIDs[i] = geometryID;
 
-    for (const MeshInstance& instance : m_MeshInstances)
-    {
-        for (uint32_t i = 0; i < instance.Mesh->GetSubmeshes().size(); i++)
+        GeometryConstants geometry = {};
+        geometry.MaterialIndex = materialID;
+
+        if (instance.Mesh->IsPrimitive())
+        {
+            const PrimitiveDescription& primitive = instance.Mesh->GetPrimitiveDescription();
+            const BufferPtr& heightfieldBuffer = instance.Mesh->GetHeightfieldBuffer();
+            geometry.VertexBufferIndex = heightfieldBuffer ? heightfieldBuffer->GetSRV() : InvalidDescriptorIndex;
+            geometry.IndexBufferIndex = InvalidDescriptorIndex;
+            geometry.PrimitiveType = primitive.Type;
+            geometry.PrimitiveCenter = primitive.Center;
+            geometry.PrimitiveExtent = primitive.Extent;
+        }
+        else
         {
-            GeometryConstants& geometry = geometries.emplace_back();
-            geometry.MaterialIndex = geometries.size() - 1;
             geometry.VertexBufferIndex = instance.Mesh->GetVertexBuffer(i)->GetSRV();
             geometry.IndexBufferIndex = instance.Mesh->GetIndexBuffer(i)->GetSRV();
+            geometry.PrimitiveType = PrimitiveType::NotPrimitive;
         }
+
+        m_GeometryBuffer.Write(geometryID, &geometry);
     }
+}
 
-    if (!geometryBuffer || geometryBuffer->GetElementCount() != geometries.size())
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::ReleaseGeometry(uint32_t geometryID)
+{
+    if (--m_GeometryRefCounts[geometryID] > 0)
+        return;
+
+    ReleaseMaterial(m_GeometryKeys[geometryID].MaterialID);
+    m_GeometryIDs.erase(m_GeometryKeys[geometryID]);
+    m_FreeGeometryIDs.push_back(geometryID);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t Renderer::AcquireMaterial(const MaterialPtr& material, bool refresh)
+{
+    auto found = m_MaterialIDs.find(material.get());
+    if (found != m_MaterialIDs.end())
     {
-        BufferDescription geometryBufferDesc;
-        geometryBufferDesc.ElementCount = geometries.size();
-        geometryBufferDesc.ElementSize = sizeof(GeometryConstants);
-        geometryBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+        m_MaterialRefCounts[found->second]++;
+        if (refresh)
+            WriteMaterialConstants(found->second, *material);
 
-        geometryBuffer = std::make_shared<Buffer>(geometryBufferDesc, fmt::format(L"Geometry Buffer {}", currentFrameIndex).c_str());
+        return found->second;
     }
 
-    memcpy(geometryBuffer->GetMappedData(), geometries.data(), geometries.size() * sizeof(GeometryConstants));
-    m_ResourceBindTable.GeometryBufferIndex = geometryBuffer->GetSRV();
+    uint32_t materialID;
+    if (!m_FreeMaterialIDs.empty())
+    {
+        materialID = m_FreeMaterialIDs.back();
+        m_FreeMaterialIDs.pop_back();
+    }
+    else
+    {
+        materialID = m_MaterialKeys.size();
+        m_MaterialKeys.emplace_back();
+        m_MaterialRefCounts.emplace_back();
+        m_MaterialBuffer.Resize(m_MaterialKeys.size());
+    }
 
-    // Update Top-level Acceleration structure
-    m_TopLevelAccelerationStructures[currentFrameIndex] = GraphicsContext::GetInstance()->BuildTopLevelAccelerationStructure(m_MeshInstances);
-    m_ResourceBindTable.AccelerationStructureIndex = m_TopLevelAccelerationStructures[currentFrameIndex]->GetSRV();
+    m_MaterialIDs[material.get()] = materialID;
+    m_MaterialKeys[materialID] = material.get();
+    m_MaterialRefCounts[materialID] = 1;
+    WriteMaterialConstants(materialID, *material);
 
-    // Render scene
-    GraphicsContext::GetInstance()->DispatchRays(m_ViewportWidth, m_ViewportHeight, m_ResourceBindTable, m_RTPipeline.get());
-    GraphicsContext::GetInstance()->AddUAVBarrier(renderTarget.get());
+    return materialID;
+}
 
-    // Render PostFX
-    ApplyBloom();
-    ApplyTonemapping();
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Renderer::ReleaseMaterial(uint32_t materialID)
+{
+    if (--m_MaterialRefCounts[materialID] > 0)
+        return;
 
-    m_SceneConstants.FrameIndex++;
+    m_MaterialIDs.erase(m_MaterialKeys[materialID]);
+    m_FreeMaterialIDs.push_back(materialID);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-const std::shared_ptr<Texture>& Renderer::GetFinalImage() const
+void Renderer::WriteMaterialConstants(uint32_t materialID, const Material& material)
 {
-    uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
-    return m_FinalOutputTexture[currentFrameIndex];
+    MaterialConstants materialConstants = {};
+    materialConstants.MaterialType = material.GetType();
+
+    material.GetProperty(MaterialPropertyType::AlbedoColor, materialConstants.AlbedoColor);
+    material.GetProperty(MaterialPropertyType::EmissiveColor, materialConstants.EmissiveColor);
+    material.GetProperty(MaterialPropertyType::RefractionColor, materialConstants.RefractionColor);
+    material.GetProperty(MaterialPropertyType::IndexOfRefraction, materialConstants.IndexOfRefraction);
+    material.GetProperty(MaterialPropertyType::ReflectionColor, materialConstants.ReflectionColor);
+
+    TexturePtr albedoMap = nullptr;
+    material.GetTexture(MaterialTextureType::Albedo, albedoMap);
+
+    materialConstants.AlbedoMapIndex = albedoMap ? albedoMap->GetSRV() : InvalidDescriptorIndex;
+    materialConstants.AlbedoVirtualTextureIndex = VirtualTextureSystem::GetVirtualTextureIndex(albedoMap);
+    materialConstants.AlbedoSamplerType = albedoMap ? albedoMap->GetSamplerType() : SamplerType::LinearClamp;
+    materialConstants.AlbedoMapScaling = albedoMap ? albedoMap->GetScaling() : 1.0f;
+    materialConstants.AlbedoProceduralType = albedoMap && albedoMap->IsProcedural() ? albedoMap->GetProceduralDescription().Type : ProceduralTextureType::NotProcedural;
+    materialConstants.AlbedoProceduralColorA = albedoMap && albedoMap->IsProcedural() ? albedoMap->GetProceduralDescription().ColorA : glm::vec4(0.0f);
+    materialConstants.AlbedoProceduralColorB = albedoMap && albedoMap->IsProcedural() ? albedoMap->GetProceduralDescription().ColorB : glm::vec4(0.0f);
+
+    // Only albedo maps are sampled through the virtual texture system, the other maps need all of their pixels resident
+    TexturePtr normalMap = nullptr;
+    material.GetTexture(MaterialTextureType::Normal, normalMap);
+    materialConstants.NormalMapIndex = normalMap && VirtualTextureSystem::MakeResident(normalMap) ? normalMap->GetSRV() : InvalidDescriptorIndex;
+
+    if (material.GetType() == MaterialType::Phong)
+    {
+        material.GetProperty(MaterialPropertyType::SpecularColor, materialConstants.SpecularColor);
+        material.GetProperty(MaterialPropertyType::Shininess, materialConstants.Shininess);
+    }
+    else if (material.GetType() == MaterialType::PBR)
+    {
+        material.GetProperty(MaterialPropertyType::Roughness, materialConstants.Roughness);
+        material.GetProperty(MaterialPropertyType::Metalness, materialConstants.Metalness);
+
+        TexturePtr roughnessMap = nullptr;
+        material.GetTexture(MaterialTextureType::Roughness, roughnessMap);
+        materialConstants.RoughnessMapIndex = roughnessMap && VirtualTextureSystem::MakeResident(roughnessMap) ? roughnessMap->GetSRV() : InvalidDescriptorIndex;
+
+        TexturePtr metalnessMap = nullptr;
+        material.GetTexture(MaterialTextureType::Metalness, metalnessMap);
+        materialConstants.MetalnessMapIndex = metalnessMap && VirtualTextureSystem::MakeResident(metalnessMap) ? metalnessMap->GetSRV() : InvalidDescriptorIndex;
+    }
+
+    m_MaterialBuffer.Write(materialID, &materialConstants);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::RecreateTextures(uint32_t frameIndex)
+RenderGraphResourceID Renderer::ApplyBloom(RenderGraphResourceID sceneTextureID)
 {
-    TextureDescription rtDesc;
-    rtDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    rtDesc.Width = m_ViewportWidth;
-    rtDesc.Height = m_ViewportHeight;
-    rtDesc.MipLevels = 1;
-    rtDesc.InitialState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-    rtDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-
-    m_RenderTargets[frameIndex] = std::make_shared<Texture>(rtDesc, fmt::format(L"Render Target {}", frameIndex).c_str());
+    if (!m_Description.EnableBloom)
+        return sceneTextureID;
 
     uint32_t maxBloomMips = glm::log2((float)glm::max(m_ViewportWidth, m_ViewportHeight)) + 1;
 
     TextureDescription bloomTextureDesc;
     bloomTextureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    bloomTextureDesc.Width = m_ViewportWidth;
-    bloomTextureDesc.Height = m_ViewportHeight;
+    bloomTextureDesc.Width = TexturePoolPolicy::GetBucketSize(m_ViewportWidth);
+    bloomTextureDesc.Height = TexturePoolPolicy::GetBucketSize(m_ViewportHeight);
     bloomTextureDesc.MipLevels = std::min(maxBloomMips, m_Description.BloomDownsampleSteps);
-    bloomTextureDesc.InitialState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
     bloomTextureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-    m_BloomTextures[frameIndex] = std::make_shared<Texture>(bloomTextureDesc, fmt::format(L"Bloom Texture {}", frameIndex).c_str());
-
     TextureDescription bloomCompositeTextureDesc;
     bloomCompositeTextureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    bloomCompositeTextureDesc.Width = m_ViewportWidth;
-    bloomCompositeTextureDesc.Height = m_ViewportHeight;
+    bloomCompositeTextureDesc.Width = TexturePoolPolicy::GetBucketSize(m_ViewportWidth);
+    bloomCompositeTextureDesc.Height = TexturePoolPolicy::GetBucketSize(m_ViewportHeight);
     bloomCompositeTextureDesc.MipLevels = 1;
-    bloomCompositeTextureDesc.InitialState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
     bloomCompositeTextureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-    m_BloomCompositeTextures[frameIndex] = std::make_shared<Texture>(bloomCompositeTextureDesc, fmt::format(L"Bloom Composite Texture {}", frameIndex).c_str());
-
-    TextureDescription finalOutputTextureDesc;
-    finalOutputTextureDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-    finalOutputTextureDesc.Width = m_ViewportWidth;
-    finalOutputTextureDesc.Height = m_ViewportHeight;
-    finalOutputTextureDesc.MipLevels = 1;
-    finalOutputTextureDesc.InitialState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-    finalOutputTextureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-
-    m_FinalOutputTexture[frameIndex] = std::make_shared<Texture>(finalOutputTextureDesc, fmt::format(L"Final Output {}", frameIndex).c_str());
-}
-
-// ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::ApplyBloom()
-{
-    if (!m_Description.EnableBloom)
-        return;
-
-    GraphicsContext* gfxContext = GraphicsContext::GetInstance();
-    uint32_t currentFrameIndex = gfxContext->GetBackBufferIndex();
-
-    std::shared_ptr<Texture>& sceneTexture = m_RenderTargets[currentFrameIndex];
-    std::shared_ptr<Texture>& bloomTexture = m_BloomTextures[currentFrameIndex];
-    std::shared_ptr<Texture>& bloomCompositeTexture = m_BloomCompositeTextures[currentFrameIndex];
+    // Transient textures are sized by the same buckets as the pooled ones, so the graph keeps them while the viewport changes within a bucket
+    RenderGraphResourceID bloomTextureID = m_RenderGraph.CreateTexture(bloomTextureDesc, L"Bloom Texture");
+    RenderGraphResourceID bloomCompositeTextureID = m_RenderGraph.CreateTexture(bloomCompositeTextureDesc, L"Bloom Composite Texture");
 
     const uint32_t THREAD_COUNT_X = 32;
     const uint32_t THREAD_COUNT_Y = 32;
 
-    // Downsample phase
-    for (uint32_t mip = 0; mip < bloomTexture->GetMipLevels(); mip++)
+    // Downsample phase. Every mip reads the previous one through the SRV while writing its own UAV, so the bloom texture
+    // stays in unordered access for the whole chain
+    for (uint32_t mip = 0; mip < bloomTextureDesc.MipLevels; mip++)
     {
-        m_ResourceBindTable.BloomDownsampleConstants.SourceMipLevel = mip == 0 ? mip : mip - 1;
-        m_ResourceBindTable.BloomDownsampleConstants.SourceTextureIndex = mip == 0 ? sceneTexture->GetSRV() : bloomTexture->GetSRV();
-        m_ResourceBindTable.BloomDownsampleConstants.DownsampledMipLevel = mip;
-        m_ResourceBindTable.BloomDownsampleConstants.DownsampledTextureIndex = bloomTexture->GetUAV(mip);
+        std::vector<RenderGraphResourceAccess> accesses = { { bloomTextureID, RenderGraphResourceState::UnorderedAccess, mip == 0 ? RenderGraphAccessType::Write : RenderGraphAccessType::ReadWrite } };
+        if (mip == 0)
+            accesses.push_back({ sceneTextureID, RenderGraphResourceState::ShaderResource, RenderGraphAccessType::Read });
 
-        uint32_t downsampledMipWidth = bloomTexture->GetWidth() >> mip;
-        uint32_t downsampledMipHeight = bloomTexture->GetHeight() >> mip;
+        m_RenderGraph.AddPass("Bloom Downsample", accesses, [=]()
+        {
+            Texture* sceneTexture = m_RenderGraph.GetTexture(sceneTextureID);
+            Texture* bloomTexture = m_RenderGraph.GetTexture(bloomTextureID);
 
-        uint threadGroupCountX = (downsampledMipWidth + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
-        uint threadGroupCountY = (downsampledMipHeight + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
+            m_ResourceBindTable.BloomDownsampleConstants.SourceMipLevel = mip == 0 ? mip : mip - 1;
+            m_ResourceBindTable.BloomDownsampleConstants.SourceTextureIndex = mip == 0 ? sceneTexture->GetSRV() : bloomTexture->GetSRV();
+            m_ResourceBindTable.BloomDownsampleConstants.DownsampledMipLevel = mip;
+            m_ResourceBindTable.BloomDownsampleConstants.DownsampledTextureIndex = bloomTexture->GetUAV(mip);
 
-        gfxContext->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_BloomDownsamplePipeline.get());
-        gfxContext->AddUAVBarrier(bloomTexture.get());
+            uint32_t downsampledMipWidth = std::max(m_ViewportWidth >> mip, 1u);
+            uint32_t downsampledMipHeight = std::max(m_ViewportHeight >> mip, 1u);
+
+            uint threadGroupCountX = (downsampledMipWidth + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
+            uint threadGroupCountY = (downsampledMipHeight + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
+
+            GraphicsContext::GetInstance()->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_BloomDownsamplePipeline.get());
+        });
     }
 
     // Upsample phase
-    for (int32_t mip = bloomTexture->GetMipLevels() - 1; mip >= 1; mip--)
+    for (int32_t mip = bloomTextureDesc.MipLevels - 1; mip >= 1; mip--)
     {
-        m_ResourceBindTable.BloomUpsampleConstants.FilterRadius = 0.005f;
-        m_ResourceBindTable.BloomUpsampleConstants.SourceMipLevel = mip;
-        m_ResourceBindTable.BloomUpsampleConstants.SourceTextureIndex = bloomTexture->GetSRV();
-        m_ResourceBindTable.BloomUpsampleConstants.UpsampledTextureIndex = bloomTexture->GetUAV(mip - 1);
+        std::vector<RenderGraphResourceAccess> accesses = { { bloomTextureID, RenderGraphResourceState::UnorderedAccess, RenderGraphAccessType::ReadWrite } };
+
+        m_RenderGraph.AddPass("Bloom Upsample", accesses, [=]()
+        {
+            Texture* bloomTexture = m_RenderGraph.GetTexture(bloomTextureID);
+
+            m_ResourceBindTable.BloomUpsampleConstants.FilterRadius = 0.005f;
+            m_ResourceBindTable.BloomUpsampleConstants.SourceMipLevel = mip;
+            m_ResourceBindTable.BloomUpsampleConstants.SourceTextureIndex = bloomTexture->GetSRV();
+            m_ResourceBindTable.BloomUpsampleConstants.UpsampledTextureIndex = bloomTexture->GetUAV(mip - 1);
 
-        uint32_t upsampledMipWidth = bloomTexture->GetWidth() >> (mip - 1);
-        uint32_t upsampledMipHeight = bloomTexture->GetHeight() >> (mip - 1);
+            uint32_t upsampledMipWidth = std::max(m_ViewportWidth >> (mip - 1), 1u);
+            uint32_t upsampledMipHeight = std::max(m_ViewportHeight >> (mip - 1), 1u);
 
-        uint threadGroupCountX = (upsampledMipWidth + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
-        uint threadGroupCountY = (upsampledMipHeight + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
+            uint threadGroupCountX = (upsampledMipWidth + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
+            uint threadGroupCountY = (upsampledMipHeight + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
 
-        gfxContext->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_BloomUpsamplePipeline.get());
-        gfxContext->AddUAVBarrier(bloomTexture.get());
+            GraphicsContext::GetInstance()->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_BloomUpsamplePipeline.get());
+        });
     }
 
     // Composite phase
-    m_ResourceBindTable.BloomCompositeConstants.BloomStrength = m_Description.BloomStrength;
-    m_ResourceBindTable.BloomCompositeConstants.BloomTextureIndex = bloomTexture->GetSRV();
-    m_ResourceBindTable.BloomCompositeConstants.SceneTextureIndex = sceneTexture->GetSRV();
-    m_ResourceBindTable.BloomCompositeConstants.OutputTextureIndex = bloomCompositeTexture->GetUAV(0);
+    std::vector<RenderGraphResourceAccess> compositeAccesses = {
+        { bloomTextureID, RenderGraphResourceState::ShaderResource, RenderGraphAccessType::Read },
+        { sceneTextureID, RenderGraphResourceState::ShaderResource, RenderGraphAccessType::Read },
+        { bloomCompositeTextureID, RenderGraphResourceState::UnorderedAccess, RenderGraphAccessType::Write },
+    };
+
+    m_RenderGraph.AddPass("Bloom Composite", compositeAccesses, [=]()
+    {
+        Texture* bloomCompositeTexture = m_RenderGraph.GetTexture(bloomCompositeTextureID);
+
+        m_ResourceBindTable.BloomCompositeConstants.BloomStrength = m_Description.BloomStrength;
+        m_ResourceBindTable.BloomCompositeConstants.BloomTextureIndex = m_RenderGraph.GetTexture(bloomTextureID)->GetSRV();
+        m_ResourceBindTable.BloomCompositeConstants.SceneTextureIndex = m_RenderGraph.GetTexture(sceneTextureID)->GetSRV();
+        m_ResourceBindTable.BloomCompositeConstants.OutputTextureIndex = bloomCompositeTexture->GetUAV(0);
 
-    uint threadGroupCountX = (bloomCompositeTexture->GetWidth() + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
-    uint threadGroupCountY = (bloomCompositeTexture->GetHeight() + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
+        uint threadGroupCountX = (m_ViewportWidth + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
+        uint threadGroupCountY = (m_ViewportHeight + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
 
-    gfxContext->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_BloomCompositePipeline.get());
+        GraphicsContext::GetInstance()->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_BloomCompositePipeline.get());
+    });
+
+    return bloomCompositeTextureID;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Renderer::ApplyTonemapping()
+void Renderer::ApplyTonemapping(RenderGraphResourceID inputTextureID)
 {
-    GraphicsContext* gfxContext = GraphicsContext::GetInstance();
-    uint32_t currentFrameIndex = gfxContext->GetBackBufferIndex();
+    uint32_t currentFrameIndex = GraphicsContext::GetInstance()->GetBackBufferIndex();
 
-    std::shared_ptr<Texture>& inputTexture = m_Description.EnableBloom ? m_BloomCompositeTextures[currentFrameIndex] : m_RenderTargets[currentFrameIndex];
-    std::shared_ptr<Texture>& finalOutputTexture = m_FinalOutputTexture[currentFrameIndex];
+    // The final image is copied to the swap chain after the graph executed
+    RenderGraphResourceID finalOutputTextureID = m_RenderGraph.ImportTexture(m_FinalOutputTexture[currentFrameIndex],
+        RenderGraphResourceState::UnorderedAccess, RenderGraphResourceState::UnorderedAccess, true);
 
-    const uint32_t THREAD_COUNT_X = 32;
-    const uint32_t THREAD_COUNT_Y = 32;
+    std::vector<RenderGraphResourceAccess> accesses = {
+        { inputTextureID, RenderGraphResourceState::ShaderResource, RenderGraphAccessType::Read },
+        { finalOutputTextureID, RenderGraphResourceState::UnorderedAccess, RenderGraphAccessType::Write },
+    };
 
-    m_ResourceBindTable.TonemapConstants.Gamma = 2.2f;
-    m_ResourceBindTable.TonemapConstants.CameraExposure = m_CameraExposure;
-    m_ResourceBindTable.TonemapConstants.InputTextureIndex = inputTexture->GetSRV();
-    m_ResourceBindTable.TonemapConstants.OutputTextureIndex = finalOutputTexture->GetUAV(0);
+    m_RenderGraph.AddPass("Tonemap", accesses, [=]()
+    {
+        Texture* finalOutputTexture = m_RenderGraph.GetTexture(finalOutputTextureID);
+
+        const uint32_t THREAD_COUNT_X = 32;
+        const uint32_t THREAD_COUNT_Y = 32;
 
-    uint threadGroupCountX = (finalOutputTexture->GetWidth() + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
-    uint threadGroupCountY = (finalOutputTexture->GetHeight() + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
+        m_ResourceBindTable.TonemapConstants.Gamma = 2.2f;
+        m_ResourceBindTable.TonemapConstants.CameraExposure = m_CameraExposure;
+        m_ResourceBindTable.TonemapConstants.InputTextureIndex = m_RenderGraph.GetTexture(inputTextureID)->GetSRV();
+        m_ResourceBindTable.TonemapConstants.OutputTextureIndex = finalOutputTexture->GetUAV(0);
 
-    gfxContext->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_TonemapPipeline.get());
-}
\ No newline at end of file
+        uint threadGroupCountX = (m_ViewportWidth + THREAD_COUNT_X - 1) / THREAD_COUNT_X;
+        uint threadGroupCountY = (m_ViewportHeight + THREAD_COUNT_Y - 1) / THREAD_COUNT_Y;
+
+        GraphicsContext::GetInstance()->DispatchComputeShader(threadGroupCountX, threadGroupCountY, 1, m_ResourceBindTable, m_TonemapPipeline.get());
+    });
+}
@@ -7,13 +7,31 @@
 #include "rendering/computepipeline.h"
 #include "rendering/mesh.h"
 #include "rendering/camera.h"
+#include "rendering/retainedbuffer.h"
+#include "rendering/linearallocator.h"
+#include "rendering/lightaliastable.h"
+#include "rendering/lightbvh.h"
+#include "rendering/emissivetriangles.h"
+#include "rendering/rendergraph.h"
+#include "rendering/texturepool.h"
 #include "rendering/shaders/resources.h"
 
+using RenderObjectID = uint32_t;
+static constexpr RenderObjectID InvalidRenderObjectID = UINT32_MAX;
+
 struct MeshInstance
 {
     glm::mat4 Transform;
     std::shared_ptr<Mesh> Mesh;
     std::shared_ptr<MaterialTable> OverrideMaterialTable;
+
+    // Optional transforms relative to Transform. All copies share the same material and geometry entries.
+    // The renderer holds a reference to them, so they stay alive after the component they came from is destroyed
+    std::shared_ptr<const std::vector<glm::mat4>> InstanceTransforms;
+    uint32_t InstanceCount = 1;
+
+    // Geometry buffer entry of every submesh, assigned by the renderer. Instances share the entries of equal submesh and material pairs
+    std::vector<uint32_t> GeometryIDs;
 };
 
 struct RendererDescription
@@ -32,19 +50,64 @@ public:
     ~Renderer();
 
     void BeginScene(const Camera& camera, const std::shared_ptr<Texture>& environmentMap);
-    void SubmitDirectionalLight(const glm::vec3& color, const glm::vec3& direction, float intensity);
-    void SubmitPointLight(const glm::vec3& color, const glm::vec3& position, float intensity, const glm::vec3& attenuationFactors);
-    void SubmitSpotLight(const glm::vec3& color, const glm::vec3& position, const glm::vec3& direction, float intensity, float coneAngleMin, float coneAngleMax, const glm::vec3& attenuationFactors);
-    void SubmitMesh(const std::shared_ptr<Mesh>& mesh, const glm::mat4& transform, const std::shared_ptr<MaterialTable>& overrideMaterialTable);
     void SetViewportSize(uint32_t width, uint32_t height);
     void Render();
 
+    // Forces the accumulation frame index and with it the random seed of every frame. 0 restores progressive accumulation
+    inline void SetFixedFrameIndex(uint32_t frameIndex) { m_FixedFrameIndex = frameIndex; }
+
+    // Meshes and lights are retained across frames. They are registered once and their buffer entries are only
+    // uploaded again when they are updated, so a static scene costs no CPU work per frame
+    RenderObjectID AddMesh(const MeshInstance& instance);
+    void UpdateMesh(RenderObjectID id, const MeshInstance& instance);
+    void UpdateMeshTransform(RenderObjectID id, const glm::mat4& transform);
+    void RemoveMesh(RenderObjectID id);
+
+    RenderObjectID AddLight(const Light& light);
+    void UpdateLight(RenderObjectID id, const Light& light);
+    void RemoveLight(RenderObjectID id);
+
+    void ClearRenderObjects();
+
+    static Light CreateDirectionalLight(const glm::vec3& color, const glm::vec3& direction, float intensity);
+    static Light CreatePointLight(const glm::vec3& color, const glm::vec3& position, float intensity, const glm::vec3& attenuationFactors);
+    static Light CreateSpotLight(const glm::vec3& color, const glm::vec3& position, const glm::vec3& direction, float intensity, float coneAngleMin, float coneAngleMax, const glm::vec3& attenuationFactors);
+
     const std::shared_ptr<Texture>& GetFinalImage() const;
     inline const RendererDescription& GetDescription() const { return m_Description; }
 private:
     void RecreateTextures(uint32_t frameIndex);
-    void ApplyBloom();
-    void ApplyTonemapping();
+    void UpdateFrameConstants(uint32_t frameIndex);
+    uint64_t AllocateFrameConstants(uint64_t size);
+    void UpdateEmissiveTriangles();
+    void AcquireGeometries(MeshInstance& instance, bool refreshMaterials);
+    void ReleaseGeometry(uint32_t geometryID);
+    uint32_t AcquireMaterial(const MaterialPtr& material, bool refresh);
+    void ReleaseMaterial(uint32_t materialID);
+    void WriteMaterialConstants(uint32_t materialID, const Material& material);
+    RenderGraphResourceID ApplyBloom(RenderGraphResourceID sceneTextureID);
+    void ApplyTonemapping(RenderGraphResourceID inputTextureID);
+private:
+    struct GeometryKey
+    {
+        const Mesh* Mesh = nullptr;
+        uint32_t Submesh = 0;
+        uint32_t MaterialID = 0;
+
+        inline bool operator==(const GeometryKey& other) const { return Mesh == other.Mesh && Submesh == other.Submesh && MaterialID == other.MaterialID; }
+    };
+
+    struct GeometryKeyHash
+    {
+        size_t operator()(const GeometryKey& key) const
+        {
+            size_t hash = 0;
+            HashCombine(hash, key.Mesh);
+            HashCombine(hash, key.Submesh);
+            HashCombine(hash, key.MaterialID);
+            return hash;
+        }
+    };
 private:
     RendererDescription m_Description;
     ResourceBindTable m_ResourceBindTable;
@@ -52,26 +115,70 @@ private:
     uint32_t m_ViewportWidth = 1;
     uint32_t m_ViewportHeight = 1;
     float m_CameraExposure = 0.0f;
-    std::vector<Light> m_Lights;
+    uint32_t m_FixedFrameIndex = 0;
+
+    // Retained scene. Removed mesh slots keep a null mesh until they are reused. Lights stay densely packed, so removing
+    // one moves the last light into its slot
     std::vector<MeshInstance> m_MeshInstances;
+    std::vector<RenderObjectID> m_FreeMeshIDs;
+    uint32_t m_MeshCount = 0;
+
+    // Reference counted tables of unique materials and unique submesh and material pairs, so their size depends on the
+    // number of distinct assets rather than on the number of instances
+    std::unordered_map<const Material*, uint32_t> m_MaterialIDs;
+    std::vector<const Material*> m_MaterialKeys;
+    std::vector<uint32_t> m_MaterialRefCounts;
+    std::vector<uint32_t> m_FreeMaterialIDs;
+    std::unordered_map<GeometryKey, uint32_t, GeometryKeyHash> m_GeometryIDs;
+    std::vector<GeometryKey> m_GeometryKeys;
+    std::vector<uint32_t> m_GeometryRefCounts;
+    std::vector<uint32_t> m_FreeGeometryIDs;
+    std::vector<uint32_t> m_LightIndices;
+    std::vector<RenderObjectID> m_LightIDs;
+    std::vector<RenderObjectID> m_FreeLightIDs;
+    RetainedBuffer m_LightsBuffer;
+    RetainedBuffer m_MaterialBuffer;
+    RetainedBuffer m_GeometryBuffer;
+
+    // Directional lights are selected by power through an alias table, local lights through a light BVH. Both are rebuilt
+    // whenever a light changes
+    LightAliasTable m_LightAliasTable;
+    RetainedBuffer m_LightAliasBuffer;
+    LightBVH m_LightBVH;
+    RetainedBuffer m_LightBVHBuffer;
+    std::vector<float> m_LightWeights;
+    bool m_IsLightSamplingDirty = true;
+
+    // Mesh instances with emissive materials are sampled like lights. They are gathered again whenever a mesh changes
+    EmissiveTriangles m_EmissiveTriangles;
+    RetainedBuffer m_EmissiveInstanceBuffer;
+    RetainedBuffer m_EmissiveCdfBuffer;
+    bool m_IsEmissiveTrianglesDirty = true;
+    bool m_IsAccelerationStructureDirty = true;
+
+    // All constants of a frame are bump allocated from one persistently mapped upload buffer per frame in flight, the
+    // shaders find them through byte offsets in the bind table
+    static constexpr uint64_t FrameConstantAlignment = 16;
+    std::shared_ptr<Buffer> m_FrameConstantBuffers[FRAMES_IN_FLIGHT];
+    LinearAllocator m_FrameConstantAllocator;
 
     // Raytracing
     std::shared_ptr<RaytracingPipeline> m_RTPipeline;
     std::shared_ptr<Texture> m_RenderTargets[FRAMES_IN_FLIGHT];
-    std::shared_ptr<Buffer> m_SceneBuffers[FRAMES_IN_FLIGHT];
-    std::shared_ptr<Buffer> m_LightsBuffers[FRAMES_IN_FLIGHT];
-    std::shared_ptr<Buffer> m_MaterialBuffers[FRAMES_IN_FLIGHT];
-    std::shared_ptr<Buffer> m_GeometryBuffers[FRAMES_IN_FLIGHT];
-    std::shared_ptr<Buffer> m_TopLevelAccelerationStructures[FRAMES_IN_FLIGHT];
+    std::shared_ptr<Buffer> m_TopLevelAccelerationStructure;
 
     // Bloom
     std::shared_ptr<ComputePipeline> m_BloomDownsamplePipeline;
     std::shared_ptr<ComputePipeline> m_BloomUpsamplePipeline;
     std::shared_ptr<ComputePipeline> m_BloomCompositePipeline;
-    std::shared_ptr<Texture> m_BloomTextures[FRAMES_IN_FLIGHT];
-    std::shared_ptr<Texture> m_BloomCompositeTextures[FRAMES_IN_FLIGHT];
 
     // Tonemap
     std::shared_ptr<ComputePipeline> m_TonemapPipeline;
     std::shared_ptr<Texture> m_FinalOutputTexture[FRAMES_IN_FLIGHT];
+
+    // Post FX textures only live within a frame and are placed in the transient memory of the graph
+    RenderGraph m_RenderGraph;
+
+    // Viewport sized textures are taken from the pool, so resizing reuses textures instead of allocating new ones every frame
+    TexturePool m_TexturePool;
 };
\ No newline at end of file
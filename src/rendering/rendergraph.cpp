@@ -0,0 +1,210 @@
+#include "rendergraph.h"
+
+#include "core/utils.h"
+#include "rendering/graphicscontext.h"
+
+#include <pix3.h>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static D3D12_RESOURCE_STATES GetD3D12ResourceState(RenderGraphResourceState state)
+{
+    switch (state)
+    {
+        case RenderGraphResourceState::ShaderResource: return D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+        case RenderGraphResourceState::UnorderedAccess: return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    }
+
+    UNREACHED;
+    return D3D12_RESOURCE_STATE_COMMON;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static bool IsSameTextureDescription(const TextureDescription& a, const TextureDescription& b)
+{
+    return a.Format == b.Format && a.Width == b.Width && a.Height == b.Height && a.MipLevels == b.MipLevels &&
+        a.ArrayLevels == b.ArrayLevels && a.Flags == b.Flags && a.IsCubeMap == b.IsCubeMap;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RenderGraph::~RenderGraph()
+{
+    // Placed textures are released before the heap they live in, both are released deferred in that order
+    m_TransientTextures.clear();
+
+    if (m_TransientHeap)
+        GraphicsContext::GetInstance()->ReleaseResource(m_TransientHeap.Detach());
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RenderGraphResourceID RenderGraph::ImportTexture(const std::shared_ptr<Texture>& texture, RenderGraphResourceState initialState, RenderGraphResourceState finalState, bool isOutput)
+{
+    HEXRAY_ASSERT(texture);
+
+    RenderGraphResourceDescription description;
+    description.Name = "Imported Texture";
+    description.IsImported = true;
+    description.IsOutput = isOutput;
+    description.InitialState = initialState;
+    description.FinalState = finalState;
+
+    m_Textures.push_back(texture);
+    m_TransientIndices.push_back(UINT32_MAX);
+    return m_Compiler.AddResource(description);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RenderGraphResourceID RenderGraph::CreateTexture(const TextureDescription& description, const std::wstring& debugName)
+{
+    HEXRAY_ASSERT_MSG((description.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) == 0, "The transient heap only holds non render target and depth textures");
+
+    D3D12_RESOURCE_DESC resourceDesc = Texture::GetResourceDescription(description);
+    D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = GraphicsContext::GetInstance()->GetDevice()->GetResourceAllocationInfo(0, 1, &resourceDesc);
+
+    RenderGraphResourceDescription resourceDescription;
+    resourceDescription.Name = ToString(debugName);
+    resourceDescription.Size = allocationInfo.SizeInBytes;
+    resourceDescription.Alignment = allocationInfo.Alignment;
+
+    uint32_t transientIndex = m_TransientTextureCount++;
+    if (transientIndex == m_TransientTextures.size())
+        m_TransientTextures.emplace_back();
+
+    TransientTexture& transientTexture = m_TransientTextures[transientIndex];
+    if (!transientTexture.Texture || !IsSameTextureDescription(transientTexture.Description, description))
+    {
+        transientTexture.Description = description;
+        transientTexture.DebugName = debugName;
+        transientTexture.Texture = nullptr;
+    }
+
+    m_Textures.push_back(nullptr);
+    m_TransientIndices.push_back(transientIndex);
+    return m_Compiler.AddResource(resourceDescription);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraph::AddPass(const std::string& name, const std::vector<RenderGraphResourceAccess>& accesses, ExecuteFunction&& execute, bool hasSideEffects)
+{
+    RenderGraphPassDescription description;
+    description.Name = name;
+    description.Accesses = accesses;
+    description.HasSideEffects = hasSideEffects;
+
+    m_Compiler.AddPass(description);
+    m_PassFunctions.push_back(std::move(execute));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraph::Execute()
+{
+    m_Compiler.Compile(m_CompiledGraph);
+    AllocateTransientTextures();
+
+    const ComPtr<ID3D12GraphicsCommandList6>& commandList = GraphicsContext::GetInstance()->GetCommandList();
+
+    for (const CompiledRenderGraphPass& compiledPass : m_CompiledGraph.Passes)
+    {
+        PIXBeginEvent(commandList.Get(), 0, m_Compiler.GetPass(compiledPass.Pass).Name.c_str());
+
+        RecordBarriers(compiledPass.Barriers);
+        m_PassFunctions[compiledPass.Pass]();
+
+        PIXEndEvent(commandList.Get());
+    }
+
+    RecordBarriers(m_CompiledGraph.FinalBarriers);
+    Reset();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+Texture* RenderGraph::GetTexture(RenderGraphResourceID id) const
+{
+    HEXRAY_ASSERT(id < m_Textures.size());
+    return m_Textures[id].get();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraph::AllocateTransientTextures()
+{
+    GraphicsContext* gfxContext = GraphicsContext::GetInstance();
+
+    if (m_CompiledGraph.TransientMemorySize > m_TransientHeapSize)
+    {
+        for (TransientTexture& transientTexture : m_TransientTextures)
+            transientTexture.Texture = nullptr;
+
+        if (m_TransientHeap)
+            gfxContext->ReleaseResource(m_TransientHeap.Detach());
+
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes = m_CompiledGraph.TransientMemorySize;
+        heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+        DXCall(gfxContext->GetDevice()->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_TransientHeap)));
+        DXCall(m_TransientHeap->SetName(L"Render Graph Transient Heap"));
+
+        m_TransientHeapSize = m_CompiledGraph.TransientMemorySize;
+        HEXRAY_INFO("RenderGraph: Allocated {:.2f} MB of transient texture memory", m_TransientHeapSize / (1024.0 * 1024.0));
+    }
+
+    for (RenderGraphResourceID resourceID = 0; resourceID < m_Compiler.GetResourceCount(); resourceID++)
+    {
+        const CompiledRenderGraphResource& compiledResource = m_CompiledGraph.Resources[resourceID];
+        if (m_TransientIndices[resourceID] == UINT32_MAX || !compiledResource.IsUsed)
+            continue;
+
+        // Textures only accessed by culled passes are never created
+        TransientTexture& transientTexture = m_TransientTextures[m_TransientIndices[resourceID]];
+        D3D12_RESOURCE_STATES creationState = GetD3D12ResourceState(compiledResource.CreationState);
+
+        if (!transientTexture.Texture || transientTexture.MemoryOffset != compiledResource.MemoryOffset || transientTexture.Texture->GetInitialState() != creationState)
+        {
+            transientTexture.Description.InitialState = creationState;
+            transientTexture.MemoryOffset = compiledResource.MemoryOffset;
+            transientTexture.Texture = std::make_shared<Texture>(transientTexture.Description, m_TransientHeap.Get(), transientTexture.MemoryOffset, transientTexture.DebugName.c_str());
+        }
+
+        m_Textures[resourceID] = transientTexture.Texture;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraph::RecordBarriers(const std::vector<RenderGraphBarrier>& barriers)
+{
+    m_Barriers.clear();
+
+    for (const RenderGraphBarrier& barrier : barriers)
+    {
+        ID3D12Resource* resource = m_Textures[barrier.Resource]->GetResource().Get();
+
+        switch (barrier.Type)
+        {
+            case RenderGraphBarrierType::Transition:
+                m_Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, GetD3D12ResourceState(barrier.StateBefore), GetD3D12ResourceState(barrier.StateAfter)));
+                break;
+            case RenderGraphBarrierType::UAV:
+                m_Barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+                break;
+            case RenderGraphBarrierType::Aliasing:
+                m_Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, resource));
+                break;
+        }
+    }
+
+    GraphicsContext::GetInstance()->AddResourceBarriers(m_Barriers);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraph::Reset()
+{
+    // Transient textures that were not requested this frame are dropped, their memory stays part of the heap
+    m_TransientTextures.resize(m_TransientTextureCount);
+    m_TransientTextureCount = 0;
+
+    m_Compiler.Reset();
+    m_PassFunctions.clear();
+    m_Textures.clear();
+    m_TransientIndices.clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/core.h"
+#include "rendering/texture.h"
+#include "rendering/rendergraphcompiler.h"
+
+// Frame graph of the renderer. Passes are added every frame together with the textures they access, executing the graph
+// compiles it, places the transient textures in one shared heap and records the passes with the barriers between them.
+// Frames execute one after another on the graphics queue, so all frames in flight share the transient heap
+class RenderGraph
+{
+public:
+    using ExecuteFunction = std::function<void()>;
+
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraphResourceID ImportTexture(const std::shared_ptr<Texture>& texture, RenderGraphResourceState initialState, RenderGraphResourceState finalState, bool isOutput = false);
+    RenderGraphResourceID CreateTexture(const TextureDescription& description, const std::wstring& debugName);
+    void AddPass(const std::string& name, const std::vector<RenderGraphResourceAccess>& accesses, ExecuteFunction&& execute, bool hasSideEffects = false);
+
+    void Execute();
+
+    Texture* GetTexture(RenderGraphResourceID id) const;
+    inline uint64_t GetTransientMemorySize() const { return m_TransientHeapSize; }
+private:
+    struct TransientTexture
+    {
+        TextureDescription Description;
+        std::wstring DebugName;
+        uint64_t MemoryOffset = 0;
+        std::shared_ptr<Texture> Texture;
+    };
+private:
+    void AllocateTransientTextures();
+    void RecordBarriers(const std::vector<RenderGraphBarrier>& barriers);
+    void Reset();
+private:
+    RenderGraphCompiler m_Compiler;
+    CompiledRenderGraph m_CompiledGraph;
+    std::vector<ExecuteFunction> m_PassFunctions;
+    std::vector<std::shared_ptr<Texture>> m_Textures;
+    std::vector<uint32_t> m_TransientIndices;
+    std::vector<D3D12_RESOURCE_BARRIER> m_Barriers;
+
+    // Transient textures are created in the same order every frame, so they are kept across frames and only recreated
+    // when their description or their place in the heap changed
+    std::vector<TransientTexture> m_TransientTextures;
+    uint32_t m_TransientTextureCount = 0;
+    ComPtr<ID3D12Heap> m_TransientHeap;
+    uint64_t m_TransientHeapSize = 0;
+};
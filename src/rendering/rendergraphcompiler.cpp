@@ -0,0 +1,258 @@
+#include "rendergraphcompiler.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static bool IsReadAccess(RenderGraphAccessType type)
+{
+    return type == RenderGraphAccessType::Read || type == RenderGraphAccessType::ReadWrite;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static bool IsWriteAccess(RenderGraphAccessType type)
+{
+    return type == RenderGraphAccessType::Write || type == RenderGraphAccessType::ReadWrite;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RenderGraphResourceID RenderGraphCompiler::AddResource(const RenderGraphResourceDescription& description)
+{
+    HEXRAY_ASSERT_MSG(description.IsImported || (description.Alignment & (description.Alignment - 1)) == 0, "Transient resource alignment has to be a power of two");
+
+    m_Resources.push_back(description);
+    return m_Resources.size() - 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RenderGraphPassID RenderGraphCompiler::AddPass(const RenderGraphPassDescription& description)
+{
+    RenderGraphPassDescription& pass = m_Passes.emplace_back();
+    pass.Name = description.Name;
+    pass.HasSideEffects = description.HasSideEffects;
+
+    // A resource is only accessed in one state per pass. Declaring it more than once merges the accesses, writing it as well
+    // as reading it through a shader resource view requires unordered access for the whole pass
+    for (const RenderGraphResourceAccess& access : description.Accesses)
+    {
+        HEXRAY_ASSERT(access.Resource < m_Resources.size());
+        HEXRAY_ASSERT_MSG(access.State == RenderGraphResourceState::UnorderedAccess || !IsWriteAccess(access.Type), "Pass {} writes a resource without unordered access", description.Name);
+
+        auto it = std::find_if(pass.Accesses.begin(), pass.Accesses.end(), [&](const RenderGraphResourceAccess& a) { return a.Resource == access.Resource; });
+        if (it == pass.Accesses.end())
+        {
+            pass.Accesses.push_back(access);
+            continue;
+        }
+
+        if (it->State != access.State)
+            it->State = RenderGraphResourceState::UnorderedAccess;
+
+        if (it->Type != access.Type)
+            it->Type = RenderGraphAccessType::ReadWrite;
+    }
+
+    return m_Passes.size() - 1;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraphCompiler::Reset()
+{
+    m_Resources.clear();
+    m_Passes.clear();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool RenderGraphCompiler::Compile(CompiledRenderGraph& outGraph) const
+{
+    outGraph.Passes.clear();
+    outGraph.FinalBarriers.clear();
+    outGraph.Resources.assign(m_Resources.size(), CompiledRenderGraphResource());
+    outGraph.TransientMemorySize = 0;
+
+    std::vector<bool> isPassAlive;
+    CullPasses(isPassAlive);
+
+    for (RenderGraphPassID passID = 0; passID < m_Passes.size(); passID++)
+    {
+        if (!isPassAlive[passID])
+            continue;
+
+        uint32_t compiledPassIndex = outGraph.Passes.size();
+        outGraph.Passes.emplace_back().Pass = passID;
+
+        for (const RenderGraphResourceAccess& access : m_Passes[passID].Accesses)
+        {
+            CompiledRenderGraphResource& resource = outGraph.Resources[access.Resource];
+            if (!resource.IsUsed)
+            {
+                resource.IsUsed = true;
+                resource.FirstPass = compiledPassIndex;
+                resource.CreationState = access.State;
+
+                if (!m_Resources[access.Resource].IsImported && access.Type == RenderGraphAccessType::Read)
+                    HEXRAY_WARNING("RenderGraph: Pass {} reads transient resource {} before it was written", m_Passes[passID].Name, m_Resources[access.Resource].Name);
+            }
+
+            resource.LastPass = compiledPassIndex;
+        }
+    }
+
+    outGraph.CulledPassCount = m_Passes.size() - outGraph.Passes.size();
+
+    // Transient outputs are read after the graph executed, so their memory can't be reused by any later pass
+    for (RenderGraphResourceID resourceID = 0; resourceID < m_Resources.size(); resourceID++)
+    {
+        if (m_Resources[resourceID].IsOutput && outGraph.Resources[resourceID].IsUsed)
+            outGraph.Resources[resourceID].LastPass = outGraph.Passes.size();
+    }
+
+    AllocateTransientMemory(outGraph);
+    BuildBarriers(outGraph);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraphCompiler::CullPasses(std::vector<bool>& outIsPassAlive) const
+{
+    outIsPassAlive.assign(m_Passes.size(), false);
+
+    std::vector<bool> isResourceNeeded(m_Resources.size(), false);
+    for (RenderGraphResourceID resourceID = 0; resourceID < m_Resources.size(); resourceID++)
+        isResourceNeeded[resourceID] = m_Resources[resourceID].IsOutput;
+
+    // Walk backwards from the outputs. A pass is kept when it writes a resource that a kept pass or an output needs,
+    // and everything it reads becomes needed in turn. Writes only cover part of a resource, so earlier writers stay needed
+    for (int32_t passID = int32_t(m_Passes.size()) - 1; passID >= 0; passID--)
+    {
+        const RenderGraphPassDescription& pass = m_Passes[passID];
+
+        bool isAlive = pass.HasSideEffects;
+        for (const RenderGraphResourceAccess& access : pass.Accesses)
+            isAlive |= IsWriteAccess(access.Type) && isResourceNeeded[access.Resource];
+
+        if (!isAlive)
+            continue;
+
+        outIsPassAlive[passID] = true;
+
+        for (const RenderGraphResourceAccess& access : pass.Accesses)
+        {
+            if (IsReadAccess(access.Type))
+                isResourceNeeded[access.Resource] = true;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraphCompiler::AllocateTransientMemory(CompiledRenderGraph& graph) const
+{
+    std::vector<RenderGraphResourceID> transientResources;
+    for (RenderGraphResourceID resourceID = 0; resourceID < m_Resources.size(); resourceID++)
+    {
+        if (!m_Resources[resourceID].IsImported && graph.Resources[resourceID].IsUsed)
+            transientResources.push_back(resourceID);
+    }
+
+    // Placing the largest resources first keeps the gaps left for the smaller ones small
+    std::sort(transientResources.begin(), transientResources.end(), [&](RenderGraphResourceID a, RenderGraphResourceID b)
+    {
+        return m_Resources[a].Size != m_Resources[b].Size ? m_Resources[a].Size > m_Resources[b].Size : a < b;
+    });
+
+    std::vector<RenderGraphResourceID> placedResources;
+    std::vector<std::pair<uint64_t, uint64_t>> occupiedRanges;
+
+    for (RenderGraphResourceID resourceID : transientResources)
+    {
+        const RenderGraphResourceDescription& description = m_Resources[resourceID];
+        CompiledRenderGraphResource& resource = graph.Resources[resourceID];
+
+        // Only the memory of resources that are alive at the same time is off limits
+        occupiedRanges.clear();
+        for (RenderGraphResourceID placedID : placedResources)
+        {
+            const CompiledRenderGraphResource& placed = graph.Resources[placedID];
+            if (placed.FirstPass <= resource.LastPass && resource.FirstPass <= placed.LastPass)
+                occupiedRanges.emplace_back(placed.MemoryOffset, placed.MemoryOffset + m_Resources[placedID].Size);
+        }
+
+        std::sort(occupiedRanges.begin(), occupiedRanges.end());
+
+        // Take the first gap that is large enough
+        uint64_t offset = 0;
+        for (const std::pair<uint64_t, uint64_t>& range : occupiedRanges)
+        {
+            if (Align(offset, description.Alignment) + description.Size <= range.first)
+                break;
+
+            offset = std::max(offset, range.second);
+        }
+
+        resource.MemoryOffset = Align(offset, description.Alignment);
+        graph.TransientMemorySize = std::max(graph.TransientMemorySize, resource.MemoryOffset + description.Size);
+
+        placedResources.push_back(resourceID);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RenderGraphCompiler::BuildBarriers(CompiledRenderGraph& graph) const
+{
+    std::vector<RenderGraphResourceState> states(m_Resources.size());
+    std::vector<bool> isAccessed(m_Resources.size(), false);
+    std::vector<bool> isWritten(m_Resources.size(), false);
+
+    for (RenderGraphResourceID resourceID = 0; resourceID < m_Resources.size(); resourceID++)
+        states[resourceID] = m_Resources[resourceID].IsImported ? m_Resources[resourceID].InitialState : graph.Resources[resourceID].CreationState;
+
+    for (uint32_t compiledPassIndex = 0; compiledPassIndex < graph.Passes.size(); compiledPassIndex++)
+    {
+        CompiledRenderGraphPass& compiledPass = graph.Passes[compiledPassIndex];
+
+        for (const RenderGraphResourceAccess& access : m_Passes[compiledPass.Pass].Accesses)
+        {
+            RenderGraphResourceID resourceID = access.Resource;
+            const RenderGraphResourceDescription& description = m_Resources[resourceID];
+            const CompiledRenderGraphResource& resource = graph.Resources[resourceID];
+
+            if (!isAccessed[resourceID] && !description.IsImported)
+            {
+                // Transient resources sharing memory have disjoint lifetimes, but the memory may have been used by another
+                // resource in this or in the previous frame, so the resource has to be activated first
+                bool isAliased = false;
+                for (RenderGraphResourceID otherID = 0; otherID < m_Resources.size() && !isAliased; otherID++)
+                {
+                    const CompiledRenderGraphResource& other = graph.Resources[otherID];
+                    if (otherID == resourceID || m_Resources[otherID].IsImported || !other.IsUsed)
+                        continue;
+
+                    isAliased = other.MemoryOffset < resource.MemoryOffset + description.Size && resource.MemoryOffset < other.MemoryOffset + m_Resources[otherID].Size;
+                }
+
+                if (isAliased)
+                    compiledPass.Barriers.push_back({ RenderGraphBarrierType::Aliasing, resourceID, states[resourceID], states[resourceID] });
+            }
+            else if (states[resourceID] != access.State)
+            {
+                compiledPass.Barriers.push_back({ RenderGraphBarrierType::Transition, resourceID, states[resourceID], access.State });
+            }
+            else if (isAccessed[resourceID] && access.State == RenderGraphResourceState::UnorderedAccess && (isWritten[resourceID] || IsWriteAccess(access.Type)))
+            {
+                // Unordered accesses in the same state still have to wait for the previous pass when either of them writes
+                compiledPass.Barriers.push_back({ RenderGraphBarrierType::UAV, resourceID, access.State, access.State });
+            }
+
+            states[resourceID] = access.State;
+            isAccessed[resourceID] = true;
+            isWritten[resourceID] = IsWriteAccess(access.Type);
+        }
+    }
+
+    for (RenderGraphResourceID resourceID = 0; resourceID < m_Resources.size(); resourceID++)
+    {
+        if (!graph.Resources[resourceID].IsUsed && !m_Resources[resourceID].IsImported)
+            continue;
+
+        RenderGraphResourceState finalState = m_Resources[resourceID].IsImported ? m_Resources[resourceID].FinalState : graph.Resources[resourceID].CreationState;
+        if (states[resourceID] != finalState)
+            graph.FinalBarriers.push_back({ RenderGraphBarrierType::Transition, resourceID, states[resourceID], finalState });
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "core/core.h"
+
+using RenderGraphResourceID = uint32_t;
+using RenderGraphPassID = uint32_t;
+static constexpr RenderGraphResourceID InvalidRenderGraphResourceID = UINT32_MAX;
+
+enum class RenderGraphResourceState : uint32_t
+{
+    ShaderResource,
+    UnorderedAccess,
+};
+
+enum class RenderGraphAccessType : uint32_t
+{
+    Read,
+    Write,
+    ReadWrite,
+};
+
+enum class RenderGraphBarrierType : uint32_t
+{
+    Transition,
+    UAV,
+    Aliasing,
+};
+
+struct RenderGraphResourceDescription
+{
+    std::string Name;
+
+    // Transient resources are placed in the shared transient memory and only live between their first and last pass
+    uint64_t Size = 0;
+    uint64_t Alignment = 1;
+
+    // Imported resources are owned outside of the graph and are returned in their final state. Outputs are read after the
+    // graph executed, so the passes writing them are never culled
+    bool IsImported = false;
+    bool IsOutput = false;
+    RenderGraphResourceState InitialState = RenderGraphResourceState::UnorderedAccess;
+    RenderGraphResourceState FinalState = RenderGraphResourceState::UnorderedAccess;
+};
+
+struct RenderGraphResourceAccess
+{
+    RenderGraphResourceID Resource = InvalidRenderGraphResourceID;
+    RenderGraphResourceState State = RenderGraphResourceState::ShaderResource;
+    RenderGraphAccessType Type = RenderGraphAccessType::Read;
+};
+
+struct RenderGraphPassDescription
+{
+    std::string Name;
+    std::vector<RenderGraphResourceAccess> Accesses;
+    bool HasSideEffects = false;
+};
+
+struct RenderGraphBarrier
+{
+    RenderGraphBarrierType Type = RenderGraphBarrierType::Transition;
+    RenderGraphResourceID Resource = InvalidRenderGraphResourceID;
+    RenderGraphResourceState StateBefore = RenderGraphResourceState::UnorderedAccess;
+    RenderGraphResourceState StateAfter = RenderGraphResourceState::UnorderedAccess;
+};
+
+struct CompiledRenderGraphPass
+{
+    RenderGraphPassID Pass = 0;
+    std::vector<RenderGraphBarrier> Barriers;
+};
+
+struct CompiledRenderGraphResource
+{
+    bool IsUsed = false;
+    uint64_t MemoryOffset = 0;
+    uint32_t FirstPass = UINT32_MAX;
+    uint32_t LastPass = 0;
+
+    // Transient resources are created in the state of their first access and are returned to it at the end of the graph,
+    // so the same resource can be executed again next frame without tracking its state outside of the graph
+    RenderGraphResourceState CreationState = RenderGraphResourceState::UnorderedAccess;
+};
+
+struct CompiledRenderGraph
+{
+    std::vector<CompiledRenderGraphPass> Passes;
+    std::vector<CompiledRenderGraphResource> Resources;
+    std::vector<RenderGraphBarrier> FinalBarriers;
+    uint64_t TransientMemorySize = 0;
+    uint32_t CulledPassCount = 0;
+};
+
+// Platform independent part of the render graph. Passes are compiled in the order they were added, every pass can only depend
+// on passes added before it. Compiling culls the passes that don't contribute to an output, derives the barriers between the
+// remaining passes and packs the transient resources into one memory range, reusing memory of resources that are no longer alive
+class RenderGraphCompiler
+{
+public:
+    RenderGraphResourceID AddResource(const RenderGraphResourceDescription& description);
+    RenderGraphPassID AddPass(const RenderGraphPassDescription& description);
+    void Reset();
+
+    bool Compile(CompiledRenderGraph& outGraph) const;
+
+    inline const RenderGraphResourceDescription& GetResource(RenderGraphResourceID id) const { return m_Resources[id]; }
+    inline const RenderGraphPassDescription& GetPass(RenderGraphPassID id) const { return m_Passes[id]; }
+    inline uint32_t GetResourceCount() const { return m_Resources.size(); }
+    inline uint32_t GetPassCount() const { return m_Passes.size(); }
+private:
+    void CullPasses(std::vector<bool>& outIsPassAlive) const;
+    void AllocateTransientMemory(CompiledRenderGraph& graph) const;
+    void BuildBarriers(CompiledRenderGraph& graph) const;
+private:
+    std::vector<RenderGraphResourceDescription> m_Resources;
+    std::vector<RenderGraphPassDescription> m_Passes;
+};
@@ -0,0 +1,67 @@
+#include "retainedbuffer.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RetainedBuffer::RetainedBuffer(uint32_t elementSize)
+    : m_ElementSize(elementSize)
+{
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+        Invalidate(i);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RetainedBuffer::Resize(uint32_t elementCount)
+{
+    m_ElementCount = elementCount;
+    m_Data.resize((size_t)elementCount * m_ElementSize);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RetainedBuffer::Write(uint32_t index, const void* data, uint32_t elementCount)
+{
+    HEXRAY_ASSERT(index + elementCount <= m_ElementCount);
+
+    memcpy(m_Data.data() + (size_t)index * m_ElementSize, data, (size_t)elementCount * m_ElementSize);
+    MarkDirty(index, index + elementCount);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RetainedBuffer::Upload(uint32_t frameIndex, uint8_t* frameData, uint64_t offset)
+{
+    // Elements that moved within the frame's memory have to be copied in full
+    if (m_UploadOffsets[frameIndex] != offset)
+    {
+        m_UploadOffsets[frameIndex] = offset;
+        m_DirtyBegin[frameIndex] = 0;
+        m_DirtyEnd[frameIndex] = m_ElementCount;
+    }
+
+    uint32_t dirtyEnd = std::min(m_DirtyEnd[frameIndex], m_ElementCount);
+    if (m_DirtyBegin[frameIndex] < dirtyEnd)
+    {
+        size_t dirtyOffset = (size_t)m_DirtyBegin[frameIndex] * m_ElementSize;
+        size_t dirtySize = (size_t)(dirtyEnd - m_DirtyBegin[frameIndex]) * m_ElementSize;
+        memcpy(frameData + offset + dirtyOffset, m_Data.data() + dirtyOffset, dirtySize);
+    }
+
+    m_DirtyBegin[frameIndex] = UINT32_MAX;
+    m_DirtyEnd[frameIndex] = 0;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RetainedBuffer::Invalidate(uint32_t frameIndex)
+{
+    // The next upload of the frame copies all elements, used when the frame's memory was replaced
+    m_UploadOffsets[frameIndex] = UINT64_MAX;
+    m_DirtyBegin[frameIndex] = UINT32_MAX;
+    m_DirtyEnd[frameIndex] = 0;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RetainedBuffer::MarkDirty(uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        m_DirtyBegin[i] = std::min(m_DirtyBegin[i], begin);
+        m_DirtyEnd[i] = std::max(m_DirtyEnd[i], end);
+    }
+}
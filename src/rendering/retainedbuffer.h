@@ -0,0 +1,30 @@
+#pragma once
+
+#include "core/core.h"
+
+// Array of structured constants that persists across frames and is uploaded into the per frame constants of every frame in
+// flight. Writes go to a CPU copy and each frame's copy is only patched with the element range that was written since that
+// frame was last uploaded, as long as the elements stay at the same place in the frame's memory
+class RetainedBuffer
+{
+public:
+    RetainedBuffer(uint32_t elementSize);
+
+    void Resize(uint32_t elementCount);
+    void Write(uint32_t index, const void* data, uint32_t elementCount = 1);
+    void Upload(uint32_t frameIndex, uint8_t* frameData, uint64_t offset);
+    void Invalidate(uint32_t frameIndex);
+
+    inline const void* GetElement(uint32_t index) const { return m_Data.data() + (size_t)index * m_ElementSize; }
+    inline uint32_t GetElementCount() const { return m_ElementCount; }
+    inline uint64_t GetSize() const { return (uint64_t)m_ElementCount * m_ElementSize; }
+private:
+    void MarkDirty(uint32_t begin, uint32_t end);
+private:
+    uint32_t m_ElementSize;
+    uint32_t m_ElementCount = 0;
+    std::vector<uint8_t> m_Data;
+    uint64_t m_UploadOffsets[FRAMES_IN_FLIGHT];
+    uint32_t m_DirtyBegin[FRAMES_IN_FLIGHT];
+    uint32_t m_DirtyEnd[FRAMES_IN_FLIGHT];
+};
@@ -0,0 +1,94 @@
+#include "ringallocator.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+RingAllocator::RingAllocator(uint64_t capacity, uint32_t maxSubmissionCount)
+    : m_Capacity(capacity), m_Submissions(maxSubmissionCount)
+{
+    HEXRAY_ASSERT(capacity > 0 && maxSubmissionCount > 0);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool RingAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset)
+{
+    HEXRAY_ASSERT_MSG((alignment & (alignment - 1)) == 0, "Ring allocator alignment has to be a power of two");
+
+    if (size == 0 || size > m_Capacity)
+        return false;
+
+    // Without anything in flight the whole range is free, starting over at the beginning keeps it contiguous
+    if (m_UsedSize == 0)
+    {
+        m_Head = 0;
+        m_Tail = 0;
+    }
+
+    uint64_t offset = Align(m_Head, alignment);
+    bool wrapsAround = false;
+
+    if (m_UsedSize == 0 || m_Head > m_Tail)
+    {
+        // Free memory is [head, capacity) followed by [0, tail). Wrapping around skips the end of the range, the skipped
+        // memory belongs to this allocation until it is released
+        if (offset + size > m_Capacity)
+        {
+            if (size > m_Tail)
+                return false;
+
+            offset = 0;
+            wrapsAround = true;
+        }
+    }
+    else if (offset + size > m_Tail)
+    {
+        // Free memory is [head, tail)
+        return false;
+    }
+
+    uint64_t consumedSize = wrapsAround ? m_Capacity - m_Head + size : offset + size - m_Head;
+    m_UsedSize += consumedSize;
+    m_UnsubmittedSize += consumedSize;
+    m_Head = (offset + size) % m_Capacity;
+
+    outOffset = offset;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RingAllocator::Submit(uint64_t fenceValue)
+{
+    HEXRAY_ASSERT_MSG(!IsSubmissionQueueFull(), "Ring allocator has too many submissions in flight");
+
+    Submission& submission = m_Submissions[(m_FirstSubmission + m_SubmissionCount) % m_Submissions.size()];
+    submission.FenceValue = fenceValue;
+    submission.Head = m_Head;
+    submission.Size = m_UnsubmittedSize;
+
+    m_SubmissionCount++;
+    m_UnsubmittedSize = 0;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void RingAllocator::Release(uint64_t completedFenceValue)
+{
+    // Submissions complete in order, so the memory of a completed one always starts at the tail
+    while (m_SubmissionCount > 0 && m_Submissions[m_FirstSubmission].FenceValue <= completedFenceValue)
+    {
+        // Empty submissions own no memory, their head may be from before the range was last started over
+        const Submission& submission = m_Submissions[m_FirstSubmission];
+        if (submission.Size > 0)
+        {
+            m_Tail = submission.Head;
+            m_UsedSize -= submission.Size;
+        }
+
+        m_FirstSubmission = (m_FirstSubmission + 1) % m_Submissions.size();
+        m_SubmissionCount--;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint64_t RingAllocator::GetOldestSubmissionFenceValue() const
+{
+    HEXRAY_ASSERT(HasSubmissions());
+    return m_Submissions[m_FirstSubmission].FenceValue;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/core.h"
+
+// Platform independent allocator for a fixed size memory range that is consumed linearly and wraps around. Allocations are
+// grouped into submissions tagged with a fence value and the memory of a submission is reused once its fence completed.
+// Allocating fails when the memory is still in use, the owner then has to wait for the oldest submission and release it
+class RingAllocator
+{
+public:
+    RingAllocator(uint64_t capacity, uint32_t maxSubmissionCount);
+
+    bool Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset);
+    void Submit(uint64_t fenceValue);
+    void Release(uint64_t completedFenceValue);
+
+    uint64_t GetOldestSubmissionFenceValue() const;
+    inline bool HasSubmissions() const { return m_SubmissionCount > 0; }
+    inline bool IsSubmissionQueueFull() const { return m_SubmissionCount == m_Submissions.size(); }
+    inline uint64_t GetCapacity() const { return m_Capacity; }
+    inline uint64_t GetUsedSize() const { return m_UsedSize; }
+private:
+    struct Submission
+    {
+        uint64_t FenceValue = 0;
+        uint64_t Head = 0;
+        uint64_t Size = 0;
+    };
+private:
+    uint64_t m_Capacity;
+    uint64_t m_Head = 0;
+    uint64_t m_Tail = 0;
+    uint64_t m_UsedSize = 0;
+    uint64_t m_UnsubmittedSize = 0;
+
+    // Submissions are kept in a fixed circular array, so allocating never allocates memory itself
+    std::vector<Submission> m_Submissions;
+    uint32_t m_FirstSubmission = 0;
+    uint32_t m_SubmissionCount = 0;
+};
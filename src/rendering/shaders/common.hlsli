@@ -103,6 +103,186 @@ SampleParams GetSampleParams(SceneConstants sceneConstants, Triangle tri, float3
     return result;
 }
 
+// Analytic primitives are intersected in object space, where the ray direction is not normalized,
+// so the returned t is the same as the one along the world space ray
+bool IntersectSphere(float3 center, float radius, float3 origin, float3 direction, float tMin, float tMax, out float t, out float3 normal)
+{
+    t = 0.0;
+    normal = float3(0.0, 0.0, 0.0);
+
+    float3 oc = origin - center;
+    float a = dot(direction, direction);
+    float b = dot(oc, direction);
+    float c = dot(oc, oc) - radius * radius;
+    float discriminant = b * b - a * c;
+
+    if (discriminant < 0.0)
+        return false;
+
+    float sqrtDiscriminant = sqrt(discriminant);
+    float tNear = (-b - sqrtDiscriminant) / a;
+    float tFar = (-b + sqrtDiscriminant) / a;
+
+    // Rays that start inside the sphere (e.g. refracted ones) hit its far side
+    t = tNear > tMin ? tNear : tFar;
+    if (t <= tMin || t >= tMax)
+        return false;
+
+    normal = (origin + direction * t - center) / radius;
+    return true;
+}
+
+bool IntersectCube(float3 center, float halfSide, float3 origin, float3 direction, float tMin, float tMax, out float t, out float3 normal)
+{
+    t = 0.0;
+    normal = float3(0.0, 0.0, 0.0);
+
+    float3 invDirection = 1.0 / direction;
+    float3 t0 = (center - halfSide - origin) * invDirection;
+    float3 t1 = (center + halfSide - origin) * invDirection;
+    float3 tMin3 = min(t0, t1);
+    float3 tMax3 = max(t0, t1);
+    float tNear = max(max(tMin3.x, tMin3.y), tMin3.z);
+    float tFar = min(min(tMax3.x, tMax3.y), tMax3.z);
+
+    t = tNear > tMin ? tNear : tFar;
+    if (tNear > tFar || t <= tMin || t >= tMax)
+        return false;
+
+    // The face that was hit is the one along the axis where the hit point is furthest from the center
+    float3 p = origin + direction * t - center;
+    float3 absP = abs(p);
+    if (absP.x >= absP.y && absP.x >= absP.z)
+        normal = float3(sign(p.x), 0.0, 0.0);
+    else if (absP.y >= absP.z)
+        normal = float3(0.0, sign(p.y), 0.0);
+    else
+        normal = float3(0.0, 0.0, sign(p.z));
+
+    return true;
+}
+
+bool IntersectPlane(float3 center, float limit, float3 origin, float3 direction, float tMin, float tMax, out float t, out float3 normal)
+{
+    t = 0.0;
+    normal = float3(0.0, 1.0, 0.0);
+
+    if (abs(direction.y) < Epsilon)
+        return false;
+
+    t = (center.y - origin.y) / direction.y;
+    if (t <= tMin || t >= tMax)
+        return false;
+
+    float3 p = origin + direction * t - center;
+    return abs(p.x) <= limit && abs(p.z) <= limit;
+}
+
+bool IntersectPrimitive(GeometryConstants geometry, float3 origin, float3 direction, float tMin, float tMax, out float t, out float3 normal)
+{
+    switch (geometry.PrimitiveType)
+    {
+        case PrimitiveType::Sphere:
+            return IntersectSphere(geometry.PrimitiveCenter, geometry.PrimitiveExtent, origin, direction, tMin, tMax, t, normal);
+        case PrimitiveType::Cube:
+            return IntersectCube(geometry.PrimitiveCenter, geometry.PrimitiveExtent, origin, direction, tMin, tMax, t, normal);
+        case PrimitiveType::Plane:
+            return IntersectPlane(geometry.PrimitiveCenter, geometry.PrimitiveExtent, origin, direction, tMin, tMax, t, normal);
+    }
+
+    t = 0.0;
+    normal = float3(0.0, 0.0, 0.0);
+    return false;
+}
+
+float2 GetPrimitiveTexCoord(GeometryConstants geometry, float3 position, float3 normal)
+{
+    float3 p = position - geometry.PrimitiveCenter;
+
+    switch (geometry.PrimitiveType)
+    {
+        case PrimitiveType::Sphere:
+        {
+            float3 d = normalize(p);
+            return float2((PI + atan2(d.z, d.x)) / TwoPI, 1.0 - (0.5 * PI + asin(clamp(d.y, -1.0, 1.0))) / PI);
+        }
+        case PrimitiveType::Cube:
+        {
+            // Every face is mapped by the two axes spanning it
+            float3 absNormal = abs(normal);
+            return absNormal.x > 0.5 ? p.yz : (absNormal.y > 0.5 ? p.zx : p.xy);
+        }
+        case PrimitiveType::Plane:
+        case PrimitiveType::Heightfield:
+            return p.xz;
+    }
+
+    return float2(0.0, 0.0);
+}
+
+void GetPrimitiveTangentFrame(GeometryConstants geometry, float3 normal, out float3 tangent, out float3 bitangent)
+{
+    float3 absNormal = abs(normal);
+
+    if (geometry.PrimitiveType == PrimitiveType::Sphere)
+    {
+        // Direction of increasing longitude, which degenerates at the poles
+        tangent = float3(-normal.z, 0.0, normal.x);
+        tangent = dot(tangent, tangent) > Epsilon ? normalize(tangent) : float3(1.0, 0.0, 0.0);
+        bitangent = cross(normal, tangent);
+    }
+    else if (geometry.PrimitiveType == PrimitiveType::Cube && absNormal.x > 0.5)
+    {
+        tangent = float3(0.0, 1.0, 0.0);
+        bitangent = float3(0.0, 0.0, 1.0);
+    }
+    else if (geometry.PrimitiveType == PrimitiveType::Cube && absNormal.z > 0.5)
+    {
+        tangent = float3(1.0, 0.0, 0.0);
+        bitangent = float3(0.0, 1.0, 0.0);
+    }
+    else if (geometry.PrimitiveType == PrimitiveType::Cube)
+    {
+        tangent = float3(0.0, 0.0, 1.0);
+        bitangent = float3(1.0, 0.0, 0.0);
+    }
+    else
+    {
+        tangent = float3(1.0, 0.0, 0.0);
+        bitangent = float3(0.0, 0.0, 1.0);
+    }
+}
+
+SampleParams GetPrimitiveSampleParams(SceneConstants sceneConstants, GeometryConstants geometry, float3 worldPosition, float3 worldNormal, float3 objectNormal, float2 texCoord)
+{
+    // Same helper ray approach as for triangles, except that the offset points are mapped back to UVs with the primitive's own parameterization
+    uint2 threadID = DispatchRaysIndex().xy;
+    float3 ddxOrigin, ddxDir;
+    GenerateCameraRay(sceneConstants, uint2(threadID.x + 1, threadID.y), ddxOrigin, ddxDir);
+    float3 ddyOrigin, ddyDir;
+    GenerateCameraRay(sceneConstants, uint2(threadID.x, threadID.y + 1), ddyOrigin, ddyDir);
+
+    float3 xOffsetPoint = RayPlaneIntersection(worldPosition, worldNormal, ddxOrigin, ddxDir);
+    float3 yOffsetPoint = RayPlaneIntersection(worldPosition, worldNormal, ddyOrigin, ddyDir);
+
+    float3x4 worldToObject = WorldToObject3x4();
+    float2 ddx = GetPrimitiveTexCoord(geometry, mul(worldToObject, float4(xOffsetPoint, 1.0)), objectNormal) - texCoord;
+    float2 ddy = GetPrimitiveTexCoord(geometry, mul(worldToObject, float4(yOffsetPoint, 1.0)), objectNormal) - texCoord;
+
+    if (geometry.PrimitiveType == PrimitiveType::Sphere)
+    {
+        // The longitude wraps around at the seam
+        ddx.x -= round(ddx.x);
+        ddy.x -= round(ddy.x);
+    }
+
+    SampleParams result;
+    result.TexCoord = texCoord;
+    result.Ddx = ddx;
+    result.Ddy = ddy;
+    return result;
+}
+
 uint ComputeMipLevel(float2 texCoords)
 {
     float2 dx = ddx(texCoords);
@@ -108,6 +108,19 @@ float3 CalculateDirectLighting_PBR(HitInfo hitInfo, float3 cameraPosition, Light
     return float3(0.0, 0.0, 0.0);
 }
 
+// Share of the light from direction L that the diffuse lobe reflects, the rest is reflected specularly or absorbed by metals
+float3 CalculateDiffuseWeight_PBR(HitInfo hitInfo, float3 cameraPosition, float3 L, float3 albedo, float metalness)
+{
+    metalness = clamp(metalness, 0.001, 1.0);
+
+    float3 V = normalize(cameraPosition - hitInfo.WorldPosition);
+    float3 H = normalize(V + L);
+    float VDotH = max(dot(V, H), 0.0);
+
+    float3 F = FresnelSchlickFunction(albedo, metalness, VDotH);
+    return (float3(1.0, 1.0, 1.0) - F) * (1.0 - metalness);
+}
+
 float3 CalculateIndirectLighting_PBR(HitInfo hitInfo, inout uint seed, uint recursionDepth, float3 cameraPosition, float3 albedo, float roughness, float metalness, RaytracingAccelerationStructure accelerationStruct)
 {
     roughness = clamp(roughness, 0.001, 1.0);
@@ -122,7 +135,7 @@ float3 CalculateIndirectLighting_PBR(HitInfo hitInfo, inout uint seed, uint recu
         float3 L = GetRandomDirectionCosineWeighted(seed, hitInfo.WorldNormal, hitInfo.WorldTangent, hitInfo.WorldBitangent);
         float NDotL = max(dot(N, L), 0.0);
         
-        ColorRayPayload diffusePayload = TraceColorRay(hitInfo.WorldPosition, L, seed, recursionDepth, accelerationStruct);
+        ColorRayPayload diffusePayload = TraceColorRay(hitInfo.WorldPosition, L, seed, recursionDepth, accelerationStruct, g_ResourceIndices.EmissiveInstanceCount > 0);
         
         float3 diffuseBRDF = albedo / PI;
         float cosineSampleProbability = NDotL / PI;
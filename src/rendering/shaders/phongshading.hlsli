@@ -94,7 +94,7 @@ float3 CalculateIndirectLighting_Phong(HitInfo hitInfo, inout uint seed, uint re
         float3 L = GetRandomDirectionCosineWeighted(seed, hitInfo.WorldNormal, hitInfo.WorldTangent, hitInfo.WorldBitangent);
         float NDotL = max(dot(N, L), 0.0);
         
-        ColorRayPayload diffusePayload = TraceColorRay(hitInfo.WorldPosition, L, seed, recursionDepth, accelerationStruct);
+        ColorRayPayload diffusePayload = TraceColorRay(hitInfo.WorldPosition, L, seed, recursionDepth, accelerationStruct, g_ResourceIndices.EmissiveInstanceCount > 0);
         
         float3 diffuseBRDF = albedo / PI;
         float cosineSampleProbability = NDotL / PI;
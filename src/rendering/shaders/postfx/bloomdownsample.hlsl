@@ -11,15 +11,27 @@ void CSMain(uint2 ThreadID : SV_DispatchThreadID)
     RWTexture2D<float4> downsampledTexture = g_RWTextures[downsampleConstants.DownsampledTextureIndex];
     Texture2D<float4> sourceTexture = g_Textures[downsampleConstants.SourceTextureIndex];
     
-    float targetWidth, targetHeight;
-    downsampledTexture.GetDimensions(targetWidth, targetHeight);
+    // Textures are allocated in size buckets, so only the region covered by the viewport is downsampled
+    uint2 viewportSize = uint2(g_ResourceIndices.ViewportWidth, g_ResourceIndices.ViewportHeight);
+    float2 targetViewportSize = max(viewportSize >> (uint)downsampleConstants.DownsampledMipLevel, 1);
+    float2 sourceViewportSize = max(viewportSize >> (uint)downsampleConstants.SourceMipLevel, 1);
     
-    float2 targetTexelSize = 1.0f / float2(targetWidth, targetHeight);
+    if (any(ThreadID.xy >= (uint2)targetViewportSize))
+        return;
+    
+    float sourceWidth, sourceHeight, sourceMipCount;
+    sourceTexture.GetDimensions((uint)downsampleConstants.SourceMipLevel, sourceWidth, sourceHeight, sourceMipCount);
+    
+    float2 sourceSize = float2(sourceWidth, sourceHeight);
+    float2 targetTexelSize = sourceViewportSize / (targetViewportSize * sourceSize);
     float2 texCoords = targetTexelSize * (ThreadID.xy);
     
+    // Samples outside of the viewport would read whatever is left in the rest of the texture
+    float2 maxTexCoords = (sourceViewportSize - 0.5f) / sourceSize;
+    
     if (downsampleConstants.DownsampledMipLevel == 0)
     {
-        downsampledTexture[ThreadID.xy] = sourceTexture.SampleLevel(g_LinearClampSampler, texCoords, downsampleConstants.SourceMipLevel);
+        downsampledTexture[ThreadID.xy] = sourceTexture.SampleLevel(g_LinearClampSampler, min(texCoords, maxTexCoords), downsampleConstants.SourceMipLevel);
         return;
     }
 
@@ -32,22 +44,22 @@ void CSMain(uint2 ThreadID : SV_DispatchThreadID)
 	// g - h - i
 	// 'e' = current texel
     
-    float3 a = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - 2 * targetTexelSize.x, texCoords.y + 2 * targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 b = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x,                         texCoords.y + 2 * targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 c = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + 2 * targetTexelSize.x, texCoords.y + 2 * targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
+    float3 a = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - 2 * targetTexelSize.x, texCoords.y + 2 * targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 b = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x,                         texCoords.y + 2 * targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 c = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + 2 * targetTexelSize.x, texCoords.y + 2 * targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
 
-    float3 d = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - 2 * targetTexelSize.x, texCoords.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 e = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x,                         texCoords.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 f = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + 2 * targetTexelSize.x, texCoords.y), downsampleConstants.SourceMipLevel).rgb;
+    float3 d = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - 2 * targetTexelSize.x, texCoords.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 e = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x,                         texCoords.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 f = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + 2 * targetTexelSize.x, texCoords.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
 
-    float3 g = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - 2 * targetTexelSize.x, texCoords.y - 2 * targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 h = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x,                         texCoords.y - 2 * targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 i = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + 2 * targetTexelSize.x, texCoords.y - 2 * targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
+    float3 g = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - 2 * targetTexelSize.x, texCoords.y - 2 * targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 h = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x,                         texCoords.y - 2 * targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 i = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + 2 * targetTexelSize.x, texCoords.y - 2 * targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
 
-    float3 j = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - targetTexelSize.x, texCoords.y + targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 k = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + targetTexelSize.x, texCoords.y + targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 l = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - targetTexelSize.x, texCoords.y - targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
-    float3 m = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + targetTexelSize.x, texCoords.y - targetTexelSize.y), downsampleConstants.SourceMipLevel).rgb;
+    float3 j = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - targetTexelSize.x, texCoords.y + targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 k = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + targetTexelSize.x, texCoords.y + targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 l = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - targetTexelSize.x, texCoords.y - targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
+    float3 m = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + targetTexelSize.x, texCoords.y - targetTexelSize.y), maxTexCoords), downsampleConstants.SourceMipLevel).rgb;
 
     float3 downSampledColor = (j + k + m + l) * 0.5f / 4.0f;
     downSampledColor += (a + b + e + d) * 0.125f / 4.0f;
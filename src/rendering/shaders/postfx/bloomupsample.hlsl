@@ -11,11 +11,20 @@ void CSMain(uint2 ThreadID : SV_DispatchThreadID)
     RWTexture2D<float4> upsampledTexture = g_RWTextures[upsampleConstants.UpsampledTextureIndex];
     Texture2D<float4> sourceTexture = g_Textures[upsampleConstants.SourceTextureIndex];
     
-    float upsampledWidth, upsampledHeight;
-    upsampledTexture.GetDimensions(upsampledWidth, upsampledHeight);
+    // Textures are allocated in size buckets, so only the region covered by the viewport is upsampled
+    uint2 viewportSize = uint2(g_ResourceIndices.ViewportWidth, g_ResourceIndices.ViewportHeight);
+    float2 upsampledViewportSize = max(viewportSize >> ((uint)upsampleConstants.SourceMipLevel - 1), 1);
+    float2 sourceViewportSize = max(viewportSize >> (uint)upsampleConstants.SourceMipLevel, 1);
     
-    float2 upsampleTexelSize = 1.0f / float2(upsampledWidth, upsampledHeight);
-    float2 texCoords = upsampleTexelSize * (ThreadID.xy);
+    if (any(ThreadID.xy >= (uint2)upsampledViewportSize))
+        return;
+    
+    float sourceWidth, sourceHeight, sourceMipCount;
+    sourceTexture.GetDimensions((uint)upsampleConstants.SourceMipLevel, sourceWidth, sourceHeight, sourceMipCount);
+    
+    float2 viewportScale = sourceViewportSize / float2(sourceWidth, sourceHeight);
+    float2 texCoords = (ThreadID.xy / upsampledViewportSize) * viewportScale;
+    float2 maxTexCoords = (sourceViewportSize - 0.5f) / float2(sourceWidth, sourceHeight);
     
     // Upsampling is done based on the method used in "Next-gen post processing in Call of Duty" presentation, ACM Siggraph 2014
     // https://www.iryoku.com/next-generation-post-processing-in-call-of-duty-advanced-warfare/
@@ -24,18 +33,19 @@ void CSMain(uint2 ThreadID : SV_DispatchThreadID)
 	// g - h - i
 	// 'e' = current texel
     
-    float radius = upsampleConstants.FilterRadius;
-    float3 a = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - radius, texCoords.y + radius), upsampleConstants.SourceMipLevel).rgb;
-    float3 b = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x,          texCoords.y + radius), upsampleConstants.SourceMipLevel).rgb;
-    float3 c = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + radius, texCoords.y + radius), upsampleConstants.SourceMipLevel).rgb;
+    // The filter radius is relative to the viewport, not to the whole texture
+    float2 radius = upsampleConstants.FilterRadius * viewportScale;
+    float3 a = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - radius.x, texCoords.y + radius.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
+    float3 b = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x, texCoords.y + radius.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
+    float3 c = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + radius.x, texCoords.y + radius.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
     
-    float3 d = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - radius, texCoords.y), upsampleConstants.SourceMipLevel).rgb;
-    float3 e = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x,          texCoords.y), upsampleConstants.SourceMipLevel).rgb;
-    float3 f = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + radius, texCoords.y), upsampleConstants.SourceMipLevel).rgb;
+    float3 d = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - radius.x, texCoords.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
+    float3 e = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x, texCoords.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
+    float3 f = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + radius.x, texCoords.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
     
-    float3 g = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x - radius, texCoords.y - radius), upsampleConstants.SourceMipLevel).rgb;
-    float3 h = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x,          texCoords.y - radius), upsampleConstants.SourceMipLevel).rgb;
-    float3 i = sourceTexture.SampleLevel(g_LinearClampSampler, float2(texCoords.x + radius, texCoords.y - radius), upsampleConstants.SourceMipLevel).rgb;
+    float3 g = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x - radius.x, texCoords.y - radius.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
+    float3 h = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x, texCoords.y - radius.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
+    float3 i = sourceTexture.SampleLevel(g_LinearClampSampler, min(float2(texCoords.x + radius.x, texCoords.y - radius.y), maxTexCoords), upsampleConstants.SourceMipLevel).rgb;
     
     // Apply a 3x3 tent filter:
     float3 upsampledColor = e * 4.0f;
@@ -7,11 +7,31 @@
 
 #ifndef HLSL
 #include <glm.hpp>
+#include <cstddef>
+#include <cstring>
 typedef glm::vec2 float2;
 typedef glm::vec3 float3;
 typedef glm::vec4 float4;
 typedef glm::mat4 matrix;
+typedef glm::ivec2 int2;
+typedef glm::uvec2 uint2;
 typedef uint32_t uint;
+
+// Functions shared with the shaders use the HLSL intrinsics, glm provides them on the C++ side
+using glm::abs;
+using glm::clamp;
+using glm::cross;
+using glm::dot;
+using glm::floor;
+using glm::length;
+using glm::max;
+using glm::min;
+using glm::normalize;
+using glm::sqrt;
+
+#define OUT_PARAM(Type) Type&
+#else
+#define OUT_PARAM(Type) out Type
 #endif // HLSL
 
 // -----------------------------------------------------------------------
@@ -67,6 +87,28 @@ enum SamplerType
     AnisoWrap = 4,
 };
 
+// -----------------------------------------------------------------------
+enum ProceduralTextureType
+{
+    NotProcedural = 0,
+    ConstantColor = 1,
+    Checker = 2
+};
+
+// -----------------------------------------------------------------------
+enum PrimitiveType
+{
+    NotPrimitive = 0,
+    Sphere = 1,
+    Cube = 2,
+    Plane = 3,
+    Heightfield = 4
+};
+
+// Hit groups are selected per instance, so their order in the pipeline has to match these indices
+static const uint c_TriangleHitGroupIndex = 0;
+static const uint c_PrimitiveHitGroupIndex = 1;
+
 // -----------------------------------------------------------------------
 struct MaterialConstants
 {
@@ -86,19 +128,51 @@ struct MaterialConstants
     uint NormalMapIndex;
     uint RoughnessMapIndex; // PBR
     uint MetalnessMapIndex; // PBR
+    uint AlbedoVirtualTextureIndex;
+    uint AlbedoProceduralType;
+    float4 AlbedoProceduralColorA;
+    float4 AlbedoProceduralColorB;
 };
 
-static const uint c_MaterialConstantsStructSize = 116;
+static const uint c_MaterialConstantsStructSize = 156;
 
 // -----------------------------------------------------------------------
 struct GeometryConstants
 {
     uint MaterialIndex;
-    uint VertexBufferIndex;
+    uint VertexBufferIndex; // Height samples and min/max pyramid for heightfields
     uint IndexBufferIndex;
+    uint PrimitiveType;
+    float3 PrimitiveCenter;
+    float PrimitiveExtent;
+};
+
+static const uint c_GeometryConstantsStructSize = 32;
+
+// -----------------------------------------------------------------------
+struct PrimitiveAttributes
+{
+    float3 Normal; // Object space
+};
+
+static const uint c_PrimitiveAttributesStructSize = 12;
+
+// -----------------------------------------------------------------------
+// Heightfield buffers start with this header, followed by the 16 bit height samples packed in pairs and the min/max pyramid.
+// Nodes of the finest pyramid level bound tiles of c_HeightfieldTileSize x c_HeightfieldTileSize cells, every next level halves
+// the resolution until a single node covers the whole grid. A node stores its min height in the low 16 bits and its max in the high 16 bits
+struct HeightfieldInfo
+{
+    uint Width;        // Samples along x
+    uint Depth;        // Samples along z
+    float CellSize;    // Object space distance between neighbouring samples
+    float HeightScale; // Object space height of a sample at full intensity
+    uint MipCount;
 };
 
-static const uint c_GeometryConstantsStructSize = 12;
+static const uint c_HeightfieldInfoStructSize = 20;
+static const uint c_HeightfieldTileSize = 4;
+static const uint c_HeightfieldMaxMipCount = 16;
 
 // -----------------------------------------------------------------------
 enum LightType
@@ -122,6 +196,107 @@ struct Light
 
 static const uint c_LightStructSize = 64;
 
+// Walker alias table over the lights. Entry i keeps light i with probability Threshold and otherwise picks light Alias, so a
+// light is selected with a single random number and two comparisons. Pdf is the selection probability of light i and
+// AliasPdf the one of the alias, so the probability of the sampled light is known without another load
+struct LightAliasEntry
+{
+    float Threshold;
+    uint Alias;
+    float Pdf;
+    float AliasPdf;
+};
+
+static const uint c_LightAliasEntryStructSize = 16;
+
+// -----------------------------------------------------------------------
+inline uint GetLightAliasEntryIndex(uint lightCount, float u)
+{
+    uint entryIndex = uint(u * float(lightCount));
+    return entryIndex < lightCount ? entryIndex : lightCount - 1;
+}
+
+// -----------------------------------------------------------------------
+// The fraction of the random number left after choosing the entry decides between the entry and its alias
+inline uint SampleLightAliasEntry(LightAliasEntry entry, uint entryIndex, uint lightCount, float u)
+{
+    float remainder = u * float(lightCount) - float(entryIndex);
+    return remainder < entry.Threshold ? entryIndex : entry.Alias;
+}
+
+// -----------------------------------------------------------------------
+inline float GetLightAliasEntryPdf(LightAliasEntry entry, uint entryIndex, uint lightIndex)
+{
+    return lightIndex == entryIndex ? entry.Pdf : entry.AliasPdf;
+}
+
+// -----------------------------------------------------------------------
+// Node of the light BVH over the point and spot lights. A node bounds the positions and the total power of its lights, and
+// the directions they emit into: every light's axis lies within the angle ThetaO of ConeAxis and its emission fades out
+// within the further angle ThetaE. Interior nodes keep their first child right after themselves, leaves hold one light
+struct LightBVHNode
+{
+    float3 BoundsMin;
+    float Power;
+    float3 BoundsMax;
+    uint ChildOrLightIndex;
+    float3 ConeAxis;
+    float CosThetaO;
+    float CosThetaE;
+    uint IsLeaf;
+};
+
+static const uint c_LightBVHNodeStructSize = 56;
+static const uint c_InvalidLightIndex = 0xffffffff;
+static const float c_OneMinusEpsilon = 0.99999994;
+
+// -----------------------------------------------------------------------
+// Mesh instance copy whose material emits light, sampled by next event estimation. Emitters are picked from a CDF over their
+// power and triangles on them from a CDF over their object space areas. Both CDFs live in one float array, the emitter CDF
+// first, then one triangle CDF per geometry that instances of the same submesh share
+struct EmissiveInstance
+{
+    float4 ObjectToWorld[3];
+    uint GeometryIndex;
+    uint TriangleCdfOffset;
+    uint TriangleCount;
+    uint IsTwoSided;
+};
+
+static const uint c_EmissiveInstanceStructSize = 64;
+
+// -----------------------------------------------------------------------
+// ------------------------ Virtual Texturing ----------------------------
+// -----------------------------------------------------------------------
+static const uint c_VirtualPageSize = 128;
+static const uint c_VirtualPageBorder = 4;
+static const uint c_VirtualPagePhysicalSize = c_VirtualPageSize + 2 * c_VirtualPageBorder;
+static const uint c_InvalidVirtualPage = 0xffffffff;
+
+// Page table entries store the physical slot in the low 16 bits and the mip of the resident page in the high 16 bits
+struct VirtualTextureInfo
+{
+    uint PageTableOffset;
+    uint Width;
+    uint Height;
+    uint PageMipLevels;
+};
+
+static const uint c_VirtualTextureInfoStructSize = 16;
+
+// -----------------------------------------------------------------------
+struct VirtualTextureConstants
+{
+    uint InfoBufferIndex;
+    uint PageTableBufferIndex;
+    uint PageAtlasIndex;
+    uint FeedbackBufferIndex;
+    uint FeedbackStamp;
+    uint PhysicalPagesPerRow;
+    float InvAtlasSize;
+    uint Padding; // Structs in constant buffers take whole 16 byte registers
+};
+
 // -----------------------------------------------------------------------
 // ---------------------------- Post FX ----------------------------------
 // -----------------------------------------------------------------------
@@ -165,12 +340,32 @@ struct ResourceBindTable
     uint EnvironmentMapIndex;
     uint RenderTargetIndex;
     uint PrevFrameRenderTargetIndex;
-    uint SceneBufferIndex;
-    uint LightsBufferIndex;
-    uint MaterialBufferIndex;
-    uint GeometryBufferIndex;
     uint AccelerationStructureIndex;
 
+    // Scene, light, material and geometry constants live in one buffer per frame, these are byte offsets into it
+    uint FrameConstantsBufferIndex;
+    uint SceneConstantsOffset;
+    uint LightsOffset;
+    uint MaterialsOffset;
+    uint GeometryOffset;
+    uint LightAliasTableOffset;
+    uint DirectionalLightCount;
+    uint LightBVHOffset;
+    uint LightBVHNodeCount;
+    uint EmissiveInstancesOffset;
+    uint EmissiveInstanceCount;
+    uint EmissiveCdfOffset;
+
+    // Render targets can be larger than the viewport, only the top left viewport sized region is rendered to
+    uint ViewportWidth;
+    uint ViewportHeight;
+
+    // Constant buffers start every struct on a new 16 byte register, the C++ side has to leave the same gap before them
+    uint Padding0;
+    uint Padding1;
+
+    VirtualTextureConstants VirtualTextureConstants;
+
     // PostFX constants
     BloomDownsampleConstants BloomDownsampleConstants;
     BloomUpsampleConstants BloomUpsampleConstants;
@@ -184,6 +379,7 @@ struct ColorRayPayload
 {
     uint Seed;
     uint RayDepth;
+    uint SkipEmission; // Set for rays whose hits are sampled by next event estimation already
     float4 Color;
 };
 
@@ -240,6 +436,7 @@ ByteAddressBuffer                 g_Buffers[]                : register(t0, ROBU
 Texture2D<float4>                 g_Textures[]               : register(t0, ROTEXTURE2D_SPACE);
 TextureCube                       g_CubeMaps[]               : register(t0, ROTEXTURECUBE_SPACE);
 RWTexture2D<float4>               g_RWTextures[]             : register(u0, RWTEXTURE2D_SPACE);
+RWByteAddressBuffer               g_RWBuffers[]              : register(u0, RWBUFFERS_SPACE);
 SamplerState                      g_PointClampSampler        : register(s0, SAMPLERSTATE_SPACE);
 SamplerState                      g_PointWrapSampler         : register(s1, SAMPLERSTATE_SPACE);
 SamplerState                      g_LinearClampSampler       : register(s2, SAMPLERSTATE_SPACE);
@@ -249,7 +446,7 @@ SamplerState                      g_AnisoWrapSampler         : register(s4, SAMP
 // -----------------------------------------------------------------------
 // Helper functions for tracing rays
 // -----------------------------------------------------------------------
-ColorRayPayload TraceColorRay(float3 origin, float3 direction, uint seed, uint currentRayDepth, RaytracingAccelerationStructure accelerationStructure)
+ColorRayPayload TraceColorRay(float3 origin, float3 direction, uint seed, uint currentRayDepth, RaytracingAccelerationStructure accelerationStructure, bool skipEmission = false)
 {
     RayDesc ray;
     ray.Origin = origin;
@@ -260,6 +457,7 @@ ColorRayPayload TraceColorRay(float3 origin, float3 direction, uint seed, uint c
     ColorRayPayload payload;
     payload.Seed = seed;
     payload.RayDepth = currentRayDepth + 1;
+    payload.SkipEmission = skipEmission;
     payload.Color = float4(0.0, 0.0, 0.0, 1.0);
 
     if (payload.RayDepth > MAX_RAY_RECURSION_DEPTH)
@@ -302,21 +500,68 @@ Vertex GetMeshVertex(uint i, uint vertexBufferIndex)
 }
 
 // -----------------------------------------------------------------------
-MaterialConstants GetMeshMaterial(uint i, uint materialBufferIndex)
+SceneConstants GetSceneConstants()
+{
+    return g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load<SceneConstants>(g_ResourceIndices.SceneConstantsOffset);
+}
+
+// -----------------------------------------------------------------------
+MaterialConstants GetMeshMaterial(uint i)
+{
+    return g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load<MaterialConstants>(g_ResourceIndices.MaterialsOffset + i * c_MaterialConstantsStructSize);
+}
+
+// -----------------------------------------------------------------------
+GeometryConstants GetMesh(uint i)
+{
+    return g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load<GeometryConstants>(g_ResourceIndices.GeometryOffset + i * c_GeometryConstantsStructSize);
+}
+
+// -----------------------------------------------------------------------
+Light GetLight(uint i)
+{
+    return g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load<Light>(g_ResourceIndices.LightsOffset + i * c_LightStructSize);
+}
+
+// -----------------------------------------------------------------------
+LightAliasEntry GetLightAliasEntry(uint i)
 {
-    return g_Buffers[materialBufferIndex].Load<MaterialConstants>(i * c_MaterialConstantsStructSize);
+    return g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load<LightAliasEntry>(g_ResourceIndices.LightAliasTableOffset + i * c_LightAliasEntryStructSize);
 }
 
 // -----------------------------------------------------------------------
-GeometryConstants GetMesh(uint i, uint geometryBufferIndex)
+typedef uint HeightfieldBuffer;
+
+HeightfieldInfo LoadHeightfieldInfo(HeightfieldBuffer heightfield)
+{
+    return g_Buffers[heightfield].Load<HeightfieldInfo>(0);
+}
+
+uint LoadHeightfieldWord(HeightfieldBuffer heightfield, uint byteOffset)
 {
-    return g_Buffers[geometryBufferIndex].Load<GeometryConstants>(i * c_GeometryConstantsStructSize);
+    return g_Buffers[heightfield].Load(byteOffset);
 }
 
 // -----------------------------------------------------------------------
-Light GetLight(uint i, uint lightsBufferIndex)
+typedef uint LightBVHNodes;
+
+LightBVHNode LoadLightBVHNode(LightBVHNodes nodes, uint i)
 {
-    return g_Buffers[lightsBufferIndex].Load<Light>(i * c_LightStructSize);
+    return g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load<LightBVHNode>(nodes + i * c_LightBVHNodeStructSize);
+}
+
+// -----------------------------------------------------------------------
+EmissiveInstance GetEmissiveInstance(uint i)
+{
+    return g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load<EmissiveInstance>(g_ResourceIndices.EmissiveInstancesOffset + i * c_EmissiveInstanceStructSize);
+}
+
+// -----------------------------------------------------------------------
+typedef uint EmissiveCdf;
+
+float LoadEmissiveCdf(EmissiveCdf cdf, uint i)
+{
+    return asfloat(g_Buffers[g_ResourceIndices.FrameConstantsBufferIndex].Load(cdf + i * 4));
 }
 
 // -----------------------------------------------------------------------
@@ -355,6 +600,84 @@ float4 SampleTextureGrad(Texture2D texture, uint samplerType, SampleParams sampl
     return SampleTextureGrad(texture, g_LinearClampSampler, sampleValues);
 }
 
+// -----------------------------------------------------------------------
+float4 EvaluateProceduralTexture(uint proceduralType, float4 colorA, float4 colorB, SampleParams sampleValues)
+{
+    switch (proceduralType)
+    {
+        case ProceduralTextureType::ConstantColor: return colorA;
+        case ProceduralTextureType::Checker:
+        {
+            // 2x2 checker per UV tile, box filtered over the footprint of the ray differentials
+            float2 p = sampleValues.TexCoord * 2.0;
+            float2 w = max(abs(sampleValues.Ddx), abs(sampleValues.Ddy)) * 2.0 + 0.0001;
+            float2 i = 2.0 * (abs(frac((p - 0.5 * w) * 0.5) - 0.5) - abs(frac((p + 0.5 * w) * 0.5) - 0.5)) / w;
+            return lerp(colorA, colorB, 0.5 - 0.5 * i.x * i.y);
+        }
+    }
+
+    return colorA;
+}
+
+// -----------------------------------------------------------------------
+// Helper functions for sampling virtual textures
+// -----------------------------------------------------------------------
+uint GetVirtualPageCount(uint size, uint mip)
+{
+    return (max(size >> mip, 1) + c_VirtualPageSize - 1) / c_VirtualPageSize;
+}
+
+// -----------------------------------------------------------------------
+// The sampler type of the material decides how coordinates outside the texture are addressed and how the atlas is filtered.
+// Pages carry their own borders, so the atlas itself is always sampled with clamping
+float4 SampleVirtualTexture(uint virtualTextureIndex, uint samplerType, SampleParams sampleValues, float4 fallbackColor)
+{
+    VirtualTextureConstants constants = g_ResourceIndices.VirtualTextureConstants;
+    VirtualTextureInfo info = g_Buffers[constants.InfoBufferIndex].Load<VirtualTextureInfo>(virtualTextureIndex * c_VirtualTextureInfoStructSize);
+
+    // Pick the mip from the texel footprint of the ray differentials
+    float2 ddx = sampleValues.Ddx * float2(info.Width, info.Height);
+    float2 ddy = sampleValues.Ddy * float2(info.Width, info.Height);
+    float lod = 0.5 * log2(max(max(dot(ddx, ddx), dot(ddy, ddy)), 1.0));
+    uint mip = min((uint)lod, info.PageMipLevels - 1);
+
+    // Find the page table entry of the requested page
+    uint pageTableIndex = info.PageTableOffset;
+    for (uint i = 0; i < mip; i++)
+    {
+        pageTableIndex += GetVirtualPageCount(info.Width, i) * GetVirtualPageCount(info.Height, i);
+    }
+
+    bool isWrapping = samplerType == SamplerType::PointWrap || samplerType == SamplerType::LinearWrap || samplerType == SamplerType::AnisoWrap;
+    float2 uv = isWrapping ? frac(sampleValues.TexCoord) : min(saturate(sampleValues.TexCoord), c_OneMinusEpsilon);
+    uint2 pageCount = uint2(GetVirtualPageCount(info.Width, mip), GetVirtualPageCount(info.Height, mip));
+    uint2 mipSize = uint2(max(info.Width >> mip, 1), max(info.Height >> mip, 1));
+    uint2 page = min(uint2(uv * mipSize) / c_VirtualPageSize, pageCount - 1);
+    pageTableIndex += page.y * pageCount.x + page.x;
+
+    // Request the page so that the CPU makes it resident in the following frames
+    g_RWBuffers[constants.FeedbackBufferIndex].Store(pageTableIndex * 4, constants.FeedbackStamp);
+
+    uint entry = g_Buffers[constants.PageTableBufferIndex].Load(pageTableIndex * 4);
+    if (entry == c_InvalidVirtualPage)
+    {
+        return fallbackColor;
+    }
+
+    // The entry points either to the requested page or to its closest resident coarser page
+    uint slot = entry & 0xffff;
+    uint residentMip = entry >> 16;
+    float2 residentTexel = uv * float2(max(info.Width >> residentMip, 1), max(info.Height >> residentMip, 1));
+    float2 pageTexel = residentTexel - floor(residentTexel / c_VirtualPageSize) * c_VirtualPageSize;
+    float2 slotOrigin = float2(slot % constants.PhysicalPagesPerRow, slot / constants.PhysicalPagesPerRow) * c_VirtualPagePhysicalSize;
+    float2 atlasUV = (slotOrigin + c_VirtualPageBorder + pageTexel) * constants.InvAtlasSize;
+
+    if (samplerType == SamplerType::PointClamp || samplerType == SamplerType::PointWrap)
+        return g_Textures[constants.PageAtlasIndex].SampleLevel(g_PointClampSampler, atlasUV, 0);
+
+    return g_Textures[constants.PageAtlasIndex].SampleLevel(g_LinearClampSampler, atlasUV, 0);
+}
+
 // Object space
 // -----------------------------------------------------------------------
 Vertex GetIntersectionPointOS(Triangle tri, float3 bary)
@@ -385,7 +708,7 @@ HitInfo GetHitInfo(SceneConstants sceneConstants, BuiltInTriangleIntersectionAtt
     uint geometryID = InstanceID();
     uint primitiveID = PrimitiveIndex();
 
-    GeometryConstants geometry = GetMesh(geometryID, g_ResourceIndices.GeometryBufferIndex);
+    GeometryConstants geometry = GetMesh(geometryID);
     Triangle tri = GetTriangle(geometry, primitiveID);
     Vertex ip = GetIntersectionPointOS(tri, float3(1.0 - attr.barycentrics.x - attr.barycentrics.y, attr.barycentrics.x, attr.barycentrics.y));
 
@@ -400,6 +723,534 @@ HitInfo GetHitInfo(SceneConstants sceneConstants, BuiltInTriangleIntersectionAtt
 
     return hitInfo;
 }
+
+// -----------------------------------------------------------------------
+HitInfo GetPrimitiveHitInfo(SceneConstants sceneConstants, PrimitiveAttributes attr)
+{
+    GeometryConstants geometry = GetMesh(InstanceID());
+    float3 positionOS = ObjectRayOrigin() + ObjectRayDirection() * RayTCurrent();
+
+    float3 tangentOS, bitangentOS;
+    GetPrimitiveTangentFrame(geometry, attr.Normal, tangentOS, bitangentOS);
+
+    float3x3 objectToWorld = (float3x3)ObjectToWorld3x4();
+
+    HitInfo hitInfo;
+    hitInfo.WorldPosition = WorldRayOrigin() + WorldRayDirection() * RayTCurrent();
+    hitInfo.WorldNormal = normalize(mul(objectToWorld, attr.Normal));
+    hitInfo.WorldTangent = normalize(mul(objectToWorld, tangentOS));
+    hitInfo.WorldBitangent = normalize(mul(objectToWorld, bitangentOS));
+    hitInfo.Sample = GetPrimitiveSampleParams(sceneConstants, geometry, hitInfo.WorldPosition, hitInfo.WorldNormal, attr.Normal, GetPrimitiveTexCoord(geometry, positionOS, attr.Normal));
+
+    return hitInfo;
+}
+#endif // HLSL
+
+// -----------------------------------------------------------------------
+// ------------------------ Heightfields ---------------------------------
+// -----------------------------------------------------------------------
+#ifndef HLSL
+typedef const uint* HeightfieldBuffer;
+
+inline HeightfieldInfo LoadHeightfieldInfo(HeightfieldBuffer heightfield)
+{
+    HeightfieldInfo info;
+    memcpy(&info, heightfield, c_HeightfieldInfoStructSize);
+    return info;
+}
+
+inline uint LoadHeightfieldWord(HeightfieldBuffer heightfield, uint byteOffset)
+{
+    return heightfield[byteOffset / 4];
+}
+#endif // HLSL
+
+static const uint c_HeightfieldMaxIterations = 4096;
+
+inline uint GetHeightfieldNodeCount(uint cellCount, uint mip)
+{
+    uint nodeSize = c_HeightfieldTileSize << mip;
+    return (cellCount + nodeSize - 1) / nodeSize;
+}
+
+// -----------------------------------------------------------------------
+inline float LoadHeightfieldSample(HeightfieldBuffer heightfield, HeightfieldInfo info, int2 sampleCoords)
+{
+    uint sampleIndex = sampleCoords.y * info.Width + sampleCoords.x;
+    uint packedSamples = LoadHeightfieldWord(heightfield, c_HeightfieldInfoStructSize + (sampleIndex >> 1) * 4);
+    uint heightSample = (sampleIndex & 1) ? packedSamples >> 16 : packedSamples & 0xffff;
+    return heightSample / 65535.0f * info.HeightScale;
+}
+
+// -----------------------------------------------------------------------
+inline float2 LoadHeightfieldNode(HeightfieldBuffer heightfield, HeightfieldInfo info, uint mipOffset, uint nodeIndex)
+{
+    uint packedRange = LoadHeightfieldWord(heightfield, mipOffset + nodeIndex * 4);
+    return float2(packedRange & 0xffff, packedRange >> 16) / 65535.0f * info.HeightScale;
+}
+
+// -----------------------------------------------------------------------
+inline float2 GetHeightfieldExitDistances(float2 cellMin, float cellSize, float3 origin, float3 direction, int2 step)
+{
+    // Rays parallel to an axis never leave the cell through that axis' sides
+    float2 exitPlanes = cellMin + float2(step.x > 0 ? cellSize : 0.0f, step.y > 0 ? cellSize : 0.0f);
+    return float2(direction.x != 0.0f ? (exitPlanes.x - origin.x) / direction.x : 1e30f,
+                  direction.z != 0.0f ? (exitPlanes.y - origin.z) / direction.z : 1e30f);
+}
+
+// -----------------------------------------------------------------------
+inline bool IntersectHeightfieldTriangle(float3 v0, float3 v1, float3 v2, float3 origin, float3 direction, float tMin, OUT_PARAM(float) t)
+{
+    t = 0.0f;
+
+    float3 edge1 = v1 - v0;
+    float3 edge2 = v2 - v0;
+    float3 p = cross(direction, edge2);
+    float det = dot(edge1, p);
+    if (det == 0.0f)
+        return false;
+
+    float invDet = 1.0f / det;
+    float3 s = origin - v0;
+    float u = dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    float3 q = cross(s, edge1);
+    float v = dot(direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    t = dot(edge2, q) * invDet;
+    return t > tMin;
+}
+
+// -----------------------------------------------------------------------
+inline bool IntersectHeightfieldCell(HeightfieldBuffer heightfield, HeightfieldInfo info, int2 cell, float3 origin, float3 direction, float tMin, float tMax, OUT_PARAM(float) t, OUT_PARAM(float3) normal)
+{
+    t = 0.0f;
+    normal = float3(0.0f, 1.0f, 0.0f);
+
+    float h00 = LoadHeightfieldSample(heightfield, info, cell);
+    float h10 = LoadHeightfieldSample(heightfield, info, cell + int2(1, 0));
+    float h01 = LoadHeightfieldSample(heightfield, info, cell + int2(0, 1));
+    float h11 = LoadHeightfieldSample(heightfield, info, cell + int2(1, 1));
+
+    float3 p00 = float3(cell.x, h00, cell.y);
+    float3 p10 = float3(cell.x + 1, h10, cell.y);
+    float3 p01 = float3(cell.x, h01, cell.y + 1);
+    float3 p11 = float3(cell.x + 1, h11, cell.y + 1);
+
+    // Every cell is split into two triangles along its diagonal
+    float tSecond;
+    bool hit = IntersectHeightfieldTriangle(p00, p10, p11, origin, direction, tMin, t);
+    if (IntersectHeightfieldTriangle(p00, p11, p01, origin, direction, tMin, tSecond) && (!hit || tSecond < t))
+    {
+        t = tSecond;
+        hit = true;
+    }
+
+    if (!hit || t >= tMax)
+        return false;
+
+    // Smooth normals come from the gradient of the bilinear patch through the four samples
+    float fx = clamp(origin.x + direction.x * t - cell.x, 0.0f, 1.0f);
+    float fz = clamp(origin.z + direction.z * t - cell.y, 0.0f, 1.0f);
+    float dhdx = (h10 - h00) + ((h11 - h01) - (h10 - h00)) * fz;
+    float dhdz = (h01 - h00) + ((h11 - h10) - (h01 - h00)) * fx;
+    normal = float3(-dhdx, 1.0f, -dhdz);
+    return true;
+}
+
+// -----------------------------------------------------------------------
+inline bool IntersectHeightfieldTile(HeightfieldBuffer heightfield, HeightfieldInfo info, int2 tile, float3 origin, float3 direction, int2 step, float tStart, float tEnd, float tMin, float tMax, OUT_PARAM(float) t, OUT_PARAM(float3) normal)
+{
+    t = 0.0f;
+    normal = float3(0.0f, 1.0f, 0.0f);
+
+    int tileSize = c_HeightfieldTileSize;
+    int2 cellMin = tile * tileSize;
+    int2 cellMax = min(cellMin + tileSize, int2(info.Width, info.Depth) - 1) - 1;
+    int2 cell = clamp(int2(floor(float2(origin.x + direction.x * tStart, origin.z + direction.z * tStart))), cellMin, cellMax);
+
+    // A ray crosses at most 2 * c_HeightfieldTileSize - 1 cells of a tile
+    for (uint i = 0; i < 2 * c_HeightfieldTileSize; i++)
+    {
+        if (IntersectHeightfieldCell(heightfield, info, cell, origin, direction, tMin, tMax, t, normal))
+            return true;
+
+        float2 tExit = GetHeightfieldExitDistances(float2(cell), 1.0f, origin, direction, step);
+        if (min(tExit.x, tExit.y) >= tEnd)
+            return false;
+
+        if (tExit.x < tExit.y)
+            cell.x += step.x;
+        else
+            cell.y += step.y;
+
+        if (cell.x < cellMin.x || cell.y < cellMin.y || cell.x > cellMax.x || cell.y > cellMax.y)
+            return false;
+    }
+
+    return false;
+}
+
+// -----------------------------------------------------------------------
+// Traces the min/max pyramid of a heightfield centered at center. Origin, direction and the returned normal are in object space
+inline bool IntersectHeightfield(HeightfieldBuffer heightfield, float3 center, float3 origin, float3 direction, float tMin, float tMax, OUT_PARAM(float) t, OUT_PARAM(float3) normal)
+{
+    t = 0.0f;
+    normal = float3(0.0f, 1.0f, 0.0f);
+
+    HeightfieldInfo info = LoadHeightfieldInfo(heightfield);
+    uint2 cellCount = uint2(info.Width - 1, info.Depth - 1);
+
+    // Trace in grid space where every cell is a unit square. Heights stay in object units, so hit distances are the same in both spaces
+    float2 gridOrigin = float2(center.x, center.z) - 0.5f * float2(cellCount) * info.CellSize;
+    float3 o = float3((origin.x - gridOrigin.x) / info.CellSize, origin.y - center.y, (origin.z - gridOrigin.y) / info.CellSize);
+    float3 d = float3(direction.x / info.CellSize, direction.y, direction.z / info.CellSize);
+    int2 step = int2(d.x >= 0.0f ? 1 : -1, d.z >= 0.0f ? 1 : -1);
+
+    // The pyramid is stored from the finest to the coarsest level, start at the single node covering the whole grid
+    uint mip = info.MipCount - 1;
+    uint mipOffset = c_HeightfieldInfoStructSize + ((info.Width * info.Depth + 1) / 2) * 4;
+    for (uint i = 0; i < mip; i++)
+    {
+        mipOffset += GetHeightfieldNodeCount(cellCount.x, i) * GetHeightfieldNodeCount(cellCount.y, i) * 4;
+    }
+
+    // Height ranges are padded so that rounding never rejects rays grazing flat regions
+    float2 heightPadding = float2(-1e-4f, 1e-4f) * max(info.HeightScale, 1.0f);
+
+    // Clip the ray to the bounds of the grid
+    float2 heightRange = LoadHeightfieldNode(heightfield, info, mipOffset, 0) + heightPadding;
+    float3 t0 = (float3(0.0f, heightRange.x, 0.0f) - o) / d;
+    float3 t1 = (float3(cellCount.x, heightRange.y, cellCount.y) - o) / d;
+    float3 tNear3 = min(t0, t1);
+    float3 tFar3 = max(t0, t1);
+    float tCurrent = max(tMin, max(max(tNear3.x, tNear3.y), tNear3.z));
+    float tEnd = min(tMax, min(min(tFar3.x, tFar3.y), tFar3.z));
+    if (tCurrent > tEnd)
+        return false;
+
+    int2 node = int2(0, 0);
+    for (uint iteration = 0; iteration < c_HeightfieldMaxIterations; iteration++)
+    {
+        int nodeSize = c_HeightfieldTileSize << mip;
+        uint nodeCountX = GetHeightfieldNodeCount(cellCount.x, mip);
+        float2 tExit = GetHeightfieldExitDistances(float2(node * nodeSize), nodeSize, o, d, step);
+        float tNodeExit = min(min(tExit.x, tExit.y), tEnd);
+
+        // Only nodes whose height range overlaps the part of the ray above them can contain a hit
+        float2 nodeRange = LoadHeightfieldNode(heightfield, info, mipOffset, node.y * nodeCountX + node.x) + heightPadding;
+        float yEnter = o.y + d.y * tCurrent;
+        float yExit = o.y + d.y * tNodeExit;
+        if (max(yEnter, yExit) >= nodeRange.x && min(yEnter, yExit) <= nodeRange.y)
+        {
+            if (mip > 0)
+            {
+                // Descend into the child the ray is currently in
+                mip--;
+                mipOffset -= GetHeightfieldNodeCount(cellCount.x, mip) * GetHeightfieldNodeCount(cellCount.y, mip) * 4;
+
+                int2 childCount = int2(GetHeightfieldNodeCount(cellCount.x, mip), GetHeightfieldNodeCount(cellCount.y, mip));
+                int2 child = int2(floor(float2(o.x + d.x * tCurrent, o.z + d.z * tCurrent) / float(nodeSize / 2)));
+                node = clamp(child, node * 2, min(node * 2 + 1, childCount - 1));
+                continue;
+            }
+
+            float3 gridNormal;
+            if (IntersectHeightfieldTile(heightfield, info, node, o, d, step, tCurrent, tNodeExit, tMin, tMax, t, gridNormal))
+            {
+                normal = normalize(float3(gridNormal.x / info.CellSize, gridNormal.y, gridNormal.z / info.CellSize));
+                return true;
+            }
+        }
+
+        if (tNodeExit >= tEnd)
+            return false;
+
+        // Step to the neighbouring node. Whenever the ray leaves the parent node go up a level, so that empty space is skipped in large steps
+        int2 parent = node >> 1;
+        if (tExit.x < tExit.y)
+            node.x += step.x;
+        else
+            node.y += step.y;
+
+        tCurrent = tNodeExit;
+
+        int2 nodeCount = int2(nodeCountX, GetHeightfieldNodeCount(cellCount.y, mip));
+        if (node.x < 0 || node.y < 0 || node.x >= nodeCount.x || node.y >= nodeCount.y)
+            return false;
+
+        if (mip + 1 < info.MipCount && ((node.x >> 1) != parent.x || (node.y >> 1) != parent.y))
+        {
+            mipOffset += nodeCount.x * nodeCount.y * 4;
+            mip++;
+            node = node >> 1;
+        }
+    }
+
+    return false;
+}
+
+// -----------------------------------------------------------------------
+// ------------------------ Light Sampling -------------------------------
+// -----------------------------------------------------------------------
+#ifndef HLSL
+typedef const LightBVHNode* LightBVHNodes;
+typedef const float* EmissiveCdf;
+
+inline LightBVHNode LoadLightBVHNode(LightBVHNodes nodes, uint i)
+{
+    return nodes[i];
+}
+
+inline float LoadEmissiveCdf(EmissiveCdf cdf, uint i)
+{
+    return cdf[i];
+}
+#endif // HLSL
+
+// -----------------------------------------------------------------------
+inline float SafeSqrt(float v)
+{
+    return sqrt(max(v, 0.0f));
+}
+
+// -----------------------------------------------------------------------
+// Cosine and sine of the difference of two angles, clamped to zero when the first angle is the smaller one
+inline float CosSubClamped(float sinThetaA, float cosThetaA, float sinThetaB, float cosThetaB)
+{
+    return cosThetaA > cosThetaB ? 1.0f : cosThetaA * cosThetaB + sinThetaA * sinThetaB;
+}
+
+inline float SinSubClamped(float sinThetaA, float cosThetaA, float sinThetaB, float cosThetaB)
+{
+    return cosThetaA > cosThetaB ? 0.0f : sinThetaA * cosThetaB - cosThetaA * sinThetaB;
+}
+
+// -----------------------------------------------------------------------
+// Conservative estimate of the light a node can deliver to a point, from "Importance Sampling of Many Lights with Adaptive
+// Tree Splitting" by Conty Estevez and Kulla as refined in pbrt-v4. The angles between the cone, the direction to the point
+// and the surface normal are each reduced by the angle the node's bounds subtend
+inline float GetLightBVHNodeImportance(LightBVHNode node, float3 position, float3 normal)
+{
+    float3 center = (node.BoundsMin + node.BoundsMax) * 0.5f;
+    float3 centerToPosition = position - center;
+    float centerDistanceSquared = dot(centerToPosition, centerToPosition);
+    float distanceSquared = max(max(centerDistanceSquared, length(node.BoundsMax - node.BoundsMin) * 0.5f), Epsilon);
+
+    float3 wi = centerToPosition * (centerDistanceSquared > 0.0f ? 1.0f / sqrt(centerDistanceSquared) : 0.0f);
+    float cosThetaW = dot(node.ConeAxis, wi);
+    float sinThetaW = SafeSqrt(1.0f - cosThetaW * cosThetaW);
+
+    // Points inside the bounding sphere can be reached from any direction
+    float3 radius = (node.BoundsMax - node.BoundsMin) * 0.5f;
+    float radiusSquared = dot(radius, radius);
+    float cosThetaB = centerDistanceSquared > radiusSquared ? SafeSqrt(1.0f - radiusSquared / centerDistanceSquared) : -1.0f;
+    float sinThetaB = SafeSqrt(1.0f - cosThetaB * cosThetaB);
+
+    float sinThetaO = SafeSqrt(1.0f - node.CosThetaO * node.CosThetaO);
+    float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, node.CosThetaO);
+    float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, node.CosThetaO);
+    float cosThetaP = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+    if (cosThetaP <= node.CosThetaE)
+        return 0.0f;
+
+    float cosThetaI = abs(dot(wi, normal));
+    float sinThetaI = SafeSqrt(1.0f - cosThetaI * cosThetaI);
+    float cosThetaIB = CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+
+    return max(node.Power * cosThetaP * cosThetaIB / distanceSquared, 0.0f);
+}
+
+// -----------------------------------------------------------------------
+// Descends the light BVH, entering each child with a probability proportional to its importance for the point. The random
+// number is rescaled at every level so one number suffices. Returns c_InvalidLightIndex when no light can reach the point
+inline uint SampleLightBVH(LightBVHNodes nodes, float3 position, float3 normal, float u, OUT_PARAM(float) pdf)
+{
+    pdf = 0.0f;
+
+    LightBVHNode node = LoadLightBVHNode(nodes, 0);
+    if (GetLightBVHNodeImportance(node, position, normal) <= 0.0f)
+        return c_InvalidLightIndex;
+
+    uint nodeIndex = 0;
+    float nodePdf = 1.0f;
+
+    while (node.IsLeaf == 0)
+    {
+        LightBVHNode child0 = LoadLightBVHNode(nodes, nodeIndex + 1);
+        LightBVHNode child1 = LoadLightBVHNode(nodes, node.ChildOrLightIndex);
+        float importance0 = GetLightBVHNodeImportance(child0, position, normal);
+        float importance1 = GetLightBVHNodeImportance(child1, position, normal);
+
+        if (importance0 <= 0.0f && importance1 <= 0.0f)
+            return c_InvalidLightIndex;
+
+        float probability0 = importance0 / (importance0 + importance1);
+        if (u < probability0)
+        {
+            u = min(u / probability0, c_OneMinusEpsilon);
+            nodePdf *= probability0;
+            nodeIndex = nodeIndex + 1;
+            node = child0;
+        }
+        else
+        {
+            u = min((u - probability0) / (1.0f - probability0), c_OneMinusEpsilon);
+            nodePdf *= 1.0f - probability0;
+            nodeIndex = node.ChildOrLightIndex;
+            node = child1;
+        }
+    }
+
+    pdf = nodePdf;
+    return node.ChildOrLightIndex;
+}
+
+// -----------------------------------------------------------------------
+// Binary search for the first of count CDF entries starting at offset that exceeds u. The last entry is exactly one, so an
+// entry is always found, and entries without any probability are never picked
+inline uint SampleEmissiveCdf(EmissiveCdf cdf, uint offset, uint count, float u, OUT_PARAM(float) pdf)
+{
+    uint first = 0;
+    uint last = count - 1;
+
+    while (first < last)
+    {
+        uint middle = (first + last) / 2;
+        if (LoadEmissiveCdf(cdf, offset + middle) > u)
+            last = middle;
+        else
+            first = middle + 1;
+    }
+
+    float previous = first > 0 ? LoadEmissiveCdf(cdf, offset + first - 1) : 0.0f;
+    pdf = LoadEmissiveCdf(cdf, offset + first) - previous;
+    return first;
+}
+
+#ifdef HLSL
+// -----------------------------------------------------------------------
+// Directional lights reach every point and are picked by power through the alias table, each of them is as likely as the
+// whole light BVH, which picks among the local lights by their estimated contribution to the point. Only directional lights
+// that emit are counted, so the alias table is never used when it holds no directional light to pick
+uint SampleLight(uint lightCount, float3 position, float3 normal, float u, out float pdf)
+{
+    uint directionalLightCount = g_ResourceIndices.DirectionalLightCount;
+    uint strategyCount = directionalLightCount + (g_ResourceIndices.LightBVHNodeCount > 0 ? 1 : 0);
+    if (strategyCount == 0)
+    {
+        pdf = 0.0f;
+        return c_InvalidLightIndex;
+    }
+
+    float directionalProbability = float(directionalLightCount) / float(strategyCount);
+    if (u < directionalProbability)
+    {
+        u = min(u / directionalProbability, c_OneMinusEpsilon);
+
+        uint entryIndex = GetLightAliasEntryIndex(lightCount, u);
+        LightAliasEntry entry = GetLightAliasEntry(entryIndex);
+
+        uint lightIndex = SampleLightAliasEntry(entry, entryIndex, lightCount, u);
+        pdf = GetLightAliasEntryPdf(entry, entryIndex, lightIndex) * directionalProbability;
+        return lightIndex;
+    }
+
+    u = min((u - directionalProbability) / (1.0f - directionalProbability), c_OneMinusEpsilon);
+
+    uint lightIndex = SampleLightBVH(g_ResourceIndices.LightBVHOffset, position, normal, u, pdf);
+    pdf *= 1.0f - directionalProbability;
+    return lightIndex;
+}
+
+// -----------------------------------------------------------------------
+// Picks an emitter by power with u.x, a triangle on it by area with u.y and a uniform point on the triangle with u.zw. Returns
+// the emitted radiance towards the position and the solid angle pdf of the sample, which is zero when the sampled point
+// faces away. One sided emitters shine to the side their vertex normals point to, the side back face culling keeps
+float3 SampleEmissiveTriangle(float3 position, float4 u, out float3 direction, out float distance, out float pdf)
+{
+    direction = float3(0.0, 0.0, 0.0);
+    distance = 0.0;
+    pdf = 0.0;
+
+    float instancePdf;
+    uint instanceIndex = SampleEmissiveCdf(g_ResourceIndices.EmissiveCdfOffset, 0, g_ResourceIndices.EmissiveInstanceCount, u.x, instancePdf);
+    EmissiveInstance instance = GetEmissiveInstance(instanceIndex);
+
+    float trianglePdf;
+    uint triangleIndex = SampleEmissiveCdf(g_ResourceIndices.EmissiveCdfOffset, instance.TriangleCdfOffset, instance.TriangleCount, u.y, trianglePdf);
+
+    GeometryConstants geometry = GetMesh(instance.GeometryIndex);
+    Triangle tri = GetTriangle(geometry, triangleIndex);
+
+    float3x4 objectToWorld = float3x4(instance.ObjectToWorld[0], instance.ObjectToWorld[1], instance.ObjectToWorld[2]);
+    float3 p0 = mul(objectToWorld, float4(tri.V0.Position, 1.0));
+    float3 p1 = mul(objectToWorld, float4(tri.V1.Position, 1.0));
+    float3 p2 = mul(objectToWorld, float4(tri.V2.Position, 1.0));
+
+    // The triangle CDF is built from object space areas, the pdf uses the world space area so it stays exact under non uniform scaling
+    float3 normal = cross(p1 - p0, p2 - p0);
+    float area = 0.5 * length(normal);
+    if (area <= 0.0)
+        return float3(0.0, 0.0, 0.0);
+
+    float sqrtU = sqrt(u.z);
+    float3 bary = float3(1.0 - sqrtU, sqrtU * (1.0 - u.w), sqrtU * u.w);
+    float3 lightPosition = bary.x * p0 + bary.y * p1 + bary.z * p2;
+
+    float3 vertexNormal = mul((float3x3)objectToWorld, bary.x * tri.V0.Normal + bary.y * tri.V1.Normal + bary.z * tri.V2.Normal);
+    normal = FaceForward(-vertexNormal, normal / (2.0 * area));
+
+    float3 toLight = lightPosition - position;
+    float distanceSquared = dot(toLight, toLight);
+    if (distanceSquared <= Epsilon)
+        return float3(0.0, 0.0, 0.0);
+
+    distance = sqrt(distanceSquared);
+    direction = toLight / distance;
+
+    float cosLight = -dot(normal, direction);
+    if (instance.IsTwoSided)
+        cosLight = abs(cosLight);
+
+    if (cosLight <= 0.0)
+        return float3(0.0, 0.0, 0.0);
+
+    pdf = instancePdf * trianglePdf / area * distanceSquared / cosLight;
+    return GetMeshMaterial(geometry.MaterialIndex).EmissiveColor.rgb;
+}
+#endif // HLSL
+
+#ifndef HLSL
+// Shaders load these structs from raw buffers with the strides above, which have to match the layout the CPU uploads
+static_assert(sizeof(Vertex) == c_VertexStructSize);
+static_assert(sizeof(SceneConstants) == c_SceneConstantsStructSize);
+static_assert(sizeof(MaterialConstants) == c_MaterialConstantsStructSize);
+static_assert(sizeof(GeometryConstants) == c_GeometryConstantsStructSize);
+static_assert(sizeof(PrimitiveAttributes) == c_PrimitiveAttributesStructSize);
+static_assert(sizeof(HeightfieldInfo) == c_HeightfieldInfoStructSize);
+static_assert(sizeof(Light) == c_LightStructSize);
+static_assert(sizeof(LightAliasEntry) == c_LightAliasEntryStructSize);
+static_assert(sizeof(LightBVHNode) == c_LightBVHNodeStructSize);
+static_assert(sizeof(EmissiveInstance) == c_EmissiveInstanceStructSize);
+static_assert(sizeof(VirtualTextureInfo) == c_VirtualTextureInfoStructSize);
+
+// The bind table is read as a constant buffer, where every nested struct starts on a 16 byte register. Without the same
+// alignment on the C++ side the root constants would end up at different offsets than the shaders read them from
+static_assert(offsetof(ResourceBindTable, VirtualTextureConstants) % 16 == 0);
+static_assert(offsetof(ResourceBindTable, BloomDownsampleConstants) % 16 == 0);
+static_assert(offsetof(ResourceBindTable, BloomUpsampleConstants) % 16 == 0);
+static_assert(offsetof(ResourceBindTable, BloomCompositeConstants) % 16 == 0);
+static_assert(offsetof(ResourceBindTable, TonemapConstants) % 16 == 0);
+static_assert(sizeof(VirtualTextureConstants) % 16 == 0);
+static_assert(sizeof(BloomDownsampleConstants) % 16 == 0);
+static_assert(sizeof(BloomUpsampleConstants) % 16 == 0);
+static_assert(sizeof(BloomCompositeConstants) % 16 == 0);
+static_assert(sizeof(TonemapConstants) % 16 == 0);
 #endif // HLSL
 
 #endif // __BINDLESS_RESOURCES_H__
\ No newline at end of file
@@ -17,7 +17,7 @@ void RayGenShader()
     RWTexture2D<float4> renderTarget = g_RWTextures[g_ResourceIndices.RenderTargetIndex];
     RWTexture2D<float4> prevFrameRenderTarget = g_RWTextures[g_ResourceIndices.PrevFrameRenderTargetIndex];
     
-    SceneConstants sceneConstants = g_Buffers[g_ResourceIndices.SceneBufferIndex].Load<SceneConstants>(0);
+    SceneConstants sceneConstants = GetSceneConstants();
     RaytracingAccelerationStructure accelerationStructure = g_AccelerationStructures[g_ResourceIndices.AccelerationStructureIndex];
     
     if (sceneConstants.FrameIndex == 1)
@@ -41,34 +41,56 @@ void RayGenShader()
     renderTarget[rayID.xy] = ((sceneConstants.FrameIndex - 1) * prevFrameRenderTarget[rayID.xy] + payload.Color) / sceneConstants.FrameIndex;
 }
 
-[shader("closesthit")]
-void ClosestHitShader_Color(inout ColorRayPayload payload, in BuiltInTriangleIntersectionAttributes attr)
+void ShadeHit(inout ColorRayPayload payload, SceneConstants sceneConstants, HitInfo hitInfo)
 {
-    SceneConstants sceneConstants = g_Buffers[g_ResourceIndices.SceneBufferIndex].Load<SceneConstants>(0);
     RaytracingAccelerationStructure accelerationStructure = g_AccelerationStructures[g_ResourceIndices.AccelerationStructureIndex];
     
-    HitInfo hitInfo = GetHitInfo(sceneConstants, attr);
-    
-    MaterialConstants material = GetMeshMaterial(InstanceID(), g_ResourceIndices.MaterialBufferIndex);
+    GeometryConstants geometry = GetMesh(InstanceID());
+    MaterialConstants material = GetMeshMaterial(geometry.MaterialIndex);
     hitInfo.Sample.TexCoord /= material.AlbedoMapScaling; // not correct fuck it
     if (material.NormalMapIndex != INVALID_DESCRIPTOR_INDEX)
     {
         ApplyNormalMap(g_Textures[material.NormalMapIndex], hitInfo);
     }
     
-    float4 albedo = material.AlbedoMapIndex != INVALID_DESCRIPTOR_INDEX ? SampleTextureGrad(g_Textures[material.AlbedoMapIndex], material.AlbedoSamplerType, hitInfo.Sample) : material.AlbedoColor;
+    float4 albedo = material.AlbedoColor;
+    if (material.AlbedoVirtualTextureIndex != INVALID_DESCRIPTOR_INDEX)
+    {
+        albedo = SampleVirtualTexture(material.AlbedoVirtualTextureIndex, material.AlbedoSamplerType, hitInfo.Sample, material.AlbedoColor);
+    }
+    else if (material.AlbedoMapIndex != INVALID_DESCRIPTOR_INDEX)
+    {
+        albedo = SampleTextureGrad(g_Textures[material.AlbedoMapIndex], material.AlbedoSamplerType, hitInfo.Sample);
+    }
+    else if (material.AlbedoProceduralType != ProceduralTextureType::NotProcedural)
+    {
+        albedo = EvaluateProceduralTexture(material.AlbedoProceduralType, material.AlbedoProceduralColorA, material.AlbedoProceduralColorB, hitInfo.Sample);
+    }
+
+    float roughness = material.Roughness;
+    float metalness = material.Metalness;
+    if (material.MaterialType == MaterialType::PBR)
+    {
+        roughness = material.RoughnessMapIndex != INVALID_DESCRIPTOR_INDEX ? SampleTextureGrad(g_Textures[material.RoughnessMapIndex], g_LinearWrapSampler, hitInfo.Sample).r : material.Roughness;
+        metalness = material.MetalnessMapIndex != INVALID_DESCRIPTOR_INDEX ? SampleTextureGrad(g_Textures[material.MetalnessMapIndex], g_LinearWrapSampler, hitInfo.Sample).r : material.Metalness;
+    }
+
     float3 finalColor = float3(0.0, 0.0, 0.0);
     
-    finalColor += material.EmissiveColor.rgb;
+    // Diffuse bounces skip the emission of triangles, those are sampled directly. Emissive primitives can only be hit by chance
+    if (!payload.SkipEmission || geometry.PrimitiveType != PrimitiveType::NotPrimitive)
+        finalColor += material.EmissiveColor.rgb;
+
+    // Direct lighting. Pick a light by its estimated contribution to the hit point, none is picked when no light can reach it
+    float lightSampleProbability = 0.0;
+    uint lightIndex = c_InvalidLightIndex;
 
-    // Direct lighting
     if (sceneConstants.NumLights > 0)
+        lightIndex = SampleLight(sceneConstants.NumLights, hitInfo.WorldPosition, hitInfo.WorldNormal, RandomFloat(payload.Seed), lightSampleProbability);
+
+    if (lightSampleProbability > 0.0)
     {
-        // Pick a random light
-        uint lightIndex = min(int(RandomFloat(payload.Seed) * sceneConstants.NumLights), sceneConstants.NumLights - 1);
-        float lightSampleProbability = 1.0 / float(sceneConstants.NumLights);
-        
-        Light light = GetLight(lightIndex, g_ResourceIndices.LightsBufferIndex);
+        Light light = GetLight(lightIndex);
 
         // Check if the surface is in shadow
         float3 shadowRayDirection = normalize(light.Position - hitInfo.WorldPosition);
@@ -77,31 +99,54 @@ void ClosestHitShader_Color(inout ColorRayPayload payload, in BuiltInTriangleInt
         bool isVisible = TraceShadowRay(hitInfo.WorldPosition, shadowRayDirection, shadowRayMaxDistance, accelerationStructure);
             
         // Calculate lighting  
+        float3 directLighting = float3(0.0, 0.0, 0.0);
         switch (material.MaterialType)
         {
             case MaterialType::Lambert:
             {
-                finalColor += CalculateDirectLighting_Lambert(hitInfo, light, albedo.rgb);
+                directLighting = CalculateDirectLighting_Lambert(hitInfo, light, albedo.rgb);
                 break;
             }
             case MaterialType::Phong:
             {
                 float4 specular = material.SpecularColor;
                 float shininess = material.Shininess;
-                finalColor += CalculateDirectLighting_Phong(hitInfo, WorldRayOrigin(), light, albedo.rgb, specular.rgb, shininess);
+                directLighting = CalculateDirectLighting_Phong(hitInfo, WorldRayOrigin(), light, albedo.rgb, specular.rgb, shininess);
                 break;
             }
             case MaterialType::PBR:
             {
-                float roughness = material.RoughnessMapIndex != INVALID_DESCRIPTOR_INDEX ? SampleTextureGrad(g_Textures[material.RoughnessMapIndex], g_LinearWrapSampler, hitInfo.Sample).r : material.Roughness;
-                float metalness = material.MetalnessMapIndex != INVALID_DESCRIPTOR_INDEX ? SampleTextureGrad(g_Textures[material.MetalnessMapIndex], g_LinearWrapSampler, hitInfo.Sample).r : material.Metalness;
-                finalColor += CalculateDirectLighting_PBR(hitInfo, WorldRayOrigin(), light, albedo.rgb, roughness, metalness);
+                directLighting = CalculateDirectLighting_PBR(hitInfo, WorldRayOrigin(), light, albedo.rgb, roughness, metalness);
                 break;
             }
         }
             
-        finalColor *= isVisible;
-        finalColor /= lightSampleProbability;
+        // Emission is not part of the light sample, so only the sampled lighting is weighted by its probability
+        finalColor += directLighting * isVisible / lightSampleProbability;
+    }
+
+    // Emissive triangles. They only light the diffuse lobe here, the specular lobes keep finding them through their own rays
+    if (g_ResourceIndices.EmissiveInstanceCount > 0)
+    {
+        float4 u = float4(RandomFloat(payload.Seed), RandomFloat(payload.Seed), RandomFloat(payload.Seed), RandomFloat(payload.Seed));
+
+        float3 emitterDirection;
+        float emitterDistance;
+        float emitterPdf;
+        float3 emission = SampleEmissiveTriangle(hitInfo.WorldPosition, u, emitterDirection, emitterDistance, emitterPdf);
+
+        float NDotL = dot(hitInfo.WorldNormal, emitterDirection);
+        if (emitterPdf > 0.0 && NDotL > 0.0)
+        {
+            // Stop the shadow ray short of the emitter so that it does not hit the sampled triangle itself
+            bool isVisible = TraceShadowRay(hitInfo.WorldPosition, emitterDirection, emitterDistance * 0.999, accelerationStructure);
+
+            float3 diffuseBRDF = albedo.rgb / PI;
+            if (material.MaterialType == MaterialType::PBR)
+                diffuseBRDF *= CalculateDiffuseWeight_PBR(hitInfo, WorldRayOrigin(), emitterDirection, albedo.rgb, metalness);
+
+            finalColor += diffuseBRDF * emission * NDotL * isVisible / emitterPdf;
+        }
     }
 
     // Indirect Light
@@ -121,8 +166,6 @@ void ClosestHitShader_Color(inout ColorRayPayload payload, in BuiltInTriangleInt
         }
         case MaterialType::PBR:
         {
-            float roughness = material.RoughnessMapIndex != INVALID_DESCRIPTOR_INDEX ? SampleTextureGrad(g_Textures[material.RoughnessMapIndex], g_LinearWrapSampler, hitInfo.Sample).r : material.Roughness;
-            float metalness = material.MetalnessMapIndex != INVALID_DESCRIPTOR_INDEX ? SampleTextureGrad(g_Textures[material.MetalnessMapIndex], g_LinearWrapSampler, hitInfo.Sample).r : material.Metalness;
             finalColor += CalculateIndirectLighting_PBR(hitInfo, payload.Seed, payload.RayDepth, WorldRayOrigin(), albedo.rgb, roughness, metalness, accelerationStructure);
             break;
         }
@@ -162,6 +205,39 @@ void ClosestHitShader_Color(inout ColorRayPayload payload, in BuiltInTriangleInt
     payload.Color.rgb += finalColor;
 }
 
+[shader("closesthit")]
+void ClosestHitShader_Color(inout ColorRayPayload payload, in BuiltInTriangleIntersectionAttributes attr)
+{
+    SceneConstants sceneConstants = GetSceneConstants();
+    ShadeHit(payload, sceneConstants, GetHitInfo(sceneConstants, attr));
+}
+
+[shader("closesthit")]
+void ClosestHitShader_Primitive(inout ColorRayPayload payload, in PrimitiveAttributes attr)
+{
+    SceneConstants sceneConstants = GetSceneConstants();
+    ShadeHit(payload, sceneConstants, GetPrimitiveHitInfo(sceneConstants, attr));
+}
+
+[shader("intersection")]
+void IntersectionShader_Primitive()
+{
+    GeometryConstants geometry = GetMesh(InstanceID());
+
+    float t;
+    PrimitiveAttributes attr;
+    bool hit;
+    if (geometry.PrimitiveType == PrimitiveType::Heightfield)
+        hit = IntersectHeightfield(geometry.VertexBufferIndex, geometry.PrimitiveCenter, ObjectRayOrigin(), ObjectRayDirection(), RayTMin(), RayTCurrent(), t, attr.Normal);
+    else
+        hit = IntersectPrimitive(geometry, ObjectRayOrigin(), ObjectRayDirection(), RayTMin(), RayTCurrent(), t, attr.Normal);
+
+    if (hit)
+    {
+        ReportHit(t, 0, attr);
+    }
+}
+
 [shader("miss")]
 void MissShader_Color(inout ColorRayPayload payload)
 {
@@ -1,28 +1,53 @@
 #include "texture.h"
 #include "core/utils.h"
 #include "rendering/graphicscontext.h"
+#include "rendering/shaders/resources.h"
 
 #include <DirectXTex.h>
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 Texture::Texture(const TextureDescription& description, const wchar_t* debugName)
-    : Asset(AssetType::Texture), m_Description(description), m_SamplerType(SamplerType::LinearClamp), m_Scaling(1.0f)
+    : Asset(AssetType::Texture), m_Description(description), m_ProceduralDescription(), m_SRVDescriptor(InvalidDescriptorIndex), m_SamplerType(SamplerType::LinearClamp), m_Scaling(1.0f), m_PixelDataOffset(0)
 {
-    CreateGPU(debugName);
+    // Virtual textures are streamed page by page from their asset file by the virtual texture system
+    if (!m_Description.IsVirtual)
+    {
+        CreateGPU(debugName);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+Texture::Texture(const TextureDescription& description, ID3D12Heap* heap, uint64_t heapOffset, const wchar_t* debugName)
+    : Asset(AssetType::Texture), m_Description(description), m_ProceduralDescription(), m_SRVDescriptor(InvalidDescriptorIndex), m_SamplerType(SamplerType::LinearClamp), m_Scaling(1.0f), m_PixelDataOffset(0)
+{
+    // Placed textures share the memory of the heap with other textures, the owner of the heap decides when they are alive
+    HEXRAY_ASSERT(heap && !m_Description.IsVirtual);
+    CreateGPU(debugName, heap, heapOffset);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+Texture::Texture(const ProceduralTextureDescription& description)
+    : Asset(AssetType::Texture), m_ProceduralDescription(description), m_SRVDescriptor(InvalidDescriptorIndex), m_SamplerType(SamplerType::PointWrap), m_Scaling(1.0f), m_PixelDataOffset(0)
+{
+    // Procedural textures are evaluated analytically in the shaders from the material constants and have no GPU resource
+    m_Description.IsProcedural = true;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 Texture::~Texture()
 {
+    if (m_Description.IsVirtual || m_Description.IsProcedural)
+        return;
+
     if ((m_Description.Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE) == 0)
     {
-        GraphicsContext::GetInstance()->GetResourceDescriptorHeap()->ReleaseDescriptor(m_SRVDescriptor, ROTexture2D, true);
+        GraphicsContext::GetInstance()->GetResourceDescriptorHeap()->ReleaseDescriptor(m_SRVDescriptor, m_Description.IsCubeMap ? ROTextureCube : ROTexture2D, true);
     }
 
     if (m_Description.Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
     {
         for (uint32_t mip = 0; mip < m_Description.MipLevels; mip++)
-            GraphicsContext::GetInstance()->GetResourceDescriptorHeap()->ReleaseDescriptor(m_MipUAVDescriptors[mip], RWTexture2D, true);
+            GraphicsContext::GetInstance()->GetResourceDescriptorHeap()->ReleaseDescriptor(m_MipUAVDescriptors[mip], m_Description.IsCubeMap ? RWTextureCube : RWTexture2D, true);
     }
 
     if (m_Description.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
@@ -41,28 +66,26 @@ Texture::~Texture()
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Texture::CreateGPU(const wchar_t* debugName)
+void Texture::CreateGPU(const wchar_t* debugName, ID3D12Heap* heap, uint64_t heapOffset)
 {
     auto d3dDevice = GraphicsContext::GetInstance()->GetDevice();
 
-    D3D12_RESOURCE_DESC resourceDesc = {};
-    resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    resourceDesc.Format = m_Description.Format;
-    resourceDesc.Width = m_Description.Width;
-    resourceDesc.Height = m_Description.Height;
-    resourceDesc.DepthOrArraySize = m_Description.IsCubeMap ? 6 : m_Description.ArrayLevels;
-    resourceDesc.MipLevels = m_Description.MipLevels;
-    resourceDesc.SampleDesc.Count = 1;
-    resourceDesc.SampleDesc.Quality = 0;
-    resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-    resourceDesc.Flags = m_Description.Flags;
-
+    D3D12_RESOURCE_DESC resourceDesc = GetResourceDescription(m_Description);
     D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
     D3D12_RESOURCE_STATES initialState = m_Description.InitialState;
 
     bool isRenderTargetOrDepthBuffer = (m_Description.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) || (m_Description.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
-    DXCall(d3dDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, initialState,
-        isRenderTargetOrDepthBuffer ? &m_Description.ClearValue : nullptr, IID_PPV_ARGS(&m_Resource)));
+    if (heap)
+    {
+        DXCall(d3dDevice->CreatePlacedResource(heap, heapOffset, &resourceDesc, initialState,
+            isRenderTargetOrDepthBuffer ? &m_Description.ClearValue : nullptr, IID_PPV_ARGS(&m_Resource)));
+    }
+    else
+    {
+        DXCall(d3dDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, initialState,
+            isRenderTargetOrDepthBuffer ? &m_Description.ClearValue : nullptr, IID_PPV_ARGS(&m_Resource)));
+    }
+
     DXCall(m_Resource->SetName(debugName));
 
     CreateViews();
@@ -71,6 +94,8 @@ void Texture::CreateGPU(const wchar_t* debugName)
 // ------------------------------------------------------------------------------------------------------------------------------------
 void Texture::UploadGPUData(uint8_t* pixels, bool keepCPUData)
 {
+    HEXRAY_ASSERT_MSG(!m_Description.IsVirtual && !m_Description.IsProcedural, "Virtual and procedural textures don't own GPU memory");
+
     size_t offset = 0;
     for (uint32_t level = 0; level < m_Description.ArrayLevels; level++)
     {
@@ -92,13 +117,23 @@ void Texture::UploadGPUData(uint8_t* pixels, bool keepCPUData)
     }
 }
 
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Texture::MakeResident(uint8_t* pixels, const wchar_t* debugName)
+{
+    HEXRAY_ASSERT_MSG(m_Description.IsVirtual, "Only virtual textures are missing their GPU memory");
+
+    m_Description.IsVirtual = false;
+    CreateGPU(debugName);
+    UploadGPUData(pixels);
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 DescriptorIndex Texture::GetSRV()
 {
-    if (m_Description.Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE)
+    if (m_Description.IsVirtual || m_Description.IsProcedural || (m_Description.Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE))
         return InvalidDescriptorIndex;
 
-    return m_SRVDescriptor;
+    return GetDescriptorSlot(m_SRVDescriptor);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -125,7 +160,24 @@ DescriptorIndex Texture::GetUAV(uint32_t mip)
     if ((m_Description.Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS) == 0)
         return InvalidDescriptorIndex;
 
-    return m_MipUAVDescriptors[mip];
+    return GetDescriptorSlot(m_MipUAVDescriptors[mip]);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+D3D12_RESOURCE_DESC Texture::GetResourceDescription(const TextureDescription& description)
+{
+    D3D12_RESOURCE_DESC resourceDesc = {};
+    resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    resourceDesc.Format = description.Format;
+    resourceDesc.Width = description.Width;
+    resourceDesc.Height = description.Height;
+    resourceDesc.DepthOrArraySize = description.IsCubeMap ? 6 : description.ArrayLevels;
+    resourceDesc.MipLevels = description.MipLevels;
+    resourceDesc.SampleDesc.Count = 1;
+    resourceDesc.SampleDesc.Quality = 0;
+    resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    resourceDesc.Flags = description.Flags;
+    return resourceDesc;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
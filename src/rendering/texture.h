@@ -7,7 +7,10 @@
 
 #include "directx12.h"
 
+#include <glm.hpp>
+
 enum SamplerType;
+enum ProceduralTextureType;
 
 struct TextureDescription
 {
@@ -20,22 +23,38 @@ struct TextureDescription
     D3D12_CLEAR_VALUE ClearValue = {};
     D3D12_RESOURCE_STATES InitialState = D3D12_RESOURCE_STATE_COMMON;
     bool IsCubeMap = false;
+    bool IsVirtual = false;
+    bool IsProcedural = false;
+};
+
+struct ProceduralTextureDescription
+{
+    ProceduralTextureType Type;
+    glm::vec4 ColorA = glm::vec4(1.0f);
+    glm::vec4 ColorB = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 };
 
 class Texture : public Asset
 {
+    friend class AssetSerializer;
 public:
     Texture(const TextureDescription& description, const wchar_t* debugName = L"Unnamed Texture");
+    Texture(const TextureDescription& description, ID3D12Heap* heap, uint64_t heapOffset, const wchar_t* debugName = L"Unnamed Texture");
+    Texture(const ProceduralTextureDescription& description);
     ~Texture();
 
     void UploadGPUData(uint8_t* pixels, bool keepCPUData = false);
 
+    // Turns a virtual texture into a regular one holding all of its pixels, for uses that can't be streamed page by page
+    void MakeResident(uint8_t* pixels, const wchar_t* debugName = L"Unnamed Texture");
+
     inline void SetSamplerType(SamplerType type) { m_SamplerType = type; }
     inline SamplerType GetSamplerType() const { return m_SamplerType; }
 
     inline void SetScaling(float scaling) { m_Scaling = scaling; }
     inline float GetScaling() const { return m_Scaling; }
 
+    // Shader resource and unordered access views return the slot shaders index the bindless tables with
     DescriptorIndex GetSRV();
     DescriptorIndex GetRTV(uint32_t mip);
     DescriptorIndex GetDSV(uint32_t mip);
@@ -50,13 +69,20 @@ public:
     inline const D3D12_CLEAR_VALUE& GetClearValue() const { return m_Description.ClearValue; }
     inline D3D12_RESOURCE_STATES GetInitialState() const { return m_Description.InitialState; }
     inline bool IsCubeMap() const { return m_Description.IsCubeMap; }
+    inline bool IsVirtual() const { return m_Description.IsVirtual; }
+    inline bool IsProcedural() const { return m_Description.IsProcedural; }
+    inline const ProceduralTextureDescription& GetProceduralDescription() const { return m_ProceduralDescription; }
+    inline uint64_t GetPixelDataOffset() const { return m_PixelDataOffset; }
     inline const ComPtr<ID3D12Resource2>& GetResource() const { return m_Resource; }
     inline const std::vector<uint8_t>& GetPixels() const { return m_Pixels; }
+
+    static D3D12_RESOURCE_DESC GetResourceDescription(const TextureDescription& description);
 private:
-    void CreateGPU(const wchar_t* debugName = L"Unnamed Texture");
+    void CreateGPU(const wchar_t* debugName = L"Unnamed Texture", ID3D12Heap* heap = nullptr, uint64_t heapOffset = 0);
     void CreateViews();
 private:
     TextureDescription m_Description;
+    ProceduralTextureDescription m_ProceduralDescription;
     ComPtr<ID3D12Resource2> m_Resource;
     DescriptorIndex m_SRVDescriptor;
     SamplerType m_SamplerType;
@@ -65,4 +91,5 @@ private:
     std::vector<DescriptorIndex> m_MipRTVDescriptors;
     std::vector<DescriptorIndex> m_MipDSVDescriptors;
     std::vector<uint8_t> m_Pixels;
+    uint64_t m_PixelDataOffset;
 };
@@ -0,0 +1,79 @@
+#include "texturepool.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static bool IsCompatibleTexture(const Texture& texture, const TextureDescription& description)
+{
+    return texture.GetFormat() == description.Format && texture.GetMipLevels() == description.MipLevels && texture.GetArrayLevels() == description.ArrayLevels &&
+        texture.GetFlags() == description.Flags && texture.GetInitialState() == description.InitialState && texture.IsCubeMap() == description.IsCubeMap;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+std::shared_ptr<Texture> TexturePool::Acquire(const TextureDescription& description, const std::wstring& debugName)
+{
+    HEXRAY_ASSERT(!description.IsVirtual && !description.IsProcedural);
+
+    // Take the smallest free texture that can serve the request
+    auto bestIt = m_FreeTextures.end();
+    uint64_t bestArea = UINT64_MAX;
+
+    for (auto it = m_FreeTextures.begin(); it != m_FreeTextures.end(); it++)
+    {
+        const Texture* texture = it->Texture.get();
+        if (!IsCompatibleTexture(*texture, description) ||
+            !TexturePoolPolicy::CanServe(texture->GetWidth(), texture->GetHeight(), description.Width, description.Height))
+            continue;
+
+        uint64_t area = (uint64_t)texture->GetWidth() * texture->GetHeight();
+        if (area < bestArea)
+        {
+            bestIt = it;
+            bestArea = area;
+        }
+    }
+
+    if (bestIt != m_FreeTextures.end())
+    {
+        std::shared_ptr<Texture> texture = bestIt->Texture;
+        m_FreeTextures.erase(bestIt);
+        return texture;
+    }
+
+    // Nothing fits, allocate at bucket size so the next resizes within the bucket reuse the texture
+    TextureDescription bucketDescription = description;
+    bucketDescription.Width = TexturePoolPolicy::GetBucketSize(description.Width);
+    bucketDescription.Height = TexturePoolPolicy::GetBucketSize(description.Height);
+
+    return std::make_shared<Texture>(bucketDescription, debugName.c_str());
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void TexturePool::Release(std::shared_ptr<Texture>& texture)
+{
+    if (!texture)
+        return;
+
+    // The texture may still be used by frames in flight. Frames execute in order on the graphics queue, so it is safe
+    // for the next owner to write it
+    m_FreeTextures.push_back({ texture, m_FrameCounter });
+    texture = nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void TexturePool::Update()
+{
+    m_FrameCounter++;
+
+    // Destroying the texture releases its resource deferred
+    auto it = std::remove_if(m_FreeTextures.begin(), m_FreeTextures.end(), [this](const PooledTexture& pooledTexture)
+    {
+        return TexturePoolPolicy::ShouldEvict(pooledTexture.LastUsedFrame, m_FrameCounter);
+    });
+
+    m_FreeTextures.erase(it, m_FreeTextures.end());
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void TexturePool::Clear()
+{
+    m_FreeTextures.clear();
+}
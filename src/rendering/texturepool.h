@@ -0,0 +1,28 @@
+#pragma once
+
+#include "core/core.h"
+#include "rendering/texture.h"
+#include "rendering/texturepoolpolicy.h"
+
+// Recycles GPU textures that are recreated whenever the viewport changes. Released textures stay in the pool and are handed
+// out again for any request the policy allows, textures that are not requested again for a while are released for real.
+// Pooled textures can be larger than requested, users render to the requested size in the top left corner
+class TexturePool
+{
+public:
+    std::shared_ptr<Texture> Acquire(const TextureDescription& description, const std::wstring& debugName);
+    void Release(std::shared_ptr<Texture>& texture);
+    void Update();
+    void Clear();
+
+    inline uint32_t GetFreeTextureCount() const { return m_FreeTextures.size(); }
+private:
+    struct PooledTexture
+    {
+        std::shared_ptr<Texture> Texture;
+        uint64_t LastUsedFrame = 0;
+    };
+private:
+    std::vector<PooledTexture> m_FreeTextures;
+    uint64_t m_FrameCounter = 0;
+};
@@ -0,0 +1,25 @@
+#include "texturepoolpolicy.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t TexturePoolPolicy::GetBucketSize(uint32_t size)
+{
+    return std::max(Align(size, BucketGranularity), BucketGranularity);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool TexturePoolPolicy::CanServe(uint32_t allocationWidth, uint32_t allocationHeight, uint32_t requestedWidth, uint32_t requestedHeight)
+{
+    if (allocationWidth < requestedWidth || allocationHeight < requestedHeight)
+        return false;
+
+    // Compared against the bucket of the request, so an allocation of exactly that bucket is always usable
+    uint64_t allocationArea = (uint64_t)allocationWidth * allocationHeight;
+    uint64_t bucketArea = (uint64_t)GetBucketSize(requestedWidth) * GetBucketSize(requestedHeight);
+    return allocationArea * 100 <= bucketArea * MaxWastedAreaPercent;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool TexturePoolPolicy::ShouldEvict(uint64_t lastUsedFrame, uint64_t currentFrame)
+{
+    return currentFrame - lastUsedFrame > EvictionFrameCount;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "core/core.h"
+
+// Decides how large pooled textures are allocated and which pooled allocation can serve a request. Sizes are rounded up to
+// buckets, so resizing within a bucket keeps the same allocation and only a sub-viewport of the texture is rendered to.
+// Allocations larger than the request are reused as long as they don't waste too much memory
+class TexturePoolPolicy
+{
+public:
+    static constexpr uint32_t BucketGranularity = 256;
+    static constexpr uint32_t MaxWastedAreaPercent = 150;
+    static constexpr uint64_t EvictionFrameCount = 240;
+
+    static uint32_t GetBucketSize(uint32_t size);
+    static bool CanServe(uint32_t allocationWidth, uint32_t allocationHeight, uint32_t requestedWidth, uint32_t requestedHeight);
+    static bool ShouldEvict(uint64_t lastUsedFrame, uint64_t currentFrame);
+};
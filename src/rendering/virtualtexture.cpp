@@ -0,0 +1,625 @@
+#include "virtualtexture.h"
+
+#include "rendering/graphicscontext.h"
+
+static const uint32_t s_TexelSize = 4;
+static const uint32_t s_PageUploadRowPitch = Align(c_VirtualPagePhysicalSize * s_TexelSize, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+static const uint32_t s_PageUploadSize = Align(s_PageUploadRowPitch * c_VirtualPagePhysicalSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+// Textures whose coarsest page level fits in this many pages keep it resident so that sampling always has a fallback
+static const uint32_t s_MaxPinnedPagesPerTexture = 4;
+
+bool VirtualTextureSystem::ms_Initialized = false;
+VirtualTextureSystemDescription VirtualTextureSystem::ms_Description;
+VirtualTextureStats VirtualTextureSystem::ms_Stats;
+VirtualTexturePageCache VirtualTextureSystem::ms_PageCache;
+std::vector<VirtualTextureSystem::VirtualTexture> VirtualTextureSystem::ms_VirtualTextures;
+std::unordered_map<Uuid, uint32_t> VirtualTextureSystem::ms_VirtualTextureIndices;
+std::vector<uint32_t> VirtualTextureSystem::ms_PageTable;
+std::vector<uint32_t> VirtualTextureSystem::ms_ResidentSlots;
+std::vector<VirtualTextureSystem::PhysicalPage> VirtualTextureSystem::ms_PhysicalPages;
+std::vector<uint32_t> VirtualTextureSystem::ms_FreePhysicalPages;
+std::vector<VirtualTextureSystem::PageRequest> VirtualTextureSystem::ms_PinnedRequests;
+uint64_t VirtualTextureSystem::ms_FrameCounter = 0;
+uint32_t VirtualTextureSystem::ms_FeedbackStamps[FRAMES_IN_FLIGHT] = {};
+std::shared_ptr<Texture> VirtualTextureSystem::ms_PageAtlas = nullptr;
+std::shared_ptr<Buffer> VirtualTextureSystem::ms_FeedbackBuffer = nullptr;
+std::shared_ptr<Buffer> VirtualTextureSystem::ms_ReadbackBuffers[FRAMES_IN_FLIGHT] = {};
+std::shared_ptr<Buffer> VirtualTextureSystem::ms_PageTableBuffers[FRAMES_IN_FLIGHT] = {};
+std::shared_ptr<Buffer> VirtualTextureSystem::ms_InfoBuffers[FRAMES_IN_FLIGHT] = {};
+std::shared_ptr<Buffer> VirtualTextureSystem::ms_UploadBuffers[FRAMES_IN_FLIGHT] = {};
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+VirtualTexturePageCache::VirtualTexturePageCache(uint64_t budget)
+    : m_Budget(budget), m_MemoryUsage(0)
+{
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+const std::vector<uint8_t>* VirtualTexturePageCache::Find(uint64_t pageKey)
+{
+    auto it = m_Pages.find(pageKey);
+    if (it == m_Pages.end())
+        return nullptr;
+
+    // Move the page to the front of the LRU list
+    m_LRUList.splice(m_LRUList.begin(), m_LRUList, it->second.LRUPosition);
+    return &it->second.Data;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTexturePageCache::Insert(uint64_t pageKey, std::vector<uint8_t>&& pageData)
+{
+    if (pageData.size() > m_Budget || m_Pages.find(pageKey) != m_Pages.end())
+        return;
+
+    // Evict the least recently used pages until the new one fits in the budget
+    while (m_MemoryUsage + pageData.size() > m_Budget && !m_LRUList.empty())
+    {
+        auto it = m_Pages.find(m_LRUList.back());
+        m_MemoryUsage -= it->second.Data.size();
+        m_Pages.erase(it);
+        m_LRUList.pop_back();
+    }
+
+    m_LRUList.push_front(pageKey);
+    m_MemoryUsage += pageData.size();
+
+    CachedPage& page = m_Pages[pageKey];
+    page.Data = std::move(pageData);
+    page.LRUPosition = m_LRUList.begin();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTexturePageCache::Clear()
+{
+    m_Pages.clear();
+    m_LRUList.clear();
+    m_MemoryUsage = 0;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::Initialize(const VirtualTextureSystemDescription& description)
+{
+    ms_Description = description;
+    ms_PageCache = VirtualTexturePageCache(ms_Description.PageCacheBudget);
+
+    uint32_t physicalPageCount = ms_Description.PhysicalPagesPerRow * ms_Description.PhysicalPagesPerRow;
+    HEXRAY_ASSERT_MSG(physicalPageCount <= 0xffff, "Page table entries can address at most 65535 physical pages");
+
+    ms_PhysicalPages.resize(physicalPageCount);
+    ms_FreePhysicalPages.reserve(physicalPageCount);
+
+    // Hand out the slots in ascending order
+    for (int32_t i = physicalPageCount - 1; i >= 0; i--)
+        ms_FreePhysicalPages.push_back(i);
+
+    TextureDescription atlasDesc;
+    atlasDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    atlasDesc.Width = ms_Description.PhysicalPagesPerRow * c_VirtualPagePhysicalSize;
+    atlasDesc.Height = ms_Description.PhysicalPagesPerRow * c_VirtualPagePhysicalSize;
+    atlasDesc.MipLevels = 1;
+    atlasDesc.InitialState = D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE;
+
+    ms_PageAtlas = std::make_shared<Texture>(atlasDesc, L"Virtual Texture Page Atlas");
+
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        BufferDescription uploadBufferDesc;
+        uploadBufferDesc.ElementCount = ms_Description.MaxPageUploadsPerFrame;
+        uploadBufferDesc.ElementSize = s_PageUploadSize;
+        uploadBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        ms_UploadBuffers[i] = std::make_shared<Buffer>(uploadBufferDesc, fmt::format(L"Virtual Texture Upload Buffer {}", i).c_str());
+    }
+
+    ms_Initialized = true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::Shutdown()
+{
+    ms_PageAtlas = nullptr;
+    ms_FeedbackBuffer = nullptr;
+
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        ms_ReadbackBuffers[i] = nullptr;
+        ms_PageTableBuffers[i] = nullptr;
+        ms_InfoBuffers[i] = nullptr;
+        ms_UploadBuffers[i] = nullptr;
+        ms_FeedbackStamps[i] = 0;
+    }
+
+    ms_PageCache.Clear();
+    ms_VirtualTextures.clear();
+    ms_VirtualTextureIndices.clear();
+    ms_PageTable.clear();
+    ms_ResidentSlots.clear();
+    ms_PhysicalPages.clear();
+    ms_FreePhysicalPages.clear();
+    ms_PinnedRequests.clear();
+    ms_Stats = VirtualTextureStats();
+    ms_Initialized = false;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool VirtualTextureSystem::ShouldVirtualize(const TextureDescription& textureDesc)
+{
+    if (!ms_Initialized || !ms_Description.Enabled)
+        return false;
+
+    // Pages are copied into a single RGBA8 atlas so only matching 2D textures can be streamed. Only albedo maps are sampled
+    // through the atlas, textures that end up in other material slots are made resident when the material is written
+    return textureDesc.Format == DXGI_FORMAT_R8G8B8A8_UNORM && !textureDesc.IsCubeMap && textureDesc.ArrayLevels == 1 &&
+        std::max(textureDesc.Width, textureDesc.Height) >= ms_Description.MinTextureSize;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t VirtualTextureSystem::GetVirtualTextureIndex(const TexturePtr& texture)
+{
+    if (!ms_Initialized || !texture || !texture->IsVirtual())
+        return InvalidDescriptorIndex;
+
+    auto it = ms_VirtualTextureIndices.find(texture->GetID());
+    if (it != ms_VirtualTextureIndices.end())
+        return it->second;
+
+    VirtualTexture virtualTexture;
+    virtualTexture.Filepath = texture->GetAssetFilepath();
+    virtualTexture.Stream = std::make_unique<std::ifstream>(virtualTexture.Filepath, std::ios::in | std::ios::binary);
+    virtualTexture.PixelDataOffset = texture->GetPixelDataOffset();
+    virtualTexture.Width = texture->GetWidth();
+    virtualTexture.Height = texture->GetHeight();
+    virtualTexture.PageTableOffset = ms_PageTable.size();
+
+    if (!*virtualTexture.Stream)
+    {
+        HEXRAY_ERROR("Virtual Texture System: Failed opening texture file {}", virtualTexture.Filepath.string());
+        ms_VirtualTextureIndices[texture->GetID()] = InvalidDescriptorIndex;
+        return InvalidDescriptorIndex;
+    }
+
+    uint64_t mipDataOffset = 0;
+    for (uint32_t mip = 0; mip < texture->GetMipLevels(); mip++)
+    {
+        uint32_t mipWidth = std::max(virtualTexture.Width >> mip, 1u);
+        uint32_t mipHeight = std::max(virtualTexture.Height >> mip, 1u);
+        glm::uvec2 pageCount = { (mipWidth + c_VirtualPageSize - 1) / c_VirtualPageSize, (mipHeight + c_VirtualPageSize - 1) / c_VirtualPageSize };
+
+        virtualTexture.MipDataOffsets.push_back(mipDataOffset);
+        virtualTexture.MipPageOffsets.push_back(virtualTexture.PageCount);
+        virtualTexture.MipPageCounts.push_back(pageCount);
+        virtualTexture.PageCount += pageCount.x * pageCount.y;
+
+        mipDataOffset += (uint64_t)mipWidth * mipHeight * s_TexelSize;
+
+        // Coarser mips would all fit in a single page, so there is no point in paging them
+        if (pageCount.x == 1 && pageCount.y == 1)
+            break;
+    }
+
+    uint32_t textureIndex = ms_VirtualTextures.size();
+    ms_PageTable.resize(ms_PageTable.size() + virtualTexture.PageCount, c_InvalidVirtualPage);
+    ms_ResidentSlots.resize(ms_ResidentSlots.size() + virtualTexture.PageCount, c_InvalidVirtualPage);
+
+    // Queue the coarsest page level so that the texture always has something to fall back to
+    uint32_t coarsestMip = virtualTexture.MipPageCounts.size() - 1;
+    glm::uvec2 coarsestPageCount = virtualTexture.MipPageCounts[coarsestMip];
+
+    if (coarsestPageCount.x * coarsestPageCount.y <= s_MaxPinnedPagesPerTexture)
+    {
+        for (uint32_t y = 0; y < coarsestPageCount.y; y++)
+        {
+            for (uint32_t x = 0; x < coarsestPageCount.x; x++)
+            {
+                uint32_t pageIndex = virtualTexture.PageTableOffset + virtualTexture.MipPageOffsets[coarsestMip] + y * coarsestPageCount.x + x;
+                ms_PinnedRequests.push_back({ pageIndex, textureIndex, coarsestMip, x, y, true });
+            }
+        }
+    }
+
+    ms_VirtualTextures.push_back(std::move(virtualTexture));
+    ms_VirtualTextureIndices[texture->GetID()] = textureIndex;
+
+    return textureIndex;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool VirtualTextureSystem::MakeResident(const TexturePtr& texture)
+{
+    if (!texture || !texture->IsVirtual())
+        return true;
+
+    std::ifstream stream(texture->GetAssetFilepath(), std::ios::in | std::ios::binary);
+    stream.seekg(texture->GetPixelDataOffset());
+
+    uint64_t pixelsSize = 0;
+    for (uint32_t mip = 0; mip < texture->GetMipLevels(); mip++)
+        pixelsSize += (uint64_t)std::max(texture->GetWidth() >> mip, 1u) * std::max(texture->GetHeight() >> mip, 1u) * s_TexelSize;
+
+    std::vector<uint8_t> pixels(pixelsSize);
+    if (!stream.read((char*)pixels.data(), pixelsSize))
+    {
+        HEXRAY_ERROR("Virtual Texture System: Failed reading the pixels of texture file {}", texture->GetAssetFilepath().string());
+        return false;
+    }
+
+    texture->MakeResident(pixels.data(), texture->GetAssetFilepath().stem().wstring().c_str());
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::Update(uint32_t frameIndex, VirtualTextureConstants& outConstants)
+{
+    outConstants.InfoBufferIndex = InvalidDescriptorIndex;
+    outConstants.PageTableBufferIndex = InvalidDescriptorIndex;
+    outConstants.PageAtlasIndex = InvalidDescriptorIndex;
+    outConstants.FeedbackBufferIndex = InvalidDescriptorIndex;
+    outConstants.FeedbackStamp = 0;
+    outConstants.PhysicalPagesPerRow = ms_Description.PhysicalPagesPerRow;
+    outConstants.InvAtlasSize = 1.0f;
+
+    if (!ms_Initialized || ms_VirtualTextures.empty())
+        return;
+
+    ms_FrameCounter++;
+
+    // Pinned pages that are still waiting for a physical page, then whatever the GPU requested a few frames ago
+    std::vector<PageRequest> faults = std::move(ms_PinnedRequests);
+    ms_PinnedRequests.clear();
+
+    ProcessFeedback(frameIndex, faults);
+    UploadPages(frameIndex, faults);
+    RebuildPageTables();
+    RecreateBuffers(frameIndex);
+
+    memcpy(ms_PageTableBuffers[frameIndex]->GetMappedData(), ms_PageTable.data(), ms_PageTable.size() * sizeof(uint32_t));
+
+    VirtualTextureInfo* infos = (VirtualTextureInfo*)ms_InfoBuffers[frameIndex]->GetMappedData();
+    for (uint32_t i = 0; i < ms_VirtualTextures.size(); i++)
+    {
+        infos[i].PageTableOffset = ms_VirtualTextures[i].PageTableOffset;
+        infos[i].Width = ms_VirtualTextures[i].Width;
+        infos[i].Height = ms_VirtualTextures[i].Height;
+        infos[i].PageMipLevels = ms_VirtualTextures[i].MipPageCounts.size();
+    }
+
+    // The stamp only has to differ between the frames in flight, 0 is reserved for the cleared feedback buffer
+    uint32_t feedbackStamp = (uint32_t)(ms_FrameCounter % 0xffffffff) + 1;
+    ms_FeedbackStamps[frameIndex] = feedbackStamp;
+
+    outConstants.InfoBufferIndex = ms_InfoBuffers[frameIndex]->GetSRV();
+    outConstants.PageTableBufferIndex = ms_PageTableBuffers[frameIndex]->GetSRV();
+    outConstants.PageAtlasIndex = ms_PageAtlas->GetSRV();
+    outConstants.FeedbackBufferIndex = ms_FeedbackBuffer->GetUAV();
+    outConstants.FeedbackStamp = feedbackStamp;
+    outConstants.InvAtlasSize = 1.0f / ms_PageAtlas->GetWidth();
+
+    ms_Stats.CacheMemoryUsage = ms_PageCache.GetMemoryUsage();
+    ms_Stats.ResidentPages = ms_PhysicalPages.size() - ms_FreePhysicalPages.size();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::ResolveFeedback(uint32_t frameIndex)
+{
+    if (!ms_FeedbackBuffer)
+        return;
+
+    std::shared_ptr<Buffer>& readbackBuffer = ms_ReadbackBuffers[frameIndex];
+
+    if (!readbackBuffer || readbackBuffer->GetElementCount() != ms_FeedbackBuffer->GetElementCount())
+    {
+        BufferDescription readbackBufferDesc;
+        readbackBufferDesc.ElementCount = ms_FeedbackBuffer->GetElementCount();
+        readbackBufferDesc.ElementSize = sizeof(uint32_t);
+        readbackBufferDesc.HeapType = D3D12_HEAP_TYPE_READBACK;
+
+        readbackBuffer = std::make_shared<Buffer>(readbackBufferDesc, fmt::format(L"Virtual Texture Readback Buffer {}", frameIndex).c_str());
+    }
+
+    GraphicsContext::GetInstance()->CopyBuffer(readbackBuffer.get(), ms_FeedbackBuffer.get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::ProcessFeedback(uint32_t frameIndex, std::vector<PageRequest>& outFaults)
+{
+    // The frame fence for this slot has already been waited on, so the readback buffer holds the requests of the last frame that used it
+    std::shared_ptr<Buffer>& readbackBuffer = ms_ReadbackBuffers[frameIndex];
+    uint32_t feedbackStamp = ms_FeedbackStamps[frameIndex];
+
+    if (!readbackBuffer || feedbackStamp == 0)
+        return;
+
+    const uint32_t* feedback = (const uint32_t*)readbackBuffer->GetMappedData();
+    uint32_t pageCount = std::min<uint32_t>(readbackBuffer->GetElementCount(), ms_ResidentSlots.size());
+
+    for (uint32_t pageIndex = 0; pageIndex < pageCount; pageIndex++)
+    {
+        if (feedback[pageIndex] != feedbackStamp)
+            continue;
+
+        ms_Stats.PageRequests++;
+
+        uint32_t slot = ms_ResidentSlots[pageIndex];
+        if (slot != c_InvalidVirtualPage)
+        {
+            ms_PhysicalPages[slot].LastUsedFrame = ms_FrameCounter;
+            continue;
+        }
+
+        ms_Stats.PageFaults++;
+        outFaults.push_back(DecodePageIndex(pageIndex));
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::UploadPages(uint32_t frameIndex, std::vector<PageRequest>& faults)
+{
+    if (faults.empty())
+        return;
+
+    // Pinned pages go first, then coarse pages so that a large fault burst quickly gives every surface a usable fallback
+    std::stable_sort(faults.begin(), faults.end(), [](const PageRequest& a, const PageRequest& b)
+    {
+        return a.Pinned != b.Pinned ? a.Pinned : a.Mip > b.Mip;
+    });
+
+    uint8_t* uploadData = (uint8_t*)ms_UploadBuffers[frameIndex]->GetMappedData();
+    std::vector<TextureRegionCopy> regions;
+    regions.reserve(ms_Description.MaxPageUploadsPerFrame);
+
+    for (const PageRequest& request : faults)
+    {
+        if (ms_ResidentSlots[request.PageIndex] != c_InvalidVirtualPage)
+            continue;
+
+        if (regions.size() == ms_Description.MaxPageUploadsPerFrame)
+        {
+            // Regular faults will be requested again by the GPU, pinned pages have to be retried explicitly
+            if (request.Pinned)
+                ms_PinnedRequests.push_back(request);
+
+            continue;
+        }
+
+        VirtualTexture& texture = ms_VirtualTextures[request.TextureIndex];
+        const std::vector<uint8_t>* pageData = ms_PageCache.Find(request.PageIndex);
+        std::vector<uint8_t> loadedPage;
+
+        if (pageData)
+        {
+            ms_Stats.CacheHits++;
+        }
+        else
+        {
+            ms_Stats.CacheMisses++;
+
+            if (!ReadPage(texture, request.Mip, request.PageX, request.PageY, loadedPage))
+                continue;
+
+            pageData = &loadedPage;
+        }
+
+        uint32_t slot = AllocatePhysicalPage();
+        if (slot == c_InvalidVirtualPage)
+        {
+            // Every physical page is in use this frame
+            if (request.Pinned)
+                ms_PinnedRequests.push_back(request);
+
+            continue;
+        }
+
+        PhysicalPage& physicalPage = ms_PhysicalPages[slot];
+        physicalPage.PageIndex = request.PageIndex;
+        physicalPage.LastUsedFrame = ms_FrameCounter;
+        physicalPage.Pinned = request.Pinned;
+
+        ms_ResidentSlots[request.PageIndex] = slot;
+        texture.IsPageTableDirty = true;
+
+        // Copy the page into the upload buffer respecting the D3D12 row pitch alignment
+        uint64_t bufferOffset = regions.size() * s_PageUploadSize;
+        for (uint32_t row = 0; row < c_VirtualPagePhysicalSize; row++)
+        {
+            memcpy(uploadData + bufferOffset + row * s_PageUploadRowPitch, pageData->data() + row * c_VirtualPagePhysicalSize * s_TexelSize, c_VirtualPagePhysicalSize * s_TexelSize);
+        }
+
+        if (!loadedPage.empty())
+        {
+            ms_PageCache.Insert(request.PageIndex, std::move(loadedPage));
+        }
+
+        TextureRegionCopy& region = regions.emplace_back();
+        region.BufferOffset = bufferOffset;
+        region.RowPitch = s_PageUploadRowPitch;
+        region.DestX = (slot % ms_Description.PhysicalPagesPerRow) * c_VirtualPagePhysicalSize;
+        region.DestY = (slot / ms_Description.PhysicalPagesPerRow) * c_VirtualPagePhysicalSize;
+        region.Width = c_VirtualPagePhysicalSize;
+        region.Height = c_VirtualPagePhysicalSize;
+
+        ms_Stats.PageUploads++;
+    }
+
+    GraphicsContext::GetInstance()->CopyBufferToTexture(ms_PageAtlas.get(), ms_UploadBuffers[frameIndex].get(), regions, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::RebuildPageTables()
+{
+    for (VirtualTexture& texture : ms_VirtualTextures)
+    {
+        if (!texture.IsPageTableDirty)
+            continue;
+
+        // Walk from the coarsest to the finest level so that every non-resident page can inherit the mapping of its parent
+        for (int32_t mip = texture.MipPageCounts.size() - 1; mip >= 0; mip--)
+        {
+            glm::uvec2 pageCount = texture.MipPageCounts[mip];
+            uint32_t mipOffset = texture.PageTableOffset + texture.MipPageOffsets[mip];
+
+            for (uint32_t y = 0; y < pageCount.y; y++)
+            {
+                for (uint32_t x = 0; x < pageCount.x; x++)
+                {
+                    uint32_t pageIndex = mipOffset + y * pageCount.x + x;
+                    uint32_t slot = ms_ResidentSlots[pageIndex];
+
+                    if (slot != c_InvalidVirtualPage)
+                    {
+                        ms_PageTable[pageIndex] = slot | (mip << 16);
+                    }
+                    else if (mip + 1 < texture.MipPageCounts.size())
+                    {
+                        glm::uvec2 parentPageCount = texture.MipPageCounts[mip + 1];
+                        uint32_t parentX = std::min(x >> 1, parentPageCount.x - 1);
+                        uint32_t parentY = std::min(y >> 1, parentPageCount.y - 1);
+
+                        ms_PageTable[pageIndex] = ms_PageTable[texture.PageTableOffset + texture.MipPageOffsets[mip + 1] + parentY * parentPageCount.x + parentX];
+                    }
+                    else
+                    {
+                        ms_PageTable[pageIndex] = c_InvalidVirtualPage;
+                    }
+                }
+            }
+        }
+
+        texture.IsPageTableDirty = false;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void VirtualTextureSystem::RecreateBuffers(uint32_t frameIndex)
+{
+    if (!ms_FeedbackBuffer || ms_FeedbackBuffer->GetElementCount() != ms_PageTable.size())
+    {
+        BufferDescription feedbackBufferDesc;
+        feedbackBufferDesc.ElementCount = ms_PageTable.size();
+        feedbackBufferDesc.ElementSize = sizeof(uint32_t);
+        feedbackBufferDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        feedbackBufferDesc.InitialState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+        ms_FeedbackBuffer = std::make_shared<Buffer>(feedbackBufferDesc, L"Virtual Texture Feedback Buffer");
+    }
+
+    std::shared_ptr<Buffer>& pageTableBuffer = ms_PageTableBuffers[frameIndex];
+
+    if (!pageTableBuffer || pageTableBuffer->GetElementCount() != ms_PageTable.size())
+    {
+        BufferDescription pageTableBufferDesc;
+        pageTableBufferDesc.ElementCount = ms_PageTable.size();
+        pageTableBufferDesc.ElementSize = sizeof(uint32_t);
+        pageTableBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        pageTableBuffer = std::make_shared<Buffer>(pageTableBufferDesc, fmt::format(L"Virtual Texture Page Table {}", frameIndex).c_str());
+    }
+
+    std::shared_ptr<Buffer>& infoBuffer = ms_InfoBuffers[frameIndex];
+
+    if (!infoBuffer || infoBuffer->GetElementCount() != ms_VirtualTextures.size())
+    {
+        BufferDescription infoBufferDesc;
+        infoBufferDesc.ElementCount = ms_VirtualTextures.size();
+        infoBufferDesc.ElementSize = sizeof(VirtualTextureInfo);
+        infoBufferDesc.HeapType = D3D12_HEAP_TYPE_UPLOAD;
+
+        infoBuffer = std::make_shared<Buffer>(infoBufferDesc, fmt::format(L"Virtual Texture Info Buffer {}", frameIndex).c_str());
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+VirtualTextureSystem::PageRequest VirtualTextureSystem::DecodePageIndex(uint32_t pageIndex)
+{
+    // Textures are appended in page table order, so the owner is the last one starting at or before the page
+    auto it = std::upper_bound(ms_VirtualTextures.begin(), ms_VirtualTextures.end(), pageIndex, [](uint32_t index, const VirtualTexture& texture) { return index < texture.PageTableOffset; });
+    HEXRAY_ASSERT(it != ms_VirtualTextures.begin());
+
+    uint32_t textureIndex = std::distance(ms_VirtualTextures.begin(), it) - 1;
+    const VirtualTexture& texture = ms_VirtualTextures[textureIndex];
+
+    uint32_t localIndex = pageIndex - texture.PageTableOffset;
+    uint32_t mip = std::distance(texture.MipPageOffsets.begin(), std::upper_bound(texture.MipPageOffsets.begin(), texture.MipPageOffsets.end(), localIndex)) - 1;
+    uint32_t mipIndex = localIndex - texture.MipPageOffsets[mip];
+
+    return { pageIndex, textureIndex, mip, mipIndex % texture.MipPageCounts[mip].x, mipIndex / texture.MipPageCounts[mip].x, false };
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t VirtualTextureSystem::AllocatePhysicalPage()
+{
+    if (!ms_FreePhysicalPages.empty())
+    {
+        uint32_t slot = ms_FreePhysicalPages.back();
+        ms_FreePhysicalPages.pop_back();
+        return slot;
+    }
+
+    // Evict the least recently used page. Frames still in flight on the GPU may sample any page they used, so pages
+    // used within the last FRAMES_IN_FLIGHT frames stay untouched
+    uint32_t evictedSlot = c_InvalidVirtualPage;
+    uint64_t oldestFrame = ms_FrameCounter;
+
+    for (uint32_t slot = 0; slot < ms_PhysicalPages.size(); slot++)
+    {
+        const PhysicalPage& physicalPage = ms_PhysicalPages[slot];
+        if (!physicalPage.Pinned && physicalPage.LastUsedFrame + FRAMES_IN_FLIGHT <= ms_FrameCounter && physicalPage.LastUsedFrame < oldestFrame)
+        {
+            oldestFrame = physicalPage.LastUsedFrame;
+            evictedSlot = slot;
+        }
+    }
+
+    if (evictedSlot == c_InvalidVirtualPage)
+        return c_InvalidVirtualPage;
+
+    PhysicalPage& physicalPage = ms_PhysicalPages[evictedSlot];
+    ms_ResidentSlots[physicalPage.PageIndex] = c_InvalidVirtualPage;
+    ms_VirtualTextures[DecodePageIndex(physicalPage.PageIndex).TextureIndex].IsPageTableDirty = true;
+    physicalPage = PhysicalPage();
+
+    ms_Stats.PageEvictions++;
+    return evictedSlot;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool VirtualTextureSystem::ReadPage(VirtualTexture& texture, uint32_t mip, uint32_t pageX, uint32_t pageY, std::vector<uint8_t>& outData)
+{
+    int32_t mipWidth = std::max(texture.Width >> mip, 1u);
+    int32_t mipHeight = std::max(texture.Height >> mip, 1u);
+    int32_t startX = pageX * c_VirtualPageSize - c_VirtualPageBorder;
+    int32_t startY = pageY * c_VirtualPageSize - c_VirtualPageBorder;
+
+    // The border texels are clamped to the texture edges
+    int32_t readStartX = std::clamp(startX, 0, mipWidth - 1);
+    int32_t readEndX = std::clamp(startX + (int32_t)c_VirtualPagePhysicalSize - 1, 0, mipWidth - 1);
+
+    std::vector<uint8_t> row((readEndX - readStartX + 1) * s_TexelSize);
+    outData.resize(c_VirtualPagePhysicalSize * c_VirtualPagePhysicalSize * s_TexelSize);
+
+    for (int32_t y = 0; y < (int32_t)c_VirtualPagePhysicalSize; y++)
+    {
+        int32_t sourceY = std::clamp(startY + y, 0, mipHeight - 1);
+        uint64_t rowOffset = texture.PixelDataOffset + texture.MipDataOffsets[mip] + ((uint64_t)sourceY * mipWidth + readStartX) * s_TexelSize;
+
+        texture.Stream->seekg(rowOffset);
+        texture.Stream->read((char*)row.data(), row.size());
+
+        if (!*texture.Stream)
+        {
+            HEXRAY_ERROR("Virtual Texture System: Failed reading page ({}, {}) of mip {} from {}", pageX, pageY, mip, texture.Filepath.string());
+            texture.Stream->clear();
+            return false;
+        }
+
+        uint8_t* destRow = outData.data() + y * c_VirtualPagePhysicalSize * s_TexelSize;
+        for (int32_t x = 0; x < (int32_t)c_VirtualPagePhysicalSize; x++)
+        {
+            int32_t sourceX = std::clamp(startX + x, 0, mipWidth - 1);
+            memcpy(destRow + x * s_TexelSize, row.data() + (sourceX - readStartX) * s_TexelSize, s_TexelSize);
+        }
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/uuid.h"
+#include "rendering/texture.h"
+#include "rendering/buffer.h"
+#include "rendering/shaders/resources.h"
+
+#include <list>
+#include <fstream>
+
+struct VirtualTextureSystemDescription
+{
+    bool Enabled = true;
+    uint32_t MinTextureSize = 2048;
+    uint32_t PhysicalPagesPerRow = 30;
+    uint64_t PageCacheBudget = 256ull * 1024 * 1024;
+    uint32_t MaxPageUploadsPerFrame = 32;
+};
+
+struct VirtualTextureStats
+{
+    uint64_t PageRequests = 0;
+    uint64_t PageFaults = 0;
+    uint64_t PageUploads = 0;
+    uint64_t PageEvictions = 0;
+    uint64_t CacheHits = 0;
+    uint64_t CacheMisses = 0;
+    uint32_t ResidentPages = 0;
+    uint64_t CacheMemoryUsage = 0;
+};
+
+class VirtualTexturePageCache
+{
+public:
+    VirtualTexturePageCache(uint64_t budget = 0);
+
+    const std::vector<uint8_t>* Find(uint64_t pageKey);
+    void Insert(uint64_t pageKey, std::vector<uint8_t>&& pageData);
+    void Clear();
+
+    inline uint64_t GetBudget() const { return m_Budget; }
+    inline uint64_t GetMemoryUsage() const { return m_MemoryUsage; }
+private:
+    struct CachedPage
+    {
+        std::vector<uint8_t> Data;
+        std::list<uint64_t>::iterator LRUPosition;
+    };
+private:
+    uint64_t m_Budget;
+    uint64_t m_MemoryUsage;
+    std::list<uint64_t> m_LRUList;
+    std::unordered_map<uint64_t, CachedPage> m_Pages;
+};
+
+class VirtualTextureSystem
+{
+public:
+    static void Initialize(const VirtualTextureSystemDescription& description);
+    static void Shutdown();
+
+    static bool ShouldVirtualize(const TextureDescription& textureDesc);
+    static uint32_t GetVirtualTextureIndex(const TexturePtr& texture);
+    static bool MakeResident(const TexturePtr& texture);
+    static void Update(uint32_t frameIndex, VirtualTextureConstants& outConstants);
+    static void ResolveFeedback(uint32_t frameIndex);
+
+    inline static bool HasVirtualTextures() { return !ms_VirtualTextures.empty(); }
+    inline static const VirtualTextureStats& GetStats() { return ms_Stats; }
+    inline static const VirtualTextureSystemDescription& GetDescription() { return ms_Description; }
+private:
+    struct VirtualTexture
+    {
+        std::filesystem::path Filepath;
+        std::unique_ptr<std::ifstream> Stream;
+        uint64_t PixelDataOffset = 0;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t PageTableOffset = 0;
+        uint32_t PageCount = 0;
+        std::vector<uint64_t> MipDataOffsets;
+        std::vector<uint32_t> MipPageOffsets;
+        std::vector<glm::uvec2> MipPageCounts;
+        bool IsPageTableDirty = true;
+    };
+
+    struct PageRequest
+    {
+        uint32_t PageIndex;
+        uint32_t TextureIndex;
+        uint32_t Mip;
+        uint32_t PageX;
+        uint32_t PageY;
+        bool Pinned;
+    };
+
+    struct PhysicalPage
+    {
+        uint32_t PageIndex = c_InvalidVirtualPage;
+        uint64_t LastUsedFrame = 0;
+        bool Pinned = false;
+    };
+private:
+    static void ProcessFeedback(uint32_t frameIndex, std::vector<PageRequest>& outFaults);
+    static void UploadPages(uint32_t frameIndex, std::vector<PageRequest>& faults);
+    static void RebuildPageTables();
+    static void RecreateBuffers(uint32_t frameIndex);
+    static PageRequest DecodePageIndex(uint32_t pageIndex);
+    static uint32_t AllocatePhysicalPage();
+    static bool ReadPage(VirtualTexture& texture, uint32_t mip, uint32_t pageX, uint32_t pageY, std::vector<uint8_t>& outData);
+private:
+    static bool ms_Initialized;
+    static VirtualTextureSystemDescription ms_Description;
+    static VirtualTextureStats ms_Stats;
+    static VirtualTexturePageCache ms_PageCache;
+    static std::vector<VirtualTexture> ms_VirtualTextures;
+    static std::unordered_map<Uuid, uint32_t> ms_VirtualTextureIndices;
+    static std::vector<uint32_t> ms_PageTable;
+    static std::vector<uint32_t> ms_ResidentSlots;
+    static std::vector<PhysicalPage> ms_PhysicalPages;
+    static std::vector<uint32_t> ms_FreePhysicalPages;
+    static std::vector<PageRequest> ms_PinnedRequests;
+    static uint64_t ms_FrameCounter;
+    static uint32_t ms_FeedbackStamps[FRAMES_IN_FLIGHT];
+
+    static std::shared_ptr<Texture> ms_PageAtlas;
+    static std::shared_ptr<Buffer> ms_FeedbackBuffer;
+    static std::shared_ptr<Buffer> ms_ReadbackBuffers[FRAMES_IN_FLIGHT];
+    static std::shared_ptr<Buffer> ms_PageTableBuffers[FRAMES_IN_FLIGHT];
+    static std::shared_ptr<Buffer> ms_InfoBuffers[FRAMES_IN_FLIGHT];
+    static std::shared_ptr<Buffer> ms_UploadBuffers[FRAMES_IN_FLIGHT];
+};
\ No newline at end of file
@@ -64,6 +64,20 @@ struct TransformComponent
 	}
 };
 
+// World space transform cached from the TransformComponents along the parent chain. The storage is sorted by hierarchy depth,
+// so iterating it visits parents before their children and a dirty parent can be propagated in the same pass
+struct WorldTransformComponent
+{
+	glm::mat4 Transform = glm::mat4(1.0f);
+	entt::entity Parent = entt::null;
+	uint32_t Depth = 0;
+	uint64_t UpdateIndex = 0;
+	bool IsDirty = true;
+
+	WorldTransformComponent() = default;
+	WorldTransformComponent(const WorldTransformComponent& other) = default;
+};
+
 struct MeshComponent
 {
 	MeshPtr Mesh = nullptr;
@@ -75,6 +89,19 @@ struct MeshComponent
 		: Mesh(mesh) {}
 };
 
+struct InstancedMeshComponent
+{
+	MeshPtr Mesh = nullptr;
+	std::shared_ptr<MaterialTable> OverrideMaterialTable = nullptr;
+	// Relative to the entity's transform. Immutable and shared with the renderer, so changing them means assigning a new vector
+	std::shared_ptr<const std::vector<glm::mat4>> InstanceTransforms;
+
+	InstancedMeshComponent() = default;
+	InstancedMeshComponent(const InstancedMeshComponent& other) = default;
+	InstancedMeshComponent(const MeshPtr& mesh)
+		: Mesh(mesh) {}
+};
+
 struct SkyLightComponent
 {
 	TexturePtr EnvironmentMap = nullptr;
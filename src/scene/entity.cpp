@@ -33,6 +33,7 @@ void Entity::AddChild(Entity entity)
 	}
 
 	entity.GetComponent<SceneHierarchyComponent>().Parent = GetUUID();
+	m_Scene->MarkHierarchyChanged(entity);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -68,6 +69,7 @@ void Entity::RemoveChild(Entity child)
 			currentChild.GetComponent<SceneHierarchyComponent>().NextSibling = Uuid(0);
 			currentChild.GetComponent<SceneHierarchyComponent>().PreviousSibling = Uuid(0);
 			currentChild.GetComponent<SceneHierarchyComponent>().Parent = Uuid(0);
+			m_Scene->MarkHierarchyChanged(currentChild);
 
 			return;
 		}
@@ -117,6 +119,7 @@ void Entity::RemoveParent()
 	}
 
 	shc.Parent = Uuid(0);
+	m_Scene->MarkHierarchyChanged(*this);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -34,6 +34,14 @@ public:
 		return component;
 	}
 
+	// Edits a component through func and notifies the scene, so changes reach systems that cache component data
+	template<typename T, typename Func>
+	T& PatchComponent(Func&& func)
+	{
+		HEXRAY_ASSERT_MSG(HasComponent<T>(), "Component does not exist!");
+		return m_Scene->m_Registry.patch<T>(m_Entity, std::forward<Func>(func));
+	}
+
 	template<typename T>
 	void RemoveComponent()
 	{
@@ -1,11 +1,29 @@
 #include "scene.h"
 
 #include "scene/component.h"
+#include "core/utils.h"
 #include "rendering/defaultresources.h"
 
+// Render objects are extracted from the registry in parallel chunks, every chunk fills its own arrays which are then
+// handed to the renderer in chunk order
+static constexpr size_t c_ExtractionChunkSize = 4096;
+
+struct MovedRenderObjects
+{
+    std::vector<std::pair<RenderObjectID, glm::mat4>> Meshes;
+    std::vector<std::pair<RenderObjectID, Light>> Lights;
+};
+
+struct ChangedRenderObjects
+{
+    std::vector<std::pair<entt::entity, MeshInstance>> Meshes;
+    std::vector<std::pair<entt::entity, MeshInstance>> InstancedMeshes;
+    std::vector<std::pair<entt::entity, Light>> Lights;
+};
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 Scene::Scene(const std::string& name)
-    : m_Name(name)
+    : Scene(name, Camera())
 {
 }
 
@@ -13,6 +31,27 @@ Scene::Scene(const std::string& name)
 Scene::Scene(const std::string& name, const Camera& camera)
     : m_Name(name), m_Camera(camera)
 {
+    m_Registry.on_update<TransformComponent>().connect<&Scene::OnTransformChanged>(this);
+
+    m_Registry.on_construct<MeshComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_update<MeshComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_destroy<MeshComponent>().connect<&Scene::OnMeshDestroyed>(this);
+
+    m_Registry.on_construct<InstancedMeshComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_update<InstancedMeshComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_destroy<InstancedMeshComponent>().connect<&Scene::OnInstancedMeshDestroyed>(this);
+
+    m_Registry.on_construct<DirectionalLightComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_update<DirectionalLightComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_destroy<DirectionalLightComponent>().connect<&Scene::OnLightDestroyed>(this);
+
+    m_Registry.on_construct<PointLightComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_update<PointLightComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_destroy<PointLightComponent>().connect<&Scene::OnLightDestroyed>(this);
+
+    m_Registry.on_construct<SpotLightComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_update<SpotLightComponent>().connect<&Scene::OnRenderObjectChanged>(this);
+    m_Registry.on_destroy<SpotLightComponent>().connect<&Scene::OnLightDestroyed>(this);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -29,8 +68,12 @@ Entity Scene::CreateEntityFromUUID(Uuid uuid, const std::string& name)
     entity.AddComponent<TagComponent>(name);
     entity.AddComponent<TransformComponent>();
     entity.AddComponent<SceneHierarchyComponent>();
+    entity.AddComponent<WorldTransformComponent>();
     m_EntitiesByID[uuid] = entity;
 
+    // Callers may parent the entity by writing its hierarchy component directly
+    MarkHierarchyChanged(entity);
+
     return entity;
 }
 
@@ -69,6 +112,12 @@ void Scene::DeleteEntity(Entity entity)
             next.GetComponent<SceneHierarchyComponent>().PreviousSibling = prev.GetUUID();
     }
 
+    // Removing a component moves the last one into its slot, which can break the parent before child order for that entity only
+    auto& worldTransforms = m_Registry.storage<WorldTransformComponent>();
+    entt::entity movedEntity = worldTransforms.data()[worldTransforms.size() - 1];
+    if (movedEntity != (entt::entity)entity)
+        MarkHierarchyChanged(movedEntity);
+
     m_EntitiesByID.erase(entity.GetUUID());
     m_Registry.destroy((entt::entity)entity);
 }
@@ -122,71 +171,389 @@ void Scene::OnRender(const std::shared_ptr<Renderer>& renderer)
         }
     }
 
+    UpdateWorldTransforms();
     renderer->BeginScene(m_Camera, environmentMap);
+    SyncRenderObjects(renderer);
+    renderer->Render();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::OnViewportResize(uint32_t width, uint32_t height)
+{
+    m_Camera.SetViewportSize(width, height);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::MarkTransformDirty(Entity entity)
+{
+    entity.GetComponent<WorldTransformComponent>().IsDirty = true;
+    m_HasDirtyTransforms = true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::OnTransformChanged(entt::registry& registry, entt::entity entity)
+{
+    MarkTransformDirty({ entity, this });
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::MarkHierarchyChanged(entt::entity entity)
+{
+    m_HierarchyChangedEntities.push_back(entity);
+    m_HasDirtyTransforms = true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::SortHierarchy()
+{
+    auto view = m_Registry.view<WorldTransformComponent, SceneHierarchyComponent>();
+    for (auto entity : view)
+    {
+        auto [wtc, shc] = view.get<WorldTransformComponent, SceneHierarchyComponent>(entity);
+
+        Entity parent = FindEntityByUUID(shc.Parent);
+        wtc.Parent = parent;
+        wtc.Depth = 0;
+        wtc.IsDirty = true;
+
+        for (Entity ancestor = parent; ancestor; ancestor = FindEntityByUUID(ancestor.GetComponent<SceneHierarchyComponent>().Parent))
+            wtc.Depth++;
+    }
 
-    // Submit directional lights
+    // Iterating a sorted storage follows the comparison order, so parents are visited before their children
+    m_Registry.sort<WorldTransformComponent>([](const WorldTransformComponent& lhs, const WorldTransformComponent& rhs)
     {
-        auto view = m_Registry.view<DirectionalLightComponent, TransformComponent>();
-        for (auto entity : view)
+        return lhs.Depth < rhs.Depth;
+    });
+
+    m_HierarchyChangedEntities.clear();
+    m_HasDirtyTransforms = true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::UpdateHierarchy()
+{
+    if (m_HierarchyChangedEntities.empty())
+        return;
+
+    // Loading a scene changes most entities at once, which is cheaper to handle with a single pass over all of them
+    if (m_HierarchyChangedEntities.size() * 8 > m_Registry.storage<WorldTransformComponent>().size())
+    {
+        SortHierarchy();
+        return;
+    }
+
+    bool isOrdered = true;
+    for (entt::entity entity : m_HierarchyChangedEntities)
+    {
+        if (m_Registry.valid(entity))
+            isOrdered &= UpdateSubtreeDepths(entity);
+    }
+
+    m_HierarchyChangedEntities.clear();
+
+    // Only the changed entities can be out of place, so the storage is nearly sorted and an insertion sort only moves those
+    if (!isOrdered)
+    {
+        m_Registry.sort<WorldTransformComponent>([](const WorldTransformComponent& lhs, const WorldTransformComponent& rhs)
         {
-            auto [dlc, tc] = view.get<DirectionalLightComponent, TransformComponent>(entity);
-            renderer->SubmitDirectionalLight(dlc.Color, glm::normalize(-tc.Translation), dlc.Intensity);
-        }
+            return lhs.Depth < rhs.Depth;
+        }, entt::insertion_sort{});
     }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool Scene::UpdateSubtreeDepths(entt::entity root)
+{
+    auto& storage = m_Registry.storage<WorldTransformComponent>();
+
+    // Views iterate the storage back to front, so a parent is visited first when it sits at a higher index than its child
+    auto isVisitedBefore = [&](entt::entity lhs, entt::entity rhs) { return storage.index(lhs) > storage.index(rhs); };
 
-    // Submit point lights
+    WorldTransformComponent& rootWtc = storage.get(root);
+    Entity parent = FindEntityByUUID(m_Registry.get<SceneHierarchyComponent>(root).Parent);
+    rootWtc.Parent = parent;
+    rootWtc.Depth = 0;
+    rootWtc.IsDirty = true;
+
+    for (Entity ancestor = parent; ancestor; ancestor = FindEntityByUUID(ancestor.GetComponent<SceneHierarchyComponent>().Parent))
+        rootWtc.Depth++;
+
+    bool isOrdered = !parent || isVisitedBefore(parent, root);
+
+    // Descendants keep their parent, only their depth follows the root
+    std::vector<entt::entity> stack = { root };
+    while (!stack.empty())
     {
-        auto view = m_Registry.view<PointLightComponent, TransformComponent>();
-        for (auto entity : view)
+        entt::entity entity = stack.back();
+        stack.pop_back();
+
+        uint32_t childDepth = storage.get(entity).Depth + 1;
+        for (Entity child = FindEntityByUUID(m_Registry.get<SceneHierarchyComponent>(entity).FirstChild); child; child = FindEntityByUUID(child.GetComponent<SceneHierarchyComponent>().NextSibling))
         {
-            auto [plc, tc] = view.get<PointLightComponent, TransformComponent>(entity);
-            renderer->SubmitPointLight(plc.Color, tc.Translation, plc.Intensity, plc.AttenuationFactors);
+            WorldTransformComponent& childWtc = storage.get(child);
+            childWtc.Parent = entity;
+            childWtc.Depth = childDepth;
+            isOrdered &= isVisitedBefore(entity, child);
+            stack.push_back(child);
         }
     }
 
-    // Submit spot lights
+    return isOrdered;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::UpdateWorldTransforms()
+{
+    UpdateHierarchy();
+
+    if (!m_HasDirtyTransforms)
+        return;
+
+    // An entity is recomputed when it was marked dirty or its parent was recomputed earlier in this pass
+    m_TransformUpdateIndex++;
+
+    auto view = m_Registry.view<WorldTransformComponent>();
+    for (auto entity : view)
     {
-        auto view = m_Registry.view<SpotLightComponent, TransformComponent>();
-        for (auto entity : view)
+        auto& wtc = view.get<WorldTransformComponent>(entity);
+        const WorldTransformComponent* parentWtc = wtc.Parent != entt::null ? &view.get<WorldTransformComponent>(wtc.Parent) : nullptr;
+
+        if (!wtc.IsDirty && !(parentWtc && parentWtc->UpdateIndex == m_TransformUpdateIndex))
+            continue;
+
+        glm::mat4 localTransform = m_Registry.get<TransformComponent>(entity).GetTransform();
+        wtc.Transform = parentWtc ? parentWtc->Transform * localTransform : localTransform;
+        wtc.UpdateIndex = m_TransformUpdateIndex;
+        wtc.IsDirty = false;
+
+        m_MovedRenderObjects.push_back(entity);
+    }
+
+    m_HasDirtyTransforms = false;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::SyncRenderObjects(const std::shared_ptr<Renderer>& renderer)
+{
+    // A renderer that did not see this scene before is filled from scratch
+    if (m_RetainedRenderer.lock() != renderer)
+    {
+        m_RetainedRenderer = renderer;
+        renderer->ClearRenderObjects();
+
+        m_MeshObjects.clear();
+        m_InstancedMeshObjects.clear();
+        m_LightObjects.clear();
+        m_RemovedMeshObjects.clear();
+        m_RemovedLightObjects.clear();
+
+        for (auto entity : m_Registry.view<MeshComponent>())
+            m_ChangedRenderObjects.insert(entity);
+        for (auto entity : m_Registry.view<InstancedMeshComponent>())
+            m_ChangedRenderObjects.insert(entity);
+        for (auto entity : m_Registry.view<DirectionalLightComponent>())
+            m_ChangedRenderObjects.insert(entity);
+        for (auto entity : m_Registry.view<PointLightComponent>())
+            m_ChangedRenderObjects.insert(entity);
+        for (auto entity : m_Registry.view<SpotLightComponent>())
+            m_ChangedRenderObjects.insert(entity);
+    }
+
+    for (RenderObjectID id : m_RemovedMeshObjects)
+        renderer->RemoveMesh(id);
+
+    for (RenderObjectID id : m_RemovedLightObjects)
+        renderer->RemoveLight(id);
+
+    m_RemovedMeshObjects.clear();
+    m_RemovedLightObjects.clear();
+
+    // Registry reads from worker threads go through a const registry, which never creates missing storage
+    const entt::registry& registry = m_Registry;
+
+    // Moved objects only need their transform updated, new ones are picked up below
+    std::vector<MovedRenderObjects> movedChunks(GetChunkCount(m_MovedRenderObjects.size(), c_ExtractionChunkSize));
+    ParallelForChunks(m_MovedRenderObjects.size(), c_ExtractionChunkSize, [&](size_t chunk, size_t begin, size_t end)
+    {
+        MovedRenderObjects& moved = movedChunks[chunk];
+
+        for (size_t i = begin; i < end; i++)
         {
-            auto [slc, tc] = view.get<SpotLightComponent, TransformComponent>(entity);
-            renderer->SubmitSpotLight(slc.Color, tc.Translation, glm::normalize(slc.Direction), slc.Intensity, glm::radians(slc.ConeAngleMin), glm::radians(slc.ConeAngleMax), slc.AttenuationFactors);
+            entt::entity entity = m_MovedRenderObjects[i];
+            if (!registry.valid(entity))
+                continue;
+
+            const glm::mat4& transform = registry.get<WorldTransformComponent>(entity).Transform;
+
+            auto mesh = m_MeshObjects.find(entity);
+            if (mesh != m_MeshObjects.end())
+                moved.Meshes.emplace_back(mesh->second, transform);
+
+            auto instancedMesh = m_InstancedMeshObjects.find(entity);
+            if (instancedMesh != m_InstancedMeshObjects.end())
+                moved.Meshes.emplace_back(instancedMesh->second, transform);
+
+            Light light;
+            auto lightObject = m_LightObjects.find(entity);
+            if (lightObject != m_LightObjects.end() && CreateLight(entity, light))
+                moved.Lights.emplace_back(lightObject->second, light);
         }
+    });
+
+    for (const MovedRenderObjects& moved : movedChunks)
+    {
+        for (const auto& [id, transform] : moved.Meshes)
+            renderer->UpdateMeshTransform(id, transform);
+
+        for (const auto& [id, light] : moved.Lights)
+            renderer->UpdateLight(id, light);
     }
 
-    // Submit meshes
+    m_MovedRenderObjects.clear();
+
+    std::vector<entt::entity> changedEntities(m_ChangedRenderObjects.begin(), m_ChangedRenderObjects.end());
+    std::vector<ChangedRenderObjects> changedChunks(GetChunkCount(changedEntities.size(), c_ExtractionChunkSize));
+    ParallelForChunks(changedEntities.size(), c_ExtractionChunkSize, [&](size_t chunk, size_t begin, size_t end)
     {
-        auto view = m_Registry.view<MeshComponent, TransformComponent, SceneHierarchyComponent>();
-        for (auto entity : view)
+        ChangedRenderObjects& changed = changedChunks[chunk];
+
+        for (size_t i = begin; i < end; i++)
         {
-            auto [mc, tc, shc] = view.get<MeshComponent, TransformComponent, SceneHierarchyComponent>(entity);
+            entt::entity entity = changedEntities[i];
+            if (!registry.valid(entity))
+                continue;
+
+            const glm::mat4& transform = registry.get<WorldTransformComponent>(entity).Transform;
+
+            if (auto mc = registry.try_get<MeshComponent>(entity))
+            {
+                MeshInstance& instance = changed.Meshes.emplace_back(entity, MeshInstance()).second;
+                instance.Transform = transform;
+                instance.Mesh = mc->Mesh;
+                instance.OverrideMaterialTable = mc->OverrideMaterialTable;
+            }
 
-            if (mc.Mesh)
+            if (auto imc = registry.try_get<InstancedMeshComponent>(entity))
             {
-                if (shc.Parent)
-                {
-                    Entity currentParent = FindEntityByUUID(shc.Parent);
-                    auto accumulatedTransform = currentParent.GetComponent<TransformComponent>().GetTransform();
-
-                    while (currentParent.GetComponent<SceneHierarchyComponent>().Parent)
-                    {
-                        currentParent = FindEntityByUUID(currentParent.GetComponent<SceneHierarchyComponent>().Parent);
-                        accumulatedTransform = currentParent.GetComponent<TransformComponent>().GetTransform() * accumulatedTransform;
-                    }
-
-                    renderer->SubmitMesh(mc.Mesh, accumulatedTransform * tc.GetTransform(), mc.OverrideMaterialTable);
-                }
-                else
-                    renderer->SubmitMesh(mc.Mesh, tc.GetTransform(), mc.OverrideMaterialTable);
+                MeshInstance& instance = changed.InstancedMeshes.emplace_back(entity, MeshInstance()).second;
+                instance.Transform = transform;
+                uint32_t instanceCount = imc->InstanceTransforms ? imc->InstanceTransforms->size() : 0;
+                instance.Mesh = instanceCount > 0 ? imc->Mesh : nullptr;
+                instance.OverrideMaterialTable = imc->OverrideMaterialTable;
+                instance.InstanceTransforms = imc->InstanceTransforms;
+                instance.InstanceCount = instanceCount;
             }
+
+            Light light;
+            if (CreateLight(entity, light))
+                changed.Lights.emplace_back(entity, light);
+        }
+    });
+
+    for (const ChangedRenderObjects& changed : changedChunks)
+    {
+        for (const auto& [entity, instance] : changed.Meshes)
+            SyncMeshObject(*renderer, m_MeshObjects, entity, instance);
+
+        for (const auto& [entity, instance] : changed.InstancedMeshes)
+            SyncMeshObject(*renderer, m_InstancedMeshObjects, entity, instance);
+
+        for (const auto& [entity, light] : changed.Lights)
+        {
+            auto lightObject = m_LightObjects.find(entity);
+            if (lightObject != m_LightObjects.end())
+                renderer->UpdateLight(lightObject->second, light);
+            else
+                m_LightObjects[entity] = renderer->AddLight(light);
         }
     }
 
-    renderer->Render();
+    m_ChangedRenderObjects.clear();
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void Scene::OnViewportResize(uint32_t width, uint32_t height)
+void Scene::SyncMeshObject(Renderer& renderer, std::unordered_map<entt::entity, RenderObjectID>& meshObjects, entt::entity entity, const MeshInstance& instance)
 {
-    m_Camera.SetViewportSize(width, height);
+    auto meshObject = meshObjects.find(entity);
+
+    if (meshObject == meshObjects.end())
+    {
+        if (instance.Mesh)
+            meshObjects[entity] = renderer.AddMesh(instance);
+    }
+    else if (!instance.Mesh)
+    {
+        renderer.RemoveMesh(meshObject->second);
+        meshObjects.erase(meshObject);
+    }
+    else
+    {
+        renderer.UpdateMesh(meshObject->second, instance);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool Scene::CreateLight(entt::entity entity, Light& outLight) const
+{
+    const TransformComponent& tc = m_Registry.get<TransformComponent>(entity);
+
+    if (auto dlc = m_Registry.try_get<DirectionalLightComponent>(entity))
+    {
+        outLight = Renderer::CreateDirectionalLight(dlc->Color, glm::normalize(-tc.Translation), dlc->Intensity);
+        return true;
+    }
+
+    if (auto plc = m_Registry.try_get<PointLightComponent>(entity))
+    {
+        outLight = Renderer::CreatePointLight(plc->Color, tc.Translation, plc->Intensity, plc->AttenuationFactors);
+        return true;
+    }
+
+    if (auto slc = m_Registry.try_get<SpotLightComponent>(entity))
+    {
+        outLight = Renderer::CreateSpotLight(slc->Color, tc.Translation, glm::normalize(slc->Direction), slc->Intensity, glm::radians(slc->ConeAngleMin), glm::radians(slc->ConeAngleMax), slc->AttenuationFactors);
+        return true;
+    }
+
+    return false;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::OnRenderObjectChanged(entt::registry& registry, entt::entity entity)
+{
+    m_ChangedRenderObjects.insert(entity);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::OnMeshDestroyed(entt::registry& registry, entt::entity entity)
+{
+    auto meshObject = m_MeshObjects.find(entity);
+    if (meshObject != m_MeshObjects.end())
+    {
+        m_RemovedMeshObjects.push_back(meshObject->second);
+        m_MeshObjects.erase(meshObject);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::OnInstancedMeshDestroyed(entt::registry& registry, entt::entity entity)
+{
+    auto meshObject = m_InstancedMeshObjects.find(entity);
+    if (meshObject != m_InstancedMeshObjects.end())
+    {
+        m_RemovedMeshObjects.push_back(meshObject->second);
+        m_InstancedMeshObjects.erase(meshObject);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void Scene::OnLightDestroyed(entt::registry& registry, entt::entity entity)
+{
+    auto lightObject = m_LightObjects.find(entity);
+    if (lightObject != m_LightObjects.end())
+    {
+        m_RemovedLightObjects.push_back(lightObject->second);
+        m_LightObjects.erase(lightObject);
+    }
 }
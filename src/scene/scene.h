@@ -10,6 +10,8 @@ class Scene
 {
     friend class Entity;
     friend class SceneSerializer;
+    friend class DefaultSceneParser;
+    friend class SceneCache;
 public:
     Scene(const std::string& name);
     Scene(const std::string& name, const Camera& camera);
@@ -24,11 +26,45 @@ public:
     void OnRender(const std::shared_ptr<Renderer>& renderer);
     void OnViewportResize(uint32_t width, uint32_t height);
 
+    // World transforms are cached. Changes made through Entity::PatchComponent mark them dirty on their own, this has to be
+    // called after writing the TransformComponent of an existing entity directly
+    void MarkTransformDirty(Entity entity);
+
     inline const std::string& GetName() { return m_Name; }
     inline Camera& GetCamera() { return m_Camera; }
+private:
+    void SortHierarchy();
+    void UpdateHierarchy();
+    bool UpdateSubtreeDepths(entt::entity root);
+    void MarkHierarchyChanged(entt::entity entity);
+    void UpdateWorldTransforms();
+    void OnTransformChanged(entt::registry& registry, entt::entity entity);
+
+    // Mesh and light components are registered with the renderer once and then kept in sync through registry signals
+    void SyncRenderObjects(const std::shared_ptr<Renderer>& renderer);
+    void SyncMeshObject(Renderer& renderer, std::unordered_map<entt::entity, RenderObjectID>& meshObjects, entt::entity entity, const MeshInstance& instance);
+    bool CreateLight(entt::entity entity, Light& outLight) const;
+    void OnRenderObjectChanged(entt::registry& registry, entt::entity entity);
+    void OnMeshDestroyed(entt::registry& registry, entt::entity entity);
+    void OnInstancedMeshDestroyed(entt::registry& registry, entt::entity entity);
+    void OnLightDestroyed(entt::registry& registry, entt::entity entity);
 private:
     std::string m_Name;
     entt::registry m_Registry;
     std::unordered_map<Uuid, Entity> m_EntitiesByID;
     Camera m_Camera;
+
+    std::weak_ptr<Renderer> m_RetainedRenderer;
+    std::unordered_map<entt::entity, RenderObjectID> m_MeshObjects;
+    std::unordered_map<entt::entity, RenderObjectID> m_InstancedMeshObjects;
+    std::unordered_map<entt::entity, RenderObjectID> m_LightObjects;
+    std::unordered_set<entt::entity> m_ChangedRenderObjects;
+    std::vector<entt::entity> m_MovedRenderObjects;
+    std::vector<RenderObjectID> m_RemovedMeshObjects;
+    std::vector<RenderObjectID> m_RemovedLightObjects;
+
+    // Entities that were created, reparented or moved within the storage since the last update
+    std::vector<entt::entity> m_HierarchyChangedEntities;
+    bool m_HasDirtyTransforms = true;
+    uint64_t m_TransformUpdateIndex = 0;
 };
\ No newline at end of file
@@ -0,0 +1,600 @@
+#include "scenecache.h"
+
+#include "core/utils.h"
+#include "core/timer.h"
+#include "core/application.h"
+#include "scene/entity.h"
+#include "scene/component.h"
+#include "scene/scenecachestream.h"
+#include "asset/assetmanager.h"
+
+#include <fstream>
+#include <algorithm>
+
+static constexpr uint32_t c_SceneCacheMagic = 0x43535848; // 'HXSC'
+static constexpr uint32_t c_SceneCacheVersion = 2;
+static constexpr uint32_t c_InvalidReference = UINT32_MAX;
+
+static constexpr uint32_t c_HasMeshComponent = 1 << 0;
+static constexpr uint32_t c_HasInstancedMeshComponent = 1 << 1;
+static constexpr uint32_t c_HasSkyLightComponent = 1 << 2;
+static constexpr uint32_t c_HasDirectionalLightComponent = 1 << 3;
+static constexpr uint32_t c_HasPointLightComponent = 1 << 4;
+static constexpr uint32_t c_HasSpotLightComponent = 1 << 5;
+
+// Gathers every texture, material and mesh used by the scene, so that components refer to them by table index
+struct SceneCacheReferences
+{
+	std::vector<Texture*> Textures;
+	std::vector<Material*> Materials;
+	std::vector<Mesh*> Meshes;
+	std::unordered_map<Texture*, uint32_t> TextureIndices;
+	std::unordered_map<Material*, uint32_t> MaterialIndices;
+	std::unordered_map<Mesh*, uint32_t> MeshIndices;
+
+	uint32_t AddTexture(Texture* texture)
+	{
+		if (!texture)
+			return c_InvalidReference;
+
+		auto [it, inserted] = TextureIndices.try_emplace(texture, (uint32_t)Textures.size());
+		if (inserted)
+			Textures.push_back(texture);
+
+		return it->second;
+	}
+
+	uint32_t AddMaterial(Material* material)
+	{
+		if (!material)
+			return c_InvalidReference;
+
+		auto [it, inserted] = MaterialIndices.try_emplace(material, (uint32_t)Materials.size());
+		if (inserted)
+			Materials.push_back(material);
+
+		return it->second;
+	}
+
+	uint32_t AddMesh(Mesh* mesh)
+	{
+		if (!mesh)
+			return c_InvalidReference;
+
+		auto [it, inserted] = MeshIndices.try_emplace(mesh, (uint32_t)Meshes.size());
+		if (inserted)
+			Meshes.push_back(mesh);
+
+		return it->second;
+	}
+};
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool SceneCache::Serialize(const std::filesystem::path& filepath, uint64_t sourceHash, const std::shared_ptr<Scene>& scene, const RendererDescription& rendererDescription)
+{
+	Timer timer;
+	timer.Reset();
+
+	entt::registry& registry = scene->m_Registry;
+
+	// Entity views iterate in reverse creation order, so store them reversed to recreate them in the original order
+	std::vector<entt::entity> entities;
+	for (entt::entity entity : registry.view<IDComponent>())
+		entities.push_back(entity);
+
+	std::reverse(entities.begin(), entities.end());
+
+	SceneCacheReferences references;
+
+	auto addMaterialTable = [&](const std::shared_ptr<MaterialTable>& materialTable)
+	{
+		if (materialTable)
+		{
+			for (const MaterialPtr& material : *materialTable)
+				references.AddMaterial(material.get());
+		}
+	};
+
+	for (entt::entity entity : entities)
+	{
+		if (MeshComponent* mc = registry.try_get<MeshComponent>(entity))
+		{
+			references.AddMesh(mc->Mesh.get());
+			addMaterialTable(mc->OverrideMaterialTable);
+		}
+
+		if (InstancedMeshComponent* imc = registry.try_get<InstancedMeshComponent>(entity))
+		{
+			references.AddMesh(imc->Mesh.get());
+			addMaterialTable(imc->OverrideMaterialTable);
+		}
+
+		if (SkyLightComponent* slc = registry.try_get<SkyLightComponent>(entity))
+			references.AddTexture(slc->EnvironmentMap.get());
+	}
+
+	for (Material* material : references.Materials)
+	{
+		for (const TexturePtr& texture : material->m_Textures)
+			references.AddTexture(texture.get());
+	}
+
+	// Only assets that can be found again by their ID are cached. Anything else means the import failed and the scene has to be parsed next time as well
+	for (Texture* texture : references.Textures)
+	{
+		if (!texture->IsProcedural() && !AssetManager::IsAssetValid(texture->GetID()))
+		{
+			HEXRAY_WARNING("Scene Cache: Texture {} is not a registered asset, skipping cache {}", (uint64_t)texture->GetID(), filepath.string());
+			return false;
+		}
+	}
+
+	for (Mesh* mesh : references.Meshes)
+	{
+		if (!mesh->IsPrimitive() && !AssetManager::IsAssetValid(mesh->GetID()))
+		{
+			HEXRAY_WARNING("Scene Cache: Mesh {} is not a registered asset, skipping cache {}", (uint64_t)mesh->GetID(), filepath.string());
+			return false;
+		}
+	}
+
+	SceneCacheWriter writer;
+
+	// Header
+	writer.Write(c_SceneCacheMagic);
+	writer.Write(c_SceneCacheVersion);
+	writer.Write(sourceHash);
+
+	// Scene settings
+	const Window* window = Application::GetInstance()->GetWindow();
+	const Camera& camera = scene->GetCamera();
+
+	writer.WriteString(scene->GetName());
+	writer.Write(rendererDescription);
+	writer.Write(window->GetWidth());
+	writer.Write(window->GetHeight());
+	writer.Write(camera.m_Position);
+	writer.Write(camera.m_AspectRatio);
+	writer.Write(camera.m_PerspectiveFOV);
+	writer.Write(camera.m_YawAngle);
+	writer.Write(camera.m_PitchAngle);
+	writer.Write(camera.m_MovementSpeed);
+	writer.Write(camera.m_Exposure);
+
+	// Textures
+	writer.Write<uint32_t>(references.Textures.size());
+	for (Texture* texture : references.Textures)
+	{
+		writer.Write<uint8_t>(texture->IsProcedural());
+
+		if (texture->IsProcedural())
+		{
+			const ProceduralTextureDescription& proceduralDesc = texture->GetProceduralDescription();
+			writer.Write<uint32_t>(proceduralDesc.Type);
+			writer.Write(proceduralDesc.ColorA);
+			writer.Write(proceduralDesc.ColorB);
+		}
+		else
+		{
+			writer.Write<uint64_t>(texture->GetID());
+		}
+
+		writer.Write(texture->GetScaling());
+		writer.Write<uint32_t>(texture->GetSamplerType());
+	}
+
+	// Materials
+	writer.Write<uint32_t>(references.Materials.size());
+	for (Material* material : references.Materials)
+	{
+		writer.Write<uint32_t>(material->m_Type);
+		writer.Write(material->m_Flags);
+		writer.Write<uint32_t>(material->m_PropertiesBuffer.size());
+		writer.WriteBytes(material->m_PropertiesBuffer.data(), material->m_PropertiesBuffer.size());
+		writer.Write<uint32_t>(material->m_Textures.size());
+
+		for (const TexturePtr& texture : material->m_Textures)
+			writer.Write(references.AddTexture(texture.get()));
+	}
+
+	// Meshes
+	writer.Write<uint32_t>(references.Meshes.size());
+	for (Mesh* mesh : references.Meshes)
+	{
+		writer.Write<uint8_t>(mesh->IsPrimitive());
+
+		if (mesh->IsPrimitive())
+		{
+			writer.Write(mesh->GetPrimitiveDescription());
+
+			// Heightfields don't keep their source image around, so the samples go into the snapshot
+			if (mesh->GetPrimitiveDescription().Type == PrimitiveType::Heightfield)
+			{
+				const HeightfieldDescription& heightfield = mesh->GetHeightfieldDescription();
+				writer.Write(heightfield.Width);
+				writer.Write(heightfield.Depth);
+				writer.Write(heightfield.HeightScale);
+				writer.Write<uint32_t>(heightfield.Heights.size());
+				writer.WriteBytes(heightfield.Heights.data(), heightfield.Heights.size() * sizeof(uint16_t));
+			}
+		}
+		else
+		{
+			writer.Write<uint64_t>(mesh->GetID());
+		}
+	}
+
+	// Entities
+	auto writeMaterialTable = [&](const std::shared_ptr<MaterialTable>& materialTable)
+	{
+		writer.Write<uint32_t>(materialTable ? materialTable->GetSize() : 0);
+
+		if (materialTable)
+		{
+			for (const MaterialPtr& material : *materialTable)
+				writer.Write(references.AddMaterial(material.get()));
+		}
+	};
+
+	writer.Write<uint32_t>(entities.size());
+	for (entt::entity entity : entities)
+	{
+		MeshComponent* mc = registry.try_get<MeshComponent>(entity);
+		InstancedMeshComponent* imc = registry.try_get<InstancedMeshComponent>(entity);
+		SkyLightComponent* slc = registry.try_get<SkyLightComponent>(entity);
+		DirectionalLightComponent* dlc = registry.try_get<DirectionalLightComponent>(entity);
+		PointLightComponent* plc = registry.try_get<PointLightComponent>(entity);
+		SpotLightComponent* splc = registry.try_get<SpotLightComponent>(entity);
+
+		uint32_t componentMask = 0;
+		componentMask |= mc ? c_HasMeshComponent : 0;
+		componentMask |= imc ? c_HasInstancedMeshComponent : 0;
+		componentMask |= slc ? c_HasSkyLightComponent : 0;
+		componentMask |= dlc ? c_HasDirectionalLightComponent : 0;
+		componentMask |= plc ? c_HasPointLightComponent : 0;
+		componentMask |= splc ? c_HasSpotLightComponent : 0;
+
+		writer.Write<uint64_t>(registry.get<IDComponent>(entity).ID);
+		writer.WriteString(registry.get<TagComponent>(entity).Tag);
+		writer.Write(registry.get<TransformComponent>(entity));
+		writer.Write(registry.get<SceneHierarchyComponent>(entity));
+		writer.Write(componentMask);
+
+		if (mc)
+		{
+			writer.Write(references.AddMesh(mc->Mesh.get()));
+			writeMaterialTable(mc->OverrideMaterialTable);
+		}
+
+		if (imc)
+		{
+			writer.Write(references.AddMesh(imc->Mesh.get()));
+			writeMaterialTable(imc->OverrideMaterialTable);
+			uint32_t instanceCount = imc->InstanceTransforms ? imc->InstanceTransforms->size() : 0;
+			writer.Write<uint32_t>(instanceCount);
+			if (instanceCount > 0)
+				writer.WriteBytes(imc->InstanceTransforms->data(), instanceCount * sizeof(glm::mat4));
+		}
+
+		if (slc)
+			writer.Write(references.AddTexture(slc->EnvironmentMap.get()));
+
+		if (dlc)
+			writer.Write(*dlc);
+
+		if (plc)
+			writer.Write(*plc);
+
+		if (splc)
+			writer.Write(*splc);
+	}
+
+	std::ofstream ofs(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!ofs)
+	{
+		HEXRAY_ERROR("Scene Cache: Failed creating/opening scene cache file {}", filepath.string());
+		return false;
+	}
+
+	ofs.write((const char*)writer.GetData().data(), writer.GetData().size());
+
+	timer.Stop();
+	HEXRAY_INFO("Scene Cache: Wrote {} ({} entities, {} KB) in {:.2f} ms", filepath.string(), entities.size(), writer.GetData().size() / 1024, timer.GetElapsedTimeMS());
+	return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool SceneCache::Deserialize(const std::filesystem::path& filepath, uint64_t sourceHash, std::shared_ptr<Scene>& scene, RendererDescription& rendererDescription)
+{
+	Timer timer;
+	timer.Reset();
+
+	// The whole snapshot is read at once and components are constructed straight from it
+	std::vector<uint8_t> data;
+	if (!ReadFile(filepath, data))
+		return false;
+
+	SceneCacheReader reader(data);
+
+	uint32_t magic, version;
+	uint64_t cachedSourceHash;
+	reader.Read(magic);
+	reader.Read(version);
+	reader.Read(cachedSourceHash);
+
+	if (!reader.IsValid() || magic != c_SceneCacheMagic || version != c_SceneCacheVersion)
+	{
+		HEXRAY_WARNING("Scene Cache: {} is not a valid scene cache of version {}", filepath.string(), c_SceneCacheVersion);
+		return false;
+	}
+
+	if (cachedSourceHash != sourceHash)
+	{
+		HEXRAY_INFO("Scene Cache: {} is out of date", filepath.string());
+		return false;
+	}
+
+	// Scene settings
+	std::string sceneName;
+	RendererDescription cachedRendererDescription;
+	uint32_t frameWidth, frameHeight;
+	Camera camera;
+
+	reader.ReadString(sceneName);
+	reader.Read(cachedRendererDescription);
+	reader.Read(frameWidth);
+	reader.Read(frameHeight);
+	reader.Read(camera.m_Position);
+	reader.Read(camera.m_AspectRatio);
+	reader.Read(camera.m_PerspectiveFOV);
+	reader.Read(camera.m_YawAngle);
+	reader.Read(camera.m_PitchAngle);
+	reader.Read(camera.m_MovementSpeed);
+	reader.Read(camera.m_Exposure);
+
+	// Textures
+	std::vector<TexturePtr> textures(reader.ReadCount(sizeof(uint8_t)));
+	for (TexturePtr& texture : textures)
+	{
+		uint8_t isProcedural;
+		reader.Read(isProcedural);
+
+		if (isProcedural)
+		{
+			uint32_t type;
+			ProceduralTextureDescription proceduralDesc;
+			reader.Read(type);
+			reader.Read(proceduralDesc.ColorA);
+			reader.Read(proceduralDesc.ColorB);
+			proceduralDesc.Type = (ProceduralTextureType)type;
+
+			texture = std::make_shared<Texture>(proceduralDesc);
+		}
+		else
+		{
+			uint64_t id;
+			reader.Read(id);
+
+			texture = reader.IsValid() ? AssetManager::GetAsset<Texture>(id) : nullptr;
+		}
+
+		float scaling;
+		uint32_t samplerType;
+		reader.Read(scaling);
+		reader.Read(samplerType);
+
+		if (!reader.IsValid() || !texture)
+		{
+			HEXRAY_WARNING("Scene Cache: Failed loading textures from {}", filepath.string());
+			return false;
+		}
+
+		texture->SetScaling(scaling);
+		texture->SetSamplerType((SamplerType)samplerType);
+	}
+
+	auto getTexture = [&](uint32_t index) { return index < textures.size() ? textures[index] : nullptr; };
+
+	// Materials
+	std::vector<MaterialPtr> materials(reader.ReadCount(sizeof(uint32_t)));
+	for (MaterialPtr& material : materials)
+	{
+		uint32_t type;
+		MaterialFlags flags;
+		reader.Read(type);
+		reader.Read(flags);
+
+		if (!reader.IsValid() || type > MaterialType::PBR)
+		{
+			HEXRAY_WARNING("Scene Cache: Failed loading materials from {}", filepath.string());
+			return false;
+		}
+
+		material = std::make_shared<Material>((MaterialType)type, flags);
+
+		uint32_t propertiesSize = reader.ReadCount(sizeof(uint8_t));
+		if (propertiesSize != material->m_PropertiesBuffer.size())
+		{
+			HEXRAY_WARNING("Scene Cache: Material layout in {} does not match", filepath.string());
+			return false;
+		}
+
+		reader.ReadBytes(material->m_PropertiesBuffer.data(), propertiesSize);
+
+		uint32_t textureCount = reader.ReadCount(sizeof(uint32_t));
+		if (textureCount != material->m_Textures.size())
+		{
+			HEXRAY_WARNING("Scene Cache: Material layout in {} does not match", filepath.string());
+			return false;
+		}
+
+		for (TexturePtr& texture : material->m_Textures)
+		{
+			uint32_t textureIndex;
+			reader.Read(textureIndex);
+			texture = getTexture(textureIndex);
+		}
+	}
+
+	auto getMaterial = [&](uint32_t index) { return index < materials.size() ? materials[index] : nullptr; };
+
+	// Meshes
+	std::vector<MeshPtr> meshes(reader.ReadCount(sizeof(uint8_t)));
+	for (MeshPtr& mesh : meshes)
+	{
+		uint8_t isPrimitive;
+		reader.Read(isPrimitive);
+
+		if (isPrimitive)
+		{
+			PrimitiveDescription primitiveDesc;
+			reader.Read(primitiveDesc);
+
+			if (primitiveDesc.Type == PrimitiveType::Heightfield)
+			{
+				HeightfieldDescription heightfield;
+				reader.Read(heightfield.Width);
+				reader.Read(heightfield.Depth);
+				reader.Read(heightfield.HeightScale);
+				heightfield.Heights.resize(reader.ReadCount(sizeof(uint16_t)));
+				reader.ReadBytes(heightfield.Heights.data(), heightfield.Heights.size() * sizeof(uint16_t));
+
+				if (reader.IsValid() && heightfield.Width >= 2 && heightfield.Depth >= 2 && heightfield.Heights.size() == (uint64_t)heightfield.Width * heightfield.Depth)
+					mesh = std::make_shared<Mesh>(primitiveDesc, std::move(heightfield), L"Heightfield");
+			}
+			else if (reader.IsValid())
+			{
+				mesh = std::make_shared<Mesh>(primitiveDesc, L"Primitive");
+			}
+		}
+		else
+		{
+			uint64_t id;
+			reader.Read(id);
+
+			mesh = reader.IsValid() ? AssetManager::GetAsset<Mesh>(id) : nullptr;
+		}
+
+		if (!mesh)
+		{
+			HEXRAY_WARNING("Scene Cache: Failed loading meshes from {}", filepath.string());
+			return false;
+		}
+	}
+
+	auto getMesh = [&](uint32_t index) { return index < meshes.size() ? meshes[index] : nullptr; };
+
+	auto readMaterialTable = [&]() -> std::shared_ptr<MaterialTable>
+	{
+		uint32_t size = reader.ReadCount(sizeof(uint32_t));
+		if (size == 0)
+			return nullptr;
+
+		std::shared_ptr<MaterialTable> materialTable = std::make_shared<MaterialTable>(size);
+		for (uint32_t i = 0; i < size; i++)
+		{
+			uint32_t materialIndex;
+			reader.Read(materialIndex);
+			materialTable->SetMaterial(i, getMaterial(materialIndex));
+		}
+
+		return materialTable;
+	};
+
+	// Entities
+	camera.RecalculateProjection();
+	camera.RecalculateView();
+	std::shared_ptr<Scene> cachedScene = std::make_shared<Scene>(sceneName, camera);
+
+	uint32_t entityCount = reader.ReadCount(sizeof(uint64_t));
+	for (uint32_t i = 0; i < entityCount && reader.IsValid(); i++)
+	{
+		uint64_t id;
+		std::string tag;
+		reader.Read(id);
+		reader.ReadString(tag);
+
+		Entity entity = cachedScene->CreateEntityFromUUID(id, tag);
+		reader.Read(entity.GetComponent<TransformComponent>());
+		reader.Read(entity.GetComponent<SceneHierarchyComponent>());
+
+		uint32_t componentMask;
+		reader.Read(componentMask);
+
+		if (componentMask & c_HasMeshComponent)
+		{
+			uint32_t meshIndex;
+			reader.Read(meshIndex);
+
+			MeshComponent& mc = entity.AddComponent<MeshComponent>(getMesh(meshIndex));
+			mc.OverrideMaterialTable = readMaterialTable();
+		}
+
+		if (componentMask & c_HasInstancedMeshComponent)
+		{
+			uint32_t meshIndex;
+			reader.Read(meshIndex);
+
+			InstancedMeshComponent& imc = entity.AddComponent<InstancedMeshComponent>(getMesh(meshIndex));
+			imc.OverrideMaterialTable = readMaterialTable();
+			auto instanceTransforms = std::make_shared<std::vector<glm::mat4>>(reader.ReadCount(sizeof(glm::mat4)));
+			reader.ReadBytes(instanceTransforms->data(), instanceTransforms->size() * sizeof(glm::mat4));
+			imc.InstanceTransforms = std::move(instanceTransforms);
+		}
+
+		if (componentMask & c_HasSkyLightComponent)
+		{
+			uint32_t textureIndex;
+			reader.Read(textureIndex);
+
+			entity.AddComponent<SkyLightComponent>(getTexture(textureIndex));
+		}
+
+		if (componentMask & c_HasDirectionalLightComponent)
+			reader.Read(entity.AddComponent<DirectionalLightComponent>());
+
+		if (componentMask & c_HasPointLightComponent)
+			reader.Read(entity.AddComponent<PointLightComponent>());
+
+		if (componentMask & c_HasSpotLightComponent)
+			reader.Read(entity.AddComponent<SpotLightComponent>());
+	}
+
+	if (!reader.IsValid() || !reader.IsAtEnd())
+	{
+		HEXRAY_WARNING("Scene Cache: {} is truncated or corrupted", filepath.string());
+		return false;
+	}
+
+	Window* window = Application::GetInstance()->GetWindow();
+	if (frameWidth && frameHeight && (window->GetWidth() != frameWidth || window->GetHeight() != frameHeight))
+		window->Resize(frameWidth, frameHeight);
+
+	scene = cachedScene;
+	rendererDescription = cachedRendererDescription;
+
+	timer.Stop();
+	HEXRAY_INFO("Scene Cache: Loaded {} ({} entities) in {:.2f} ms", filepath.string(), entityCount, timer.GetElapsedTimeMS());
+	return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool SceneCache::HashSourceFile(const std::filesystem::path& filepath, uint64_t& outHash)
+{
+	MappedFile file(filepath);
+	if (!file.IsValid())
+		return false;
+
+	// 64 bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const uint8_t* bytes = (const uint8_t*)file.GetData();
+	for (size_t i = 0; i < file.GetSize(); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	outHash = hash;
+	return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "core/core.h"
+#include "scene/scene.h"
+
+// Compact binary snapshot of a fully resolved scene. Snapshots are keyed by the hash of the file the scene was parsed from,
+// so a stale snapshot is rejected on load and the caller falls back to parsing the source again. Standalone binary scenes
+// that have no source file use StandaloneSourceHash. Hashing reports failure through its return value, so a source that can't
+// be read never matches a snapshot
+class SceneCache
+{
+public:
+	static constexpr uint64_t StandaloneSourceHash = 0;
+
+	static bool Serialize(const std::filesystem::path& filepath, uint64_t sourceHash, const std::shared_ptr<Scene>& scene, const RendererDescription& rendererDescription);
+	static bool Deserialize(const std::filesystem::path& filepath, uint64_t sourceHash, std::shared_ptr<Scene>& scene, RendererDescription& rendererDescription);
+	static bool HashSourceFile(const std::filesystem::path& filepath, uint64_t& outHash);
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Byte streams of the scene cache format. They only depend on the standard library, so the snapshot encoding can be measured
+// and tested without a renderer
+class SceneCacheWriter
+{
+public:
+	template<typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		WriteBytes(&value, sizeof(T));
+	}
+
+	void WriteBytes(const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		m_Data.insert(m_Data.end(), bytes, bytes + size);
+	}
+
+	void WriteString(const std::string& value)
+	{
+		Write<uint32_t>(value.size());
+		WriteBytes(value.data(), value.size());
+	}
+
+	inline const std::vector<uint8_t>& GetData() const { return m_Data; }
+private:
+	std::vector<uint8_t> m_Data;
+};
+
+// Reads never go past the end of the snapshot. Once a read fails, every following read returns zeroes and IsValid() turns false
+class SceneCacheReader
+{
+public:
+	SceneCacheReader(const std::vector<uint8_t>& data)
+		: m_Data(data) {}
+
+	template<typename T>
+	void Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		ReadBytes(&value, sizeof(T));
+	}
+
+	void ReadBytes(void* data, size_t size)
+	{
+		if (!m_IsValid || size > m_Data.size() - m_Offset)
+		{
+			m_IsValid = false;
+			memset(data, 0, size);
+			return;
+		}
+
+		memcpy(data, m_Data.data() + m_Offset, size);
+		m_Offset += size;
+	}
+
+	void ReadString(std::string& value)
+	{
+		uint32_t size = 0;
+		Read(size);
+
+		if (!m_IsValid || size > m_Data.size() - m_Offset)
+		{
+			m_IsValid = false;
+			return;
+		}
+
+		value.assign((const char*)m_Data.data() + m_Offset, size);
+		m_Offset += size;
+	}
+
+	// Element counts are checked against the remaining data so a corrupted count can't trigger a huge allocation
+	uint32_t ReadCount(size_t minElementSize)
+	{
+		uint32_t count = 0;
+		Read(count);
+
+		if (m_IsValid && (uint64_t)count * minElementSize > m_Data.size() - m_Offset)
+			m_IsValid = false;
+
+		return m_IsValid ? count : 0;
+	}
+
+	inline bool IsValid() const { return m_IsValid; }
+	inline bool IsAtEnd() const { return m_Offset == m_Data.size(); }
+private:
+	const std::vector<uint8_t>& m_Data;
+	size_t m_Offset = 0;
+	bool m_IsValid = true;
+};
@@ -1,7 +1,9 @@
 #include "sceneserializer.h"
 
+#include "core/timer.h"
 #include "scene/entity.h"
 #include "scene/component.h"
+#include "scene/scenecache.h"
 #include "asset/assetmanager.h"
 
 #include <yaml-cpp/yaml.h>
@@ -93,8 +95,14 @@ YAML::Emitter& operator<<(YAML::Emitter& out, const glm::vec4& v)
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
-void SceneSerializer::Serialize(const std::filesystem::path& filepath, const std::shared_ptr<Scene>& scene, const RendererDescription& rendererDescription)
+bool SceneSerializer::Serialize(const std::filesystem::path& filepath, const std::shared_ptr<Scene>& scene, const RendererDescription& rendererDescription)
 {
+	if (IsBinaryScene(filepath))
+		return SceneCache::Serialize(filepath, SceneCache::StandaloneSourceHash, scene, rendererDescription);
+
+	Timer timer;
+	timer.Reset();
+
 	YAML::Emitter out;
 	out << YAML::BeginMap;
 	out << YAML::Key << "Name" << YAML::Value << scene->GetName();
@@ -231,11 +239,26 @@ void SceneSerializer::Serialize(const std::filesystem::path& filepath, const std
 
 	std::ofstream fout(filepath);
 	fout << out.c_str();
+	if (!fout)
+	{
+		HEXRAY_ERROR("Scene Serializer: Failed writing {}", filepath.string());
+		return false;
+	}
+
+	timer.Stop();
+	HEXRAY_INFO("Scene Serializer: Wrote {} ({} entities) in {:.2f} ms", filepath.string(), scene->m_Registry.alive(), timer.GetElapsedTimeMS());
+	return true;
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------------
 bool SceneSerializer::Deserialize(const std::filesystem::path& filepath, std::shared_ptr<Scene>& scene, RendererDescription& rendererDescription)
 {
+	if (IsBinaryScene(filepath))
+		return SceneCache::Deserialize(filepath, SceneCache::StandaloneSourceHash, scene, rendererDescription);
+
+	Timer timer;
+	timer.Reset();
+
 	std::ifstream stream(filepath);
 	std::stringstream strStream;
 
@@ -358,5 +381,13 @@ bool SceneSerializer::Deserialize(const std::filesystem::path& filepath, std::sh
 		}
 	}
 
+	timer.Stop();
+	HEXRAY_INFO("Scene Serializer: Loaded {} ({} entities) in {:.2f} ms", filepath.string(), data["Entities"] ? data["Entities"].size() : 0, timer.GetElapsedTimeMS());
 	return true;
 }
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool SceneSerializer::IsBinaryScene(const std::filesystem::path& filepath)
+{
+	return filepath.extension() == ".hexscene";
+}
\ No newline at end of file
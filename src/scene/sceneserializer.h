@@ -3,9 +3,12 @@
 #include "core/core.h"
 #include "scene/scene.h"
 
+// Scenes are stored as YAML unless the file has the binary scene extension, in which case they are written as standalone scene
+// snapshots. Binary scenes skip the YAML document entirely, which matters for scenes with a large number of entities
 class SceneSerializer
 {
 public:
-    static void Serialize(const std::filesystem::path& filepath, const std::shared_ptr<Scene>& scene, const RendererDescription& rendererDescription);
+    static bool Serialize(const std::filesystem::path& filepath, const std::shared_ptr<Scene>& scene, const RendererDescription& rendererDescription);
     static bool Deserialize(const std::filesystem::path& filepath, std::shared_ptr<Scene>& scene, RendererDescription& rendererDescription);
+    static bool IsBinaryScene(const std::filesystem::path& filepath);
 };
\ No newline at end of file
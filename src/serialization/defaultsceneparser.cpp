@@ -1,9 +1,11 @@
 #include "defaultsceneparser.h"
 #include "core/utils.h"
+#include "core/timer.h"
 #include "core/application.h"
 #include "scene/component.h"
 #include "scene/scene.h"
 #include "serialization/parsedblockimpl.h"
+#include "serialization/scenetokenizer.h"
 #include "asset/assetimporter.h"
 #include "asset/assetmanager.h"
 #include "asset/assetserializer.h"
@@ -12,11 +14,13 @@
 #include <vector>
 #include <cstdarg>
 #include <random>
+#include <string_view>
 
 
 DefaultSceneParser::DefaultSceneParser()
 {
 	m_IsParsingObject = false;
+	m_IsReloading = false;
 	m_Scene = nullptr;
 	m_SceneRootDirectory = "data/";
 }
@@ -25,7 +29,7 @@ DefaultSceneParser::~DefaultSceneParser()
 {
 }
 
-bool DefaultSceneParser::AddSceneElement(const std::string& className, const std::string& objectName, ParsedBlockImpl& pb)
+bool DefaultSceneParser::AddSceneElement(const std::string& className, const std::string& objectName, ParsedBlockImpl& pb, Entity& outEntity)
 {
 	TextureImportOptions noCompressNoMipMapTexOptions;
 	noCompressNoMipMapTexOptions.Compress = false;
@@ -70,7 +74,8 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 	{
 		auto& camera = m_Scene->GetCamera();
 		camera.m_Position = glm::vec3(0.0f);
-		camera.m_MovementSpeed *= 10;
+		if (!m_IsReloading)
+			camera.m_MovementSpeed *= 10;
 		pb.GetRequiredProperty("pos", camera.m_Position);
 		pb.GetProperty("aspectRatio", camera.m_AspectRatio, 1e-6);
 		pb.GetProperty("fov", camera.m_PerspectiveFOV, 0.0001, 179);
@@ -103,11 +108,10 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 		pb.GetProperty("scaling", scaling);
 
 		m_Textures[objectName] = DefaultResources::GetCheckerTexture(color1, color2);
-		m_Textures[objectName]->SetScaling(scaling); // this is not correct as it is not part of the hash, fuck it
+		m_Textures[objectName]->SetScaling(scaling);
 		return true;
 	}
 
-	//if (className == "Heightfield") return new Heightfield;
 	//if (className == "Bumps") return new Bumps;
 	//if (className == "Const") return new Const;
 	if (className == "BitmapTexture" || className == "BumpTexture")
@@ -116,7 +120,7 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 		if (!pb.GetFilenameProp("file", filename))
 			pb.RequiredProp("file");
 
-		m_Textures[objectName] = AssetManager::GetAsset<Texture>(AssetImporter::ImportTextureAsset(filename, noCompressNoMipMapTexOptions));
+		m_Textures[objectName] = RequestTexture(filename, noCompressNoMipMapTexOptions);
 		return true;
 	}
 
@@ -127,7 +131,8 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 			pb.RequiredProp("folder");
 
 		Entity sky = m_Scene->CreateEntity(objectName);
-		sky.AddComponent<SkyLightComponent>().EnvironmentMap = AssetManager::GetAsset<Texture>(AssetImporter::ImportTextureAsset(folder + std::string("/skybox.exr"), noCompressNoMipMapTexOptions));
+		outEntity = sky;
+		sky.AddComponent<SkyLightComponent>().EnvironmentMap = RequestTexture(folder + std::string("/skybox.exr"), noCompressNoMipMapTexOptions);
 
 		return true;
 	}
@@ -135,32 +140,26 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 	// Meshes
 	if (className == "Sphere")
 	{
-		glm::vec3 center = glm::vec3(0.f);
-		pb.GetProperty("O", center);
+		PrimitiveDescription sphereDesc;
+		sphereDesc.Type = PrimitiveType::Sphere;
+		pb.GetProperty("O", sphereDesc.Center);
+		pb.GetProperty("R", sphereDesc.Extent);
 
-		float radius = 1.0f;
-		pb.GetProperty("R", radius);
-		radius *= 2.f;
-
-		MeshPtr mesh = AssetManager::GetAsset<Mesh>(AssetImporter::ImportMeshAsset("data/meshes/sphere.fbx", noFlipMeshOptions));
-		m_Meshes[objectName] = mesh;
-		m_MeshesTransforms[mesh].Translation = center; // not correct, but ok for now
-		m_MeshesTransforms[mesh].Scale = { radius, radius, radius }; // not correct, but ok for now
+		m_Meshes[objectName] = std::make_shared<Mesh>(sphereDesc, L"Sphere");
 		return true;
 	}
 	
 	if (className == "Cube")
 	{
-		glm::vec3 center = glm::vec3(0.f);
-		pb.GetProperty("O", center);
+		PrimitiveDescription cubeDesc;
+		cubeDesc.Type = PrimitiveType::Cube;
+		pb.GetProperty("O", cubeDesc.Center);
 
 		float side = 1.0f;
 		pb.GetProperty("side", side);
+		cubeDesc.Extent = side * 0.5f;
 
-		MeshPtr mesh = AssetManager::GetAsset<Mesh>(AssetImporter::ImportMeshAsset("data/meshes/cube.obj", noFlipMeshOptions));
-		m_Meshes[objectName] = mesh;
-		m_MeshesTransforms[mesh].Translation = center;
-		m_MeshesTransforms[mesh].Scale = { side, side, side };
+		m_Meshes[objectName] = std::make_shared<Mesh>(cubeDesc, L"Cube");
 		return true;
 	}
 
@@ -169,15 +168,39 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 	//if (className == "CSGDiff") return new CSGDiff;
 	if (className == "Plane")
 	{
-		float y = 0.f;
-		float limit = 1000;
-		pb.GetProperty("y", y);
-		pb.GetProperty("limit", limit);
+		PrimitiveDescription planeDesc;
+		planeDesc.Type = PrimitiveType::Plane;
+		planeDesc.Extent = 1000;
+		pb.GetProperty("y", planeDesc.Center.y);
+		pb.GetProperty("limit", planeDesc.Extent);
 
-		MeshPtr mesh = AssetManager::GetAsset<Mesh>(AssetImporter::ImportMeshAsset("data/meshes/plane.obj", noFlipMeshOptions));
-		m_Meshes[objectName] = mesh;
-		m_MeshesTransforms[mesh].Translation = { 0, y, 0 };
-		m_MeshesTransforms[mesh].Scale = { limit, 1, limit };
+		m_Meshes[objectName] = std::make_shared<Mesh>(planeDesc, L"Plane");
+		return true;
+	}
+
+	if (className == "Heightfield")
+	{
+		char filename[256];
+		if (!pb.GetFilenameProp("file", filename))
+			pb.RequiredProp("file");
+
+		HeightfieldDescription heightfield;
+		if (!AssetImporter::ImportHeightfield(filename, heightfield))
+			pb.SignalError("Could not import heightfield");
+
+		pb.GetProperty("height", heightfield.HeightScale, 0.0f);
+
+		// Neighbouring samples are a unit apart unless the size of the longer side is given
+		PrimitiveDescription heightfieldDesc;
+		heightfieldDesc.Type = PrimitiveType::Heightfield;
+		heightfieldDesc.Extent = 0.5f * (std::max(heightfield.Width, heightfield.Depth) - 1);
+		pb.GetProperty("O", heightfieldDesc.Center);
+
+		float size;
+		if (pb.GetProperty("size", size, 0.001f))
+			heightfieldDesc.Extent = 0.5f * size;
+
+		m_Meshes[objectName] = std::make_shared<Mesh>(heightfieldDesc, std::move(heightfield), L"Heightfield");
 		return true;
 	}
 
@@ -187,7 +210,7 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 		if (!pb.GetFilenameProp("file", filename))
 			pb.RequiredProp("file");
 
-		m_Meshes[objectName] = AssetManager::GetAsset<Mesh>(AssetImporter::ImportMeshAsset(filename, noFlipMeshOptions));
+		m_Meshes[objectName] = RequestMesh(filename, noFlipMeshOptions);
 		return true;
 	}
 
@@ -344,6 +367,7 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 	if (className == "PointLight")
 	{
 		Entity e = m_Scene->CreateEntity(objectName);
+		outEntity = e;
 		auto& light = e.AddComponent<PointLightComponent>();
 		pb.GetProperty("color", light.Color);
 		pb.GetProperty("power", light.Intensity);
@@ -354,6 +378,7 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 	if (className == "SpotLight")
 	{
 		Entity e = m_Scene->CreateEntity(objectName);
+		outEntity = e;
 		auto& light = e.AddComponent<SpotLightComponent>();
 		pb.GetProperty("color", light.Color);
 		pb.GetProperty("power", light.Intensity);
@@ -367,6 +392,7 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 	if (className == "RectLight")
 	{
 		Entity e = m_Scene->CreateEntity(objectName);
+		outEntity = e;
 		pb.GetProperty(e.GetComponent<TransformComponent>());
 
 		glm::vec4 emissive;
@@ -380,7 +406,7 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 		material->SetProperty(MaterialPropertyType::EmissiveColor, emissive * power);
 
 		MeshComponent& mc = e.AddComponent<MeshComponent>();
-		mc.Mesh = AssetManager::GetAsset<Mesh>(AssetImporter::ImportMeshAsset("data/meshes/halfplane.obj", noFlipMeshOptions));
+		mc.Mesh = RequestMesh("data/meshes/halfplane.obj", noFlipMeshOptions);
 		mc.OverrideMaterialTable = std::make_shared<MaterialTable>(1);
 		mc.OverrideMaterialTable->SetMaterial(0, material);
 		return true;
@@ -398,26 +424,117 @@ bool DefaultSceneParser::AddSceneElement(const std::string& className, const std
 		material->SetTexture(MaterialTextureType::Normal, bump);
 
 		Entity node = m_Scene->CreateEntity(objectName);
+		outEntity = node;
 		auto& mc = node.AddComponent<MeshComponent>();
 		pb.GetProperty("geometry", mc.Mesh);
 		pb.GetProperty(node.GetComponent<TransformComponent>());
 
-		auto foundTransform = m_MeshesTransforms.find(mc.Mesh);
-		if (foundTransform != m_MeshesTransforms.end())
-		{
-			auto& tc = node.GetComponent<TransformComponent>();
-			tc.Translation += foundTransform->second.Translation;
-			tc.Scale *= foundTransform->second.Scale;
-		}
-
 		mc.OverrideMaterialTable = std::make_shared<MaterialTable>(1);
 		mc.OverrideMaterialTable->SetMaterial(0, material);
 		return true;
 	}
 
+	// A single entity holding N copies of a geometry, placed on a grid or a jittered grid
+	if (className == "Instances")
+	{
+		MaterialPtr material;
+		pb.GetRequiredProperty("shader", material);
+
+		Entity instances = m_Scene->CreateEntity(objectName);
+		outEntity = instances;
+		auto& imc = instances.AddComponent<InstancedMeshComponent>();
+		pb.GetRequiredProperty("geometry", imc.Mesh);
+		pb.GetProperty(instances.GetComponent<TransformComponent>());
+
+		InstanceScatterDescription scatterDesc;
+		pb.GetRequiredProperty("count", scatterDesc.Count, 1u);
+		pb.GetRequiredProperty("min", scatterDesc.Min);
+		pb.GetRequiredProperty("max", scatterDesc.Max);
+		pb.GetProperty("seed", scatterDesc.Seed);
+
+		// Ranges collapse to their minimum when no maximum is given
+		pb.GetProperty("scaleMin", scatterDesc.ScaleMin, 0.0f);
+		if (!pb.GetProperty("scaleMax", scatterDesc.ScaleMax, scatterDesc.ScaleMin))
+			scatterDesc.ScaleMax = scatterDesc.ScaleMin;
+
+		pb.GetProperty("yawMin", scatterDesc.YawMin);
+		if (!pb.GetProperty("yawMax", scatterDesc.YawMax, scatterDesc.YawMin))
+			scatterDesc.YawMax = scatterDesc.YawMin;
+
+		char mode[256] = "grid";
+		pb.GetProperty("mode", mode);
+		if (!strcmp(mode, "jitter"))
+			scatterDesc.Jitter = true;
+		else if (strcmp(mode, "grid"))
+			pb.SignalError("Unknown instance mode (expected grid or jitter)");
+
+		auto instanceTransforms = std::make_shared<std::vector<glm::mat4>>();
+		GenerateInstanceTransforms(scatterDesc, *instanceTransforms);
+		imc.InstanceTransforms = std::move(instanceTransforms);
+
+		imc.OverrideMaterialTable = std::make_shared<MaterialTable>(1);
+		imc.OverrideMaterialTable->SetMaterial(0, material);
+		return true;
+	}
+
 	return false;
 }
 
+AssetType DefaultSceneParser::GetBlockAssetType(const std::string& className)
+{
+	if (className == "CheckerTexture" || className == "BitmapTexture" || className == "BumpTexture")
+		return AssetType::Texture;
+
+	if (className == "Sphere" || className == "Cube" || className == "Plane" || className == "Heightfield" || className == "Mesh")
+		return AssetType::Mesh;
+
+	if (className == "Lambert" || className == "Phong" || className == "Reflection" || className == "Refraction" || className == "Layered")
+		return AssetType::Material;
+
+	return AssetType::NumTypes;
+}
+
+std::string DefaultSceneParser::GetAssetKey(AssetType type, const std::string& name)
+{
+	return std::to_string((uint32_t)type) + ' ' + name;
+}
+
+void DefaultSceneParser::GenerateInstanceTransforms(const InstanceScatterDescription& desc, std::vector<glm::mat4>& outTransforms)
+{
+	// Instances fill the cells of a square grid on the XZ plane of the [min, max] box. Jittered instances get a random
+	// position inside their cell and a random height, which scatters them without the clumping of pure random placement
+	uint32_t columns = (uint32_t)glm::ceil(glm::sqrt((float)desc.Count));
+	uint32_t rows = (desc.Count + columns - 1) / columns;
+	glm::vec2 cellSize = glm::vec2(desc.Max.x - desc.Min.x, desc.Max.z - desc.Min.z) / glm::vec2(columns, rows);
+
+	std::mt19937 generator(desc.Seed);
+	std::uniform_real_distribution<float> unitSampler(0.0f, 1.0f);
+	std::uniform_real_distribution<float> scaleSampler(desc.ScaleMin, desc.ScaleMax);
+	std::uniform_real_distribution<float> yawSampler(glm::radians(desc.YawMin), glm::radians(desc.YawMax));
+
+	outTransforms.resize(desc.Count);
+
+	for (uint32_t i = 0; i < desc.Count; i++)
+	{
+		glm::vec2 cellOffset = desc.Jitter ? glm::vec2(unitSampler(generator), unitSampler(generator)) : glm::vec2(0.5f);
+		float height = desc.Jitter ? glm::mix(desc.Min.y, desc.Max.y, unitSampler(generator)) : desc.Min.y;
+		float scale = scaleSampler(generator);
+		float yaw = yawSampler(generator);
+
+		glm::vec2 position = glm::vec2(desc.Min.x, desc.Min.z) + (glm::vec2(i % columns, i / columns) + cellOffset) * cellSize;
+
+		// translation * rotationY * scale, written out directly since this runs for every instance
+		float cosYaw = glm::cos(yaw) * scale;
+		float sinYaw = glm::sin(yaw) * scale;
+
+		glm::mat4& transform = outTransforms[i];
+		transform[0] = glm::vec4(cosYaw, 0.0f, -sinYaw, 0.0f);
+		transform[1] = glm::vec4(0.0f, scale, 0.0f, 0.0f);
+		transform[2] = glm::vec4(sinYaw, 0.0f, cosYaw, 0.0f);
+		transform[3] = glm::vec4(position.x, height, position.y, 1.0f);
+	}
+}
+
 bool DefaultSceneParser::ResolveFullPath(char* path)
 {
 	std::string temp = m_SceneRootDirectory;
@@ -431,188 +548,310 @@ bool DefaultSceneParser::ResolveFullPath(char* path)
 	}
 }
 
-static void StripWhiteSpace(char* s)
-{
-	int i = (int)strlen(s) - 1;
-	while (i >= 0 && isspace(s[i])) i--;
-	s[++i] = 0;
-	int l = i;
-	i = 0;
-	while (i < l && isspace(s[i])) i++;
-	if (i > 0 && i < l) {
-		for (int j = 0; j <= l - i; j++)
-			s[j] = s[i + j];
-	}
-}
-
 bool DefaultSceneParser::Parse(const char* filename, Scene* ss, RendererDescription* rendererDesc)
 {
 	m_Scene = ss;
 	m_RendererDescription = rendererDesc;
 	m_CurrentLine = 0;
-
-	//
-	FILE* f = fopen(filename, "rt");
-	if (!f)
+	m_IsParsingObject = false;
+	m_VisitedBlocks.clear();
+	m_AppliedBlocks.clear();
+	m_VisitedAssets.clear();
+	m_AppliedAssets.clear();
+
+	// Only a reload compares against the blocks of the last parse, a new scene starts without any
+	if (!m_IsReloading)
+		m_Blocks.clear();
+
+	Timer parseTimer;
+	parseTimer.Reset();
+	double sceneElementsTime = 0.0;
+
+	// The file is mapped copy-on-write and lines are stripped and null terminated in place,
+	// so the parsed blocks point straight into the mapped view instead of owning copies of their lines
+	MappedFile file(filename, true);
+	if (!file.IsValid())
 	{
 		fprintf(stderr, "Cannot open scene file `%s'!\n", filename);
 		return false;
 	}
 
-	FileRAII fraii(f);
-	char line[1024];
-	bool commentedOut = false;
+	char* data = file.GetData();
+	size_t dataSize = file.GetSize();
+
+	// Every line is terminated by overwriting its '\n', so a last line without one is parsed from a copy that has it
+	std::vector<char> terminatedCopy;
+	if (dataSize > 0 && data[dataSize - 1] != '\n')
+	{
+		terminatedCopy.reserve(dataSize + 1);
+		terminatedCopy.assign(data, data + dataSize);
+		terminatedCopy.push_back('\n');
+		data = terminatedCopy.data();
+		dataSize = terminatedCopy.size();
+	}
+
 	std::vector<ParsedBlockImpl> parsedBlocks;
 	ParsedBlockImpl* cblock = NULL;
 	std::string currentClassName;
 	std::string currentObjectName;
-	while (fgets(line, sizeof(line), f))
+
+	SceneTokenizer tokenizer(data, dataSize, [this](int srcLine, char* line) { ReplaceRandomNumbers(srcLine, line); });
+	SceneToken token;
+	while (tokenizer.Next(token))
 	{
-		m_CurrentLine++;
-		if (commentedOut)
+		m_CurrentLine = token.Line;
+		switch (token.Type)
 		{
-			if (line[0] == '*' && line[1] == '/') commentedOut = false;
-			continue;
-		}
-		char* commentBegin = NULL;
-		if (strstr(line, "//")) commentBegin = strstr(line, "//");
-		if (strstr(line, "#"))
+		case SceneTokenType::BlockBegin:
 		{
-			char* temp = strstr(line, "#");
-			if (!commentBegin || commentBegin > temp) commentBegin = temp;
+			currentClassName = token.ClassName;
+			currentObjectName = token.ObjectName;
+			m_IsParsingObject = true;
+
+			parsedBlocks.push_back(ParsedBlockImpl());
+			cblock = &parsedBlocks[parsedBlocks.size() - 1];
+			cblock->parser = this;
+			cblock->blockBegin = m_CurrentLine;
+			break;
 		}
-		if (commentBegin) *commentBegin = 0;
-		StripWhiteSpace(line);
-		if (strlen(line) == 0) continue; // empty line
-		if (line[0] == '#' || (line[0] == '/' && line[1] == '/')) continue; // comment
-		if (line[0] == '/' && line[1] == '*')
+		case SceneTokenType::Property:
 		{
-			commentedOut = true;
-			continue;
+			// keep the length limits of the fixed size buffers the properties are copied to
+			if (token.PropertyNameLength >= ParsedBlockImpl::MaxPropertyNameLength) token.PropertyName[ParsedBlockImpl::MaxPropertyNameLength - 1] = 0;
+			if (token.PropertyValueLength >= ParsedBlockImpl::MaxPropertyValueLength) token.PropertyValue[ParsedBlockImpl::MaxPropertyValueLength - 1] = 0;
+
+			cblock->m_Lines.emplace_back(m_CurrentLine, token.PropertyName, token.PropertyValue);
+			break;
 		}
-		ReplaceRandomNumbers(m_CurrentLine, line);
-		std::vector<std::string> tokens = Tokenize(line);
-		if (!m_IsParsingObject)
+		case SceneTokenType::BlockEnd:
 		{
-			switch (tokens.size())
-			{
-			case 1:
+			cblock->blockEnd = m_CurrentLine;
+			cblock->BuildPropertyIndex();
+
+			// Hash the block before applying it, reading properties may rewrite their values in place
+			size_t blockHash = 0;
+			HashCombine(blockHash, currentClassName);
+			HashCombine(blockHash, currentObjectName);
+			for (const auto& blockLine : cblock->m_Lines)
 			{
-				if (tokens[0] == "{")
-					fprintf(stderr, "Excess `}' on line %d\n", m_CurrentLine);
-				else
-					fprintf(stderr, "Unexpected token `%s' on line %d\n", tokens[0].c_str(), m_CurrentLine);
-				return false;
+				HashCombine(blockHash, std::string_view(blockLine.propName));
+				HashCombine(blockHash, std::string_view(blockLine.propValue));
 			}
-			case 2:
+
+			// Blocks repeating the class and name of an earlier one are told apart by their order in the file
+			std::string blockKey = currentClassName + ' ' + currentObjectName;
+			for (uint32_t occurrence = 2; m_VisitedBlocks.count(blockKey); occurrence++)
+				blockKey = currentClassName + ' ' + currentObjectName + " #" + std::to_string(occurrence);
+
+			AssetType assetType = GetBlockAssetType(currentClassName);
+			m_VisitedBlocks.insert(blockKey);
+			if (assetType != AssetType::NumTypes)
+				m_VisitedAssets.insert(GetAssetKey(assetType, currentObjectName));
+
+			if (ShouldApplyBlock(blockKey, blockHash))
 			{
-				if (tokens[1] != "{")
-				{
-					fprintf(stderr, "A singleton object definition should end with a `{' (on line %d)\n", m_CurrentLine);
+				// Only a reload finds the entity of an earlier parse, which is replaced once the whole file parsed
+				BlockState& block = m_Blocks[blockKey];
+				if (block.Entity != Uuid::Invalid)
+					m_ReplacedEntities.push_back(block.Entity);
+
+				Entity createdEntity;
+				m_BlockDependencies.clear();
+
+				Timer sceneElementTimer;
+				sceneElementTimer.Reset();
+				try {
+					AddSceneElement(currentClassName, currentObjectName, *cblock, createdEntity);
+				}
+				catch (SyntaxError err) {
+					fprintf(stderr, "%s:%d: Syntax error on line %d: %s\n", filename, err.line, err.line, err.msg);
+					if (m_IsReloading && createdEntity)
+						m_StagedEntities.push_back(createdEntity.GetUUID());
 					return false;
 				}
-				currentClassName = currentObjectName = tokens[0];
-				m_IsParsingObject = true;
-				break;
-			}
-			case 3:
-			{
-				if (tokens[2] != "{")
-				{
-					fprintf(stderr, "A object definition should end with a `{' (on line %d)\n", m_CurrentLine);
+				catch (FileNotFoundError err) {
+					fprintf(stderr, "%s:%d: Required file not found (%s) (required at line %d)\n", filename, err.line, err.filename, err.line);
+					if (m_IsReloading && createdEntity)
+						m_StagedEntities.push_back(createdEntity.GetUUID());
 					return false;
 				}
-				currentClassName = tokens[0];
-				currentObjectName = tokens[1];
-				m_IsParsingObject = true;
-				break;
-			}
-			default:
-			{
-				fprintf(stderr, "Unexpected content on line %d!\n", m_CurrentLine);
-				return false;
-			}
+				sceneElementTimer.Stop();
+				sceneElementsTime += sceneElementTimer.GetElapsedTimeMS();
+
+				block.Hash = blockHash;
+				block.Entity = createdEntity ? createdEntity.GetUUID() : Uuid::Invalid;
+				block.ClassName = currentClassName;
+				block.ObjectName = currentObjectName;
+				block.Dependencies = std::move(m_BlockDependencies);
+				if (m_IsReloading && block.Entity != Uuid::Invalid)
+					m_StagedEntities.push_back(block.Entity);
+
+				m_AppliedBlocks.insert(blockKey);
+				if (assetType != AssetType::NumTypes)
+					m_AppliedAssets.insert(GetAssetKey(assetType, currentObjectName));
+
+				for (int i = 0; i < (int)cblock->m_Lines.size(); i++)
+					if (!cblock->m_Lines[i].recognized)
+						fprintf(stderr, "%s:%d: Warning: the property `%s' isn't recognized!\n", filename, cblock->m_Lines[i].line, cblock->m_Lines[i].propName);
 			}
 
-			if (m_IsParsingObject)
-			{
-				parsedBlocks.push_back(ParsedBlockImpl());
-				cblock = &parsedBlocks[parsedBlocks.size() - 1];
-				cblock->parser = this;
-				cblock->blockBegin = m_CurrentLine;
-			}
-			else
-			{
-				fprintf(stderr, "Unknown object class `%s' on line %d\n", tokens[0].c_str(), m_CurrentLine);
-				return false;
-			}
+			m_IsParsingObject = false;
+			cblock = NULL;
+			currentClassName = currentObjectName = "";
+			break;
 		}
-		else
+		}
+	}
+
+	if (tokenizer.HasError())
+	{
+		fprintf(stderr, "%s\n", tokenizer.GetError().c_str());
+		return false;
+	}
+	m_CurrentLine = tokenizer.GetLineCount();
+
+	parseTimer.Stop();
+	double tokenizeTime = parseTimer.GetElapsedTimeMS() - sceneElementsTime;
+	double fileSizeMB = file.GetSize() / (1024.0 * 1024.0);
+	double throughput = tokenizeTime > 0.0 ? fileSizeMB / (tokenizeTime / 1000.0) : 0.0;
+	HEXRAY_INFO("Scene Parser: Parsed {} ({} lines, {:.2f} MB): tokenizing {:.2f} ms ({:.1f} MB/s), scene elements {:.2f} ms",
+		filename, m_CurrentLine, fileSizeMB, tokenizeTime, throughput, sceneElementsTime);
+
+	return PostParse(filename, parsedBlocks);
+}
+
+bool DefaultSceneParser::Reload(const char* filename, bool& outRendererDescriptionChanged)
+{
+	Timer reloadTimer;
+	reloadTimer.Reset();
+
+	// Everything a failed reload could have changed besides the staged entities. Blocks also edit materials other blocks
+	// created, nodes set the bump map of their shader, so the contents of the materials the scene uses are copied as well
+	std::unordered_map<std::string, BlockState> blocks = m_Blocks;
+	std::unordered_map<std::string, MaterialPtr> materials = m_Materials;
+	std::vector<std::pair<MaterialPtr, Material>> materialContents;
+	materialContents.reserve(m_Materials.size());
+	for (const auto& [name, material] : m_Materials)
+		if (material)
+			materialContents.emplace_back(material, *material);
+
+	std::unordered_map<std::string, MeshPtr> meshes = m_Meshes;
+	std::unordered_map<std::string, TexturePtr> textures = m_Textures;
+	Camera camera = m_Scene->GetCamera();
+	RendererDescription rendererDescription = *m_RendererDescription;
+
+	m_StagedEntities.clear();
+	m_ReplacedEntities.clear();
+
+	m_IsReloading = true;
+	bool result = Parse(filename, m_Scene, m_RendererDescription);
+	m_IsReloading = false;
+
+	std::vector<Uuid>& deletedEntities = result ? m_ReplacedEntities : m_StagedEntities;
+	for (Uuid id : deletedEntities)
+	{
+		Entity entity = m_Scene->FindEntityByUUID(id);
+		if (entity)
+			m_Scene->DeleteEntity(entity);
+	}
+
+	m_StagedEntities.clear();
+	m_ReplacedEntities.clear();
+
+	if (!result)
+	{
+		m_Blocks = std::move(blocks);
+		m_Materials = std::move(materials);
+		for (auto& [material, contents] : materialContents)
+			*material = contents;
+
+		m_Meshes = std::move(meshes);
+		m_Textures = std::move(textures);
+		m_Scene->GetCamera() = camera;
+		*m_RendererDescription = rendererDescription;
+
+		ClearAssetRequests();
+		m_AppliedBlocks.clear();
+		m_IsParsingObject = false;
+
+		HEXRAY_WARNING("Scene Parser: Failed reloading {}, rolled back to the last good scene", filename);
+		outRendererDescriptionChanged = false;
+		return false;
+	}
+
+	outRendererDescriptionChanged = m_AppliedBlocks.count("GlobalSettings GlobalSettings") > 0;
+
+	reloadTimer.Stop();
+	HEXRAY_INFO("Scene Parser: Reloaded {}, re-applied {} of {} blocks in {:.2f} ms", filename, m_AppliedBlocks.size(), m_Blocks.size(), reloadTimer.GetElapsedTimeMS());
+	return result;
+}
+
+bool DefaultSceneParser::ShouldApplyBlock(const std::string& blockKey, size_t blockHash) const
+{
+	if (!m_IsReloading)
+		return true;
+
+	auto found = m_Blocks.find(blockKey);
+	if (found == m_Blocks.end() || found->second.Hash != blockHash)
+		return true;
+
+	// Unchanged blocks still have to be re-applied when an asset they looked up by name was replaced
+	for (const std::string& dependency : found->second.Dependencies)
+		if (m_AppliedAssets.count(dependency))
+			return true;
+
+	return false;
+}
+
+void DefaultSceneParser::RemoveStaleBlocks()
+{
+	for (auto it = m_Blocks.begin(); it != m_Blocks.end();)
+	{
+		if (m_VisitedBlocks.count(it->first))
 		{
-			if (tokens.size() == 1)
-			{
-				if (tokens[0] == "}")
-				{
-					cblock->blockEnd = m_CurrentLine;
+			++it;
+			continue;
+		}
 
-					try {
-						AddSceneElement(currentClassName, currentObjectName, *cblock);
-					}
-					catch (SyntaxError err) {
-						fprintf(stderr, "%s:%d: Syntax error on line %d: %s\n", filename, err.line, err.line, err.msg);
-						return false;
-					}
-					catch (FileNotFoundError err) {
-						fprintf(stderr, "%s:%d: Required file not found (%s) (required at line %d)\n", filename, err.line, err.filename, err.line);
-						return false;
-					}
-					for (int i = 0; i < (int)cblock->m_Lines.size(); i++)
-						if (!cblock->m_Lines[i].recognized)
-							fprintf(stderr, "%s:%d: Warning: the property `%s' isn't recognized!\n", filename, cblock->m_Lines[i].line, cblock->m_Lines[i].propName);
+		if (it->second.Entity != Uuid::Invalid)
+		{
+			Entity entity = m_Scene->FindEntityByUUID(it->second.Entity);
+			if (entity)
+				m_Scene->DeleteEntity(entity);
+		}
 
-					m_IsParsingObject = false;
-					cblock = NULL;
-					currentClassName = currentObjectName = "";
-				}
-				else
-				{
-					fprintf(stderr, "Unexpected token in object definition on line %d: `%s'\n", m_CurrentLine, tokens[0].c_str());
-					return false;
-				}
-			}
+		// The asset stays when another block defines one of the same type and name now, e.g. after its class was changed
+		AssetType assetType = GetBlockAssetType(it->second.ClassName);
+		if (assetType != AssetType::NumTypes && !m_VisitedAssets.count(GetAssetKey(assetType, it->second.ObjectName)))
+		{
+			if (assetType == AssetType::Material)
+				m_Materials.erase(it->second.ObjectName);
+			else if (assetType == AssetType::Mesh)
+				m_Meshes.erase(it->second.ObjectName);
 			else
-			{
-				// try to find a property with that name...
-				int i = (int)tokens[0].length();
-				while (isspace(line[i])) i++;
-				int l = (int)strlen(line) - 1;
-				if (i < l && line[i] == '"' && line[l] == '"')
-				{ // strip the quotes of a quoted argument
-					line[l] = 0;
-					i++;
-				}
-				ParsedBlockImpl::LineInfo info;
-				cblock->m_Lines.push_back(ParsedBlockImpl::LineInfo(m_CurrentLine, tokens[0].c_str(), line + i));
-			}
+				m_Textures.erase(it->second.ObjectName);
 		}
-	}
 
-	return PostParse(filename, parsedBlocks);
+		it = m_Blocks.erase(it);
+	}
 }
 
 MaterialPtr DefaultSceneParser::FindMaterialByName(const char* name) const
 {
+	m_BlockDependencies.push_back(GetAssetKey(AssetType::Material, name));
 	auto found = m_Materials.find(name);
 	return found != m_Materials.end() ? found->second : nullptr;
 }
 
 MeshPtr DefaultSceneParser::FindMeshByName(const char* name) const
 {
+	m_BlockDependencies.push_back(GetAssetKey(AssetType::Mesh, name));
 	auto found = m_Meshes.find(name);
 	return found != m_Meshes.end() ? found->second : nullptr;
 }
 TexturePtr DefaultSceneParser::FindTextureByName(const char* name) const
 {
+	m_BlockDependencies.push_back(GetAssetKey(AssetType::Texture, name));
 	auto found = m_Textures.find(name);
 	return found != m_Textures.end() ? found->second : nullptr;
 }
@@ -625,9 +864,120 @@ bool DefaultSceneParser::PostParse(const char* filename, std::vector<ParsedBlock
 		return false;
 	}
 
+	if (m_IsReloading)
+		RemoveStaleBlocks();
+
+	ResolveAssetRequests();
 	return true;
 }
 
+TexturePtr DefaultSceneParser::RequestTexture(const std::filesystem::path& sourceFilepath, const TextureImportOptions& options)
+{
+	auto found = m_TextureRequestIndices.find(sourceFilepath.string());
+	if (found != m_TextureRequestIndices.end())
+		return m_TexturePlaceholders[found->second];
+
+	m_TextureRequestIndices[sourceFilepath.string()] = (uint32_t)m_TextureRequests.size();
+	m_TextureRequests.push_back({ sourceFilepath, options });
+	m_TexturePlaceholders.push_back(DefaultResources::GetColorTexture(glm::vec4(1.0f)));
+	return m_TexturePlaceholders.back();
+}
+
+MeshPtr DefaultSceneParser::RequestMesh(const std::filesystem::path& sourceFilepath, const MeshImportOptions& options)
+{
+	auto found = m_MeshRequestIndices.find(sourceFilepath.string());
+	if (found != m_MeshRequestIndices.end())
+		return m_MeshPlaceholders[found->second];
+
+	m_MeshRequestIndices[sourceFilepath.string()] = (uint32_t)m_MeshRequests.size();
+	m_MeshRequests.push_back({ sourceFilepath, options });
+	m_MeshPlaceholders.push_back(std::make_shared<Mesh>(MeshDescription(), sourceFilepath.stem().wstring().c_str())); // no submeshes, so no GPU resources
+	return m_MeshPlaceholders.back();
+}
+
+void DefaultSceneParser::ResolveAssetRequests()
+{
+	Timer resolveTimer;
+	resolveTimer.Reset();
+
+	std::vector<Uuid> textureIDs = AssetImporter::ImportTextureAssets(m_TextureRequests);
+	std::vector<Uuid> meshIDs = AssetImporter::ImportMeshAssets(m_MeshRequests);
+
+	std::unordered_map<TexturePtr, TexturePtr> resolvedTextures;
+	for (uint32_t i = 0; i < textureIDs.size(); i++)
+		resolvedTextures[m_TexturePlaceholders[i]] = AssetManager::GetAsset<Texture>(textureIDs[i]);
+
+	std::unordered_map<MeshPtr, MeshPtr> resolvedMeshes;
+	for (uint32_t i = 0; i < meshIDs.size(); i++)
+		resolvedMeshes[m_MeshPlaceholders[i]] = AssetManager::GetAsset<Mesh>(meshIDs[i]);
+
+	auto resolveTexture = [&resolvedTextures](TexturePtr& texture)
+	{
+		auto found = resolvedTextures.find(texture);
+		if (found != resolvedTextures.end()) texture = found->second;
+	};
+
+	auto resolveMesh = [&resolvedMeshes](MeshPtr& mesh)
+	{
+		auto found = resolvedMeshes.find(mesh);
+		if (found != resolvedMeshes.end()) mesh = found->second;
+	};
+
+	std::unordered_set<Material*> patchedMaterials;
+	auto patchMaterial = [&](const MaterialPtr& material)
+	{
+		if (!material || !patchedMaterials.insert(material.get()).second) return;
+		for (TexturePtr& texture : material->m_Textures)
+			resolveTexture(texture);
+	};
+
+	// Patch everything that captured a placeholder while parsing
+	for (auto& [name, texture] : m_Textures)
+		resolveTexture(texture);
+
+	for (auto& [name, mesh] : m_Meshes)
+		resolveMesh(mesh);
+
+	for (auto& [name, material] : m_Materials)
+		patchMaterial(material);
+
+	for (auto entity : m_Scene->m_Registry.view<MeshComponent>())
+	{
+		auto& mc = m_Scene->m_Registry.get<MeshComponent>(entity);
+		resolveMesh(mc.Mesh);
+		if (mc.OverrideMaterialTable)
+			for (const MaterialPtr& material : *mc.OverrideMaterialTable)
+				patchMaterial(material);
+	}
+
+	for (auto entity : m_Scene->m_Registry.view<InstancedMeshComponent>())
+	{
+		auto& imc = m_Scene->m_Registry.get<InstancedMeshComponent>(entity);
+		resolveMesh(imc.Mesh);
+		if (imc.OverrideMaterialTable)
+			for (const MaterialPtr& material : *imc.OverrideMaterialTable)
+				patchMaterial(material);
+	}
+
+	for (auto entity : m_Scene->m_Registry.view<SkyLightComponent>())
+		resolveTexture(m_Scene->m_Registry.get<SkyLightComponent>(entity).EnvironmentMap);
+
+	resolveTimer.Stop();
+	HEXRAY_INFO("Scene Parser: Resolved {} textures and {} meshes in {:.2f} ms", m_TextureRequests.size(), m_MeshRequests.size(), resolveTimer.GetElapsedTimeMS());
+
+	ClearAssetRequests();
+}
+
+void DefaultSceneParser::ClearAssetRequests()
+{
+	m_TextureRequests.clear();
+	m_TexturePlaceholders.clear();
+	m_TextureRequestIndices.clear();
+	m_MeshRequests.clear();
+	m_MeshPlaceholders.clear();
+	m_MeshRequestIndices.clear();
+}
+
 void DefaultSceneParser::ReplaceRandomNumbers(int srcLine, char s[])
 {
 	static std::mt19937 generator; // mersenne twister generator
@@ -4,32 +4,79 @@
 #include "rendering/material.h"
 #include "rendering/mesh.h"
 #include "scene/component.h"
+#include "asset/assetimporter.h"
 
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <vector>
 
 class ParsedBlockImpl;
 class Scene;
+class Entity;
 struct RendererDescription;
 
 
+struct InstanceScatterDescription
+{
+	uint32_t Count = 1;
+	bool Jitter = false;
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+	float ScaleMin = 1.0f;
+	float ScaleMax = 1.0f;
+	float YawMin = 0.0f;
+	float YawMax = 0.0f;
+	uint32_t Seed = 0;
+};
+
 class DefaultSceneParser : public SceneParser
 {
 public:
 	DefaultSceneParser();
 	~DefaultSceneParser();
 
-	bool AddSceneElement(const std::string& className, const std::string& objectName, ParsedBlockImpl& pb);
+	bool AddSceneElement(const std::string& className, const std::string& objectName, ParsedBlockImpl& pb, Entity& outEntity);
 	virtual bool ResolveFullPath(char* path);
 	virtual MaterialPtr FindMaterialByName(const char* name) const;
 	virtual TexturePtr FindTextureByName(const char* name) const;
 	virtual MeshPtr FindMeshByName(const char* name) const;
 
 	bool Parse(const char* filename, Scene* s, RendererDescription* rendererDesc);
+
+	// Parses the file again into the scene of the last Parse and only applies the blocks that changed since then, together
+	// with every block that looks up a changed one by name. Entities of re-applied or removed blocks are replaced in place.
+	// Re-applied blocks are staged next to the entities they replace, which are only deleted once the whole file parsed.
+	// A failed reload deletes the staged entities and restores the scene and the block state of the last good parse
+	bool Reload(const char* filename, bool& outRendererDescriptionChanged);
+
+	inline bool HasParsed() const { return m_Scene != nullptr; }
 private:
+	struct BlockState
+	{
+		size_t Hash = 0;
+		Uuid Entity = Uuid::Invalid;
+		std::string ClassName;
+		std::string ObjectName;
+		std::vector<std::string> Dependencies;
+	};
+
+	bool ShouldApplyBlock(const std::string& blockKey, size_t blockHash) const;
+	void RemoveStaleBlocks();
 	bool PostParse(const char* filename, std::vector<ParsedBlockImpl>& parsedBlocks);
 	void ReplaceRandomNumbers(int srcLine, char line[]);
+	void GenerateInstanceTransforms(const InstanceScatterDescription& desc, std::vector<glm::mat4>& outTransforms);
+
+	// Textures, meshes and materials are looked up by name within their own type, other blocks don't define assets
+	static AssetType GetBlockAssetType(const std::string& className);
+	static std::string GetAssetKey(AssetType type, const std::string& name);
+
+	// Assets are only requested while parsing and imported in one batch after the whole file is read.
+	// Until then the scene holds CPU-only placeholders that get swapped for the imported assets
+	TexturePtr RequestTexture(const std::filesystem::path& sourceFilepath, const TextureImportOptions& options);
+	MeshPtr RequestMesh(const std::filesystem::path& sourceFilepath, const MeshImportOptions& options);
+	void ResolveAssetRequests();
+	void ClearAssetRequests();
 private:
 	Scene* m_Scene;
 	RendererDescription* m_RendererDescription;
@@ -37,9 +84,27 @@ private:
 	std::unordered_map<std::string, MaterialPtr> m_Materials;
 	std::unordered_map<std::string, MeshPtr> m_Meshes;
 	std::unordered_map<std::string, TexturePtr> m_Textures;
-	std::unordered_map<MeshPtr, TransformComponent> m_MeshesTransforms;
+
+	std::vector<TextureImportRequest> m_TextureRequests;
+	std::vector<TexturePtr> m_TexturePlaceholders;
+	std::unordered_map<std::string, uint32_t> m_TextureRequestIndices;
+	std::vector<MeshImportRequest> m_MeshRequests;
+	std::vector<MeshPtr> m_MeshPlaceholders;
+	std::unordered_map<std::string, uint32_t> m_MeshRequestIndices;
+
+	// Blocks are tracked by class and object name so a reload can tell which ones changed and which entities they own.
+	// Blocks depend on the assets they look up by name, which are tracked by asset type and name
+	std::unordered_map<std::string, BlockState> m_Blocks;
+	std::unordered_set<std::string> m_VisitedBlocks;
+	std::unordered_set<std::string> m_AppliedBlocks;
+	std::unordered_set<std::string> m_VisitedAssets;
+	std::unordered_set<std::string> m_AppliedAssets;
+	mutable std::vector<std::string> m_BlockDependencies;
+	std::vector<Uuid> m_StagedEntities;
+	std::vector<Uuid> m_ReplacedEntities;
 
 	std::string m_SceneRootDirectory;
 	int m_CurrentLine;
 	bool m_IsParsingObject;
+	bool m_IsReloading;
 };
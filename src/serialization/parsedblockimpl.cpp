@@ -87,16 +87,46 @@ FileNotFoundError::FileNotFoundError(int line, const char* filename)
 	strcpy(this->filename, filename);
 }
 
-bool ParsedBlockImpl::FindProperty(const char* name, int& i_s, int& line_s, char*& value)
+size_t ParsedBlockImpl::CaseInsensitiveHash::operator()(std::string_view str) const
 {
-	for (int i = 0; i < (int)m_Lines.size(); i++) if (!stricmp(m_Lines[i].propName, name)) {
-		i_s = i;
-		line_s = m_Lines[i].line;
-		value = m_Lines[i].propValue;
-		m_Lines[i].recognized = true;
-		return true;
+	// FNV-1a over the lower case characters
+	size_t hash = 14695981039346656037ull;
+	for (char c : str)
+	{
+		hash ^= (size_t)tolower((unsigned char)c);
+		hash *= 1099511628211ull;
 	}
-	return false;
+	return hash;
+}
+
+bool ParsedBlockImpl::CaseInsensitiveEqual::operator()(std::string_view a, std::string_view b) const
+{
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+	return true;
+}
+
+void ParsedBlockImpl::BuildPropertyIndex()
+{
+	// Called once the whole block is read. Only the first line of a repeated property is indexed, same as the lookups always did
+	m_PropertyIndex.clear();
+	m_PropertyIndex.reserve(m_Lines.size());
+	for (int i = 0; i < (int)m_Lines.size(); i++)
+		m_PropertyIndex.emplace(m_Lines[i].propName, i);
+}
+
+bool ParsedBlockImpl::FindProperty(const char* name, int& i_s, int& line_s, char*& value)
+{
+	auto found = m_PropertyIndex.find(name);
+	if (found == m_PropertyIndex.end()) return false;
+
+	int i = found->second;
+	i_s = i;
+	line_s = m_Lines[i].line;
+	value = m_Lines[i].propValue;
+	m_Lines[i].recognized = true;
+	return true;
 }
 
 #define PBEGIN\
@@ -2,6 +2,8 @@
 #include "serialization/parsedblock.h"
 
 #include <vector>
+#include <unordered_map>
+#include <string_view>
 
 class SceneParser;
 
@@ -27,6 +29,7 @@ public:
 	virtual bool GetProperty(const char* name, char* value);
 
 	bool FindProperty(const char* name, int& i_s, int& line_s, char*& value);
+	void BuildPropertyIndex();
 	virtual bool GetFilenameProp(const char* name, char* value);
 	virtual void GetProperty(TransformComponent& T);
 
@@ -38,22 +41,33 @@ public:
 	void GetBlockLine(int idx, int& srcLine, char head[], char tail[]);
 private:
 	friend class DefaultSceneParser;
+	static constexpr int MaxPropertyNameLength = 128;
+	static constexpr int MaxPropertyValueLength = 256;
+
+	// The name and value point into the scene file buffer of the parser, which outlives the block
 	struct LineInfo
 	{
 		int line;
-		char propName[128];
-		char propValue[256];
+		const char* propName;
+		char* propValue;
 		bool recognized;
 
 		LineInfo() {}
-		LineInfo(int line, const char* name, const char* value) : line(line)
-		{
-			strncpy(propName, name, sizeof(propName) - 1);
-			strncpy(propValue, value, sizeof(propValue) - 1);
-			recognized = false;
-		}
+		LineInfo(int line, const char* name, char* value) : line(line), propName(name), propValue(value), recognized(false) {}
+	};
+
+	struct CaseInsensitiveHash
+	{
+		size_t operator()(std::string_view str) const;
 	};
+
+	struct CaseInsensitiveEqual
+	{
+		bool operator()(std::string_view a, std::string_view b) const;
+	};
+
 	std::vector<LineInfo> m_Lines;
+	std::unordered_map<std::string_view, int, CaseInsensitiveHash, CaseInsensitiveEqual> m_PropertyIndex; // property name -> first line with that name
 	int blockBegin, blockEnd; // line numbers
 	SceneParser* parser;
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "scenetokenizer.h"
+
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+SceneTokenizer::SceneTokenizer(char* data, size_t size, std::function<void(int, char*)> replaceRandomNumbers)
+	: m_Cursor(data), m_End(data + size), m_Line(0), m_IsInsideBlock(false), m_IsCommentedOut(false), m_ReplaceRandomNumbers(std::move(replaceRandomNumbers))
+{
+}
+
+bool SceneTokenizer::Next(SceneToken& outToken)
+{
+	while (m_Cursor < m_End)
+	{
+		char* line = m_Cursor;
+		char* lineEnd = (char*)memchr(m_Cursor, '\n', m_End - m_Cursor);
+		m_Cursor = lineEnd + 1;
+		*lineEnd = 0;
+
+		m_Line++;
+		if (m_IsCommentedOut)
+		{
+			if (line[0] == '*' && line[1] == '/') m_IsCommentedOut = false;
+			continue;
+		}
+
+		// Single pass over the line: cut it at the first comment and remember whether it needs random numbers replaced
+		bool hasRandomNumbers = false;
+		for (char* c = line; c < lineEnd; c++)
+		{
+			if (*c == '#' || (*c == '/' && c[1] == '/'))
+			{
+				lineEnd = c;
+				break;
+			}
+			if (*c == 'r' && !strncmp(c, "rand", 4)) hasRandomNumbers = true;
+		}
+
+		while (line < lineEnd && isspace((unsigned char)*line)) line++;
+		while (lineEnd > line && isspace((unsigned char)lineEnd[-1])) lineEnd--;
+		*lineEnd = 0;
+
+		if (line == lineEnd) continue; // empty line
+		if (line[0] == '/' && line[1] == '*')
+		{
+			m_IsCommentedOut = true;
+			continue;
+		}
+		if (hasRandomNumbers && m_ReplaceRandomNumbers) m_ReplaceRandomNumbers(m_Line, line);
+
+		// Tokens are views into the line, only the first three are needed to classify it
+		std::string_view tokens[3];
+		int tokenCount = 0;
+		for (char* c = line; c < lineEnd && tokenCount < 4;)
+		{
+			while (c < lineEnd && isspace((unsigned char)*c)) c++;
+			if (c == lineEnd) break;
+			char* tokenBegin = c;
+			while (c < lineEnd && !isspace((unsigned char)*c)) c++;
+			if (tokenCount < 3) tokens[tokenCount] = std::string_view(tokenBegin, c - tokenBegin);
+			tokenCount++;
+		}
+
+		outToken = SceneToken();
+		outToken.Line = m_Line;
+
+		if (!m_IsInsideBlock)
+		{
+			switch (tokenCount)
+			{
+			case 1:
+			{
+				if (tokens[0] == "{")
+					return SetError("Excess `}' on line %d", m_Line);
+				return SetError("Unexpected token `%.*s' on line %d", (int)tokens[0].size(), tokens[0].data(), m_Line);
+			}
+			case 2:
+			{
+				if (tokens[1] != "{")
+					return SetError("A singleton object definition should end with a `{' (on line %d)", m_Line);
+				outToken.ClassName = outToken.ObjectName = tokens[0];
+				break;
+			}
+			case 3:
+			{
+				if (tokens[2] != "{")
+					return SetError("A object definition should end with a `{' (on line %d)", m_Line);
+				outToken.ClassName = tokens[0];
+				outToken.ObjectName = tokens[1];
+				break;
+			}
+			default:
+				return SetError("Unexpected content on line %d!", m_Line);
+			}
+
+			outToken.Type = SceneTokenType::BlockBegin;
+			m_IsInsideBlock = true;
+			return true;
+		}
+
+		if (tokenCount == 1)
+		{
+			if (tokens[0] != "}")
+				return SetError("Unexpected token in object definition on line %d: `%.*s'", m_Line, (int)tokens[0].size(), tokens[0].data());
+
+			outToken.Type = SceneTokenType::BlockEnd;
+			m_IsInsideBlock = false;
+			return true;
+		}
+
+		// split the line in place into a property name and a value
+		char* name = line;
+		char* value = line + tokens[0].size();
+		while (isspace((unsigned char)*value)) value++;
+		name[tokens[0].size()] = 0;
+
+		char* valueEnd = lineEnd;
+		if (value < valueEnd - 1 && value[0] == '"' && valueEnd[-1] == '"')
+		{ // strip the quotes of a quoted argument
+			*(--valueEnd) = 0;
+			value++;
+		}
+
+		outToken.Type = SceneTokenType::Property;
+		outToken.PropertyName = name;
+		outToken.PropertyValue = value;
+		outToken.PropertyNameLength = tokens[0].size();
+		outToken.PropertyValueLength = valueEnd - value;
+		return true;
+	}
+
+	return false;
+}
+
+bool SceneTokenizer::SetError(const char* format, ...)
+{
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	m_Error = message;
+	return false;
+}
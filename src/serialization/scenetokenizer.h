@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+enum class SceneTokenType
+{
+	BlockBegin,
+	Property,
+	BlockEnd
+};
+
+struct SceneToken
+{
+	SceneTokenType Type = SceneTokenType::BlockEnd;
+	int Line = 0;
+
+	// Block headers, singleton blocks use their class as the object name
+	std::string_view ClassName;
+	std::string_view ObjectName;
+
+	// Properties, null terminated inside the tokenized buffer. Quotes around the value are stripped
+	char* PropertyName = nullptr;
+	char* PropertyValue = nullptr;
+	size_t PropertyNameLength = 0;
+	size_t PropertyValueLength = 0;
+};
+
+// Splits a scene file into block headers, properties and block ends without interpreting them. The buffer is tokenized in
+// place, lines are stripped and null terminated inside it, so tokens point straight into the buffer and it has to outlive them
+class SceneTokenizer
+{
+public:
+	// The buffer has to end with a '\n'. Lines using random numbers are passed to replaceRandomNumbers before they are split
+	SceneTokenizer(char* data, size_t size, std::function<void(int, char*)> replaceRandomNumbers = nullptr);
+
+	// Returns false at the end of the buffer or on a syntax error, which HasError tells apart
+	bool Next(SceneToken& outToken);
+
+	inline bool HasError() const { return !m_Error.empty(); }
+	inline const std::string& GetError() const { return m_Error; }
+	inline int GetLineCount() const { return m_Line; }
+	inline bool IsInsideBlock() const { return m_IsInsideBlock; }
+private:
+	bool SetError(const char* format, ...);
+private:
+	char* m_Cursor;
+	char* m_End;
+	int m_Line;
+	bool m_IsInsideBlock;
+	bool m_IsCommentedOut;
+	std::string m_Error;
+	std::function<void(int, char*)> m_ReplaceRandomNumbers;
+};
@@ -0,0 +1,169 @@
+#include "testframework.h"
+
+#include "core/timer.h"
+#include "rendering/descriptorallocator.h"
+
+#include <random>
+#include <thread>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Threads allocate, release and defer releases concurrently while the main thread advances frames and processes the deferred
+// releases, like the render thread does. Every slot tracks who owns it, so a slot handed out twice, a deferred slot handed out
+// before its frame was processed or a slot that never comes back to the free list fails the benchmark
+TEST_CASE(DescriptorAllocatorConcurrentStress)
+{
+    enum SlotState : uint32_t
+    {
+        Free,
+        Allocated,
+        PendingRelease,
+    };
+
+    const uint32_t threadCount = 32;
+    const uint32_t operationCount = 200000;
+    const uint32_t maxHeldCount = 96;
+    const uint32_t capacity = 16384;
+
+    DescriptorAllocator allocator(capacity);
+    std::unique_ptr<std::atomic<uint32_t>[]> slotStates(new std::atomic<uint32_t>[capacity]);
+    std::unique_ptr<std::atomic<uint64_t>[]> slotReleaseFrames(new std::atomic<uint64_t>[capacity]);
+    for (uint32_t slot = 0; slot < capacity; slot++)
+    {
+        slotStates[slot].store(Free);
+        slotReleaseFrames[slot].store(0);
+    }
+
+    // Deferred releases go to the list of the current frame, whose previous contents were processed when the frame started
+    std::atomic<uint64_t> currentFrame = FRAMES_IN_FLIGHT;
+    std::atomic<uint64_t> processingFrame = FRAMES_IN_FLIGHT;
+    std::atomic<uint32_t> runningThreadCount = threadCount;
+    std::atomic<uint32_t> duplicateCount = 0;
+    std::atomic<uint32_t> earlyReuseCount = 0;
+    std::atomic<uint32_t> staleCount = 0;
+    std::atomic<uint64_t> failedAllocationCount = 0;
+
+    auto worker = [&](uint32_t threadIndex)
+    {
+        std::mt19937 generator(threadIndex);
+        std::vector<DescriptorIndex> heldIndices;
+        heldIndices.reserve(maxHeldCount);
+
+        auto release = [&](DescriptorIndex index, bool deferred)
+        {
+            uint32_t slot = GetDescriptorSlot(index);
+            if (!allocator.IsValid(index))
+                staleCount++;
+
+            if (deferred)
+            {
+                uint64_t frame = currentFrame.load();
+                slotReleaseFrames[slot].store(frame);
+                slotStates[slot].store(PendingRelease);
+                allocator.ReleaseDeferred(index, frame % FRAMES_IN_FLIGHT);
+            }
+            else
+            {
+                slotStates[slot].store(Free);
+                allocator.Release(index);
+            }
+        };
+
+        for (uint32_t i = 0; i < operationCount; i++)
+        {
+            bool shouldAllocate = heldIndices.empty() || (heldIndices.size() < maxHeldCount && (generator() & 1));
+            if (shouldAllocate)
+            {
+                DescriptorIndex index = allocator.Allocate();
+                if (index == InvalidDescriptorIndex)
+                {
+                    // Everything free is waiting for the next frame, give the main thread a chance to process it
+                    failedAllocationCount++;
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                uint32_t slot = GetDescriptorSlot(index);
+                uint32_t previousState = slotStates[slot].exchange(Allocated);
+                if (previousState == Allocated)
+                    duplicateCount++;
+
+                // A deferred slot may only come back once a frame at least FRAMES_IN_FLIGHT later started processing its list
+                if (previousState == PendingRelease && processingFrame.load() < slotReleaseFrames[slot].load() + FRAMES_IN_FLIGHT)
+                    earlyReuseCount++;
+
+                heldIndices.push_back(index);
+            }
+            else
+            {
+                size_t heldIndex = generator() % heldIndices.size();
+                DescriptorIndex index = heldIndices[heldIndex];
+                heldIndices[heldIndex] = heldIndices.back();
+                heldIndices.pop_back();
+
+                release(index, generator() % 3 == 0);
+            }
+        }
+
+        for (DescriptorIndex index : heldIndices)
+            release(index, true);
+
+        runningThreadCount--;
+    };
+
+    Timer timer;
+    timer.Reset();
+
+    std::vector<std::thread> threads;
+    for (uint32_t threadIndex = 0; threadIndex < threadCount; threadIndex++)
+        threads.emplace_back(worker, threadIndex);
+
+    // The main thread plays the render thread, which processes the deferred releases of a frame when the frame begins
+    auto advanceFrame = [&]()
+    {
+        uint64_t frame = currentFrame.load() + 1;
+        processingFrame.store(frame);
+        allocator.ProcessDeferredReleases(frame % FRAMES_IN_FLIGHT);
+        currentFrame.store(frame);
+    };
+
+    uint64_t startFrame = currentFrame.load();
+    while (runningThreadCount.load() > 0)
+    {
+        advanceFrame();
+        std::this_thread::yield();
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    timer.Stop();
+
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+        advanceFrame();
+
+    // Every slot has to be back on the free list, so a single thread gets all of them exactly once
+    CHECK(allocator.GetAllocatedCount() == 0);
+
+    std::vector<bool> isAllocated(capacity, false);
+    uint32_t allocatedCount = 0;
+    uint32_t finalDuplicateCount = 0;
+    for (DescriptorIndex index = allocator.Allocate(); index != InvalidDescriptorIndex; index = allocator.Allocate())
+    {
+        uint32_t slot = GetDescriptorSlot(index);
+        finalDuplicateCount += isAllocated[slot] ? 1 : 0;
+        isAllocated[slot] = true;
+        allocatedCount++;
+    }
+
+    CHECK(duplicateCount.load() == 0);
+    CHECK(earlyReuseCount.load() == 0);
+    CHECK(staleCount.load() == 0);
+    CHECK(finalDuplicateCount == 0);
+    CHECK(allocatedCount == capacity);
+    CHECK(allocator.GetAllocatedCount() == capacity);
+
+    uint64_t totalOperationCount = uint64_t(threadCount) * operationCount;
+    HEXRAY_INFO("{} threads, {} operations in {:.2f} ms ({:.1f} M ops/s), {} frames, {} failed allocations, {} duplicates, {} early reuses, {} of {} slots recovered",
+        threadCount, totalOperationCount, timer.GetElapsedTimeMS(), totalOperationCount / timer.GetElapsedTimeMS() / 1000.0, currentFrame.load() - startFrame,
+        failedAllocationCount.load(), duplicateCount.load() + finalDuplicateCount, earlyReuseCount.load(), allocatedCount, capacity);
+}
@@ -0,0 +1,158 @@
+#include "testframework.h"
+
+#include "core/timer.h"
+#include "rendering/heightfield.h"
+
+#include <random>
+
+struct HeightfieldRay
+{
+    glm::vec3 Origin;
+    glm::vec3 Direction;
+};
+
+struct HeightfieldHit
+{
+    bool Hit = false;
+    float T = 0.0f;
+    glm::vec3 Normal = glm::vec3(0.0f);
+};
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static HeightfieldDescription CreateTerrain(uint32_t sampleCount)
+{
+    HeightfieldDescription heightfield;
+    heightfield.Width = sampleCount;
+    heightfield.Depth = sampleCount;
+    heightfield.HeightScale = 0.4f;
+    heightfield.Heights.resize(sampleCount * sampleCount);
+
+    // A few octaves of waves with some noise on top, so the pyramid has both smooth and rough regions
+    std::mt19937 generator(sampleCount);
+    std::uniform_real_distribution<float> noise(-0.02f, 0.02f);
+
+    for (uint32_t z = 0; z < sampleCount; z++)
+    {
+        for (uint32_t x = 0; x < sampleCount; x++)
+        {
+            float u = float(x) / (sampleCount - 1);
+            float v = float(z) / (sampleCount - 1);
+            float height = 0.5f + 0.25f * glm::sin(u * 6.0f) * glm::cos(v * 5.0f) + 0.1f * glm::sin(u * 23.0f + v * 17.0f) + noise(generator);
+            heightfield.Heights[z * sampleCount + x] = uint16_t(glm::clamp(height, 0.0f, 1.0f) * 65535.0f);
+        }
+    }
+
+    return heightfield;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static std::vector<HeightfieldRay> CreateRays(uint32_t rayCount)
+{
+    std::mt19937 generator(rayCount);
+    std::uniform_real_distribution<float> position(-1.2f, 1.2f);
+    std::uniform_real_distribution<float> height(0.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // Rays start around and above the grid and point anywhere, from steep primary rays to grazing shadow rays
+    std::vector<HeightfieldRay> rays(rayCount);
+    for (HeightfieldRay& ray : rays)
+    {
+        ray.Origin = glm::vec3(position(generator), height(generator), position(generator));
+        ray.Direction = glm::normalize(glm::vec3(unit(generator), unit(generator) - 0.3f, unit(generator)));
+    }
+
+    return rays;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static HeightfieldHit IntersectBruteForce(HeightfieldBuffer heightfield, const HeightfieldRay& ray, float tMin, float tMax)
+{
+    HeightfieldInfo info = LoadHeightfieldInfo(heightfield);
+    glm::ivec2 cellCount = glm::ivec2(info.Width - 1, info.Depth - 1);
+
+    // Same grid space transform as IntersectHeightfield, with the heightfield centered at the origin
+    glm::vec2 gridOrigin = -0.5f * glm::vec2(cellCount) * info.CellSize;
+    glm::vec3 o = glm::vec3((ray.Origin.x - gridOrigin.x) / info.CellSize, ray.Origin.y, (ray.Origin.z - gridOrigin.y) / info.CellSize);
+    glm::vec3 d = glm::vec3(ray.Direction.x / info.CellSize, ray.Direction.y, ray.Direction.z / info.CellSize);
+
+    HeightfieldHit result;
+    for (int32_t z = 0; z < cellCount.y; z++)
+    {
+        for (int32_t x = 0; x < cellCount.x; x++)
+        {
+            float t;
+            glm::vec3 normal;
+            if (IntersectHeightfieldCell(heightfield, info, glm::ivec2(x, z), o, d, tMin, result.Hit ? result.T : tMax, t, normal))
+            {
+                result.Hit = true;
+                result.T = t;
+                result.Normal = glm::normalize(glm::vec3(normal.x / info.CellSize, normal.y, normal.z / info.CellSize));
+            }
+        }
+    }
+
+    return result;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Traces the same rays through the min/max pyramid and through every cell of the grid. Both must find the same closest hits,
+// the timings show how much the pyramid saves as the grid grows
+TEST_CASE(HeightfieldTraversalVsBruteForce)
+{
+    const uint32_t rayCount = 1024;
+    const float tMin = 0.0f;
+    const float tMax = 100.0f;
+
+    std::vector<HeightfieldRay> rays = CreateRays(rayCount);
+
+    for (uint32_t sampleCount : { 65, 257, 513 })
+    {
+        HeightfieldDescription terrain = CreateTerrain(sampleCount);
+
+        std::vector<uint32_t> data;
+        HeightfieldBuilder::Build(terrain, 2.0f / (sampleCount - 1), data);
+        HeightfieldBuffer heightfield = data.data();
+
+        std::vector<HeightfieldHit> pyramidHits(rayCount);
+        std::vector<HeightfieldHit> bruteForceHits(rayCount);
+
+        Timer pyramidTimer;
+        pyramidTimer.Reset();
+        for (uint32_t i = 0; i < rayCount; i++)
+        {
+            HeightfieldHit& hit = pyramidHits[i];
+            hit.Hit = IntersectHeightfield(heightfield, glm::vec3(0.0f), rays[i].Origin, rays[i].Direction, tMin, tMax, hit.T, hit.Normal);
+        }
+        pyramidTimer.Stop();
+
+        Timer bruteForceTimer;
+        bruteForceTimer.Reset();
+        for (uint32_t i = 0; i < rayCount; i++)
+        {
+            bruteForceHits[i] = IntersectBruteForce(heightfield, rays[i], tMin, tMax);
+        }
+        bruteForceTimer.Stop();
+
+        uint32_t hitCount = 0;
+        uint32_t mismatchCount = 0;
+        for (uint32_t i = 0; i < rayCount; i++)
+        {
+            const HeightfieldHit& pyramid = pyramidHits[i];
+            const HeightfieldHit& bruteForce = bruteForceHits[i];
+
+            bool matches = pyramid.Hit == bruteForce.Hit;
+            if (matches && pyramid.Hit)
+                matches = glm::abs(pyramid.T - bruteForce.T) <= 1e-4f * glm::max(bruteForce.T, 1.0f) && glm::dot(pyramid.Normal, bruteForce.Normal) > 0.999f;
+
+            hitCount += bruteForce.Hit ? 1 : 0;
+            mismatchCount += matches ? 0 : 1;
+        }
+
+        CHECK(mismatchCount == 0);
+        CHECK(hitCount > 0 && hitCount < rayCount);
+
+        HEXRAY_INFO("{}x{} heightfield, {} of {} rays hit: pyramid {:.4f} ms/ray, brute force {:.4f} ms/ray ({:.1f}x), {} mismatches",
+            sampleCount, sampleCount, hitCount, rayCount, pyramidTimer.GetElapsedTimeMS() / rayCount, bruteForceTimer.GetElapsedTimeMS() / rayCount,
+            bruteForceTimer.GetElapsedTimeMS() / pyramidTimer.GetElapsedTimeMS(), mismatchCount);
+    }
+}
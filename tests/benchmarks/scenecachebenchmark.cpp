@@ -0,0 +1,193 @@
+#include "testframework.h"
+
+#include "core/timer.h"
+#include "scene/scenecachestream.h"
+
+#include <glm.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+// Mirrors the entity records of SceneCache snapshots: the components are written as raw bytes, so plain structs of the same
+// layout produce the same stream without creating a scene and its GPU resources
+struct EntityTransform
+{
+    glm::vec3 Translation;
+    glm::vec3 Rotation;
+    glm::vec3 Scale;
+};
+
+struct EntityHierarchy
+{
+    uint64_t Parent;
+    uint64_t FirstChild;
+    uint64_t PreviousSibling;
+    uint64_t NextSibling;
+};
+
+struct EntityPointLight
+{
+    glm::vec3 Color;
+    float Intensity;
+    glm::vec3 AttenuationFactors;
+};
+
+struct EntityRecord
+{
+    uint64_t ID = 0;
+    std::string Tag;
+    EntityTransform Transform = {};
+    EntityHierarchy Hierarchy = {};
+    uint32_t ComponentMask = 0;
+    uint32_t MeshIndex = 0;
+    EntityPointLight PointLight = {};
+};
+
+static constexpr uint32_t c_HasMeshComponent = 1 << 0;
+static constexpr uint32_t c_HasPointLightComponent = 1 << 4;
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static std::vector<EntityRecord> CreateEntities(uint32_t entityCount)
+{
+    std::mt19937 generator(entityCount);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+    // Mostly mesh nodes parented in small groups, with a point light every few entities
+    std::vector<EntityRecord> entities(entityCount);
+    for (uint32_t i = 0; i < entityCount; i++)
+    {
+        EntityRecord& entity = entities[i];
+        entity.ID = 0x9e3779b97f4a7c15ull * (i + 1);
+        entity.Tag = "Entity" + std::to_string(i);
+        entity.Transform = { glm::vec3(position(generator), position(generator), position(generator)), glm::vec3(0.0f, float(i % 360), 0.0f), glm::vec3(1.0f) };
+        entity.Hierarchy.Parent = i % 8 ? entities[i - i % 8].ID : 0;
+        entity.ComponentMask = i % 4 ? c_HasMeshComponent : c_HasPointLightComponent;
+        entity.MeshIndex = i % 64;
+        entity.PointLight = { glm::vec3(1.0f, 0.9f, 0.8f), float(i % 10), glm::vec3(1.0f, 0.1f, 0.01f) };
+    }
+
+    return entities;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static void WriteEntities(const std::vector<EntityRecord>& entities, SceneCacheWriter& writer)
+{
+    writer.Write<uint32_t>(entities.size());
+    for (const EntityRecord& entity : entities)
+    {
+        writer.Write(entity.ID);
+        writer.WriteString(entity.Tag);
+        writer.Write(entity.Transform);
+        writer.Write(entity.Hierarchy);
+        writer.Write(entity.ComponentMask);
+
+        if (entity.ComponentMask & c_HasMeshComponent)
+        {
+            writer.Write(entity.MeshIndex);
+            writer.Write<uint32_t>(0); // no override material table
+        }
+
+        if (entity.ComponentMask & c_HasPointLightComponent)
+            writer.Write(entity.PointLight);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static bool ReadEntities(SceneCacheReader& reader, std::vector<EntityRecord>& outEntities)
+{
+    outEntities.resize(reader.ReadCount(sizeof(uint64_t)));
+    for (EntityRecord& entity : outEntities)
+    {
+        reader.Read(entity.ID);
+        reader.ReadString(entity.Tag);
+        reader.Read(entity.Transform);
+        reader.Read(entity.Hierarchy);
+        reader.Read(entity.ComponentMask);
+
+        if (entity.ComponentMask & c_HasMeshComponent)
+        {
+            uint32_t materialTableSize;
+            reader.Read(entity.MeshIndex);
+            reader.Read(materialTableSize);
+        }
+
+        if (entity.ComponentMask & c_HasPointLightComponent)
+            reader.Read(entity.PointLight);
+    }
+
+    return reader.IsValid() && reader.IsAtEnd();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Saves and loads the entity records of binary scenes with increasing entity counts through a file, the same way SceneCache
+// does. The loaded entities must match the saved ones, the timings show how encoding and file IO scale with the scene size
+TEST_CASE(SceneCacheSaveLoad)
+{
+    std::filesystem::path filepath = std::filesystem::temp_directory_path() / "hexray_scenecachebenchmark.hxscene";
+
+    for (uint32_t entityCount : { 1000, 10000, 100000, 1000000 })
+    {
+        std::vector<EntityRecord> entities = CreateEntities(entityCount);
+
+        Timer serializeTimer;
+        serializeTimer.Reset();
+
+        SceneCacheWriter writer;
+        WriteEntities(entities, writer);
+
+        std::ofstream ofs(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+        ofs.write((const char*)writer.GetData().data(), writer.GetData().size());
+        ofs.close();
+
+        serializeTimer.Stop();
+
+        Timer deserializeTimer;
+        deserializeTimer.Reset();
+
+        std::ifstream ifs(filepath, std::ios::in | std::ios::binary);
+        std::vector<uint8_t> data(std::filesystem::file_size(filepath));
+        ifs.read((char*)data.data(), data.size());
+
+        SceneCacheReader reader(data);
+        std::vector<EntityRecord> loadedEntities;
+        bool isValid = ifs.gcount() == (std::streamsize)data.size() && ReadEntities(reader, loadedEntities);
+
+        deserializeTimer.Stop();
+
+        uint32_t mismatchCount = 0;
+        for (uint32_t i = 0; i < entityCount && i < loadedEntities.size(); i++)
+        {
+            const EntityRecord& a = entities[i];
+            const EntityRecord& b = loadedEntities[i];
+            bool matches = a.ID == b.ID && a.Tag == b.Tag && !memcmp(&a.Transform, &b.Transform, sizeof(EntityTransform)) &&
+                !memcmp(&a.Hierarchy, &b.Hierarchy, sizeof(EntityHierarchy)) && a.ComponentMask == b.ComponentMask;
+            mismatchCount += matches ? 0 : 1;
+        }
+
+        CHECK(isValid);
+        CHECK(loadedEntities.size() == entityCount);
+        CHECK(mismatchCount == 0);
+
+        HEXRAY_INFO("{} entities ({} KB): save {:.2f} ms ({:.3f} us/entity), load {:.2f} ms ({:.3f} us/entity)",
+            entityCount, writer.GetData().size() / 1024, serializeTimer.GetElapsedTimeMS(), serializeTimer.GetElapsedTimeMS() * 1000.0 / entityCount,
+            deserializeTimer.GetElapsedTimeMS(), deserializeTimer.GetElapsedTimeMS() * 1000.0 / entityCount);
+    }
+
+    std::filesystem::remove(filepath);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// A truncated snapshot fails every read after the end instead of reading past it
+TEST_CASE(SceneCacheTruncatedLoad)
+{
+    SceneCacheWriter writer;
+    WriteEntities(CreateEntities(16), writer);
+
+    std::vector<uint8_t> data(writer.GetData().begin(), writer.GetData().end() - 5);
+    SceneCacheReader reader(data);
+
+    std::vector<EntityRecord> loadedEntities;
+    CHECK(!ReadEntities(reader, loadedEntities));
+    CHECK(!reader.IsValid());
+}
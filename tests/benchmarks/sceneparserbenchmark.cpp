@@ -0,0 +1,129 @@
+#include "testframework.h"
+
+#include "core/timer.h"
+#include "serialization/scenetokenizer.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct GeneratedScene
+{
+    std::string Text;
+    uint32_t BlockCount = 0;
+    uint32_t PropertyCount = 0;
+};
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static GeneratedScene GenerateScene(uint32_t nodeCount)
+{
+    // Shaped like the scenes the editor saves: a material, a mesh and a node per object, with comments and quoted paths in between
+    GeneratedScene scene;
+    scene.Text.reserve(nodeCount * 512);
+
+    scene.Text += "# generated scene\nGlobalSettings {\n\tframeWidth 1920\n\tframeHeight 1080\n}\n\n";
+    scene.BlockCount += 1;
+    scene.PropertyCount += 2;
+
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        std::string index = std::to_string(i);
+
+        scene.Text += "Lambert Material" + index + " {\n";
+        scene.Text += "\tcolor (" + std::to_string(i % 7 / 7.0f) + ", 0.5, 0.25)\n";
+        scene.Text += "\ttexture \"textures/albedo_" + index + ".png\" // quoted path\n";
+        scene.Text += "\troughness 0.35\n}\n\n";
+
+        if (i % 16 == 0)
+            scene.Text += "/*\nNode Disabled" + index + " {\n\tmesh Mesh0\n}\n*/\n";
+
+        scene.Text += "Mesh Mesh" + index + " {\n\tfile \"meshes/mesh_" + index + ".obj\"\n}\n\n";
+
+        scene.Text += "Node Node" + index + " {\n";
+        scene.Text += "    mesh    Mesh" + index + "\n";
+        scene.Text += "\tmaterial Material" + index + "   # trailing comment\n";
+        scene.Text += "\ttranslate (" + index + ", 0, " + std::to_string(i * 2) + ")\n";
+        scene.Text += "\tscale (1, 1, 1)\n";
+        scene.Text += "\trotate (0, " + std::to_string(i % 360) + ", 0)\n}\n\n";
+
+        scene.BlockCount += 3;
+        scene.PropertyCount += 3 + 1 + 5;
+    }
+
+    return scene;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Tokenizes generated scenes of increasing size the way DefaultSceneParser::Parse reads a mapped file, in place. Every block
+// and property has to come out of the tokenizer, the timings give the tokenizing throughput without creating scene elements
+TEST_CASE(SceneTokenizerThroughput)
+{
+    const uint32_t iterationCount = 8;
+
+    for (uint32_t nodeCount : { 1000, 10000, 100000 })
+    {
+        GeneratedScene scene = GenerateScene(nodeCount);
+        std::vector<char> buffer(scene.Text.size());
+
+        double elapsedMS = 0.0;
+        uint32_t blockCount = 0;
+        uint32_t propertyCount = 0;
+        uint32_t unbalancedCount = 0;
+        bool hasError = false;
+
+        for (uint32_t iteration = 0; iteration < iterationCount; iteration++)
+        {
+            // The tokenizer writes into the buffer, so every iteration starts from a fresh copy
+            buffer.assign(scene.Text.begin(), scene.Text.end());
+            blockCount = propertyCount = unbalancedCount = 0;
+
+            Timer timer;
+            timer.Reset();
+
+            SceneTokenizer tokenizer(buffer.data(), buffer.size());
+            SceneToken token;
+            while (tokenizer.Next(token))
+            {
+                switch (token.Type)
+                {
+                case SceneTokenType::BlockBegin: blockCount++; break;
+                case SceneTokenType::Property: propertyCount++; break;
+                case SceneTokenType::BlockEnd: unbalancedCount += blockCount == 0 ? 1 : 0; break;
+                }
+            }
+
+            timer.Stop();
+            elapsedMS += timer.GetElapsedTimeMS();
+            hasError |= tokenizer.HasError() || tokenizer.IsInsideBlock();
+        }
+
+        CHECK(!hasError);
+        CHECK(blockCount == scene.BlockCount);
+        CHECK(propertyCount == scene.PropertyCount);
+        CHECK(unbalancedCount == 0);
+
+        double sizeMB = scene.Text.size() / (1024.0 * 1024.0);
+        double averageMS = elapsedMS / iterationCount;
+        HEXRAY_INFO("{} nodes ({:.2f} MB, {} blocks, {} properties): tokenizing {:.3f} ms ({:.1f} MB/s)",
+            nodeCount, sizeMB, blockCount, propertyCount, averageMS, averageMS > 0.0 ? sizeMB / (averageMS / 1000.0) : 0.0);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Properties come out null terminated with their quotes stripped, and syntax errors stop the tokenizer with the parser's messages
+TEST_CASE(SceneTokenizerProperties)
+{
+    std::string text = "Mesh Rock {\n\tfile   \"meshes/rock one.obj\"  # comment\n}\nbroken\n";
+    std::vector<char> buffer(text.begin(), text.end());
+
+    SceneTokenizer tokenizer(buffer.data(), buffer.size());
+    SceneToken token;
+
+    CHECK(tokenizer.Next(token) && token.Type == SceneTokenType::BlockBegin && token.ClassName == "Mesh" && token.ObjectName == "Rock");
+    CHECK(tokenizer.Next(token) && token.Type == SceneTokenType::Property);
+    CHECK(std::string(token.PropertyName) == "file" && std::string(token.PropertyValue) == "meshes/rock one.obj");
+    CHECK(token.PropertyValueLength == strlen(token.PropertyValue) && token.Line == 2);
+    CHECK(tokenizer.Next(token) && token.Type == SceneTokenType::BlockEnd);
+    CHECK(!tokenizer.Next(token) && tokenizer.HasError());
+    CHECK(tokenizer.GetError() == "Unexpected token `broken' on line 4");
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "core/core.h"
+
+// Test cases register themselves during static initialization and run from testmain.cpp. A failing check logs the condition
+// and marks the case as failed but lets it run to the end, so one run reports every broken expectation
+struct TestCase
+{
+    const char* Name;
+    void (*Function)();
+};
+
+class TestRegistry
+{
+public:
+    static bool Register(const char* name, void (*function)());
+    static void ReportFailure(const char* condition, const char* file, int line);
+
+    static std::vector<TestCase>& GetTestCases();
+    static uint32_t& GetFailureCount();
+};
+
+#define TEST_CASE(name) \
+static void name(); \
+static bool s_##name##Registered = TestRegistry::Register(#name, name); \
+static void name()
+
+#define CHECK(condition) { if (!(condition)) TestRegistry::ReportFailure(HEXRAY_MACRO_TO_STR(condition), __FILE__, __LINE__); }
@@ -0,0 +1,68 @@
+#include "testframework.h"
+
+#include "core/timer.h"
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+bool TestRegistry::Register(const char* name, void (*function)())
+{
+    GetTestCases().push_back(TestCase{ name, function });
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+void TestRegistry::ReportFailure(const char* condition, const char* file, int line)
+{
+    HEXRAY_ERROR("Check failed \"{}\"\n{},{}", condition, file, line);
+    GetFailureCount()++;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+std::vector<TestCase>& TestRegistry::GetTestCases()
+{
+    static std::vector<TestCase> testCases;
+    return testCases;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+uint32_t& TestRegistry::GetFailureCount()
+{
+    static uint32_t failureCount = 0;
+    return failureCount;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Logger::Initialize();
+
+    // The only argument is an optional filter, only cases whose name contains it are run
+    std::string filter = argc > 1 ? argv[1] : "";
+
+    uint32_t runCount = 0;
+    uint32_t failedCount = 0;
+
+    for (const TestCase& testCase : TestRegistry::GetTestCases())
+    {
+        if (!filter.empty() && std::string(testCase.Name).find(filter) == std::string::npos)
+            continue;
+
+        uint32_t previousFailureCount = TestRegistry::GetFailureCount();
+
+        Timer timer;
+        timer.Reset();
+        testCase.Function();
+        timer.Stop();
+
+        bool passed = TestRegistry::GetFailureCount() == previousFailureCount;
+        if (passed)
+            HEXRAY_INFO("{} passed ({:.2f} ms)", testCase.Name, timer.GetElapsedTimeMS());
+        else
+            HEXRAY_ERROR("{} failed ({:.2f} ms)", testCase.Name, timer.GetElapsedTimeMS());
+
+        runCount++;
+        failedCount += passed ? 0 : 1;
+    }
+
+    HEXRAY_INFO("{} of {} test cases passed", runCount - failedCount, runCount);
+    return failedCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+#include "testframework.h"
+
+#include "rendering/emissivetriangles.h"
+
+#include <gtc/matrix_transform.hpp>
+
+#include <random>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Every CDF range has to grow monotonically and end at exactly one, which SampleEmissiveCdf relies on to always find an entry
+static void CheckCdfRange(const std::vector<float>& cdf, uint32_t offset, uint32_t count)
+{
+    CHECK(offset + count <= cdf.size());
+
+    float previous = 0.0f;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        CHECK(cdf[offset + i] >= previous && cdf[offset + i] <= 1.0f);
+        previous = cdf[offset + i];
+    }
+
+    CHECK(cdf[offset + count - 1] == 1.0f);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Samples stratified over [0, 1) and counts how often each entry of a range is picked, checking the reported Pdfs on the way
+static std::vector<double> SampleFrequencies(const std::vector<float>& cdf, uint32_t offset, uint32_t count)
+{
+    const uint32_t sampleCount = 1 << 16;
+
+    std::vector<double> frequencies(count, 0.0);
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        float pdf = 0.0f;
+        uint32_t index = SampleEmissiveCdf(cdf.data(), offset, count, (i + 0.5f) / sampleCount, pdf);
+        if (index >= count)
+        {
+            CHECK(index < count);
+            return frequencies;
+        }
+
+        float previous = index > 0 ? cdf[offset + index - 1] : 0.0f;
+        CHECK(pdf > 0.0f && pdf == cdf[offset + index] - previous);
+        frequencies[index] += 1.0 / sampleCount;
+    }
+
+    return frequencies;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(EmissiveTriangles_NormalizesByPower)
+{
+    EmissiveTriangles emissiveTriangles;
+
+    std::vector<float> areas = { 1.0f, 3.0f };
+    float surfaceArea = 4.0f;
+
+    // Twice the scale is four times the area, the second instance also emits three times as much
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 0, areas.data(), areas.size(), surfaceArea, glm::vec3(1.0f), false);
+    emissiveTriangles.AddInstance(glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)), 0, areas.data(), areas.size(), surfaceArea, glm::vec3(3.0f), true);
+    emissiveTriangles.Build();
+
+    const std::vector<EmissiveInstance>& instances = emissiveTriangles.GetInstances();
+    const std::vector<float>& cdf = emissiveTriangles.GetCdf();
+    CHECK(instances.size() == 2);
+
+    CheckCdfRange(cdf, 0, instances.size());
+    CHECK(glm::abs(cdf[0] - 1.0f / 13.0f) <= 1e-6f);
+
+    // Instances of one mesh share its triangle CDF, which sits behind the instance CDF
+    CHECK(instances[0].TriangleCdfOffset == instances.size() && instances[1].TriangleCdfOffset == instances[0].TriangleCdfOffset);
+    CHECK(cdf.size() == instances.size() + areas.size());
+    CheckCdfRange(cdf, instances[0].TriangleCdfOffset, instances[0].TriangleCount);
+    CHECK(glm::abs(cdf[instances[0].TriangleCdfOffset] - 0.25f) <= 1e-6f);
+
+    std::vector<double> instanceFrequencies = SampleFrequencies(cdf, 0, instances.size());
+    CHECK(glm::abs(instanceFrequencies[0] - 1.0 / 13.0) <= 1e-3);
+
+    float pdf = 0.0f;
+    CHECK(emissiveTriangles.SampleInstance(0.99f, pdf) == 1 && glm::abs(pdf - 12.0f / 13.0f) <= 1e-6f);
+    CHECK(emissiveTriangles.SampleTriangle(1, 0.1f, pdf) == 0 && glm::abs(pdf - 0.25f) <= 1e-6f);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(EmissiveTriangles_NormalizesTriangleAreas)
+{
+    EmissiveTriangles emissiveTriangles;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.001f, 10.0f);
+
+    std::vector<float> areas(1000);
+    double areaSum = 0.0;
+    for (float& area : areas)
+    {
+        area = distribution(generator);
+        areaSum += area;
+    }
+
+    // A surface area that doesn't match the triangles only changes the instance weight, the triangle CDF still ends at one
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 7, areas.data(), areas.size(), float(areaSum) * 0.5f, glm::vec3(1.0f), false);
+    emissiveTriangles.Build();
+
+    const EmissiveInstance& instance = emissiveTriangles.GetInstances()[0];
+    const std::vector<float>& cdf = emissiveTriangles.GetCdf();
+    CheckCdfRange(cdf, 0, 1);
+    CheckCdfRange(cdf, instance.TriangleCdfOffset, instance.TriangleCount);
+
+    double maxError = 0.0;
+    double cumulativeArea = 0.0;
+    for (uint32_t i = 0; i < areas.size(); i++)
+    {
+        cumulativeArea += areas[i];
+        maxError = glm::max(maxError, glm::abs(cdf[instance.TriangleCdfOffset + i] - cumulativeArea / areaSum));
+    }
+
+    CHECK(maxError <= 1e-5);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(EmissiveTriangles_SkipsEmittersWithoutPower)
+{
+    EmissiveTriangles emissiveTriangles;
+
+    std::vector<float> areas = { 1.0f, 1.0f };
+    std::vector<float> zeroAreas = { 0.0f, 0.0f, 0.0f };
+
+    // No emission, no surface area, no triangles, triangles without area and a flattened transform all carry no power
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 0, areas.data(), areas.size(), 2.0f, glm::vec3(0.0f), false);
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 0, areas.data(), areas.size(), 2.0f, glm::vec3(-1.0f), false);
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 1, areas.data(), areas.size(), 0.0f, glm::vec3(1.0f), false);
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 2, areas.data(), 0, 2.0f, glm::vec3(1.0f), false);
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 3, zeroAreas.data(), zeroAreas.size(), 1.0f, glm::vec3(1.0f), false);
+    emissiveTriangles.AddInstance(glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 1.0f)), 4, areas.data(), areas.size(), 2.0f, glm::vec3(1.0f), false);
+    emissiveTriangles.Build();
+
+    CHECK(emissiveTriangles.GetInstances().empty());
+    CHECK(emissiveTriangles.GetCdf().empty());
+
+    // Degenerate triangles stay in the CDF to keep the triangle indices, but are never picked
+    std::vector<float> mixedAreas = { 0.0f, 2.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 5, mixedAreas.data(), mixedAreas.size(), 3.0f, glm::vec3(1.0f), false);
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 6, areas.data(), areas.size(), 2.0f, glm::vec3(0.0f, 0.0f, 0.0f), false);
+    emissiveTriangles.Build();
+
+    const std::vector<EmissiveInstance>& instances = emissiveTriangles.GetInstances();
+    const std::vector<float>& cdf = emissiveTriangles.GetCdf();
+    CHECK(instances.size() == 1 && instances[0].TriangleCount == mixedAreas.size());
+    CheckCdfRange(cdf, 0, 1);
+    CheckCdfRange(cdf, instances[0].TriangleCdfOffset, instances[0].TriangleCount);
+
+    std::vector<double> frequencies = SampleFrequencies(cdf, instances[0].TriangleCdfOffset, instances[0].TriangleCount);
+    for (uint32_t i = 0; i < mixedAreas.size(); i++)
+    {
+        double expectedFrequency = mixedAreas[i] / 3.0;
+        CHECK(expectedFrequency > 0.0 ? glm::abs(frequencies[i] - expectedFrequency) <= 1e-3 : frequencies[i] == 0.0);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(EmissiveTriangles_ClearsBetweenBuilds)
+{
+    EmissiveTriangles emissiveTriangles;
+
+    std::vector<float> areas = { 1.0f, 2.0f, 3.0f };
+    for (uint32_t i = 0; i < 4; i++)
+        emissiveTriangles.AddInstance(glm::mat4(1.0f), i, areas.data(), areas.size(), 6.0f, glm::vec3(1.0f), false);
+    emissiveTriangles.Build();
+
+    // Offsets are rebased by the build, a second build after a clear must not carry any of them over
+    emissiveTriangles.Clear();
+    emissiveTriangles.AddInstance(glm::mat4(1.0f), 9, areas.data(), 2, 3.0f, glm::vec3(2.0f), false);
+    emissiveTriangles.Build();
+
+    const std::vector<EmissiveInstance>& instances = emissiveTriangles.GetInstances();
+    CHECK(instances.size() == 1 && instances[0].TriangleCdfOffset == 1);
+    CHECK(emissiveTriangles.GetCdf().size() == 3);
+    CheckCdfRange(emissiveTriangles.GetCdf(), 1, 2);
+}
@@ -0,0 +1,157 @@
+#include "testframework.h"
+
+#include "rendering/lightaliastable.h"
+
+#include <random>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Checks a table built from the weights three ways: every light's Pdf is its normalized weight, the probability the entries
+// hand to each light through their thresholds and aliases adds up to that Pdf, and drawing random samples picks every light
+// as often as its Pdf says while reporting that Pdf
+static void CheckLightAliasTable(const std::vector<float>& weights, uint32_t seed)
+{
+    uint32_t lightCount = weights.size();
+
+    LightAliasTable table;
+    table.Build(weights.data(), lightCount);
+
+    const std::vector<LightAliasEntry>& entries = table.GetEntries();
+    CHECK(entries.size() == lightCount);
+
+    double weightSum = 0.0;
+    for (float weight : weights)
+        weightSum += glm::max(weight, 0.0f);
+
+    std::vector<double> expectedPdfs(lightCount);
+    for (uint32_t i = 0; i < lightCount; i++)
+        expectedPdfs[i] = weightSum > 0.0 ? glm::max(weights[i], 0.0f) / weightSum : 1.0 / lightCount;
+
+    std::vector<double> entryMasses(lightCount, 0.0);
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        const LightAliasEntry& entry = entries[i];
+        CHECK(entry.Alias < lightCount);
+        CHECK(entry.Threshold >= 0.0f && entry.Threshold <= 1.0f);
+        CHECK(entry.AliasPdf == entries[entry.Alias].Pdf);
+        CHECK(glm::abs(entry.Pdf - expectedPdfs[i]) <= 1e-6 + 1e-5 * expectedPdfs[i]);
+
+        entryMasses[i] += entry.Threshold / double(lightCount);
+        entryMasses[entry.Alias] += (1.0 - entry.Threshold) / double(lightCount);
+    }
+
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        CHECK(glm::abs(entryMasses[i] - expectedPdfs[i]) <= 1e-5);
+
+        // Lights without weight must not even be reachable through rounding, unless no light has any weight
+        if (expectedPdfs[i] == 0.0)
+            CHECK(entryMasses[i] == 0.0);
+    }
+
+    const uint32_t sampleCount = 1 << 21;
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    std::vector<uint32_t> sampleCounts(lightCount, 0);
+    uint32_t pdfMismatchCount = 0;
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        float u = glm::min(distribution(generator), 0x1.fffffep-1f);
+
+        float pdf = 0.0f;
+        uint32_t lightIndex = table.Sample(u, pdf);
+        if (lightIndex >= lightCount)
+        {
+            CHECK(lightIndex < lightCount);
+            return;
+        }
+
+        sampleCounts[lightIndex]++;
+        pdfMismatchCount += pdf == entries[lightIndex].Pdf ? 0 : 1;
+    }
+
+    CHECK(pdfMismatchCount == 0);
+
+    // Frequencies have to be within five standard deviations of the Pdf
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        double frequency = sampleCounts[i] / double(sampleCount);
+        double tolerance = 5.0 * glm::sqrt(expectedPdfs[i] * (1.0 - expectedPdfs[i]) / sampleCount) + 1e-6;
+        CHECK(glm::abs(frequency - expectedPdfs[i]) <= tolerance);
+
+        if (expectedPdfs[i] == 0.0)
+            CHECK(sampleCounts[i] == 0);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(LightAliasTable_MatchesWeights)
+{
+    CheckLightAliasTable({ 1.0f }, 1);
+    CheckLightAliasTable({ 1.0f, 3.0f }, 2);
+    CheckLightAliasTable({ 2.0f, 2.0f, 2.0f, 2.0f }, 3);
+
+    // Weights spanning several orders of magnitude
+    std::mt19937 generator(4);
+    std::uniform_real_distribution<float> exponentDistribution(-4.0f, 4.0f);
+
+    std::vector<float> weights(57);
+    for (float& weight : weights)
+        weight = glm::pow(10.0f, exponentDistribution(generator));
+
+    CheckLightAliasTable(weights, 5);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(LightAliasTable_NeverSamplesZeroWeights)
+{
+    CheckLightAliasTable({ 0.0f, 1.0f }, 6);
+    CheckLightAliasTable({ 5.0f, 0.0f, 0.0f, 1.0f, 0.0f }, 7);
+
+    // Negative weights count as zero
+    CheckLightAliasTable({ -1.0f, 2.0f, 0.0f, 3.0f }, 8);
+
+    // A single light carrying all the weight among many without any
+    std::vector<float> weights(100, 0.0f);
+    weights[37] = 0.25f;
+    CheckLightAliasTable(weights, 9);
+
+    std::mt19937 generator(10);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    weights.resize(73);
+    for (float& weight : weights)
+        weight = distribution(generator) < 0.4f ? 0.0f : distribution(generator);
+
+    CheckLightAliasTable(weights, 11);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(LightAliasTable_AllZeroWeightsAreUniform)
+{
+    CheckLightAliasTable({ 0.0f }, 12);
+    CheckLightAliasTable({ 0.0f, 0.0f, 0.0f }, 13);
+    CheckLightAliasTable(std::vector<float>(64, 0.0f), 14);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(LightAliasTable_RebuildsWithFewerLights)
+{
+    LightAliasTable table;
+
+    std::vector<float> weights = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+    table.Build(weights.data(), weights.size());
+
+    // Entries of the previous build must not leak into a smaller table
+    weights = { 0.0f, 1.0f };
+    table.Build(weights.data(), weights.size());
+    CHECK(table.GetEntries().size() == 2);
+
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        float pdf = 0.0f;
+        CHECK(table.Sample((i + 0.5f) / 64.0f, pdf) == 1);
+        CHECK(pdf == 1.0f);
+    }
+}
@@ -0,0 +1,236 @@
+#include "testframework.h"
+
+#include "rendering/lightaliastable.h"
+#include "rendering/lightbvh.h"
+
+#include <random>
+#include <gtc/constants.hpp>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Point and spot lights scattered through a box, with a few directional lights and lights without power mixed in that the
+// BVH has to leave out
+static std::vector<Light> CreateRandomLights(uint32_t lightCount, uint32_t seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    std::vector<Light> lights(lightCount);
+    for (Light& light : lights)
+    {
+        float type = distribution(generator);
+        light.LightType = type < 0.1f ? LightType::DirLight : type < 0.55f ? LightType::PointLight : LightType::SpotLight;
+        light.Position = glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 20.0f - 10.0f;
+        light.Direction = glm::normalize(glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 2.0f - 1.0f);
+        light.Color = glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+        light.Intensity = distribution(generator) < 0.1f ? 0.0f : 1.0f + 99.0f * distribution(generator);
+        light.AttenuationFactors = glm::vec3(1.0f, 0.1f * distribution(generator), 0.05f * distribution(generator));
+
+        float innerAngle = glm::radians(5.0f + 40.0f * distribution(generator));
+        float outerAngle = innerAngle + glm::radians(20.0f * distribution(generator));
+        light.ConeAngleMin = glm::cos(innerAngle);
+        light.ConeAngleMax = glm::cos(outerAngle);
+    }
+
+    return lights;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static bool IsInLightBVH(const Light& light)
+{
+    return light.LightType != LightType::DirLight && LightAliasTable::GetLightIntensity(light) > 0.0f;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Probability of every light the way SampleLightBVH descends, the mass of branches where both children are out of reach is
+// returned separately since sampling gives up there
+static double ComputeLightBVHPmf(const std::vector<LightBVHNode>& nodes, const glm::vec3& position, const glm::vec3& normal, std::vector<double>& outPmf)
+{
+    double deadEndProbability = 0.0;
+
+    auto descend = [&](auto& self, uint32_t nodeIndex, double probability) -> void
+    {
+        const LightBVHNode& node = nodes[nodeIndex];
+        if (node.IsLeaf)
+        {
+            outPmf[node.ChildOrLightIndex] += probability;
+            return;
+        }
+
+        double importance0 = GetLightBVHNodeImportance(nodes[nodeIndex + 1], position, normal);
+        double importance1 = GetLightBVHNodeImportance(nodes[node.ChildOrLightIndex], position, normal);
+        if (importance0 <= 0.0 && importance1 <= 0.0)
+        {
+            deadEndProbability += probability;
+            return;
+        }
+
+        double probability0 = importance0 / (importance0 + importance1);
+        if (probability0 > 0.0)
+            self(self, nodeIndex + 1, probability * probability0);
+
+        if (probability0 < 1.0)
+            self(self, node.ChildOrLightIndex, probability * (1.0 - probability0));
+    };
+
+    if (GetLightBVHNodeImportance(nodes[0], position, normal) > 0.0f)
+        descend(descend, 0, 1.0);
+    else
+        deadEndProbability = 1.0;
+
+    return deadEndProbability;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(LightBVH_HoldsEveryLightWithPowerOnce)
+{
+    for (uint32_t lightCount : { 1u, 2u, 3u, 17u, 64u, 257u })
+    {
+        std::vector<Light> lights = CreateRandomLights(lightCount, lightCount);
+
+        LightBVH bvh;
+        bvh.Build(lights.data(), lights.size());
+
+        const std::vector<LightBVHNode>& nodes = bvh.GetNodes();
+
+        uint32_t expectedLeafCount = 0;
+        for (const Light& light : lights)
+            expectedLeafCount += IsInLightBVH(light) ? 1 : 0;
+
+        CHECK(nodes.size() == (expectedLeafCount > 0 ? expectedLeafCount * 2 - 1 : 0));
+
+        std::vector<uint32_t> leafCounts(lightCount, 0);
+        for (uint32_t i = 0; i < nodes.size(); i++)
+        {
+            const LightBVHNode& node = nodes[i];
+            if (node.IsLeaf)
+            {
+                CHECK(node.ChildOrLightIndex < lightCount);
+                if (node.ChildOrLightIndex < lightCount)
+                    leafCounts[node.ChildOrLightIndex]++;
+
+                continue;
+            }
+
+            // The first child follows its parent, the second one comes after the whole first subtree
+            CHECK(node.ChildOrLightIndex > i + 1 && node.ChildOrLightIndex < nodes.size());
+            if (node.ChildOrLightIndex >= nodes.size())
+                continue;
+
+            const LightBVHNode& child0 = nodes[i + 1];
+            const LightBVHNode& child1 = nodes[node.ChildOrLightIndex];
+            CHECK(glm::abs(node.Power - child0.Power - child1.Power) <= 1e-4f * node.Power);
+            CHECK(glm::all(glm::lessThanEqual(node.BoundsMin, glm::min(child0.BoundsMin, child1.BoundsMin))));
+            CHECK(glm::all(glm::greaterThanEqual(node.BoundsMax, glm::max(child0.BoundsMax, child1.BoundsMax))));
+        }
+
+        for (uint32_t i = 0; i < lightCount; i++)
+            CHECK(leafCounts[i] == (IsInLightBVH(lights[i]) ? 1 : 0));
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Every light has to be reachable from a point it illuminates: in front of it along its axis, facing back towards it
+TEST_CASE(LightBVH_ReachesEveryLightFromPointsItLights)
+{
+    std::vector<Light> lights = CreateRandomLights(200, 21);
+
+    LightBVH bvh;
+    bvh.Build(lights.data(), lights.size());
+
+    std::vector<double> pmf(lights.size());
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        if (!IsInLightBVH(lights[i]))
+            continue;
+
+        glm::vec3 position = lights[i].Position + lights[i].Direction * 0.5f;
+        glm::vec3 normal = -lights[i].Direction;
+
+        std::fill(pmf.begin(), pmf.end(), 0.0);
+        ComputeLightBVHPmf(bvh.GetNodes(), position, normal, pmf);
+        CHECK(pmf[i] > 0.0);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// The pdf SampleLightBVH reports has to be the probability of descending to the light, and the lights have to be sampled as
+// often as that probability says
+TEST_CASE(LightBVH_SamplesMatchPmf)
+{
+    std::vector<Light> lights = CreateRandomLights(96, 31);
+
+    LightBVH bvh;
+    bvh.Build(lights.data(), lights.size());
+
+    std::mt19937 generator(32);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    const uint32_t pointCount = 16;
+    const uint32_t sampleCount = 1 << 18;
+
+    std::vector<double> pmf(lights.size());
+    std::vector<uint32_t> sampleCounts(lights.size());
+
+    for (uint32_t point = 0; point < pointCount; point++)
+    {
+        glm::vec3 position = glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 24.0f - 12.0f;
+        float z = distribution(generator) * 2.0f - 1.0f;
+        float phi = distribution(generator) * glm::two_pi<float>();
+        glm::vec3 normal = glm::vec3(glm::sqrt(1.0f - z * z) * glm::cos(phi), glm::sqrt(1.0f - z * z) * glm::sin(phi), z);
+
+        std::fill(pmf.begin(), pmf.end(), 0.0);
+        double deadEndProbability = ComputeLightBVHPmf(bvh.GetNodes(), position, normal, pmf);
+
+        double pmfSum = deadEndProbability;
+        for (uint32_t i = 0; i < lights.size(); i++)
+        {
+            pmfSum += pmf[i];
+            if (!IsInLightBVH(lights[i]))
+                CHECK(pmf[i] == 0.0);
+        }
+
+        CHECK(glm::abs(pmfSum - 1.0) <= 1e-6);
+
+        std::fill(sampleCounts.begin(), sampleCounts.end(), 0);
+        uint32_t invalidCount = 0;
+        uint32_t pdfMismatchCount = 0;
+
+        for (uint32_t i = 0; i < sampleCount; i++)
+        {
+            float u = glm::min(distribution(generator), c_OneMinusEpsilon);
+
+            float pdf = 0.0f;
+            uint32_t lightIndex = bvh.Sample(position, normal, u, pdf);
+            if (lightIndex == c_InvalidLightIndex)
+            {
+                invalidCount++;
+                pdfMismatchCount += pdf == 0.0f ? 0 : 1;
+                continue;
+            }
+
+            if (lightIndex >= lights.size())
+            {
+                CHECK(lightIndex < lights.size());
+                return;
+            }
+
+            sampleCounts[lightIndex]++;
+            pdfMismatchCount += glm::abs(pdf - pmf[lightIndex]) <= 1e-4 * pmf[lightIndex] ? 0 : 1;
+        }
+
+        CHECK(pdfMismatchCount == 0);
+
+        // Frequencies have to be within five standard deviations of the PMF, the float random number adds a little slack
+        auto checkFrequency = [&](uint32_t count, double probability)
+        {
+            double frequency = count / double(sampleCount);
+            double tolerance = 5.0 * glm::sqrt(probability * (1.0 - probability) / sampleCount) + 1e-5;
+            CHECK(glm::abs(frequency - probability) <= tolerance);
+        };
+
+        for (uint32_t i = 0; i < lights.size(); i++)
+            checkFrequency(sampleCounts[i], pmf[i]);
+
+        checkFrequency(invalidCount, deadEndProbability);
+    }
+}
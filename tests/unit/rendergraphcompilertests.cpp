@@ -0,0 +1,311 @@
+#include "testframework.h"
+
+#include "rendering/rendergraphcompiler.h"
+
+#include <random>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static RenderGraphResourceID AddTransient(RenderGraphCompiler& compiler, const char* name, uint64_t size, uint64_t alignment = 1, bool isOutput = false)
+{
+    RenderGraphResourceDescription description;
+    description.Name = name;
+    description.Size = size;
+    description.Alignment = alignment;
+    description.IsOutput = isOutput;
+    return compiler.AddResource(description);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static RenderGraphResourceID AddImported(RenderGraphCompiler& compiler, const char* name, RenderGraphResourceState initialState, RenderGraphResourceState finalState, bool isOutput)
+{
+    RenderGraphResourceDescription description;
+    description.Name = name;
+    description.IsImported = true;
+    description.IsOutput = isOutput;
+    description.InitialState = initialState;
+    description.FinalState = finalState;
+    return compiler.AddResource(description);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static RenderGraphResourceAccess Read(RenderGraphResourceID resource)
+{
+    return { resource, RenderGraphResourceState::ShaderResource, RenderGraphAccessType::Read };
+}
+
+static RenderGraphResourceAccess Write(RenderGraphResourceID resource)
+{
+    return { resource, RenderGraphResourceState::UnorderedAccess, RenderGraphAccessType::Write };
+}
+
+static RenderGraphResourceAccess ReadWrite(RenderGraphResourceID resource)
+{
+    return { resource, RenderGraphResourceState::UnorderedAccess, RenderGraphAccessType::ReadWrite };
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static RenderGraphPassID AddPass(RenderGraphCompiler& compiler, const char* name, std::vector<RenderGraphResourceAccess> accesses, bool hasSideEffects = false)
+{
+    RenderGraphPassDescription description;
+    description.Name = name;
+    description.Accesses = std::move(accesses);
+    description.HasSideEffects = hasSideEffects;
+    return compiler.AddPass(description);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static const CompiledRenderGraphPass* FindCompiledPass(const CompiledRenderGraph& graph, RenderGraphPassID pass)
+{
+    auto it = std::find_if(graph.Passes.begin(), graph.Passes.end(), [&](const CompiledRenderGraphPass& compiledPass) { return compiledPass.Pass == pass; });
+    return it != graph.Passes.end() ? &*it : nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+static uint32_t CountBarriers(const std::vector<RenderGraphBarrier>& barriers, RenderGraphBarrierType type, RenderGraphResourceID resource)
+{
+    return std::count_if(barriers.begin(), barriers.end(), [&](const RenderGraphBarrier& barrier) { return barrier.Type == type && barrier.Resource == resource; });
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+// Transient resources that are alive at the same time must not share memory, and every one has to fit the transient range
+static bool HasValidTransientPlacement(const RenderGraphCompiler& compiler, const CompiledRenderGraph& graph)
+{
+    for (RenderGraphResourceID a = 0; a < compiler.GetResourceCount(); a++)
+    {
+        const RenderGraphResourceDescription& descriptionA = compiler.GetResource(a);
+        const CompiledRenderGraphResource& resourceA = graph.Resources[a];
+        if (descriptionA.IsImported || !resourceA.IsUsed)
+            continue;
+
+        if (resourceA.MemoryOffset % descriptionA.Alignment != 0 || resourceA.MemoryOffset + descriptionA.Size > graph.TransientMemorySize)
+            return false;
+
+        for (RenderGraphResourceID b = a + 1; b < compiler.GetResourceCount(); b++)
+        {
+            const RenderGraphResourceDescription& descriptionB = compiler.GetResource(b);
+            const CompiledRenderGraphResource& resourceB = graph.Resources[b];
+            if (descriptionB.IsImported || !resourceB.IsUsed)
+                continue;
+
+            bool livesOverlap = resourceA.FirstPass <= resourceB.LastPass && resourceB.FirstPass <= resourceA.LastPass;
+            bool memoryOverlaps = resourceA.MemoryOffset < resourceB.MemoryOffset + descriptionB.Size && resourceB.MemoryOffset < resourceA.MemoryOffset + descriptionA.Size;
+            if (livesOverlap && memoryOverlaps)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RenderGraphCompiler_CullsPassesWithoutOutputs)
+{
+    RenderGraphCompiler compiler;
+    RenderGraphResourceID gbuffer = AddTransient(compiler, "GBuffer", 1024);
+    RenderGraphResourceID unused = AddTransient(compiler, "Unused", 1024);
+    RenderGraphResourceID readback = AddTransient(compiler, "Readback", 256);
+    RenderGraphResourceID output = AddImported(compiler, "Output", RenderGraphResourceState::UnorderedAccess, RenderGraphResourceState::UnorderedAccess, true);
+
+    RenderGraphPassID gbufferPass = AddPass(compiler, "GBufferPass", { Write(gbuffer) });
+    RenderGraphPassID unusedPass = AddPass(compiler, "UnusedPass", { Read(gbuffer), Write(unused) });
+    RenderGraphPassID lightingPass = AddPass(compiler, "LightingPass", { Read(gbuffer), Write(output) });
+    RenderGraphPassID readbackPass = AddPass(compiler, "ReadbackPass", { Write(readback) }, true);
+
+    CompiledRenderGraph graph;
+    CHECK(compiler.Compile(graph));
+
+    CHECK(graph.CulledPassCount == 1);
+    CHECK(graph.Passes.size() == 3);
+    CHECK(FindCompiledPass(graph, gbufferPass));
+    CHECK(!FindCompiledPass(graph, unusedPass));
+    CHECK(FindCompiledPass(graph, lightingPass));
+    CHECK(FindCompiledPass(graph, readbackPass));
+
+    // Resources only touched by culled passes get no memory
+    CHECK(!graph.Resources[unused].IsUsed);
+    CHECK(graph.Resources[readback].IsUsed);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RenderGraphCompiler_KeepsEarlierWritersOfNeededResources)
+{
+    RenderGraphCompiler compiler;
+    RenderGraphResourceID accumulation = AddTransient(compiler, "Accumulation", 512, 1, true);
+
+    // Writes may only cover part of a resource, so a later write doesn't make the earlier ones dead
+    RenderGraphPassID clearPass = AddPass(compiler, "Clear", { Write(accumulation) });
+    RenderGraphPassID accumulatePass = AddPass(compiler, "Accumulate", { ReadWrite(accumulation) });
+    RenderGraphPassID overwritePass = AddPass(compiler, "Overwrite", { Write(accumulation) });
+
+    CompiledRenderGraph graph;
+    CHECK(compiler.Compile(graph));
+
+    CHECK(graph.CulledPassCount == 0);
+    CHECK(FindCompiledPass(graph, clearPass));
+    CHECK(FindCompiledPass(graph, accumulatePass));
+    CHECK(FindCompiledPass(graph, overwritePass));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RenderGraphCompiler_AliasesResourcesWithDisjointLifetimes)
+{
+    RenderGraphCompiler compiler;
+    RenderGraphResourceID a = AddTransient(compiler, "A", 4096, 256);
+    RenderGraphResourceID b = AddTransient(compiler, "B", 4096, 256);
+    RenderGraphResourceID c = AddTransient(compiler, "C", 4096, 256);
+    RenderGraphResourceID output = AddImported(compiler, "Output", RenderGraphResourceState::UnorderedAccess, RenderGraphResourceState::UnorderedAccess, true);
+
+    // A is dead once C is written, so C can take its memory. B overlaps both
+    AddPass(compiler, "WriteA", { Write(a) });
+    AddPass(compiler, "AToB", { Read(a), Write(b) });
+    AddPass(compiler, "BToC", { Read(b), Write(c) });
+    AddPass(compiler, "CToOutput", { Read(c), Write(output) });
+
+    CompiledRenderGraph graph;
+    CHECK(compiler.Compile(graph));
+
+    CHECK(HasValidTransientPlacement(compiler, graph));
+    CHECK(graph.Resources[a].MemoryOffset == graph.Resources[c].MemoryOffset);
+    CHECK(graph.Resources[a].MemoryOffset != graph.Resources[b].MemoryOffset);
+    CHECK(graph.TransientMemorySize == 2 * 4096);
+
+    // C reuses the memory of A, so its first use needs an aliasing barrier
+    const CompiledRenderGraphPass* bToC = FindCompiledPass(graph, 2);
+    CHECK(bToC && CountBarriers(bToC->Barriers, RenderGraphBarrierType::Aliasing, c) == 1);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RenderGraphCompiler_KeepsOutputMemoryUntilTheEnd)
+{
+    RenderGraphCompiler compiler;
+    RenderGraphResourceID output = AddTransient(compiler, "TransientOutput", 1024, 1, true);
+    RenderGraphResourceID scratch = AddTransient(compiler, "Scratch", 1024);
+    RenderGraphResourceID sideEffect = AddTransient(compiler, "SideEffect", 1024);
+
+    AddPass(compiler, "WriteOutput", { Write(output) });
+    AddPass(compiler, "WriteScratch", { Write(scratch) }, true);
+    AddPass(compiler, "ReadScratch", { Read(scratch), Write(sideEffect) }, true);
+
+    CompiledRenderGraph graph;
+    CHECK(compiler.Compile(graph));
+
+    // The output is read after the graph, so the later scratch resources can't take its memory
+    CHECK(HasValidTransientPlacement(compiler, graph));
+    CHECK(graph.Resources[output].LastPass == graph.Passes.size());
+    CHECK(graph.Resources[scratch].MemoryOffset != graph.Resources[output].MemoryOffset);
+    CHECK(graph.Resources[sideEffect].MemoryOffset != graph.Resources[output].MemoryOffset);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RenderGraphCompiler_PlacesRandomGraphsWithoutOverlap)
+{
+    std::mt19937 generator(43);
+
+    for (uint32_t iteration = 0; iteration < 200; iteration++)
+    {
+        RenderGraphCompiler compiler;
+
+        uint32_t resourceCount = std::uniform_int_distribution<uint32_t>(1, 16)(generator);
+        for (uint32_t i = 0; i < resourceCount; i++)
+        {
+            uint64_t size = std::uniform_int_distribution<uint64_t>(1, 64)(generator) * 64;
+            uint64_t alignment = uint64_t(1) << std::uniform_int_distribution<uint32_t>(0, 8)(generator);
+            AddTransient(compiler, "Resource", size, alignment, std::uniform_int_distribution<uint32_t>(0, 5)(generator) == 0);
+        }
+
+        // Every pass writes one resource and reads up to two others, the writes come first so no transient is read uninitialized
+        std::vector<RenderGraphResourceID> writtenResources;
+        uint32_t passCount = std::uniform_int_distribution<uint32_t>(1, 24)(generator);
+        for (uint32_t i = 0; i < passCount; i++)
+        {
+            std::vector<RenderGraphResourceAccess> accesses;
+            RenderGraphResourceID written = std::uniform_int_distribution<uint32_t>(0, resourceCount - 1)(generator);
+
+            for (uint32_t j = 0; j < 2 && !writtenResources.empty(); j++)
+            {
+                RenderGraphResourceID read = writtenResources[std::uniform_int_distribution<size_t>(0, writtenResources.size() - 1)(generator)];
+                if (read != written)
+                    accesses.push_back(Read(read));
+            }
+
+            accesses.push_back(Write(written));
+            writtenResources.push_back(written);
+            AddPass(compiler, "Pass", accesses, std::uniform_int_distribution<uint32_t>(0, 7)(generator) == 0);
+        }
+
+        CompiledRenderGraph graph;
+        CHECK(compiler.Compile(graph));
+        CHECK(HasValidTransientPlacement(compiler, graph));
+        CHECK(graph.Passes.size() + graph.CulledPassCount == passCount);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RenderGraphCompiler_DerivesBarriers)
+{
+    RenderGraphCompiler compiler;
+    RenderGraphResourceID history = AddImported(compiler, "History", RenderGraphResourceState::ShaderResource, RenderGraphResourceState::UnorderedAccess, true);
+    RenderGraphResourceID transient = AddTransient(compiler, "Transient", 1024);
+
+    RenderGraphPassID writeHistory = AddPass(compiler, "WriteHistory", { Write(history), Write(transient) });
+    RenderGraphPassID accumulate = AddPass(compiler, "Accumulate", { ReadWrite(history), Write(transient) });
+    RenderGraphPassID readHistory = AddPass(compiler, "ReadHistory", { Read(history), Read(transient) }, true);
+    RenderGraphPassID readAgain = AddPass(compiler, "ReadAgain", { Read(history) }, true);
+
+    CompiledRenderGraph graph;
+    CHECK(compiler.Compile(graph));
+    CHECK(graph.Passes.size() == 4);
+
+    const CompiledRenderGraphPass* pass0 = FindCompiledPass(graph, writeHistory);
+    const CompiledRenderGraphPass* pass1 = FindCompiledPass(graph, accumulate);
+    const CompiledRenderGraphPass* pass2 = FindCompiledPass(graph, readHistory);
+    const CompiledRenderGraphPass* pass3 = FindCompiledPass(graph, readAgain);
+    CHECK(pass0 && pass1 && pass2 && pass3);
+    if (!pass0 || !pass1 || !pass2 || !pass3)
+        return;
+
+    // Imported resources start in their initial state
+    CHECK(pass0->Barriers.size() == 1);
+    CHECK(CountBarriers(pass0->Barriers, RenderGraphBarrierType::Transition, history) == 1);
+    CHECK(pass0->Barriers[0].StateBefore == RenderGraphResourceState::ShaderResource && pass0->Barriers[0].StateAfter == RenderGraphResourceState::UnorderedAccess);
+
+    // Transient resources are created in the state of their first access and don't alias anything here
+    CHECK(CountBarriers(pass0->Barriers, RenderGraphBarrierType::Aliasing, transient) == 0);
+
+    // Writes after writes in unordered access wait through UAV barriers
+    CHECK(pass1->Barriers.size() == 2);
+    CHECK(CountBarriers(pass1->Barriers, RenderGraphBarrierType::UAV, history) == 1);
+    CHECK(CountBarriers(pass1->Barriers, RenderGraphBarrierType::UAV, transient) == 1);
+
+    CHECK(pass2->Barriers.size() == 2);
+    CHECK(CountBarriers(pass2->Barriers, RenderGraphBarrierType::Transition, history) == 1);
+    CHECK(CountBarriers(pass2->Barriers, RenderGraphBarrierType::Transition, transient) == 1);
+
+    // Reads after reads in the same state need nothing
+    CHECK(pass3->Barriers.empty());
+
+    // The imported resource goes to its final state and the transient one back to its creation state
+    CHECK(graph.FinalBarriers.size() == 2);
+    CHECK(CountBarriers(graph.FinalBarriers, RenderGraphBarrierType::Transition, history) == 1);
+    CHECK(CountBarriers(graph.FinalBarriers, RenderGraphBarrierType::Transition, transient) == 1);
+    for (const RenderGraphBarrier& barrier : graph.FinalBarriers)
+        CHECK(barrier.StateBefore == RenderGraphResourceState::ShaderResource && barrier.StateAfter == RenderGraphResourceState::UnorderedAccess);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RenderGraphCompiler_MergesRepeatedAccesses)
+{
+    RenderGraphCompiler compiler;
+    RenderGraphResourceID output = AddImported(compiler, "Output", RenderGraphResourceState::ShaderResource, RenderGraphResourceState::ShaderResource, true);
+
+    // Reading through a shader resource view and writing the same resource needs unordered access for the whole pass
+    RenderGraphPassID pass = AddPass(compiler, "ReadAndWrite", { Read(output), Write(output) });
+    CHECK(compiler.GetPass(pass).Accesses.size() == 1);
+    CHECK(compiler.GetPass(pass).Accesses[0].State == RenderGraphResourceState::UnorderedAccess);
+    CHECK(compiler.GetPass(pass).Accesses[0].Type == RenderGraphAccessType::ReadWrite);
+
+    CompiledRenderGraph graph;
+    CHECK(compiler.Compile(graph));
+    CHECK(graph.Passes.size() == 1 && graph.Passes[0].Barriers.size() == 1);
+    CHECK(graph.FinalBarriers.size() == 1);
+}
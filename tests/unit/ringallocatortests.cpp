@@ -0,0 +1,165 @@
+#include "testframework.h"
+
+#include "rendering/ringallocator.h"
+
+#include <deque>
+#include <random>
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RingAllocator_AlignsOffsets)
+{
+    RingAllocator allocator(1024, 4);
+
+    uint64_t offset = UINT64_MAX;
+    CHECK(allocator.Allocate(3, 1, offset) && offset == 0);
+    CHECK(allocator.Allocate(8, 16, offset) && offset == 16);
+    CHECK(allocator.Allocate(1, 256, offset) && offset == 256);
+
+    // Padding skipped for alignment is consumed along with the allocation
+    CHECK(allocator.GetUsedSize() == 257);
+
+    // Sizes of zero or larger than the whole range never succeed
+    CHECK(!allocator.Allocate(0, 1, offset));
+    CHECK(!allocator.Allocate(1025, 1, offset));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RingAllocator_WrapsAround)
+{
+    RingAllocator allocator(1024, 4);
+
+    uint64_t offset = UINT64_MAX;
+    CHECK(allocator.Allocate(600, 1, offset) && offset == 0);
+    allocator.Submit(1);
+    CHECK(allocator.Allocate(300, 1, offset) && offset == 600);
+    allocator.Submit(2);
+
+    // The end of the range is too small, so the allocation starts over at the beginning once that memory is released
+    CHECK(!allocator.Allocate(200, 1, offset));
+    allocator.Release(1);
+    CHECK(allocator.Allocate(200, 1, offset) && offset == 0);
+
+    // The 124 bytes skipped at the end stay in use until the wrapping allocation is released
+    CHECK(allocator.GetUsedSize() == 300 + 124 + 200);
+    allocator.Submit(3);
+
+    allocator.Release(2);
+    CHECK(allocator.GetUsedSize() == 124 + 200);
+    allocator.Release(3);
+    CHECK(allocator.GetUsedSize() == 0);
+
+    // An empty range starts over at the beginning
+    CHECK(allocator.Allocate(1024, 1, offset) && offset == 0);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RingAllocator_FailsUntilMemoryIsReleased)
+{
+    RingAllocator allocator(256, 2);
+
+    uint64_t offset = UINT64_MAX;
+    CHECK(allocator.Allocate(128, 1, offset));
+    allocator.Submit(10);
+    CHECK(allocator.Allocate(128, 1, offset));
+    allocator.Submit(11);
+
+    CHECK(allocator.IsSubmissionQueueFull());
+    CHECK(allocator.GetUsedSize() == allocator.GetCapacity());
+    CHECK(!allocator.Allocate(1, 1, offset));
+
+    // The owner waits for the oldest submission and releases it
+    CHECK(allocator.GetOldestSubmissionFenceValue() == 10);
+    allocator.Release(9);
+    CHECK(!allocator.Allocate(1, 1, offset));
+    allocator.Release(10);
+    CHECK(!allocator.IsSubmissionQueueFull());
+    CHECK(allocator.Allocate(128, 1, offset) && offset == 0);
+    CHECK(!allocator.Allocate(1, 1, offset));
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RingAllocator_ReleasesSubmissionsInOrder)
+{
+    RingAllocator allocator(1024, 4);
+
+    uint64_t offset = UINT64_MAX;
+    CHECK(allocator.Allocate(100, 1, offset));
+    allocator.Submit(1);
+    allocator.Submit(2); // Empty submissions own no memory
+    CHECK(allocator.Allocate(200, 1, offset));
+    allocator.Submit(3);
+    CHECK(allocator.Allocate(300, 1, offset));
+    allocator.Submit(4);
+
+    allocator.Release(0);
+    CHECK(allocator.GetUsedSize() == 600);
+
+    allocator.Release(2);
+    CHECK(allocator.GetUsedSize() == 500);
+    CHECK(allocator.GetOldestSubmissionFenceValue() == 3);
+
+    // A completed fence releases every submission up to it at once
+    allocator.Release(4);
+    CHECK(allocator.GetUsedSize() == 0);
+    CHECK(!allocator.HasSubmissions());
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------------
+TEST_CASE(RingAllocator_LiveAllocationsNeverOverlap)
+{
+    struct LiveAllocation
+    {
+        uint64_t Fence;
+        uint64_t Offset;
+        uint64_t Size;
+    };
+
+    const uint64_t capacity = 4096;
+    RingAllocator allocator(capacity, 8);
+    std::deque<LiveAllocation> liveAllocations;
+    std::mt19937 generator(45);
+
+    uint64_t fenceValue = 0;
+    uint64_t completedFenceValue = 0;
+    uint32_t failedCount = 0;
+
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        uint64_t size = std::uniform_int_distribution<uint64_t>(1, 700)(generator);
+        uint64_t alignment = uint64_t(1) << std::uniform_int_distribution<uint32_t>(0, 8)(generator);
+
+        uint64_t offset;
+        if (allocator.Allocate(size, alignment, offset))
+        {
+            CHECK(offset % alignment == 0);
+            CHECK(offset + size <= capacity);
+
+            for (const LiveAllocation& live : liveAllocations)
+                CHECK(offset + size <= live.Offset || live.Offset + live.Size <= offset);
+
+            liveAllocations.push_back({ fenceValue + 1, offset, size });
+        }
+        else
+        {
+            failedCount++;
+        }
+
+        // Submit every few allocations and let the GPU fall behind by a random number of submissions
+        if (std::uniform_int_distribution<uint32_t>(0, 3)(generator) == 0 && !allocator.IsSubmissionQueueFull())
+            allocator.Submit(++fenceValue);
+
+        if (std::uniform_int_distribution<uint32_t>(0, 4)(generator) == 0 || allocator.IsSubmissionQueueFull())
+            completedFenceValue = std::uniform_int_distribution<uint64_t>(completedFenceValue, fenceValue)(generator);
+
+        allocator.Release(completedFenceValue);
+        while (!liveAllocations.empty() && liveAllocations.front().Fence <= completedFenceValue)
+            liveAllocations.pop_front();
+    }
+
+    // Allocations made after the last submission belong to the next one
+    allocator.Release(fenceValue);
+    allocator.Submit(++fenceValue);
+    allocator.Release(fenceValue);
+    CHECK(allocator.GetUsedSize() == 0);
+    CHECK(failedCount > 0);
+}